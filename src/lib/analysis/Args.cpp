@@ -105,6 +105,10 @@ Args::Ctor()
 
   profflat_computeFinalMetricValues = true;
 
+  prof_nThreads = 1;
+
+  prof_metricColumns = false;
+
   // -------------------------------------------------------
   // Output arguments
   // -------------------------------------------------------
@@ -115,6 +119,7 @@ Args::Ctor()
   db_copySrcFiles   = true;
   out_db_config     = "";
   db_makeMetricDB   = false;
+  db_metricDBAggregate = false;
   db_addStructId    = false;
 
   out_txt           = Analysis_OUT_TXT;
@@ -191,6 +191,13 @@ public:
   // moment this is a sinking ship and not worth the time investment.
   bool profflat_computeFinalMetricValues;
 
+  // Number of threads for reading and merging profiles
+  uint prof_nThreads;
+
+  // Keep the canonical CCT's metrics in columns (Prof::Metric::ColumnStore)
+  // while computing summary metrics
+  bool prof_metricColumns;
+
   // -------------------------------------------------------
   // Output arguments: experiment database output
   // -------------------------------------------------------
@@ -212,6 +219,7 @@ public:
   std::string out_db_config;     // disable: "", stdout: "-"
 
   bool db_makeMetricDB;
+  bool db_metricDBAggregate; // hpcprof-metricdb 01.00: one db per group/rank
   bool db_addStructId;
 
   // -------------------------------------------------------
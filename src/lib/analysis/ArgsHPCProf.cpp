@@ -118,6 +118,8 @@ Options: General:\n\
   -V, --version        Print version information.\n\
   -h, --help           Print this help.\n\
   --debug [<n>]        Debug: use debug level <n>. {1}\n\
+  --threads <n>        Use <n> threads to read and merge measurement\n\
+                       profiles. {1}\n\
 \n\
 Options: Source Code and Static Structure:\n\
   --name <name>, --title <name>\n\
@@ -148,6 +150,10 @@ Options: Metrics:\n\
                        hpcprof-mpi does not compute 'thread'.\n\
   --force-metric       Force hpcprof to show all thread-level metrics,\n\
                        regardless of their number.\n\
+  --metric-columns <yes|no>\n\
+                       Keep summary metrics in per-metric columns while\n\
+                       computing them, which saves memory for sparse\n\
+                       metrics on large CCTs. {no}\n\
 \n\
 Options: Output:\n\
   -o <db-path>, --db <db-path>, --output <db-path>\n\
@@ -157,7 +163,13 @@ Options: Output:\n\
 static const char* usage_details_2 = "\n\
   --metric-db <yes|no>\n\
                        Control whether to generate a thread-level metric\n\
-                       value database for hpcviewer scatter plots. {no}";
+                       value database for hpcviewer scatter plots. {no}\n\
+  --metric-db-aggregate <yes|no>\n\
+                       Write the thread-level metric database as one\n\
+                       sparse file per group and rank (format 01.00)\n\
+                       instead of one dense file per profile. Readers\n\
+                       of the database must understand format 01.00.\n\
+                       {no}";
 
 static const char* usage_details_3 = "\n\
   --remove-redundancy \n\
@@ -201,6 +213,8 @@ CmdLineParser::OptArgDesc Analysis::ArgsHPCProf::optArgs[] = {
      NULL },
   {  0 , "force-metric",    CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
      NULL },
+  {  0 , "metric-columns",  CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     NULL },
 
   // Output options
   { 'o', "output",          CLP::ARG_REQ , CLP::DUPOPT_CLOB, NULL,
@@ -209,6 +223,8 @@ CmdLineParser::OptArgDesc Analysis::ArgsHPCProf::optArgs[] = {
      NULL },
   {  0 , "metric-db",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
      NULL },
+  {  0 , "metric-db-aggregate", CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     NULL },
   {  0 , "struct-id",       CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
      NULL },
 
@@ -221,6 +237,8 @@ CmdLineParser::OptArgDesc Analysis::ArgsHPCProf::optArgs[] = {
      NULL },
   { 0, "remove-redundancy", CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
      NULL },
+  {  0 , "threads",         CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     NULL },
   {  0 , "debug",           CLP::ARG_OPT,  CLP::DUPOPT_CLOB, NULL,  // hidden
      CLP::isOptArg_long },
   CmdLineParser_OptArgDesc_NULL_MACRO // SGI's compiler requires this version
@@ -377,6 +395,14 @@ ArgsHPCProf::parse(int argc, const char* const argv[], AppType type)
       }
       Diagnostics_SetDiagnosticFilterLevel(verb);
     }
+    if (parser.isOpt("threads")) {
+      const string& arg = parser.getOptArg("threads");
+      long nThreads = CmdLineParser::toLong(arg);
+      if (nThreads < 1) {
+	ARG_ERROR("--threads option requires a positive integer");
+      }
+      prof_nThreads = (uint)nThreads;
+    }
 
     // Check for agent options
     if (parser.isOpt("agent-cilk")) {
@@ -452,6 +478,11 @@ ArgsHPCProf::parse(int argc, const char* const argv[], AppType type)
       }
     }
     // N.B.: hpcprof checks for "force-metric": src/tool/hpcprof/Args.cpp
+    if (parser.isOpt("metric-columns")) {
+      const string& arg = parser.getOptArg("metric-columns");
+      prof_metricColumns =
+	CmdLineParser::parseArg_bool(arg, "--metric-columns option");
+    }
     
     // Check for other options: Output options
     bool isDbDirSet = false;
@@ -467,6 +498,11 @@ ArgsHPCProf::parse(int argc, const char* const argv[], AppType type)
       const string& arg = parser.getOptArg("metric-db");
       db_makeMetricDB = CmdLineParser::parseArg_bool(arg, "--metric-db option");
     }
+    if (parser.isOpt("metric-db-aggregate")) {
+      const string& arg = parser.getOptArg("metric-db-aggregate");
+      db_metricDBAggregate =
+	CmdLineParser::parseArg_bool(arg, "--metric-db-aggregate option");
+    }
     if (parser.isOpt("struct-id")) {
       db_addStructId = true;
     }
@@ -68,9 +68,12 @@ using std::dec;
 #include <string>
 using std::string;
 
+#include <algorithm>
 #include <climits>
 #include <cstring>
+#include <exception>
 #include <map>
+#include <set>
 #include <vector>
 
 #include <typeinfo>
@@ -132,17 +135,174 @@ namespace Analysis {
 namespace CallPath {
 
 
+// Profiles are read (and, when possible, merged) in batches of
+// 'ReadBatchFactor * nThreads' files so that at most one batch of
+// unmerged profiles is resident at a time.
+static const uint ReadBatchFactor = 4;
+
+static Prof::CallPath::Profile*
+readSerial(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
+	   int mergeTy, uint rFlags, uint mrgFlags);
+
+static bool
+isTreeMergeable(const Prof::CallPath::Profile* prof,
+		const std::vector<Prof::CallPath::Profile*>& batch,
+		int mergeTy, std::set<string>& metricNms);
+
+// the sample count and mean period of each metric of a profile, by
+// position (cf. Prof::Metric::Mgr::mergePerfEventStatistics())
+typedef std::vector<std::pair<uint64_t, float> > PerfEventStats;
+
+static void
+getPerfEventStats(const Prof::Metric::Mgr* mMgr, PerfEventStats& stats);
+
+static void
+mergePerfEventStats(Prof::Metric::Mgr* mMgr, const PerfEventStats& stats);
+
+
 Prof::CallPath::Profile*
 read(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
-     int mergeTy, uint rFlags, uint mrgFlags)
+     int mergeTy, uint rFlags, uint mrgFlags, uint nThreads)
 {
   // Special case
   if (profileFiles.empty()) {
     Prof::CallPath::Profile* prof = Prof::CallPath::Profile::make(rFlags);
     return prof;
   }
-  
-  // General case
+
+  if (nThreads <= 1) {
+    return readSerial(profileFiles, groupMap, mergeTy, rFlags, mrgFlags);
+  }
+
+  // General case: read each batch in parallel and then merge it into
+  // 'prof'.  The result must be identical to readSerial(), which
+  // merges profile i+1 into the merge of [0, i].
+  //
+  // - If the batch meets the conditions of isTreeMergeable(),
+  //   Profile::merge is associative over it and the batch is merged
+  //   with a pairwise tree reduction.
+  // - Otherwise, the batch is merged in file order.
+  Prof::CallPath::Profile* prof = NULL;
+  std::set<string> metricNms; // unique metric names within 'prof'
+
+  uint batchSz = ReadBatchFactor * nThreads;
+
+  for (uint beg = 0; beg < profileFiles.size(); beg += batchSz) {
+    int end = (int)std::min<size_t>(beg + batchSz, profileFiles.size());
+    std::vector<Prof::CallPath::Profile*> batch(end - beg, NULL);
+
+    // -------------------------------------------------------
+    // 1. Read
+    // -------------------------------------------------------
+    std::exception_ptr err;
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads)
+    for (int i = beg; i < end; ++i) {
+      try {
+	uint groupId = (groupMap) ? (*groupMap)[i] : 0;
+	batch[i - beg] = read(profileFiles[i], groupId, rFlags);
+      }
+      catch (...) {
+#pragma omp critical (Analysis_CallPath_read)
+	if (!err) { err = std::current_exception(); }
+      }
+    }
+
+    if (err) {
+      for (uint i = 0; i < batch.size(); ++i) {
+	delete batch[i];
+      }
+      delete prof;
+      std::rethrow_exception(err);
+    }
+
+    // Concurrent reads draw node ids from one interleaved sequence.
+    // Renumber each profile in file order so that ids, and therefore
+    // the tie-breaks of ANodeSortedIterator::cmpByStructureInfo (cf.
+    // makeDensePreorderIds), are ordered as in readSerial().
+    for (uint i = 0; i < batch.size(); ++i) {
+      batch[i]->cct()->renumberUniqueIds();
+    }
+
+    // -------------------------------------------------------
+    // 2. Merge
+    // -------------------------------------------------------
+    if (!prof) {
+      prof = batch[0];
+      batch.erase(batch.begin());
+      for (uint i = 0; i < prof->metricMgr()->size(); ++i) {
+	metricNms.insert(prof->metricMgr()->metric(i)->name());
+      }
+    }
+
+    if (isTreeMergeable(prof, batch, mergeTy, metricNms)) {
+      // N.B.: as in readSerial(), each profile's statistics are added
+      // by position to the merged profile, which must already hold the
+      // metrics the merge appends; so they are applied after the
+      // reduction.  The batch profiles do not survive it.
+      std::vector<PerfEventStats> batchStats(batch.size());
+      for (uint i = 0; i < batch.size(); ++i) {
+	getPerfEventStats(batch[i]->metricMgr(), batchStats[i]);
+      }
+
+      batch.insert(batch.begin(), prof);
+      int n = batch.size();
+
+      for (int stride = 1; stride < n; stride *= 2) {
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads)
+	for (int i = 0; i < n - stride; i += 2 * stride) {
+	  try {
+	    batch[i]->merge(*batch[i + stride], mergeTy, mrgFlags);
+	  }
+	  catch (...) {
+#pragma omp critical (Analysis_CallPath_read)
+	    if (!err) { err = std::current_exception(); }
+	  }
+	  delete batch[i + stride];
+	  batch[i + stride] = NULL;
+	}
+	if (err) {
+	  for (int i = 0; i < n; ++i) {
+	    delete batch[i];
+	  }
+	  std::rethrow_exception(err);
+	}
+      }
+
+      for (uint i = 0; i < batchStats.size(); ++i) {
+	mergePerfEventStats(prof->metricMgr(), batchStats[i]);
+      }
+    }
+    else {
+      for (uint i = 0; i < batch.size(); ++i) {
+	Prof::CallPath::Profile* p = batch[i];
+	prof->merge(*p, mergeTy, mrgFlags);
+
+	prof->metricMgr()->mergePerfEventStatistics(p->metricMgr());
+	delete p;
+      }
+
+      metricNms.clear();
+      for (uint i = 0; i < prof->metricMgr()->size(); ++i) {
+	metricNms.insert(prof->metricMgr()->metric(i)->name());
+      }
+    }
+  }
+
+  // add the directories into the set of directories
+  for (uint i = 0; i < profileFiles.size(); ++i) {
+    prof->addDirectory(profileFiles[i]);
+  }
+  prof->metricMgr()->mergePerfEventStatistics_finalize(profileFiles.size());
+
+  return prof;
+}
+
+
+static Prof::CallPath::Profile*
+readSerial(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
+	   int mergeTy, uint rFlags, uint mrgFlags)
+{
   uint groupId = (groupMap) ? (*groupMap)[0] : 0;
   Prof::CallPath::Profile* prof = read(profileFiles[0], groupId, rFlags);
 
@@ -166,6 +326,84 @@ read(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
 }
 
 
+// isTreeMergeable: Returns true if merging 'batch' into 'prof' with a
+// tree reduction yields the same profile as merging it in order.
+// This holds when
+// - no profile has a trace: otherwise each merge rewrites the trace
+//   file of its right operand with respect to its left operand; and
+// - every profile contributes new metrics that are distinct by name
+//   from all others: then each merge appends its right operand's
+//   metrics (Merge_CreateMetric) and metric values are never summed,
+//   so neither metric order nor floating-point rounding depends on
+//   the shape of the reduction.
+// This is the common case for hpcprof, where metric names carry a
+// [rank,thread] suffix.  On success, 'metricNms' is updated with the
+// names of the batch's metrics.
+static bool
+isTreeMergeable(const Prof::CallPath::Profile* prof,
+		const std::vector<Prof::CallPath::Profile*>& batch,
+		int mergeTy, std::set<string>& metricNms)
+{
+  using Prof::CallPath::Profile;
+
+  if (mergeTy != Profile::Merge_CreateMetric
+      && mergeTy != Profile::Merge_MergeMetricByName) {
+    return false;
+  }
+
+  if (!prof->traceFileNameSet().empty()) {
+    return false;
+  }
+
+  std::set<string> batchNms;
+  for (uint i = 0; i < batch.size(); ++i) {
+    const Profile* p = batch[i];
+    if (!p->traceFileNameSet().empty()) {
+      return false;
+    }
+    for (uint j = 0; j < p->metricMgr()->size(); ++j) {
+      const string& nm = p->metricMgr()->metric(j)->name();
+      if (metricNms.find(nm) != metricNms.end()
+	  || !batchNms.insert(nm).second) {
+	return false;
+      }
+    }
+  }
+
+  metricNms.insert(batchNms.begin(), batchNms.end());
+  return true;
+}
+
+
+static void
+getPerfEventStats(const Prof::Metric::Mgr* mMgr, PerfEventStats& stats)
+{
+  stats.resize(mMgr->size());
+  for (uint i = 0; i < mMgr->size(); ++i) {
+    const Prof::Metric::ADesc* m = mMgr->metric(i);
+    stats[i] = std::make_pair(m->num_samples(), m->periodMean());
+  }
+}
+
+
+// mergePerfEventStats: as Metric::Mgr::mergePerfEventStatistics() with
+// the source's statistics in 'stats'
+static void
+mergePerfEventStats(Prof::Metric::Mgr* mMgr, const PerfEventStats& stats)
+{
+  DIAG_Assert(stats.size() <= mMgr->size(), DIAG_UnexpectedInput);
+  for (uint i = 0; i < stats.size(); ++i) {
+    Prof::Metric::ADesc* m = mMgr->metric(i);
+
+    uint64_t samples = m->num_samples() + stats[i].first;
+    uint64_t period  = m->periodMean() + stats[i].second;
+
+    m->num_samples(samples);
+    m->periodMean (period);
+  }
+}
+
+
 Prof::CallPath::Profile*
 read(const char* prof_fnm, uint groupId, uint rFlags)
 {
@@ -1275,6 +1513,10 @@ write(Prof::CallPath::Profile& prof, std::ostream& os,
     oFlags |= CCT::Tree::OFlg_StructId;
   }
 
+  if (args.db_metricDBAggregate) {
+    oFlags |= CCT::Tree::OFlg_MetricDBAggregate;
+  }
+
   uint metricBegId = 0;
   uint metricEndId = prof.metricMgr()->size();
 
@@ -1323,4 +1565,117 @@ write(Prof::CallPath::Profile& prof, std::ostream& os,
 } // namespace Analysis
 
 //***************************************************************************
+// unit test
+//***************************************************************************
+
+// Writes synthetic profiles, reads them both serially and with several
+// threads (Analysis::CallPath::read) and checks that the two merged
+// profiles produce identical experiment.xml text after
+// makeDensePreorderIds().  Each profile is a random tree over a small
+// set of call sites, so profiles overlap.  Sibling call sites that
+// differ only in their lush path length are ordered solely by node id
+// (cf. cmpByStructureInfo).  Profiles are written once with distinct
+// metric names ([rank,thread] suffixes: the tree reduction) and once
+// with equal names (the in-order merge), and a third time with
+// distinct names and a different number of metrics per profile, so
+// that later profiles have more metrics than the first (the sample
+// and period statistics, in experiment.xml, are merged by position).
+//
+// build with UNIT_TEST defined, linking lib/analysis, lib/prof,
+// lib/profxml, lib/xml, lib/support and lib/prof-lean.
+
+// #define UNIT_TEST
+#ifdef UNIT_TEST
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+#include <unistd.h>
+
+#include <lib/prof/CallPath-TestProfile.hpp>
+
+static void
+writeTestProfile(const string& fnm, uint seed, uint numNodes, bool doSfx,
+		 uint numMetrics)
+{
+  Prof::CallPath::TestProfileOpts opts;
+  opts.numNodes = numNodes;
+  opts.numMetrics = numMetrics;
+  opts.shapeSeed = seed;
+  opts.valueSeed = seed;
+  opts.isOverlapping = true;
+  if (doSfx) {
+    opts.mpiRank = seed / 4;
+    opts.tid = seed % 4;
+  }
+
+  FILE* fs = fopen(fnm.c_str(), "w");
+  Prof::CallPath::writeTestProfile(fs, opts);
+  fclose(fs);
+}
+
+
+static string
+writeTestOutput(Prof::CallPath::Profile& prof)
+{
+  prof.cct()->makeDensePreorderIds();
+
+  Analysis::Args args;
+  std::ostringstream os;
+  Analysis::CallPath::write(prof, os, args);
+  return os.str();
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  const uint numProfiles = 40, numNodes = 2000;
+  uint nThreads = (argc > 1) ? atoi(argv[1]) : 4;
+
+  char dirTpl[] = "/tmp/callpath-read-XXXXXX";
+  string dir = mkdtemp(dirTpl);
+
+  const char* passNms[] = { "distinct", "equal", "varying" };
+
+  int nErr = 0;
+  for (int pass = 0; pass < 3; ++pass) {
+    bool doSfx = (pass != 1);
+    Analysis::Util::StringVec files;
+    for (uint i = 0; i < numProfiles; ++i) {
+      uint numMetrics = (pass == 2) ? 1 + i % 4 : 2;
+      files.push_back(dir + "/p-" + StrUtil::toStr(i) + ".hpcrun");
+      writeTestProfile(files.back(), i, numNodes, doSfx, numMetrics);
+    }
+
+    using Prof::CallPath::Profile;
+    int mergeTy = Profile::Merge_MergeMetricByName;
+
+    Profile* prof1 = Analysis::CallPath::read(files, NULL, mergeTy, 0, 0, 1);
+    string out1 = writeTestOutput(*prof1);
+    delete prof1;
+
+    Profile* profN = Analysis::CallPath::read(files, NULL, mergeTy, 0, 0,
+					      nThreads);
+    string outN = writeTestOutput(*profN);
+    delete profN;
+
+    bool isEq = (out1 == outN);
+    printf("%s metric names, %u threads: %s (%zu bytes)\n",
+	   passNms[pass], nThreads,
+	   isEq ? "identical" : "DIFFERENT", out1.size());
+    if (!isEq) {
+      nErr++;
+    }
+
+    for (uint i = 0; i < files.size(); ++i) {
+      unlink(files[i].c_str());
+    }
+  }
+  rmdir(dir.c_str());
+
+  return nErr;
+}
 
+#endif // UNIT_TEST
@@ -94,9 +94,13 @@ extern std::ostream* dbgOs; // for parallel debugging
 //
 // ---------------------------------------------------------
 
+// read: Read and merge 'profileFiles'.  If 'nThreads' > 1, profiles
+// are read concurrently and, when the merge order cannot affect the
+// result, merged with a tree reduction; the result is always identical
+// to that of a serial (file order) merge.
 Prof::CallPath::Profile*
 read(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
-     int mergeTy, uint rFlags = 0, uint mrgFlags = 0);
+     int mergeTy, uint rFlags = 0, uint mrgFlags = 0, uint nThreads = 1);
 
 Prof::CallPath::Profile*
 read(const char* prof_fnm, uint groupId, uint rFlags = 0);
@@ -63,6 +63,11 @@
 #include <string>
 using std::string;
 
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 
@@ -125,6 +130,57 @@ Analysis::Raw::writeAsText_callpath(const char* filenm)
 }
 
 
+static void
+writeAsText_callpathMetricDB_sparse(const hpcmetricDB_fmt_hdr_t& hdr,
+				    FILE* fs, const char* filenm)
+{
+  // read table of contents
+  if (fseeko(fs, hdr.tocOffset, SEEK_SET) != 0) {
+    DIAG_Throw("error reading metric-db file '" << filenm << "'");
+  }
+
+  std::vector<hpcmetricDB_fmt_tocEntry_t> toc(hdr.numProfiles);
+  for (uint i = 0; i < hdr.numProfiles; ++i) {
+    int ret = hpcmetricDB_fmt_tocEntry_fread(&toc[i], fs, malloc);
+    if (ret != HPCFMT_OK) {
+      DIAG_Throw("error reading metric-db file '" << filenm << "'");
+    }
+  }
+
+  // read each profile: metric index, then (node-id, value) pairs
+  for (uint i = 0; i < hdr.numProfiles; ++i) {
+    hpcmetricDB_fmt_tocEntry_t& entry = toc[i];
+    hpcmetricDB_fmt_tocEntry_fprint(&entry, stdout);
+
+    std::vector<uint64_t> idx(entry.numMetrics + 1);
+
+    int ret = HPCFMT_ERR;
+    if (fseeko(fs, entry.offset, SEEK_SET) == 0) {
+      ret = hpcmetricDB_fmt_idx_fread(&idx[0], entry.numMetrics, fs);
+    }
+    if (ret != HPCFMT_OK) {
+      DIAG_Throw("error reading metric-db file '" << filenm << "'");
+    }
+
+    for (uint mId = 0; mId < entry.numMetrics; ++mId) {
+      fprintf(stdout, "  (metric %u: ", mId);
+      for (uint64_t j = idx[mId]; j < idx[mId + 1]; ++j) {
+	uint32_t nodeId = 0;
+	double mval = 0;
+	ret = hpcmetricDB_fmt_value_fread(&nodeId, &mval, fs);
+	if (ret != HPCFMT_OK) {
+	  DIAG_Throw("error reading metric-db file '" << filenm << "'");
+	}
+	fprintf(stdout, "(%u: %g) ", nodeId, mval);
+      }
+      fprintf(stdout, ")\n");
+    }
+
+    hpcmetricDB_fmt_tocEntry_free(&entry, free);
+  }
+}
+
+
 void
 Analysis::Raw::writeAsText_callpathMetricDB(const char* filenm)
 {
@@ -144,17 +200,22 @@ Analysis::Raw::writeAsText_callpathMetricDB(const char* filenm)
 
     hpcmetricDB_fmt_hdr_fprint(&hdr, stdout);
 
-    for (uint nodeId = 1; nodeId < hdr.numNodes + 1; ++nodeId) {
-      fprintf(stdout, "(%6u: ", nodeId);
-      for (uint mId = 0; mId < hdr.numMetrics; ++mId) {
-	double mval = 0;
-	ret = hpcfmt_real8_fread(&mval, fs);
-	if (ret != HPCFMT_OK) {
-	  DIAG_Throw("error reading trace file '" << filenm << "'");
+    if (hdr.version < HPCMETRICDB_FMT_Version_10) {
+      for (uint nodeId = 1; nodeId < hdr.numNodes + 1; ++nodeId) {
+	fprintf(stdout, "(%6u: ", nodeId);
+	for (uint mId = 0; mId < hdr.numMetrics; ++mId) {
+	  double mval = 0;
+	  ret = hpcfmt_real8_fread(&mval, fs);
+	  if (ret != HPCFMT_OK) {
+	    DIAG_Throw("error reading metric-db file '" << filenm << "'");
+	  }
+	  fprintf(stdout, "%12g ", mval);
 	}
-	fprintf(stdout, "%12g ", mval);
+	fprintf(stdout, ")\n");
       }
-      fprintf(stdout, ")\n");
+    }
+    else {
+      writeAsText_callpathMetricDB_sparse(hdr, fs, filenm);
     }
 
     hpcio_fclose(fs);
@@ -189,7 +250,7 @@ Analysis::Raw::writeAsText_callpathTrace(const char* filenm)
     // Read trace records and exit on EOF
     while ( !feof(fs) ) {
       hpctrace_fmt_datum_t datum;
-      ret = hpctrace_fmt_datum_fread(&datum, hdr.flags, fs);
+      ret = hpctrace_fmt_datum_fread(&datum, &hdr, fs);
       if (ret == HPCFMT_EOF) {
 	break;
       }
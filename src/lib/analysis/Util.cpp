@@ -68,6 +68,7 @@ using std::string;
 #include <typeinfo>
 
 #include <cstring> // strlen()
+#include <climits> // PATH_MAX
 
 #include <dirent.h> // scandir()
 
@@ -81,6 +82,7 @@ using std::string;
 #include <lib/banal/StructSimple.hpp>
 
 #include <lib/prof-lean/hpcio.h>
+#include <lib/prof-lean/hpcio-pack.h>
 #include <lib/prof-lean/hpcfmt.h>
 #include <lib/prof-lean/hpcrun-fmt.h>
 #include <lib/prof-lean/hpcrunflat-fmt.h>
@@ -115,8 +117,67 @@ hpcrunFileFilter(const struct dirent* entry)
 {
   static const string ext = string(".") + HPCRUN_ProfileFnmSfx;
   static const uint extLen = ext.length();
+  static const string extPack = string(".") + HPCIO_PACK_FnmSfx;
+  static const uint extPackLen = extPack.length();
 
-  return fileExtensionFilter(entry, ext, extLen);
+  return (fileExtensionFilter(entry, ext, extLen)
+	  || fileExtensionFilter(entry, extPack, extPackLen));
+}
+
+
+static bool
+isPackFile(const string& fnm)
+{
+  static const string ext = string(".") + HPCIO_PACK_FnmSfx;
+
+  return (fnm.length() > ext.length()
+	  && fnm.compare(fnm.length() - ext.length(), ext.length(), ext) == 0);
+}
+
+
+// hpcio_pack_foreach() callback: collects the profile members of a
+// pack as "<pack-file>/<member-name>".
+struct PackProfiles {
+  const string* packFnm;
+  Analysis::Util::StringVec* paths;
+};
+
+static void
+addPackProfile(const char* name, uint64_t GCC_ATTR_UNUSED size, void* arg)
+{
+  static const string ext = string(".") + HPCRUN_ProfileFnmSfx;
+
+  PackProfiles* pp = static_cast<PackProfiles*>(arg);
+  string nm = name;
+  if (nm.length() > ext.length()
+      && nm.compare(nm.length() - ext.length(), ext.length(), ext) == 0) {
+    pp->paths->push_back(*pp->packFnm + "/" + nm);
+  }
+}
+
+
+// Adds 'fnm' to 'out' in the current group, or the profiles inside it
+// if it is a pack file (HPCRUN_PACK).
+static void
+addProfilePath(Analysis::Util::NormalizeProfileArgs_t& out, const string& fnm)
+{
+  Analysis::Util::StringVec nms;
+  if (isPackFile(fnm)) {
+    PackProfiles pp = { &fnm, &nms };
+    if (hpcio_pack_foreach(fnm.c_str(), addPackProfile, &pp) < 0) {
+      DIAG_Throw("could not read pack file: " << fnm);
+    }
+  }
+  else {
+    nms.push_back(fnm);
+  }
+
+  for (Analysis::Util::StringVec::const_iterator it = nms.begin();
+       it != nms.end(); ++it) {
+    out.paths->push_back(*it);
+    out.pathLenMax = std::max(out.pathLenMax, (uint)it->length());
+    out.groupMap->push_back(out.groupMax);
+  }
 }
 
 
@@ -145,9 +206,19 @@ getProfileType(const std::string& filenm)
   static const int bufSZ = 32;
   char buf[bufSZ] = { '\0' };
 
-  std::istream* is = IOUtil::OpenIStream(filenm.c_str());
-  is->read(buf, bufSZ);
-  IOUtil::CloseStream(is);
+  if (hpcio_pack_member_name(filenm.c_str())) {
+    // a member of a pack file (HPCRUN_PACK)
+    FILE* fs = hpcio_fopen_r(filenm.c_str());
+    if (fs) {
+      size_t GCC_ATTR_UNUSED n = fread(buf, 1, bufSZ, fs);
+      hpcio_fclose(fs);
+    }
+  }
+  else {
+    std::istream* is = IOUtil::OpenIStream(filenm.c_str());
+    is->read(buf, bufSZ);
+    IOUtil::CloseStream(is);
+  }
   
   ProfType_t ty = ProfType_NULL;
   if (strncmp(buf, HPCRUN_FMT_Magic, HPCRUN_FMT_MagicLen) == 0) {
@@ -202,9 +273,7 @@ normalizeProfileArgs(const StringVec& inPaths)
         for (int i = 0; i < dirEntriesSz; ++i) {
           string nm = path + dirEntries[i]->d_name;
           free(dirEntries[i]);
-          out.paths->push_back(nm);
-          out.pathLenMax = std::max(out.pathLenMax, (uint)nm.length());
-          out.groupMap->push_back(out.groupMax);
+          addProfilePath(out, nm);
         }
         free(dirEntries);
       }
@@ -212,9 +281,7 @@ normalizeProfileArgs(const StringVec& inPaths)
     }
     else {
       out.groupMax++; // obtain next group;
-      out.paths->push_back(path);
-      out.pathLenMax = std::max(out.pathLenMax, (uint)path.length());
-      out.groupMap->push_back(out.groupMax);
+      addProfilePath(out, path);
     }
   }
 
@@ -611,14 +678,27 @@ void
 copyTraceFiles(const std::string& dstDir, const std::set<string>& srcFiles)
 {
   bool tryMove = true;
+  std::set<string> packsDone;
 
   for (std::set<string>::iterator it = srcFiles.begin();
        it != srcFiles.end(); ++it) {
 
     const string& x = *it;
 
-    const string  srcFnm1 = x + "." + HPCPROF_TmpFnmSfx;
-    const string& srcFnm2 = x;
+    // A trace in a pack file (HPCRUN_PACK) is "<pack-file>/<member>".
+    // Its rewritten trace.tmp sits next to the pack and moves into
+    // the database as an individual file, else the whole pack is
+    // copied (once) and hpcserver finds the trace inside it.
+    const char* member = hpcio_pack_member_name(x.c_str());
+    char unpackedFnm[PATH_MAX];
+    if (hpcio_pack_unpacked_name(x.c_str(), unpackedFnm,
+				 sizeof(unpackedFnm)) != 0) {
+      DIAG_EMsg("Trace file name too long: '" << x << "'");
+      continue;
+    }
+
+    const string  srcFnm1 = string(unpackedFnm) + "." + HPCPROF_TmpFnmSfx;
+    const string  srcFnm2 = (member) ? x.substr(0, member - x.c_str() - 1) : x;
     const string  dstFnm = dstDir + "/" + FileUtil::basename(x);
 
     // Note: the source and destination directories may be on
@@ -652,15 +732,19 @@ copyTraceFiles(const std::string& dstDir, const std::set<string>& srcFiles)
 	}
       }
     }
+    else if (member && !packsDone.insert(srcFnm2).second) {
+      // pack already copied
+    }
     else {
       // no trace.tmp file: always copy (keep original)
+      const string dstFnm2 = dstDir + "/" + FileUtil::basename(srcFnm2);
       try {
-	DIAG_Msg(2, "trace (cp): '" << srcFnm2 << "' -> '" << dstFnm << "'");
-	FileUtil::copy(dstFnm, srcFnm2);
+	DIAG_Msg(2, "trace (cp): '" << srcFnm2 << "' -> '" << dstFnm2 << "'");
+	FileUtil::copy(dstFnm2, srcFnm2);
       }
       catch (const Diagnostics::Exception& ex) {
 	DIAG_EMsg("While copying trace files ['"
-		  << srcFnm2 << "' -> '" << dstFnm << "']:" << ex.message());
+		  << srcFnm2 << "' -> '" << dstFnm2 << "']:" << ex.message());
       }
     }
   }
@@ -0,0 +1,506 @@
+//******************************************************************************
+// macros
+//******************************************************************************
+
+#define UNIT_TEST 0
+
+#define HASHTABLE_INITIAL_CAPACITY 64
+
+// 2^64 / golden ratio: multiplicative (fibonacci) hashing spreads the
+// dense, monotonically increasing ids typical of runtime correlation
+// ids across the table
+#define HASHTABLE_MULTIPLIER 0x9e3779b97f4a7c15ULL
+
+
+
+//******************************************************************************
+// global includes
+//******************************************************************************
+
+#include <string.h>
+
+
+
+//******************************************************************************
+// local includes
+//******************************************************************************
+
+#include "hashtable-uint64.h"
+
+
+
+//******************************************************************************
+// private operations
+//******************************************************************************
+
+static inline uint64_t
+hashtable_index
+(
+ hashtable_uint64_t *table,
+ uint64_t key
+)
+{
+  return (key * HASHTABLE_MULTIPLIER) >> table->shift;
+}
+
+
+static unsigned int
+hashtable_log2
+(
+ uint64_t capacity
+)
+{
+  unsigned int log2 = 0;
+  while (capacity > 1) {
+    capacity >>= 1;
+    log2++;
+  }
+  return log2;
+}
+
+
+// place node in the first free slot of its probe sequence.
+// pre-condition: key is not present and the table has a free slot
+static void
+hashtable_place
+(
+ hashtable_uint64_t *table,
+ uint64_t key,
+ hashtable_uint64_node_t *node
+)
+{
+  uint64_t mask = table->capacity - 1;
+  uint64_t i = hashtable_index(table, key);
+
+  while (table->slots[i].node) {
+    i = (i + 1) & mask;
+  }
+
+  table->slots[i].key = key;
+  table->slots[i].node = node;
+}
+
+
+static bool
+hashtable_resize
+(
+ hashtable_uint64_t *table,
+ uint64_t capacity
+)
+{
+  size_t bytes = capacity * sizeof(hashtable_uint64_slot_t);
+  hashtable_uint64_slot_t *slots = (hashtable_uint64_slot_t *) table->alloc(bytes);
+  if (slots == NULL) return false;
+
+  memset(slots, 0, bytes);
+
+  hashtable_uint64_slot_t *old_slots = table->slots;
+  uint64_t old_capacity = table->capacity;
+
+  table->slots = slots;
+  table->capacity = capacity;
+  table->shift = 64 - hashtable_log2(capacity);
+
+  for (uint64_t i = 0; i < old_capacity; i++) {
+    if (old_slots[i].node) {
+      hashtable_place(table, old_slots[i].key, old_slots[i].node);
+    }
+  }
+
+  if (old_slots && table->free) table->free(old_slots);
+
+  return true;
+}
+
+
+// return the index of the slot holding key, or -1 if key is absent
+static int64_t
+hashtable_find
+(
+ hashtable_uint64_t *table,
+ uint64_t key
+)
+{
+  if (table->count == 0) return -1;
+
+  uint64_t mask = table->capacity - 1;
+  uint64_t i = hashtable_index(table, key);
+
+  for (;;) {
+    hashtable_uint64_slot_t *slot = &table->slots[i];
+    if (slot->node == NULL) return -1;
+    if (slot->key == key) return i;
+    i = (i + 1) & mask;
+  }
+}
+
+
+
+//******************************************************************************
+// interface operations
+//******************************************************************************
+
+bool
+hashtable_uint64_insert
+(
+ hashtable_uint64_t *table,
+ hashtable_uint64_node_t *node
+)
+{
+  if (hashtable_find(table, node->key) >= 0) return false;
+
+  // keep the load factor at or below 1/2 so that probe sequences stay short
+  if (2 * (table->count + 1) > table->capacity) {
+    uint64_t capacity =
+      table->capacity ? 2 * table->capacity : HASHTABLE_INITIAL_CAPACITY;
+    if (!hashtable_resize(table, capacity)) return false;
+  }
+
+  node->next = NULL;
+  hashtable_place(table, node->key, node);
+  table->count++;
+
+  return true;
+}
+
+
+hashtable_uint64_node_t *
+hashtable_uint64_lookup
+(
+ hashtable_uint64_t *table,
+ uint64_t key
+)
+{
+  int64_t i = hashtable_find(table, key);
+  return (i < 0) ? NULL : table->slots[i].node;
+}
+
+
+hashtable_uint64_node_t *
+hashtable_uint64_delete
+(
+ hashtable_uint64_t *table,
+ uint64_t key
+)
+{
+  int64_t found = hashtable_find(table, key);
+  if (found < 0) return NULL;
+
+  hashtable_uint64_node_t *node = table->slots[found].node;
+
+  // backward-shift deletion: walk the cluster after the hole and move
+  // back each entry whose home slot does not lie between the hole and
+  // its current position
+  uint64_t mask = table->capacity - 1;
+  uint64_t hole = found;
+  uint64_t j = found;
+
+  for (;;) {
+    j = (j + 1) & mask;
+    hashtable_uint64_slot_t *slot = &table->slots[j];
+    if (slot->node == NULL) break;
+
+    uint64_t home = hashtable_index(table, slot->key);
+    if (((j - home) & mask) >= ((j - hole) & mask)) {
+      table->slots[hole] = *slot;
+      hole = j;
+    }
+  }
+
+  table->slots[hole].node = NULL;
+  table->count--;
+
+  return node;
+}
+
+
+void
+hashtable_uint64_forall
+(
+ hashtable_uint64_t *table,
+ hashtable_fn_t fn,
+ void *arg
+)
+{
+  for (uint64_t i = 0; i < table->capacity; i++) {
+    if (table->slots[i].node) fn(table->slots[i].node, arg);
+  }
+}
+
+
+uint64_t
+hashtable_uint64_count
+(
+ hashtable_uint64_t *table
+)
+{
+  return table->count;
+}
+
+
+hashtable_uint64_node_t *
+hashtable_uint64_node_alloc
+(
+ hashtable_uint64_t *table,
+ hashtable_uint64_node_t **free_list,
+ size_t size
+)
+{
+  hashtable_uint64_node_t *first = *free_list;
+
+  if (first) {
+    *free_list = first->next;
+  } else {
+    first = (hashtable_uint64_node_t *) table->alloc(size);
+  }
+
+  memset(first, 0, size);
+
+  return first;
+}
+
+
+void
+hashtable_uint64_node_free
+(
+ hashtable_uint64_node_t **free_list,
+ hashtable_uint64_node_t *node
+)
+{
+  node->next = *free_list;
+  *free_list = node;
+}
+
+
+
+//******************************************************************************
+// unit test
+//
+// replays a recorded sequence of map operations against both this table
+// and splay-uint64 and reports the cost per operation. a recording is a
+// text file with one operation per line:
+//   i <key>    insert
+//   l <key>    lookup
+//   d <key>    delete
+// without a recording, a sequence shaped like GPU correlation traffic is
+// synthesized: ids are inserted in increasing order at kernel launch,
+// looked up when activity arrives, and deleted slightly out of order.
+//
+// build with UNIT_TEST set to 1:
+//   cc -O2 -I. hashtable-uint64.c splay-uint64.c
+//******************************************************************************
+
+#if UNIT_TEST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "splay-uint64.h"
+
+
+
+#define N 1000000
+
+#define WINDOW 256
+
+
+
+typedef struct op_t {
+  char op;
+  uint64_t key;
+} op_t;
+
+
+typedef struct typed_hashtable_node(int) {
+  struct typed_hashtable_node(int) *next;
+  uint64_t key;
+  long mysquared;
+} typed_hashtable_node(int);
+
+
+typedef struct typed_splay_node(int) {
+  struct typed_splay_node(int) *left;
+  struct typed_splay_node(int) *right;
+  uint64_t key;
+  long mysquared;
+} typed_splay_node(int);
+
+
+typed_hashtable_impl(int)
+
+
+
+static op_t *
+ops_read
+(
+ const char *path,
+ size_t *n_ops
+)
+{
+  FILE *f = fopen(path, "r");
+  if (f == NULL) return NULL;
+
+  size_t n = 0, cap = 1024;
+  op_t *ops = malloc(cap * sizeof(op_t));
+  char op;
+  unsigned long long key;
+
+  while (fscanf(f, " %c %llu", &op, &key) == 2) {
+    if (n == cap) ops = realloc(ops, (cap *= 2) * sizeof(op_t));
+    ops[n].op = op;
+    ops[n].key = key;
+    n++;
+  }
+  fclose(f);
+
+  *n_ops = n;
+  return ops;
+}
+
+
+static op_t *
+ops_synthesize
+(
+ size_t *n_ops
+)
+{
+  // retire ids WINDOW behind the newest, permuted within groups of 4
+  static const uint64_t perm[4] = { 2, 0, 3, 1 };
+
+  op_t *ops = malloc(3 * N * sizeof(op_t));
+  size_t n = 0;
+
+  for (uint64_t id = 0; id < N; id++) {
+    ops[n].op = 'i'; ops[n].key = id; n++;
+    if (id >= WINDOW) {
+      uint64_t r = id - WINDOW;
+      uint64_t victim = (r & ~(uint64_t) 3) | perm[r & 3];
+      ops[n].op = 'l'; ops[n].key = victim; n++;
+      ops[n].op = 'd'; ops[n].key = victim; n++;
+    }
+  }
+
+  *n_ops = n;
+  return ops;
+}
+
+
+static double
+now
+(
+ void
+)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+static uint64_t
+replay_hashtable
+(
+ op_t *ops,
+ size_t n_ops
+)
+{
+  hashtable_uint64_t table = HASHTABLE_UINT64_INITIALIZER(malloc, free);
+  int_hashtable_uint64_node_t *free_list = NULL;
+  uint64_t hits = 0;
+
+  for (size_t k = 0; k < n_ops; k++) {
+    switch (ops[k].op) {
+    case 'i': {
+      int_hashtable_uint64_node_t *node =
+	typed_hashtable_alloc(&table, &free_list, int_hashtable_uint64_node_t);
+      node->key = ops[k].key;
+      node->mysquared = ops[k].key * ops[k].key;
+      if (!int_insert(&table, node)) typed_hashtable_free(&free_list, node);
+      break;
+    }
+    case 'l':
+      hits += (int_lookup(&table, ops[k].key) != NULL);
+      break;
+    case 'd': {
+      int_hashtable_uint64_node_t *node = int_delete(&table, ops[k].key);
+      if (node) typed_hashtable_free(&free_list, node);
+      break;
+    }
+    }
+  }
+
+  return hits;
+}
+
+
+static uint64_t
+replay_splay
+(
+ op_t *ops,
+ size_t n_ops
+)
+{
+  splay_uint64_node_t *root = NULL;
+  int_splay_uint64_node_t *free_list = NULL;
+  uint64_t hits = 0;
+
+  for (size_t k = 0; k < n_ops; k++) {
+    switch (ops[k].op) {
+    case 'i': {
+      int_splay_uint64_node_t *node = free_list;
+      if (node) free_list = node->left;
+      else node = malloc(sizeof(int_splay_uint64_node_t));
+      node->key = ops[k].key;
+      node->mysquared = ops[k].key * ops[k].key;
+      if (!splay_uint64_insert(&root, (splay_uint64_node_t *) node)) {
+	node->left = free_list; free_list = node;
+      }
+      break;
+    }
+    case 'l':
+      hits += (splay_uint64_lookup(&root, ops[k].key) != NULL);
+      break;
+    case 'd': {
+      int_splay_uint64_node_t *node = (int_splay_uint64_node_t *)
+	splay_uint64_delete(&root, ops[k].key);
+      if (node) { node->left = free_list; free_list = node; }
+      break;
+    }
+    }
+  }
+
+  return hits;
+}
+
+
+int
+main
+(
+ int argc,
+ char **argv
+)
+{
+  size_t n_ops = 0;
+  op_t *ops = (argc > 1) ? ops_read(argv[1], &n_ops) : ops_synthesize(&n_ops);
+  if (ops == NULL) {
+    fprintf(stderr, "unable to read recording %s\n", argv[1]);
+    return 1;
+  }
+
+  double t0 = now();
+  uint64_t hhits = replay_hashtable(ops, n_ops);
+  double t1 = now();
+  uint64_t shits = replay_splay(ops, n_ops);
+  double t2 = now();
+
+  printf("%zu operations\n", n_ops);
+  printf("hashtable: %6.1f ns/op (%lu lookup hits)\n",
+	 1e9 * (t1 - t0) / n_ops, hhits);
+  printf("splay:     %6.1f ns/op (%lu lookup hits)\n",
+	 1e9 * (t2 - t1) / n_ops, shits);
+
+  return hhits != shits;
+}
+
+#endif
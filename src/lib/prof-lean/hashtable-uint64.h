@@ -0,0 +1,282 @@
+//******************************************************************************
+// File: hashtable-uint64.h
+//
+// Description:
+//   extensible open-addressing hash table that uses 64-bit unsigned keys
+//
+//   the table maps keys to caller-allocated nodes; slots hold the key
+//   alongside the node pointer so that probing never touches a node
+//   until the key matches. collisions are resolved by linear probing
+//   and deletion shifts displaced entries back, so the table never
+//   accumulates tombstones. the table grows by doubling once it is
+//   half full; it never shrinks.
+//
+//   like splay-uint64, the table is unsynchronized: callers that share
+//   a table between threads must provide their own mutual exclusion.
+//******************************************************************************
+
+#ifndef hashtable_uint64_h
+#define hashtable_uint64_h
+
+
+
+//******************************************************************************
+// global includes
+//******************************************************************************
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+
+
+//******************************************************************************
+// local includes
+//******************************************************************************
+
+#include "mem_manager.h"
+
+
+
+//******************************************************************************
+// type declarations
+//******************************************************************************
+
+typedef struct hashtable_uint64_node_t {
+  struct hashtable_uint64_node_t *next; // free list link; unused in a table
+  uint64_t key;
+} hashtable_uint64_node_t;
+
+
+typedef struct hashtable_uint64_slot_t {
+  uint64_t key;
+  hashtable_uint64_node_t *node;        // NULL if the slot is empty
+} hashtable_uint64_slot_t;
+
+
+typedef void (*hashtable_uint64_mem_free)(void *ptr);
+
+
+typedef struct hashtable_uint64_t {
+  hashtable_uint64_slot_t *slots;
+  uint64_t capacity;                    // power of 2; 0 until first insert
+  uint64_t count;
+  unsigned int shift;                   // 64 - log2(capacity)
+  mem_alloc alloc;                      // allocator for slot arrays
+  hashtable_uint64_mem_free free;       // NULL for arena allocators
+} hashtable_uint64_t;
+
+
+typedef void (*hashtable_fn_t)
+(
+ hashtable_uint64_node_t *node,
+ void *arg
+);
+
+
+
+//*****************************************************************************
+// macros
+//*****************************************************************************
+
+// static initializer for an empty table. slot arrays are obtained from
+// alloc; arrays outgrown by the table are released with free, if any.
+#define HASHTABLE_UINT64_INITIALIZER(alloc, free) \
+  { NULL, 0, 0, 0, alloc, free }
+
+
+#define hashtable_macro_body_ignore(x) ;
+#define hashtable_macro_body_show(x) x
+
+
+// declare typed interface functions
+#define typed_hashtable_declare(type)		\
+  typed_hashtable(type, hashtable_macro_body_ignore)
+
+// implementation of typed interface functions
+#define typed_hashtable_impl(type)			\
+  typed_hashtable(type, hashtable_macro_body_show)
+
+
+// routine name for a hashtable operation
+#define hashtable_op(op) \
+  hashtable_uint64 ## _ ## op
+
+
+#define typed_hashtable_node(type) \
+  type ## _ ## hashtable_uint64_node_t
+
+
+// routine name for a typed hashtable operation
+#define typed_hashtable_op(type, op) \
+  type ## _  ## op
+
+
+// insert routine name for a typed hashtable
+#define typed_hashtable_insert(type) \
+  typed_hashtable_op(type, insert)
+
+// lookup routine name for a typed hashtable
+#define typed_hashtable_lookup(type) \
+  typed_hashtable_op(type, lookup)
+
+// delete routine name for a typed hashtable
+#define typed_hashtable_delete(type) \
+  typed_hashtable_op(type, delete)
+
+// forall routine name for a typed hashtable
+#define typed_hashtable_forall(type) \
+  typed_hashtable_op(type, forall)
+
+// count routine name for a typed hashtable
+#define typed_hashtable_count(type) \
+  typed_hashtable_op(type, count)
+
+
+// allocate a typed node, recycling from free_list when possible
+#define typed_hashtable_alloc(table, free_list, node_type)		\
+  (node_type *) hashtable_uint64_node_alloc				\
+  (table, (hashtable_uint64_node_t **) free_list, sizeof(node_type))
+
+// return a typed node to free_list
+#define typed_hashtable_free(free_list, node)				\
+  hashtable_uint64_node_free						\
+  ((hashtable_uint64_node_t **) free_list,				\
+   (hashtable_uint64_node_t *) node)
+
+
+// define typed wrappers for a hashtable type
+#define typed_hashtable(type, macro) \
+  static bool \
+  typed_hashtable_insert(type) \
+  (hashtable_uint64_t *table, typed_hashtable_node(type) *node)	\
+  macro({ \
+    return hashtable_op(insert)(table, (hashtable_uint64_node_t *) node); \
+  }) \
+\
+  static typed_hashtable_node(type) * \
+  typed_hashtable_lookup(type) \
+  (hashtable_uint64_t *table, uint64_t key) \
+  macro({ \
+    typed_hashtable_node(type) *result = (typed_hashtable_node(type) *) \
+      hashtable_op(lookup)(table, key); \
+    return result; \
+  }) \
+\
+  static typed_hashtable_node(type) * \
+  __attribute__((unused)) /* prevent unused warnings */ \
+  typed_hashtable_delete(type) \
+  (hashtable_uint64_t *table, uint64_t key) \
+  macro({ \
+    typed_hashtable_node(type) *result = (typed_hashtable_node(type) *) \
+      hashtable_op(delete)(table, key); \
+    return result; \
+  }) \
+\
+  static void \
+  __attribute__((unused)) /* prevent unused warnings */ \
+  typed_hashtable_forall(type) \
+  (hashtable_uint64_t *table, void (*fn)(typed_hashtable_node(type) *, void *), void *arg) \
+  macro({ \
+    hashtable_op(forall)(table, (hashtable_fn_t) fn, arg); \
+  }) \
+  static uint64_t \
+  __attribute__((unused)) /* prevent unused warnings */ \
+  typed_hashtable_count(type) \
+  (hashtable_uint64_t *table) \
+  macro({ \
+    return hashtable_op(count)(table); \
+  })
+
+
+
+//******************************************************************************
+// interface operations
+//******************************************************************************
+
+//------------------------------------------------------------------------------
+// inserts node under node->key
+//
+// returns false if node->key already present in table and node not inserted
+//------------------------------------------------------------------------------
+bool
+hashtable_uint64_insert
+(
+ hashtable_uint64_t *table,
+ hashtable_uint64_node_t *node
+);
+
+
+//------------------------------------------------------------------------------
+// look up key in table.
+//
+// returns pointer to node with key, or NULL if key not found
+//------------------------------------------------------------------------------
+hashtable_uint64_node_t *
+hashtable_uint64_lookup
+(
+ hashtable_uint64_t *table,
+ uint64_t key
+);
+
+
+//------------------------------------------------------------------------------
+// returns deleted node with matching key, or NULL if key is not found
+//------------------------------------------------------------------------------
+hashtable_uint64_node_t *
+hashtable_uint64_delete
+(
+ hashtable_uint64_t *table,
+ uint64_t key
+);
+
+
+//------------------------------------------------------------------------------
+// iterates over all nodes in unspecified order and calls fn(node, arg).
+// fn must not insert into or delete from the table.
+//------------------------------------------------------------------------------
+void
+hashtable_uint64_forall
+(
+ hashtable_uint64_t *table,
+ hashtable_fn_t fn,
+ void *arg
+);
+
+
+//------------------------------------------------------------------------------
+// return the number of nodes in the table
+//------------------------------------------------------------------------------
+uint64_t
+hashtable_uint64_count
+(
+ hashtable_uint64_t *table
+);
+
+
+//------------------------------------------------------------------------------
+// return a zeroed node of the given size, taken from free_list if it is
+// not empty and from the table's allocator otherwise
+//------------------------------------------------------------------------------
+hashtable_uint64_node_t *
+hashtable_uint64_node_alloc
+(
+ hashtable_uint64_t *table,
+ hashtable_uint64_node_t **free_list,
+ size_t size
+);
+
+
+//------------------------------------------------------------------------------
+// push node onto free_list for reuse by hashtable_uint64_node_alloc
+//------------------------------------------------------------------------------
+void
+hashtable_uint64_node_free
+(
+ hashtable_uint64_node_t **free_list,
+ hashtable_uint64_node_t *node
+);
+
+
+
+#endif
@@ -72,7 +72,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <string.h>
 #include <inttypes.h>
+#include <endian.h>
 
 
 //*************************** User Include Files ****************************
@@ -201,6 +203,27 @@ hpcfmt_real8_fread(double* val, FILE* infs)
 }
 
 
+// Reads an unsigned LEB128 varint: 7 bits per byte, least significant
+// group first, with the high bit set on every byte but the last.
+static inline int
+hpcfmt_varint_fread(uint64_t* val, FILE* infs)
+{
+  uint64_t x = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int c = getc(infs);
+    if (c == EOF) {
+      return (shift == 0 && feof(infs)) ? HPCFMT_EOF : HPCFMT_ERR;
+    }
+    x |= ((uint64_t)(c & 0x7f)) << shift;
+    if ((c & 0x80) == 0) {
+      *val = x;
+      return HPCFMT_OK;
+    }
+  }
+  return HPCFMT_ERR;
+}
+
+
 //***************************************************************************
 
 static inline int
@@ -257,6 +280,76 @@ hpcfmt_real8_fwrite(double val, FILE* outfs)
 }
 
 
+//***************************************************************************
+// In-memory reader primitives
+//***************************************************************************
+
+// hpcfmt_*_mread: Decode a big-endian value from the in-memory image
+// [*buf, end) of a file (e.g., a memory-mapped file) and advance *buf.
+// Equivalent to the corresponding hpcfmt_*_fread, but without a stdio
+// call per byte.
+
+static inline int
+hpcfmt_mread_check(size_t size, const char* buf, const char* end)
+{
+  if ((size_t)(end - buf) < size) {
+    return (buf == end) ? HPCFMT_EOF : HPCFMT_ERR;
+  }
+  return HPCFMT_OK;
+}
+
+
+static inline int
+hpcfmt_int2_mread(uint16_t* val, const char** buf, const char* end)
+{
+  HPCFMT_ThrowIfError(hpcfmt_mread_check(sizeof(uint16_t), *buf, end));
+  uint16_t v;
+  memcpy(&v, *buf, sizeof(v));
+  *val = be16toh(v);
+  *buf += sizeof(v);
+  return HPCFMT_OK;
+}
+
+
+static inline int
+hpcfmt_int4_mread(uint32_t* val, const char** buf, const char* end)
+{
+  HPCFMT_ThrowIfError(hpcfmt_mread_check(sizeof(uint32_t), *buf, end));
+  uint32_t v;
+  memcpy(&v, *buf, sizeof(v));
+  *val = be32toh(v);
+  *buf += sizeof(v);
+  return HPCFMT_OK;
+}
+
+
+static inline int
+hpcfmt_int8_mread(uint64_t* val, const char** buf, const char* end)
+{
+  HPCFMT_ThrowIfError(hpcfmt_mread_check(sizeof(uint64_t), *buf, end));
+  uint64_t v;
+  memcpy(&v, *buf, sizeof(v));
+  *val = be64toh(v);
+  *buf += sizeof(v);
+  return HPCFMT_OK;
+}
+
+
+// hpcfmt_int8v_mread: decode 'n' consecutive 8-byte values
+static inline int
+hpcfmt_int8v_mread(uint64_t* vals, size_t n, const char** buf,
+		   const char* end)
+{
+  HPCFMT_ThrowIfError(hpcfmt_mread_check(n * sizeof(uint64_t), *buf, end));
+  memcpy(vals, *buf, n * sizeof(uint64_t));
+  for (size_t i = 0; i < n; ++i) {
+    vals[i] = be64toh(vals[i]);
+  }
+  *buf += n * sizeof(uint64_t);
+  return HPCFMT_OK;
+}
+
+
 //***************************************************************************
 // hpcfmt_str_t
 //***************************************************************************
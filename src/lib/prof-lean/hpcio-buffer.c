@@ -69,6 +69,12 @@
 // control at the end of the process, so there is no way to auto close
 // the buffers.
 //
+// With HPCIO_OUTBUF_ASYNC, the writing thread only swaps halves of
+// the buffer and queues the full one for a writer thread, so that a
+// slow file system does not stall the application inside a sample.
+// The writer must keep up: a thread that fills both halves waits for
+// the older one to be written.
+//
 // Deserves further study: the best way to handle errors from write().
 //
 //***************************************************************************
@@ -79,6 +85,7 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sched.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -87,7 +94,9 @@
 
 #include "hpcfmt.h"
 #include "hpcio-buffer.h"
+#include "queues.h"
 #include "spinlock.h"
+#include "stdatomic.h"
 #include <include/min-max.h>
 
 #define HPCIO_OUTBUF_MAGIC  0x494F4246
@@ -98,6 +107,16 @@
 // type declarations
 //***************************************************************************
 
+// One half of an async outbuf.  'busy' is set from the time the half
+// is queued until the writer thread has written it.
+typedef struct outbuf_half_s {
+  q_element_t elem;  // must be first
+  struct hpcio_outbuf_s *outbuf;
+  void  *start;
+  size_t len;
+  _Atomic(int) busy;
+} outbuf_half_t;
+
 typedef struct hpcio_outbuf_s {
   struct hpcio_outbuf_s *next;
   uint32_t magic;
@@ -105,9 +124,16 @@ typedef struct hpcio_outbuf_s {
   size_t buf_size;
   size_t in_use;
   int  fd;
+  hpcio_pack_member_t *member;
   int  flags;
   char use_lock;
   spinlock_t lock;
+
+  // async output
+  char async;
+  int  active;
+  outbuf_half_t half[2];
+  _Atomic(int) async_err;
 } hpcio_outbuf_t;
 
 
@@ -119,6 +145,10 @@ typedef struct hpcio_outbuf_s {
 static spinlock_t freelist_lock = SPINLOCK_UNLOCKED;
 static hpcio_outbuf_t *freelist = 0;
 
+// full halves of async outbufs, newest first
+static q_element_ptr_t async_queue;
+static void (*async_notify)(void) = 0;
+
 
 
 //*************************** Private Functions *****************************
@@ -167,21 +197,19 @@ outbuf_free
 }
 
 
-// Try to write() the entire outbuf.
+// write() as much of buf as possible.
 //
-// Returns: HPCFMT_OK if the entire buffer was successfully written,
-// else HPCFMT_ERR.
+// Returns: the number of bytes written, len on success.
 //
-static int
-outbuf_flush_buffer(hpcio_outbuf_t *outbuf)
+static size_t
+write_all(int fd, const void *buf, size_t len)
 {
-  ssize_t amt_done, ret;
+  ssize_t ret;
+  size_t amt_done = 0;
 
-  amt_done = 0;
-  while (amt_done < outbuf->in_use) {
+  while (amt_done < len) {
     errno = 0;
-    ret = write(outbuf->fd, outbuf->buf_start + amt_done,
-		outbuf->in_use - amt_done);
+    ret = write(fd, buf + amt_done, len - amt_done);
 
     // Check for short writes.  Note: EINTR is not failure.
     if (ret > 0 || (ret == 0 && errno == EINTR)) {
@@ -190,27 +218,174 @@ outbuf_flush_buffer(hpcio_outbuf_t *outbuf)
     }
     else {
       // hard failure
-      // FIXME: should do better than copy to begin of buffer.
-      // However, this case is rare, it probably will continue to fail
-      // and I want to rethink this case anyway.  So, this will do for
-      // now. (krentel)
-      if (amt_done > 0) {
-	memmove(outbuf->buf_start, outbuf->buf_start + amt_done,
-		outbuf->in_use - amt_done);
-	outbuf->in_use = amt_done;
-      }
-      return HPCFMT_ERR;
+      break;
     }
   }
 
+  return amt_done;
+}
+
+
+// Write len bytes from buf to the outbuf's file or pack member.
+//
+// Returns: the number of bytes written, len on success.
+//
+static size_t
+outbuf_write_data(hpcio_outbuf_t *outbuf, const void *buf, size_t len)
+{
+  if (outbuf->member != NULL) {
+    return hpcio_pack_member_write(outbuf->member, buf, len);
+  }
+  return write_all(outbuf->fd, buf, len);
+}
+
+
+// Try to write() the entire outbuf.
+//
+// Returns: HPCFMT_OK if the entire buffer was successfully written,
+// else HPCFMT_ERR.
+//
+static int
+outbuf_flush_buffer(hpcio_outbuf_t *outbuf)
+{
+  size_t amt_done = outbuf_write_data(outbuf, outbuf->buf_start,
+				      outbuf->in_use);
+
+  if (amt_done < outbuf->in_use) {
+    // hard failure
+    // FIXME: should do better than copy to begin of buffer.
+    // However, this case is rare, it probably will continue to fail
+    // and I want to rethink this case anyway.  So, this will do for
+    // now. (krentel)
+    if (amt_done > 0) {
+      memmove(outbuf->buf_start, outbuf->buf_start + amt_done,
+	      outbuf->in_use - amt_done);
+      outbuf->in_use = amt_done;
+    }
+    return HPCFMT_ERR;
+  }
+
   // entire buffer was successfully written
   outbuf->in_use = 0;
   return HPCFMT_OK;
 }
 
 
+// Wait until the writer thread is done with 'half'.
+static void
+outbuf_half_wait(outbuf_half_t *half)
+{
+  while (atomic_load(&half->busy)) {
+    sched_yield();
+  }
+}
+
+
+// Queue the active half of an async outbuf for the writer thread and
+// continue in the other half, once that one is written.
+static void
+outbuf_handoff(hpcio_outbuf_t *outbuf)
+{
+  if (outbuf->in_use == 0) {
+    return;
+  }
+
+  outbuf_half_t *full = &outbuf->half[outbuf->active];
+  full->len = outbuf->in_use;
+  atomic_store(&full->busy, 1);
+  cqueue_ptr_set(&full->elem.next, 0);
+  cqueue_push(&async_queue, &full->elem);
+  async_notify();
+
+  outbuf->active ^= 1;
+  outbuf_half_t *next = &outbuf->half[outbuf->active];
+  outbuf_half_wait(next);
+
+  outbuf->buf_start = next->start;
+  outbuf->in_use = 0;
+}
+
+
+// Make room in the outbuf: write() it, or hand it off if async.
+static void
+outbuf_make_room(hpcio_outbuf_t *outbuf)
+{
+  if (outbuf->async) {
+    outbuf_handoff(outbuf);
+  }
+  else {
+    outbuf_flush_buffer(outbuf);
+  }
+}
+
+
+// Wait for the queued halves of an async outbuf, so that data written
+// next lands after them in the file.
+//
+// Returns: HPCFMT_OK if they were all written, else HPCFMT_ERR.
+//
+static int
+outbuf_async_quiesce(hpcio_outbuf_t *outbuf)
+{
+  if (! outbuf->async) {
+    return HPCFMT_OK;
+  }
+  outbuf_half_wait(&outbuf->half[0]);
+  outbuf_half_wait(&outbuf->half[1]);
+
+  return atomic_load(&outbuf->async_err) ? HPCFMT_ERR : HPCFMT_OK;
+}
+
+
 //*************************** Interface Functions ***************************
 
+// Fill in the outbuf struct for either a file descriptor or a pack
+// member.
+//
+static hpcio_outbuf_t *
+outbuf_init
+(
+  int fd,
+  hpcio_pack_member_t *member,
+  void *buf_start,
+  size_t buf_size,
+  int flags,
+  allocator_t alloc
+)
+{
+  hpcio_outbuf_t *outbuf = outbuf_alloc(alloc);
+
+  outbuf->next = NULL;
+  outbuf->magic = HPCIO_OUTBUF_MAGIC;
+  outbuf->buf_start = buf_start;
+  outbuf->buf_size = buf_size;
+  outbuf->in_use = 0;
+  outbuf->fd = fd;
+  outbuf->member = member;
+  outbuf->flags = flags;
+  outbuf->use_lock = (flags & HPCIO_OUTBUF_LOCKED);
+  spinlock_unlock(&outbuf->lock);
+
+  outbuf->async = (flags & HPCIO_OUTBUF_ASYNC) && async_notify != 0
+    && buf_size >= 2;
+  outbuf->active = 0;
+  atomic_store(&outbuf->async_err, 0);
+  if (outbuf->async) {
+    size_t half_size = buf_size / 2;
+    int i;
+    for (i = 0; i < 2; i++) {
+      outbuf->half[i].outbuf = outbuf;
+      outbuf->half[i].start = buf_start + i * half_size;
+      outbuf->half[i].len = 0;
+      atomic_store(&outbuf->half[i].busy, 0);
+    }
+    outbuf->buf_size = half_size;
+  }
+
+  return outbuf;
+}
+
+
 // Attach the file descriptor to the buffer, initialize and fill in
 // the outbuf struct.  The client supplies the buffer and fd.
 //
@@ -233,19 +408,33 @@ hpcio_outbuf_attach
     return HPCFMT_ERR;
   }
 
-  hpcio_outbuf_t *outbuf = outbuf_alloc(alloc);
+  *outbuf_ptr = outbuf_init(fd, NULL, buf_start, buf_size, flags, alloc);
 
-  outbuf->next = NULL;
-  outbuf->magic = HPCIO_OUTBUF_MAGIC;
-  outbuf->buf_start = buf_start;
-  outbuf->buf_size = buf_size;
-  outbuf->in_use = 0;
-  outbuf->fd = fd;
-  outbuf->flags = flags;
-  outbuf->use_lock = (flags & HPCIO_OUTBUF_LOCKED);
-  spinlock_unlock(&outbuf->lock);
+  return HPCFMT_OK;
+}
 
-  *outbuf_ptr = outbuf;
+
+// Attach the pack member to the buffer, as above.
+//
+// Returns: HPCFMT_OK on success, else HPCFMT_ERR.
+//
+int
+hpcio_outbuf_attach_member
+(
+  hpcio_outbuf_t **outbuf_ptr /* out */,
+  hpcio_pack_member_t *member,
+  void *buf_start,
+  size_t buf_size,
+  int flags,
+  allocator_t alloc
+)
+{
+  if (outbuf_ptr == NULL || member == NULL || buf_start == NULL
+      || buf_size == 0) {
+    return HPCFMT_ERR;
+  }
+
+  *outbuf_ptr = outbuf_init(-1, member, buf_start, buf_size, flags, alloc);
 
   return HPCFMT_OK;
 }
@@ -271,7 +460,7 @@ hpcio_outbuf_write(hpcio_outbuf_t *outbuf, const void *data, size_t size)
   while (amt_done < size) {
     // flush if needed
     if (size > outbuf->buf_size - outbuf->in_use) {
-      outbuf_flush_buffer(outbuf);
+      outbuf_make_room(outbuf);
       if (outbuf->in_use == outbuf->buf_size) {
 	// flush failed, no space
 	break;
@@ -306,7 +495,10 @@ hpcio_outbuf_flush(hpcio_outbuf_t *outbuf)
     spinlock_lock(&outbuf->lock);
   }
 
-  int ret = outbuf_flush_buffer(outbuf);
+  int ret = outbuf_async_quiesce(outbuf);
+  if (outbuf_flush_buffer(outbuf) != HPCFMT_OK) {
+    ret = HPCFMT_ERR;
+  }
 
   if (outbuf->use_lock) {
     spinlock_unlock(&outbuf->lock);
@@ -335,8 +527,9 @@ hpcio_outbuf_close(hpcio_outbuf_t **outbuf_ptr)
     spinlock_lock(&outbuf->lock);
   }
 
-  if (outbuf_flush_buffer(outbuf) == HPCFMT_OK
-      && close(outbuf->fd) == 0) {
+  if (outbuf_async_quiesce(outbuf) == HPCFMT_OK
+      && outbuf_flush_buffer(outbuf) == HPCFMT_OK
+      && (outbuf->member != NULL || close(outbuf->fd) == 0)) {
     // flush and close both succeed
     outbuf->magic = 0;
     outbuf->fd = -1;
@@ -355,3 +548,48 @@ hpcio_outbuf_close(hpcio_outbuf_t **outbuf_ptr)
 
   return ret;
 }
+
+
+// Enable (or disable, for NULL) async output for outbufs attached
+// from now on, dropping anything queued.
+//
+void
+hpcio_outbuf_async_init(void (*notify)(void))
+{
+  cqueue_steal(&async_queue);
+  async_notify = notify;
+}
+
+
+// Write the queued halves of async outbufs in the order they filled.
+//
+// Returns: the number of halves written.
+//
+int
+hpcio_outbuf_async_drain(void)
+{
+  // the queue is LIFO; reverse what we take off it
+  q_element_t *e = cqueue_steal(&async_queue);
+  q_element_t *fifo = 0;
+  while (e) {
+    q_element_t *next = cqueue_ptr_get(&e->next);
+    cqueue_ptr_set(&e->next, fifo);
+    fifo = e;
+    e = next;
+  }
+
+  int count = 0;
+  while (fifo) {
+    outbuf_half_t *half = (outbuf_half_t *) fifo;
+    fifo = cqueue_ptr_get(&fifo->next);
+
+    hpcio_outbuf_t *outbuf = half->outbuf;
+    if (outbuf_write_data(outbuf, half->start, half->len) < half->len) {
+      atomic_store(&outbuf->async_err, 1);
+    }
+    atomic_store(&half->busy, 0);
+    count++;
+  }
+
+  return count;
+}
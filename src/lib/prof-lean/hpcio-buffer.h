@@ -52,6 +52,7 @@
 #include <stdio.h>
 
 #include "allocator.h"
+#include "hpcio-pack.h"
 
 // opaque type
 
@@ -64,6 +65,11 @@ typedef struct hpcio_outbuf_s hpcio_outbuf_t;
 #define HPCIO_OUTBUF_LOCKED    0x1
 #define HPCIO_OUTBUF_UNLOCKED  0x2
 
+// Split the buffer in two halves and hand each full half to the writer
+// thread (see hpcio_outbuf_async_init()) instead of calling write().
+// Ignored unless async output has been enabled.
+#define HPCIO_OUTBUF_ASYNC     0x4
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -80,6 +86,20 @@ hpcio_outbuf_attach
 );
 
 
+// Like hpcio_outbuf_attach(), but the data is appended to 'member' of
+// a pack file, and closing the outbuf leaves the pack open.
+int
+hpcio_outbuf_attach_member
+(
+  hpcio_outbuf_t **outbuf /* out */,
+  hpcio_pack_member_t *member,
+  void *buf_start,
+  size_t buf_size,
+  int flags,
+  allocator_t alloc
+);
+
+
 ssize_t
 hpcio_outbuf_write
 (
@@ -103,6 +123,29 @@ hpcio_outbuf_close
 );
 
 
+// Enables HPCIO_OUTBUF_ASYNC for the outbufs attached from now on, or
+// disables it if 'notify' is NULL.  'notify' is called after a full
+// half is queued, from the thread that filled it (possibly inside a
+// signal handler), to wake the thread that runs
+// hpcio_outbuf_async_drain().  Anything still queued is discarded, so
+// a forked child can call this again without rewriting its parent's
+// data.
+void
+hpcio_outbuf_async_init
+(
+  void (*notify)(void)
+);
+
+
+// Writes the queued halves, in the order they filled, and returns
+// their number.  Only one thread may drain at a time.
+int
+hpcio_outbuf_async_drain
+(
+  void
+);
+
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,1008 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Implements pack files, cf. hpcio-pack.h.
+//
+//***************************************************************************
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  // fopencookie()
+#endif
+
+//************************* System Include Files ****************************
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+//*************************** User Include Files ****************************
+
+#include "hpcfmt.h"
+#include "hpcio-pack.h"
+#include "spinlock.h"
+#include "stdatomic.h"
+#include <include/min-max.h>
+
+
+
+//***************************************************************************
+// type declarations
+//***************************************************************************
+
+// a segment as it is listed in the index
+typedef struct pack_seg_s {
+  uint32_t kind;
+  uint32_t member;
+  uint64_t offset;   // of the segment header
+  uint64_t len;      // of the data
+} pack_seg_t;
+
+// A table of segments for one part of the index.  Segment i is listed
+// in part i / HPCIO_PACK_IndexPartSegs, which is held by table
+// (i / HPCIO_PACK_IndexPartSegs) % 2.
+typedef struct pack_index_table_s {
+  _Atomic(uint64_t) part;       // the part the table holds
+  _Atomic(uint64_t) filled;     // its entries filled in so far
+  pack_seg_t *segs;
+} pack_index_table_t;
+
+// Segments are listed in two tables allocated with the pack, so that
+// writing needs no allocation (the trace writer thread has no
+// allocator).  Whoever fills in the last entry of a part writes the
+// part out and passes the table on to the part after next.  A segment
+// whose part's table is still busy is not listed, and then no index
+// is written.
+struct hpcio_pack_s {
+  int fd;
+  allocator_t *alloc;
+  _Atomic(uint64_t) end;        // where the next segment goes
+  _Atomic(uint32_t) next_member;
+  _Atomic(uint64_t) num_segs;
+  pack_index_table_t index[2];
+  _Atomic(int) index_lost;
+};
+
+struct hpcio_pack_member_s {
+  hpcio_pack_t *pack;
+  uint32_t id;
+};
+
+
+// a member, as found by a reader
+typedef struct pack_member_info_s {
+  uint32_t id;
+  char *name;
+  uint64_t size;
+  size_t num_segs;
+  pack_seg_t **segs;  // DATA segments, in order
+} pack_member_info_t;
+
+typedef struct pack_info_s {
+  size_t num_segs;
+  pack_seg_t *segs;   // by offset
+  size_t num_members;
+  pack_member_info_t *members;
+
+  // identifies the pack file in the cache
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  time_t mtime;
+  int refs;           // guarded by pack_cache_lock
+} pack_info_t;
+
+
+// the state of a stream reading a member
+typedef struct pack_stream_s {
+  int fd;
+  pack_info_t *info;
+  pack_member_info_t *member;
+  uint64_t pos;
+} pack_stream_t;
+
+
+
+//***************************************************************************
+// local variables
+//***************************************************************************
+
+// the packs read last, most recent first; members of a pack are
+// usually opened one after another, by one or a few threads
+#define PACK_CACHE_SIZE 4
+
+static pack_info_t *pack_cache[PACK_CACHE_SIZE];
+static spinlock_t pack_cache_lock = SPINLOCK_UNLOCKED;
+
+
+
+//*************************** Private Functions *****************************
+
+static void
+put_be32(unsigned char *p, uint32_t x)
+{
+  int i;
+  for (i = 3; i >= 0; i--, x >>= 8) {
+    p[i] = x & 0xff;
+  }
+}
+
+
+static void
+put_be64(unsigned char *p, uint64_t x)
+{
+  int i;
+  for (i = 7; i >= 0; i--, x >>= 8) {
+    p[i] = x & 0xff;
+  }
+}
+
+
+static uint32_t
+get_be32(const unsigned char *p)
+{
+  uint32_t x = 0;
+  int i;
+  for (i = 0; i < 4; i++) {
+    x = (x << 8) | p[i];
+  }
+  return x;
+}
+
+
+static uint64_t
+get_be64(const unsigned char *p)
+{
+  uint64_t x = 0;
+  int i;
+  for (i = 0; i < 8; i++) {
+    x = (x << 8) | p[i];
+  }
+  return x;
+}
+
+
+// pwrite() all of buf.
+//
+// Returns: the number of bytes written, len on success.
+//
+static size_t
+pwrite_all(int fd, const void *buf, size_t len, uint64_t offset)
+{
+  size_t amt_done = 0;
+
+  while (amt_done < len) {
+    errno = 0;
+    ssize_t ret = pwrite(fd, buf + amt_done, len - amt_done,
+			 offset + amt_done);
+    if (ret > 0 || (ret == 0 && errno == EINTR)) {
+      amt_done += ret;
+    }
+    else {
+      break;
+    }
+  }
+
+  return amt_done;
+}
+
+
+static size_t
+pread_all(int fd, void *buf, size_t len, uint64_t offset)
+{
+  size_t amt_done = 0;
+
+  while (amt_done < len) {
+    errno = 0;
+    ssize_t ret = pread(fd, buf + amt_done, len - amt_done,
+			offset + amt_done);
+    if (ret > 0 || (ret < 0 && errno == EINTR)) {
+      amt_done += (ret > 0) ? ret : 0;
+    }
+    else {
+      break;
+    }
+  }
+
+  return amt_done;
+}
+
+
+// Reserve room for a segment of 'len' bytes and write its header.
+//
+// Returns: the offset of the segment's data.
+//
+static uint64_t
+pack_seg_begin(hpcio_pack_t *pack, uint32_t kind, uint32_t member,
+	       uint64_t len, int *ok)
+{
+  unsigned char hdr[HPCIO_PACK_SegHeaderLen];
+  uint64_t offset =
+    atomic_fetch_add(&pack->end, HPCIO_PACK_SegHeaderLen + len);
+
+  put_be32(hdr, kind);
+  put_be32(hdr + 4, member);
+  put_be64(hdr + 8, len);
+  *ok = pwrite_all(pack->fd, hdr, sizeof(hdr), offset) == sizeof(hdr);
+
+  return offset + HPCIO_PACK_SegHeaderLen;
+}
+
+
+// Write the first 'num_segs' entries of 'table' as a segment of kind
+// 'kind' (INDEX or INDEX_PART).  The entries are written in pieces to
+// avoid allocating them.
+//
+// Returns: the offset of the segment's data, 0 on failure.
+//
+static uint64_t
+pack_index_write(hpcio_pack_t *pack, uint32_t kind, pack_seg_t *table,
+		 uint64_t num_segs)
+{
+  int ok;
+  uint64_t len = num_segs * HPCIO_PACK_IndexEntryLen;
+  uint64_t data_offset = pack_seg_begin(pack, kind, 0, len, &ok);
+  uint64_t offset = data_offset;
+
+  unsigned char buf[128 * HPCIO_PACK_IndexEntryLen];
+  size_t in_use = 0;
+  uint64_t i;
+  for (i = 0; i < num_segs && ok; i++) {
+    pack_seg_t *seg = &table[i];
+    unsigned char *p = buf + in_use;
+    put_be32(p, seg->kind);
+    put_be32(p + 4, seg->member);
+    put_be64(p + 8, seg->offset);
+    put_be64(p + 16, seg->len);
+    in_use += HPCIO_PACK_IndexEntryLen;
+    if (in_use == sizeof(buf) || i + 1 == num_segs) {
+      ok = pwrite_all(pack->fd, buf, in_use, offset) == in_use;
+      offset += in_use;
+      in_use = 0;
+    }
+  }
+
+  return ok ? data_offset : 0;
+}
+
+
+// Remember a segment for the index.
+static void
+pack_seg_record(hpcio_pack_t *pack, uint32_t kind, uint32_t member,
+		uint64_t data_offset, uint64_t len)
+{
+  uint64_t i = atomic_fetch_add(&pack->num_segs, 1);
+  uint64_t part = i / HPCIO_PACK_IndexPartSegs;
+  pack_index_table_t *table = &pack->index[part % 2];
+  if (table->segs == NULL || atomic_load(&table->part) != part) {
+    atomic_store(&pack->index_lost, 1);  // readers will have to scan
+    return;
+  }
+
+  pack_seg_t *seg = &table->segs[i % HPCIO_PACK_IndexPartSegs];
+  seg->kind = kind;
+  seg->member = member;
+  seg->offset = data_offset - HPCIO_PACK_SegHeaderLen;
+  seg->len = len;
+
+  if (atomic_fetch_add(&table->filled, 1) + 1 < HPCIO_PACK_IndexPartSegs) {
+    return;
+  }
+
+  // the part is complete: write it out, free the table for the part
+  // after next, and list the new INDEX_PART segment itself
+  uint64_t part_offset = pack_index_write(pack, HPCIO_PACK_SEG_INDEX_PART,
+					  table->segs,
+					  HPCIO_PACK_IndexPartSegs);
+  atomic_store(&table->filled, 0);
+  atomic_store(&table->part, part + 2);
+
+  if (part_offset == 0) {
+    atomic_store(&pack->index_lost, 1);
+    return;
+  }
+  pack_seg_record(pack, HPCIO_PACK_SEG_INDEX_PART, 0, part_offset,
+		  HPCIO_PACK_IndexPartSegs * HPCIO_PACK_IndexEntryLen);
+}
+
+
+static size_t
+pack_seg_write(hpcio_pack_t *pack, uint32_t kind, uint32_t member,
+	       const void *data, size_t len)
+{
+  int ok;
+  uint64_t offset = pack_seg_begin(pack, kind, member, len, &ok);
+  if (! ok) {
+    return 0;
+  }
+
+  size_t amt_done = pwrite_all(pack->fd, data, len, offset);
+  if (amt_done == len) {
+    pack_seg_record(pack, kind, member, offset, len);
+  }
+  return amt_done;
+}
+
+
+static ssize_t
+member_cookie_write(void *cookie, const char *buf, size_t size)
+{
+  size_t ret = hpcio_pack_member_write((hpcio_pack_member_t *) cookie,
+				       buf, size);
+  return (ret == size) ? (ssize_t) size : -1;
+}
+
+
+
+//*************************** Interface Functions ***************************
+
+int
+hpcio_pack_open(hpcio_pack_t **pack_ptr /* out */, int fd, allocator_t alloc)
+{
+  if (pack_ptr == NULL || fd < 0) {
+    return HPCFMT_ERR;
+  }
+
+  unsigned char hdr[HPCIO_PACK_HeaderLen] = { 0 };
+  memcpy(hdr, HPCIO_PACK_Magic, HPCIO_PACK_MagicLen);
+  memcpy(hdr + HPCIO_PACK_MagicLen, HPCIO_PACK_Version,
+	 HPCIO_PACK_VersionLen);
+  hdr[HPCIO_PACK_MagicLen + HPCIO_PACK_VersionLen] = HPCIO_PACK_Endian;
+  if (pwrite_all(fd, hdr, sizeof(hdr), 0) != sizeof(hdr)) {
+    return HPCFMT_ERR;
+  }
+
+  hpcio_pack_t *pack = (hpcio_pack_t *) alloc(sizeof(hpcio_pack_t));
+  if (pack == NULL) {
+    return HPCFMT_ERR;
+  }
+  pack->fd = fd;
+  pack->alloc = alloc;
+  atomic_store(&pack->end, HPCIO_PACK_HeaderLen);
+  atomic_store(&pack->next_member, 0);
+  atomic_store(&pack->num_segs, 0);
+  atomic_store(&pack->index_lost, 0);
+  int k;
+  for (k = 0; k < 2; k++) {
+    pack_index_table_t *table = &pack->index[k];
+    atomic_store(&table->part, k);
+    atomic_store(&table->filled, 0);
+    table->segs = (pack_seg_t *)
+      alloc(HPCIO_PACK_IndexPartSegs * sizeof(pack_seg_t));
+  }
+
+  *pack_ptr = pack;
+
+  return HPCFMT_OK;
+}
+
+
+hpcio_pack_member_t *
+hpcio_pack_member_open(hpcio_pack_t *pack, const char *name)
+{
+  if (pack == NULL) {
+    return NULL;
+  }
+
+  hpcio_pack_member_t *member =
+    (hpcio_pack_member_t *) pack->alloc(sizeof(hpcio_pack_member_t));
+  if (member == NULL) {
+    return NULL;
+  }
+  member->pack = pack;
+  member->id = atomic_fetch_add(&pack->next_member, 1);
+
+  if (hpcio_pack_member_rename(member, name) != HPCFMT_OK) {
+    return NULL;
+  }
+  return member;
+}
+
+
+int
+hpcio_pack_member_rename(hpcio_pack_member_t *member, const char *name)
+{
+  size_t len = strlen(name);
+  size_t ret = pack_seg_write(member->pack, HPCIO_PACK_SEG_NAME, member->id,
+			      name, len);
+  return (ret == len) ? HPCFMT_OK : HPCFMT_ERR;
+}
+
+
+size_t
+hpcio_pack_member_write(hpcio_pack_member_t *member, const void *data,
+			size_t size)
+{
+  if (member == NULL || size == 0) {
+    return 0;
+  }
+  return pack_seg_write(member->pack, HPCIO_PACK_SEG_DATA, member->id,
+			data, size);
+}
+
+
+FILE *
+hpcio_pack_member_fopen_w(hpcio_pack_member_t *member, size_t buf_size)
+{
+  cookie_io_functions_t fns = {
+    .read = NULL, .write = member_cookie_write, .seek = NULL, .close = NULL
+  };
+
+  FILE *fs = fopencookie(member, "w", fns);
+  if (fs != NULL && buf_size > 0) {
+    void *buf = member->pack->alloc(buf_size);
+    if (buf != NULL) {
+      setvbuf(fs, buf, _IOFBF, buf_size);
+    }
+  }
+  return fs;
+}
+
+
+int
+hpcio_pack_close(hpcio_pack_t **pack_ptr)
+{
+  hpcio_pack_t *pack = *pack_ptr;
+  if (pack == NULL) {
+    return HPCFMT_ERR;
+  }
+
+  // the earlier parts have been written out; the last one, which
+  // lists the segments since, becomes the INDEX segment
+  uint64_t num_segs = atomic_load(&pack->num_segs);
+  uint64_t part = num_segs / HPCIO_PACK_IndexPartSegs;
+  uint64_t num_listed = num_segs % HPCIO_PACK_IndexPartSegs;
+  pack_index_table_t *table = &pack->index[part % 2];
+  int indexed = (! atomic_load(&pack->index_lost)
+		 && table->segs != NULL && atomic_load(&table->part) == part
+		 && atomic_load(&table->filled) == num_listed);
+  int ok = 1;
+
+  uint64_t index_offset = 0;
+  if (indexed) {
+    uint64_t offset = pack_index_write(pack, HPCIO_PACK_SEG_INDEX,
+				       table->segs, num_listed);
+    ok = (offset != 0);
+    index_offset = offset - HPCIO_PACK_SegHeaderLen;
+  }
+
+  unsigned char trailer[HPCIO_PACK_TrailerLen];
+  put_be64(trailer, index_offset);
+  memcpy(trailer + 8, HPCIO_PACK_Magic, HPCIO_PACK_MagicLen);
+  if (indexed && ok) {
+    uint64_t end = atomic_fetch_add(&pack->end, sizeof(trailer));
+    ok = pwrite_all(pack->fd, trailer, sizeof(trailer), end)
+      == sizeof(trailer);
+  }
+
+  if (close(pack->fd) != 0) {
+    ok = 0;
+  }
+  *pack_ptr = NULL;
+
+  return ok ? HPCFMT_OK : HPCFMT_ERR;
+}
+
+
+//***************************************************************************
+// reading
+//***************************************************************************
+
+static int
+seg_cmp(const void *a, const void *b)
+{
+  const pack_seg_t *x = (const pack_seg_t *) a;
+  const pack_seg_t *y = (const pack_seg_t *) b;
+  return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+
+// Append the entries of the index segment (INDEX or INDEX_PART) at
+// 'offset' to info->segs.
+//
+// Returns: 0 on success, else -1.
+//
+static int
+pack_read_index(int fd, uint64_t offset, uint32_t kind, pack_info_t *info,
+		size_t *cap)
+{
+  unsigned char hdr[HPCIO_PACK_SegHeaderLen];
+  if (pread_all(fd, hdr, sizeof(hdr), offset) != sizeof(hdr)
+      || get_be32(hdr) != kind) {
+    return -1;
+  }
+
+  uint64_t len = get_be64(hdr + 8);
+  size_t n = len / HPCIO_PACK_IndexEntryLen;
+  if (info->num_segs + n > *cap) {
+    *cap = MAX(2 * (*cap), info->num_segs + n);
+    pack_seg_t *segs = realloc(info->segs, (*cap) * sizeof(pack_seg_t));
+    if (segs == NULL) return -1;
+    info->segs = segs;
+  }
+
+  unsigned char *index = malloc(len + 1);
+  if (index == NULL
+      || pread_all(fd, index, len, offset + sizeof(hdr)) != len) {
+    free(index);
+    return -1;
+  }
+
+  size_t i;
+  for (i = 0; i < n; i++) {
+    const unsigned char *p = index + i * HPCIO_PACK_IndexEntryLen;
+    pack_seg_t *seg = &info->segs[info->num_segs++];
+    seg->kind = get_be32(p);
+    seg->member = get_be32(p + 4);
+    seg->offset = get_be64(p + 8);
+    seg->len = get_be64(p + 16);
+  }
+  free(index);
+
+  return 0;
+}
+
+
+// Read the index of the pack, or else the segment headers.
+//
+// Returns: 0 on success, -1 if 'fd' is not a pack.
+//
+static int
+pack_read_segs(int fd, pack_info_t *info)
+{
+  struct stat st;
+  unsigned char buf[HPCIO_PACK_HeaderLen];
+
+  if (fstat(fd, &st) != 0
+      || pread_all(fd, buf, sizeof(buf), 0) != sizeof(buf)
+      || memcmp(buf, HPCIO_PACK_Magic, HPCIO_PACK_MagicLen) != 0) {
+    return -1;
+  }
+  uint64_t size = st.st_size;
+
+  info->num_segs = 0;
+  info->segs = NULL;
+  size_t cap = 0;
+
+  // the index, if the writer got to close the pack: the INDEX segment
+  // and the INDEX_PART segments it (or a later part) lists
+  unsigned char trailer[HPCIO_PACK_TrailerLen];
+  unsigned char hdr[HPCIO_PACK_SegHeaderLen];
+  if (size >= HPCIO_PACK_HeaderLen + HPCIO_PACK_TrailerLen
+      && pread_all(fd, trailer, sizeof(trailer), size - sizeof(trailer))
+         == sizeof(trailer)
+      && memcmp(trailer + 8, HPCIO_PACK_Magic, HPCIO_PACK_MagicLen) == 0) {
+    int ok = (pack_read_index(fd, get_be64(trailer), HPCIO_PACK_SEG_INDEX,
+			      info, &cap) == 0);
+    size_t i;
+    for (i = 0; i < info->num_segs && ok; i++) {
+      if (info->segs[i].kind == HPCIO_PACK_SEG_INDEX_PART) {
+	ok = (pack_read_index(fd, info->segs[i].offset,
+			      HPCIO_PACK_SEG_INDEX_PART, info, &cap) == 0);
+      }
+    }
+    if (! ok) {
+      info->num_segs = 0;
+    }
+  }
+
+  // else scan the segments, up to the first one not fully written
+  if (info->num_segs == 0) {
+    uint64_t offset = HPCIO_PACK_HeaderLen;
+    while (offset + sizeof(hdr) <= size
+	   && pread_all(fd, hdr, sizeof(hdr), offset) == sizeof(hdr)) {
+      uint32_t kind = get_be32(hdr);
+      uint64_t len = get_be64(hdr + 8);
+      if (kind < HPCIO_PACK_SEG_NAME || kind > HPCIO_PACK_SEG_INDEX_PART
+	  || len > size - offset - sizeof(hdr)) {
+	break;
+      }
+      if (info->num_segs == cap) {
+	cap = (cap == 0) ? 64 : 2 * cap;
+	pack_seg_t *segs = realloc(info->segs, cap * sizeof(pack_seg_t));
+	if (segs == NULL) {
+	  free(info->segs);
+	  return -1;
+	}
+	info->segs = segs;
+      }
+      pack_seg_t *seg = &info->segs[info->num_segs++];
+      seg->kind = kind;
+      seg->member = get_be32(hdr + 4);
+      seg->offset = offset;
+      seg->len = len;
+      offset += sizeof(hdr) + len;
+    }
+  }
+
+  qsort(info->segs, info->num_segs, sizeof(pack_seg_t), seg_cmp);
+
+  return 0;
+}
+
+
+static pack_member_info_t *
+pack_find_member(pack_info_t *info, uint32_t id)
+{
+  size_t i;
+  for (i = 0; i < info->num_members; i++) {
+    if (info->members[i].id == id) return &info->members[i];
+  }
+  return NULL;
+}
+
+
+static void
+pack_info_free(pack_info_t *info)
+{
+  size_t i;
+  for (i = 0; i < info->num_members; i++) {
+    free(info->members[i].name);
+    free(info->members[i].segs);
+  }
+  free(info->members);
+  free(info->segs);
+}
+
+
+// Read the pack's list of members.
+//
+// Returns: 0 on success, -1 if 'fd' is not a pack.
+//
+static int
+pack_read(int fd, pack_info_t *info)
+{
+  memset(info, 0, sizeof(*info));
+  if (pack_read_segs(fd, info) != 0) {
+    return -1;
+  }
+
+  info->members = malloc((info->num_segs + 1) * sizeof(pack_member_info_t));
+  if (info->members == NULL) {
+    pack_info_free(info);
+    return -1;
+  }
+
+  size_t i;
+  for (i = 0; i < info->num_segs; i++) {
+    pack_seg_t *seg = &info->segs[i];
+    if (seg->kind == HPCIO_PACK_SEG_INDEX
+	|| seg->kind == HPCIO_PACK_SEG_INDEX_PART) continue;
+
+    pack_member_info_t *m = pack_find_member(info, seg->member);
+    if (m == NULL) {
+      m = &info->members[info->num_members++];
+      memset(m, 0, sizeof(*m));
+      m->id = seg->member;
+    }
+
+    if (seg->kind == HPCIO_PACK_SEG_NAME) {
+      char *name = malloc(seg->len + 1);
+      if (name && pread_all(fd, name, seg->len,
+			    seg->offset + HPCIO_PACK_SegHeaderLen) == seg->len) {
+	name[seg->len] = '\0';
+	free(m->name);
+	m->name = name;
+      }
+      else {
+	free(name);
+      }
+    }
+    else {
+      m->segs = realloc(m->segs, (m->num_segs + 1) * sizeof(pack_seg_t *));
+      m->segs[m->num_segs++] = seg;
+      m->size += seg->len;
+    }
+  }
+
+  return 0;
+}
+
+
+static void
+pack_info_put(pack_info_t *info)
+{
+  spinlock_lock(&pack_cache_lock);
+  int refs = --info->refs;
+  spinlock_unlock(&pack_cache_lock);
+
+  if (refs == 0) {
+    pack_info_free(info);
+    free(info);
+  }
+}
+
+
+// Returns the list of members of the pack 'fd', from the cache if the
+// pack has not changed since it was read, else NULL if 'fd' is not a
+// pack.  Release it with pack_info_put().
+//
+static pack_info_t *
+pack_info_get(int fd)
+{
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    return NULL;
+  }
+
+  spinlock_lock(&pack_cache_lock);
+  int i;
+  for (i = 0; i < PACK_CACHE_SIZE && pack_cache[i] != NULL; i++) {
+    pack_info_t *info = pack_cache[i];
+    if (info->dev == st.st_dev && info->ino == st.st_ino
+	&& info->size == st.st_size && info->mtime == st.st_mtime) {
+      info->refs++;
+      spinlock_unlock(&pack_cache_lock);
+      return info;
+    }
+  }
+  spinlock_unlock(&pack_cache_lock);
+
+  // read it without holding the lock; if two threads miss at once, the
+  // pack is simply read twice
+  pack_info_t *info = malloc(sizeof(pack_info_t));
+  if (info == NULL || pack_read(fd, info) != 0) {
+    free(info);
+    return NULL;
+  }
+  info->dev = st.st_dev;
+  info->ino = st.st_ino;
+  info->size = st.st_size;
+  info->mtime = st.st_mtime;
+  info->refs = 2;  // the caller's and the cache's
+
+  spinlock_lock(&pack_cache_lock);
+  pack_info_t *evicted = pack_cache[PACK_CACHE_SIZE - 1];
+  memmove(&pack_cache[1], &pack_cache[0],
+	  (PACK_CACHE_SIZE - 1) * sizeof(pack_info_t *));
+  pack_cache[0] = info;
+  spinlock_unlock(&pack_cache_lock);
+
+  if (evicted != NULL) {
+    pack_info_put(evicted);
+  }
+  return info;
+}
+
+
+static ssize_t
+pack_stream_read(void *cookie, char *buf, size_t size)
+{
+  pack_stream_t *s = (pack_stream_t *) cookie;
+  pack_member_info_t *m = s->member;
+  size_t amt_done = 0;
+
+  // find the segment holding 'pos'; streams are mostly read in order,
+  // so a linear walk is fine
+  uint64_t seg_begin = 0;
+  size_t i;
+  for (i = 0; i < m->num_segs && amt_done < size; i++) {
+    pack_seg_t *seg = m->segs[i];
+    uint64_t seg_end = seg_begin + seg->len;
+    if (s->pos < seg_end) {
+      uint64_t within = s->pos - seg_begin;
+      size_t amt = MIN(size - amt_done, seg_end - s->pos);
+      size_t ret = pread_all(s->fd, buf + amt_done, amt,
+			     seg->offset + HPCIO_PACK_SegHeaderLen + within);
+      amt_done += ret;
+      s->pos += ret;
+      if (ret < amt) {
+	return (amt_done > 0) ? (ssize_t) amt_done : -1;
+      }
+    }
+    seg_begin = seg_end;
+  }
+
+  return amt_done;
+}
+
+
+static int
+pack_stream_seek(void *cookie, off64_t *offset, int whence)
+{
+  pack_stream_t *s = (pack_stream_t *) cookie;
+  int64_t base = (whence == SEEK_SET) ? 0
+    : (whence == SEEK_CUR) ? (int64_t) s->pos
+    : (int64_t) s->member->size;
+
+  if (base + *offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  s->pos = base + *offset;
+  *offset = s->pos;
+  return 0;
+}
+
+
+static int
+pack_stream_close(void *cookie)
+{
+  pack_stream_t *s = (pack_stream_t *) cookie;
+  int ret = close(s->fd);
+  pack_info_put(s->info);
+  free(s);
+  return ret;
+}
+
+
+const char *
+hpcio_pack_member_name(const char *fnm)
+{
+  // look for ".hpcpack/"
+  size_t sfx_len = strlen(HPCIO_PACK_FnmSfx);
+  const char *p = fnm;
+  while ((p = strchr(p, '.')) != NULL) {
+    p++;
+    if (strncmp(p, HPCIO_PACK_FnmSfx, sfx_len) == 0 && p[sfx_len] == '/'
+	&& p[sfx_len + 1] != '\0') {
+      return p + sfx_len + 1;
+    }
+  }
+  return NULL;
+}
+
+
+int
+hpcio_pack_unpacked_name(const char *fnm, char *buf, size_t buf_size)
+{
+  const char *member = hpcio_pack_member_name(fnm);
+  size_t dir_len = 0;
+
+  if (member != NULL) {
+    // the directory of the pack, including the '/'
+    const char *pack_end = member - 1;
+    const char *slash = pack_end;
+    while (slash > fnm && *(slash - 1) != '/') slash--;
+    dir_len = slash - fnm;
+  }
+  else {
+    member = fnm;
+  }
+
+  if (dir_len + strlen(member) + 1 > buf_size) {
+    return -1;
+  }
+  memcpy(buf, fnm, dir_len);
+  strcpy(buf + dir_len, member);
+  return 0;
+}
+
+
+int
+hpcio_pack_foreach(const char *pack_fnm,
+		   void (*fn)(const char *name, uint64_t size, void *arg),
+		   void *arg)
+{
+  int fd = open(pack_fnm, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+
+  pack_info_t *info = pack_info_get(fd);
+  close(fd);
+  if (info == NULL) {
+    return -1;
+  }
+
+  int count = 0;
+  size_t i;
+  for (i = 0; i < info->num_members; i++) {
+    pack_member_info_t *m = &info->members[i];
+    if (m->name != NULL) {
+      fn(m->name, m->size, arg);
+      count++;
+    }
+  }
+
+  pack_info_put(info);
+  return count;
+}
+
+
+FILE *
+hpcio_pack_fopen_r(const char *fnm)
+{
+  const char *name = hpcio_pack_member_name(fnm);
+  if (name == NULL) {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  size_t pack_len = name - 1 - fnm;
+  char *pack_fnm = strndup(fnm, pack_len);
+  if (pack_fnm == NULL) {
+    return NULL;
+  }
+  int fd = open(pack_fnm, O_RDONLY);
+  free(pack_fnm);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  pack_stream_t *s = malloc(sizeof(pack_stream_t));
+  if (s == NULL || (s->info = pack_info_get(fd)) == NULL) {
+    free(s);
+    close(fd);
+    errno = ENOENT;
+    return NULL;
+  }
+  s->fd = fd;
+  s->pos = 0;
+  s->member = NULL;
+
+  size_t i;
+  for (i = 0; i < s->info->num_members; i++) {
+    pack_member_info_t *m = &s->info->members[i];
+    if (m->name != NULL && strcmp(m->name, name) == 0) {
+      s->member = m;
+    }
+  }
+  if (s->member == NULL) {
+    pack_stream_close(s);
+    errno = ENOENT;
+    return NULL;
+  }
+
+  cookie_io_functions_t fns = {
+    .read = pack_stream_read, .write = NULL,
+    .seek = pack_stream_seek, .close = pack_stream_close
+  };
+  FILE *fs = fopencookie(s, "r", fns);
+  if (fs == NULL) {
+    pack_stream_close(s);
+  }
+  return fs;
+}
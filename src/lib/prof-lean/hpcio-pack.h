@@ -0,0 +1,262 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   A container ("pack") file that holds the profile and trace files
+//   of all threads of a process, so that a large job creates one file
+//   per process instead of two per thread.
+//
+// Description:
+//   Each file in the pack (a member) is written as a sequence of
+//   segments.  Threads append segments concurrently: a segment's place
+//   is reserved by atomically advancing the end of the file, and then
+//   filled with pwrite().  The index of all segments is written in
+//   parts of HPCIO_PACK_IndexPartSegs entries as the segments are
+//   written, and closing the pack writes the last part and a trailer
+//   that points to it.  Without the index (e.g., the process was
+//   killed), readers find the segments by scanning.
+//
+//     pack:     header segment* [index-segment trailer]
+//     header:   "HPCPACK_" version[5] endian[1] pad[2]         (16 bytes)
+//     segment:  kind[4] member-id[4] length[8] data[length]
+//     trailer:  index-segment-offset[8] "HPCPACK_"             (16 bytes)
+//
+//   A NAME segment gives a member's name (the name the file would
+//   have on its own); the last one written wins, so that a member may
+//   be renamed.  A DATA segment holds the next piece of a member's
+//   contents.  The INDEX segment holds, for each other segment, its
+//   kind, member id, offset and length (24 bytes).  An INDEX_PART
+//   segment holds entries in the same way; the parts are listed in the
+//   INDEX segment or in later parts.  All integers are big-endian.
+//
+//   Readers name a member "<pack-file>/<member-name>"; hpcio_fopen_r()
+//   accepts such names.
+//
+//   The writer side does not allocate memory except through the
+//   client's allocator, and may be used in signal handlers, except for
+//   hpcio_pack_member_fopen_w().  The reader side uses malloc(), and
+//   keeps the lists of members of the packs it read last, so that
+//   opening each member of a pack does not read the pack's index again.
+//
+//***************************************************************************
+
+#ifndef prof_lean_hpcio_pack
+#define prof_lean_hpcio_pack
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "allocator.h"
+
+static const char HPCIO_PACK_FnmSfx[] = "hpcpack";
+
+#define HPCIO_PACK_Magic    "HPCPACK_"  // 8 bytes
+#define HPCIO_PACK_Version  "01.00"     // 5 bytes
+#define HPCIO_PACK_Endian   'b'         // 1 byte
+
+#define HPCIO_PACK_MagicLen      (sizeof(HPCIO_PACK_Magic) - 1)
+#define HPCIO_PACK_VersionLen    (sizeof(HPCIO_PACK_Version) - 1)
+#define HPCIO_PACK_HeaderLen     16
+#define HPCIO_PACK_SegHeaderLen  16
+#define HPCIO_PACK_IndexEntryLen 24
+#define HPCIO_PACK_TrailerLen    16
+
+// segments listed in one part of the index (the writer keeps two
+// parts in memory)
+#define HPCIO_PACK_IndexPartSegs (32 * 1024)
+
+typedef enum {
+  HPCIO_PACK_SEG_NAME  = 1,
+  HPCIO_PACK_SEG_DATA  = 2,
+  HPCIO_PACK_SEG_INDEX = 3,
+  HPCIO_PACK_SEG_INDEX_PART = 4
+} hpcio_pack_seg_kind_t;
+
+// opaque types
+
+typedef struct hpcio_pack_s hpcio_pack_t;
+typedef struct hpcio_pack_member_s hpcio_pack_member_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+//***************************************************************************
+// writing
+//***************************************************************************
+
+// Takes over 'fd', an empty file open for writing, and writes the pack
+// header.
+//
+// Returns: HPCFMT_OK on success, else HPCFMT_ERR.
+int
+hpcio_pack_open
+(
+  hpcio_pack_t **pack /* out */,
+  int fd,
+  allocator_t alloc
+);
+
+
+// Adds a member named 'name' to the pack.  Thread safe.
+//
+// Returns: the member, or NULL on failure.
+hpcio_pack_member_t *
+hpcio_pack_member_open
+(
+  hpcio_pack_t *pack,
+  const char *name
+);
+
+
+// Gives 'member' a new name.
+//
+// Returns: HPCFMT_OK on success, else HPCFMT_ERR.
+int
+hpcio_pack_member_rename
+(
+  hpcio_pack_member_t *member,
+  const char *name
+);
+
+
+// Appends 'size' bytes to 'member' as one segment.  Different members
+// may be written concurrently, one member by one thread at a time.
+//
+// Returns: the number of bytes written, 'size' on success.
+size_t
+hpcio_pack_member_write
+(
+  hpcio_pack_member_t *member,
+  const void *data,
+  size_t size
+);
+
+
+// Returns a stdio stream that appends to 'member', with a buffer of
+// 'buf_size' bytes (one segment per buffer full).  Close it with
+// hpcio_fclose().  N.B.: not async signal safe.
+FILE *
+hpcio_pack_member_fopen_w
+(
+  hpcio_pack_member_t *member,
+  size_t buf_size
+);
+
+
+// Writes the index and closes the pack's file.  Members must no longer
+// be written.
+//
+// Returns: HPCFMT_OK on success, else HPCFMT_ERR.
+int
+hpcio_pack_close
+(
+  hpcio_pack_t **pack
+);
+
+
+//***************************************************************************
+// reading
+//***************************************************************************
+
+// If 'fnm' names a member of a pack, "<dir>/<pack-file>/<member-name>",
+// returns a pointer to the member name within 'fnm'; else NULL.
+const char *
+hpcio_pack_member_name
+(
+  const char *fnm
+);
+
+
+// Stores in 'buf' the name a member would have if it were not in a
+// pack, "<dir>/<member-name>", or 'fnm' itself if it does not name a
+// member, e.g., to put files derived from a member next to the pack.
+//
+// Returns: 0 on success, else -1 ('buf' too small).
+int
+hpcio_pack_unpacked_name
+(
+  const char *fnm,
+  char *buf,
+  size_t buf_size
+);
+
+
+// Calls 'fn' for each member of the pack 'pack_fnm' with the member's
+// name and size, in the order the members were added.
+//
+// Returns: the number of members, or -1 if 'pack_fnm' is not a pack.
+int
+hpcio_pack_foreach
+(
+  const char *pack_fnm,
+  void (*fn)(const char *name, uint64_t size, void *arg),
+  void *arg
+);
+
+
+// Opens the member named "<pack-file>/<member-name>" for reading.  The
+// stream supports fseek() and ftell().
+//
+// Returns: the stream, or NULL if there is no such member.
+FILE *
+hpcio_pack_fopen_r
+(
+  const char *fnm
+);
+
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  // prof_lean_hpcio_pack
@@ -91,6 +91,7 @@
 //*************************** User Include Files ****************************
 
 #include "hpcio.h"
+#include "hpcio-pack.h"
 
 
 
@@ -141,6 +142,10 @@ FILE*
 hpcio_fopen_r(const char* fnm)
 {
   FILE* fs = fopen(fnm, "r");
+  if (fs == NULL && (errno == ENOENT || errno == ENOTDIR)) {
+    // perhaps a member of a pack file
+    fs = hpcio_pack_fopen_r(fnm);
+  }
   return fs;
 }
 
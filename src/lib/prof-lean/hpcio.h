@@ -94,7 +94,8 @@ extern "C" {
 // returns a file stream for buffered I/O.  For writing, if
 // 'overwrite' is 0, it is an error for the file to already exist; if
 // 'overwrite' is 1 any existing file will be overwritten.  For
-// reading, it is an error if the file does not exist.  For any of
+// reading, it is an error if the file does not exist.  'fnm' may also
+// name a member of a pack file (cf. hpcio-pack.h).  For any of
 // these errors, or other open errors, NULL is returned; otherwise a
 // non-null FILE pointer is returned.
 //
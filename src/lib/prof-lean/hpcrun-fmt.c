@@ -616,9 +616,9 @@ hpcrun_fmt_loadmapEntry_free(loadmap_entry_t* x, hpcfmt_free_fn dealloc)
 // cct
 //***************************************************************************
 
- int
+int
 hpcrun_fmt_cct_node_fread(hpcrun_fmt_cct_node_t* x,
-			  epoch_flags_t flags, FILE* fs)
+			  epoch_flags_t flags, double fmtVersion, FILE* fs)
 {
   HPCFMT_ThrowIfError(hpcfmt_int4_fread(&x->id, fs));
   HPCFMT_ThrowIfError(hpcfmt_int4_fread(&x->id_parent, fs));
@@ -636,8 +636,76 @@ hpcrun_fmt_cct_node_fread(hpcrun_fmt_cct_node_t* x,
     hpcrun_fmt_lip_fread(&x->lip, fs);
   }
 
-  for (int i = 0; i < x->num_metrics; ++i) {
-    HPCFMT_ThrowIfError(hpcfmt_int8_fread(&x->metrics[i].bits, fs));
+  if (hpcrun_fmt_doSparseMetrics(fmtVersion)) {
+    memset(x->metrics, 0, x->num_metrics * sizeof(hpcrun_metricVal_t));
+
+    uint32_t num_nzs;
+    HPCFMT_ThrowIfError(hpcfmt_int4_fread(&num_nzs, fs));
+
+    for (uint32_t i = 0; i < num_nzs; ++i) {
+      uint32_t mid;
+      uint64_t val;
+      HPCFMT_ThrowIfError(hpcfmt_int4_fread(&mid, fs));
+      HPCFMT_ThrowIfError(hpcfmt_int8_fread(&val, fs));
+      if (mid >= x->num_metrics) {
+	return HPCFMT_ERR;
+      }
+      x->metrics[mid].bits = val;
+    }
+  }
+  else {
+    for (int i = 0; i < x->num_metrics; ++i) {
+      HPCFMT_ThrowIfError(hpcfmt_int8_fread(&x->metrics[i].bits, fs));
+    }
+  }
+  
+  return HPCFMT_OK;
+}
+
+
+int
+hpcrun_fmt_cct_node_mread(hpcrun_fmt_cct_node_t* x,
+			  epoch_flags_t flags, double fmtVersion,
+			  const char** buf, const char* end)
+{
+  HPCFMT_ThrowIfError(hpcfmt_int4_mread(&x->id, buf, end));
+  HPCFMT_ThrowIfError(hpcfmt_int4_mread(&x->id_parent, buf, end));
+
+  x->as_info = lush_assoc_info_NULL;
+  if (flags.fields.isLogicalUnwind) {
+    HPCFMT_ThrowIfError(hpcfmt_int4_mread(&x->as_info.bits, buf, end));
+  }
+
+  HPCFMT_ThrowIfError(hpcfmt_int2_mread(&x->lm_id, buf, end));
+  HPCFMT_ThrowIfError(hpcfmt_int8_mread(&x->lm_ip, buf, end));
+
+  lush_lip_init(&x->lip);
+  if (flags.fields.isLogicalUnwind) {
+    HPCFMT_ThrowIfError(hpcfmt_int8v_mread(x->lip.data8, LUSH_LIP_DATA8_SZ,
+					   buf, end));
+  }
+
+  if (hpcrun_fmt_doSparseMetrics(fmtVersion)) {
+    memset(x->metrics, 0, x->num_metrics * sizeof(hpcrun_metricVal_t));
+
+    uint32_t num_nzs;
+    HPCFMT_ThrowIfError(hpcfmt_int4_mread(&num_nzs, buf, end));
+
+    for (uint32_t i = 0; i < num_nzs; ++i) {
+      uint32_t mid;
+      uint64_t val;
+      HPCFMT_ThrowIfError(hpcfmt_int4_mread(&mid, buf, end));
+      HPCFMT_ThrowIfError(hpcfmt_int8_mread(&val, buf, end));
+      if (mid >= x->num_metrics) {
+	return HPCFMT_ERR;
+      }
+      x->metrics[mid].bits = val;
+    }
+  }
+  else if (x->num_metrics > 0) {
+    // N.B.: hpcrun_metricVal_t is an 8-byte union
+    HPCFMT_ThrowIfError(hpcfmt_int8v_mread(&x->metrics[0].bits,
+					   x->num_metrics, buf, end));
   }
   
   return HPCFMT_OK;
@@ -662,8 +730,20 @@ hpcrun_fmt_cct_node_fwrite(hpcrun_fmt_cct_node_t* x,
     HPCFMT_ThrowIfError(hpcrun_fmt_lip_fwrite(&x->lip, fs));
   }
 
+  uint32_t num_nzs = 0;
   for (int i = 0; i < x->num_metrics; ++i) {
-    HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(x->metrics[i].bits, fs));
+    if (x->metrics[i].bits != 0) {
+      num_nzs++;
+    }
+  }
+
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(num_nzs, fs));
+
+  for (int i = 0; i < x->num_metrics; ++i) {
+    if (x->metrics[i].bits != 0) {
+      HPCFMT_ThrowIfError(hpcfmt_int4_fwrite((uint32_t)i, fs));
+      HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(x->metrics[i].bits, fs));
+    }
   }
   
   return HPCFMT_OK;
@@ -804,6 +884,9 @@ hpctrace_fmt_hdr_fread(hpctrace_fmt_hdr_t* hdr, FILE* infs)
     HPCFMT_ThrowIfError(hpcfmt_int8_fread(&(hdr->flags), infs));
   }
 
+  hdr->blockRecordsLeft = 0;
+  hdr->prevTime = 0;
+
   return HPCFMT_OK;
 }
 
@@ -878,10 +961,19 @@ hpctrace_fmt_hdr_fprint(hpctrace_fmt_hdr_t* hdr, FILE* fs)
 // [hpctrace] datum (trace record)
 //***************************************************************************
 
+static int
+hpctrace_fmt_datum_fread_v2(hpctrace_fmt_datum_t* x, hpctrace_fmt_hdr_t* hdr,
+			    FILE* fs);
+
 int
-hpctrace_fmt_datum_fread(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
+hpctrace_fmt_datum_fread(hpctrace_fmt_datum_t* x, hpctrace_fmt_hdr_t* hdr,
 			 FILE* fs)
 {
+  if (hdr->version >= HPCTRACE_FMT_Version_20) {
+    return hpctrace_fmt_datum_fread_v2(x, hdr, fs);
+  }
+
+  hpctrace_hdr_flags_t flags = hdr->flags;
   int ret = HPCFMT_OK;
   
   ret = hpcfmt_int8_fread(&(x->comp), fs);
@@ -891,6 +983,8 @@ hpctrace_fmt_datum_fread(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
 
   HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(x->cpId), fs));
 
+  x->dLCA = HPCTRACE_FMT_GET_DLCA(x->comp);
+
   if (HPCTRACE_HDR_FLAGS_GET_BIT(flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS)) {
     HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(x->metricId), fs));
   }
@@ -902,72 +996,198 @@ hpctrace_fmt_datum_fread(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
 }
 
 
-// Append the trace record to the outbuf.
-// Returns: HPCFMT_OK on success, else HPCFMT_ERR.
 int
-hpctrace_fmt_datum_outbuf(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
-			  hpcio_outbuf_t* outbuf)
+hpctrace_fmt_datum_fprint(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
+			  FILE* fs)
 {
-  const int bufSZ = sizeof(hpctrace_fmt_datum_t);
-  unsigned char buf[bufSZ];
-  int shift, k;
+  fprintf(fs, "(%llu, %u", HPCTRACE_FMT_GET_TIME(x->comp), x->cpId);
+  if (HPCTRACE_HDR_FLAGS_GET_BIT(flags, HPCTRACE_HDR_FLAGS_LCA_RECORDED_BIT_POS)) {
+    fprintf(fs, ", %u",  x->dLCA);
+  }
+  if (HPCTRACE_HDR_FLAGS_GET_BIT(flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS)) {
+    fprintf(fs, ", %u",  x->metricId);
+  }
+  fputs(")\n", fs);
+  return HPCFMT_OK;
+}
 
-  k = 0;
 
-  uint64_t comp = x->comp;
-  for (shift = 56; shift >= 0; shift -= 8) {
-    buf[k] = (comp >> shift) & 0xff;
-    k++;
+//***************************************************************************
+// [hpctrace] block (version 2.00)
+//***************************************************************************
+
+static inline unsigned char*
+hpctrace_fmt_varint_put(unsigned char* p, uint64_t val)
+{
+  while (val >= 0x80) {
+    *p++ = (unsigned char)(val | 0x80);
+    val >>= 7;
   }
+  *p++ = (unsigned char)val;
+  return p;
+}
 
-  uint32_t cpId = x->cpId;
-  for (shift = 24; shift >= 0; shift -= 8) {
-    buf[k] = (cpId >> shift) & 0xff;
-    k++;
+
+static inline unsigned char*
+hpctrace_fmt_be_put(unsigned char* p, uint64_t val, int len)
+{
+  for (int shift = 8 * (len - 1); shift >= 0; shift -= 8) {
+    *p++ = (val >> shift) & 0xff;
   }
+  return p;
+}
 
-  if (HPCTRACE_HDR_FLAGS_GET_BIT(flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS)) {
-    uint32_t metricId = x->metricId;
-    for (shift = 24; shift >= 0; shift -= 8) {
-      buf[k] = (metricId >> shift) & 0xff;
-      k++;
-    }
+
+void
+hpctrace_fmt_block_init(hpctrace_fmt_block_t* blk, hpctrace_hdr_flags_t flags)
+{
+  blk->flags = flags;
+  blk->hdr.numRecords = 0;
+  blk->hdr.len = 0;
+  blk->hdr.firstTime = 0;
+  blk->hdr.lastTime = 0;
+}
+
+
+bool
+hpctrace_fmt_block_add(hpctrace_fmt_block_t* blk, hpctrace_fmt_datum_t* x)
+{
+  uint64_t time = HPCTRACE_FMT_GET_TIME(x->comp);
+  if (blk->hdr.numRecords == 0) {
+    blk->hdr.firstTime = time;
+    blk->hdr.lastTime = time;
   }
-  
-  if (hpcio_outbuf_write(outbuf, buf, k) != k) {
-    return HPCFMT_ERR;
+
+  // zigzag keeps small steps back in time (e.g., from GPU activity
+  // timestamps) as short as small steps forward
+  int64_t delta = (int64_t)(time - blk->hdr.lastTime);
+  uint64_t zz = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+
+  unsigned char* start = blk->buf + HPCTRACE_FMT_BlockHdrLen + blk->hdr.len;
+  unsigned char* p = hpctrace_fmt_varint_put(start, zz);
+  p = hpctrace_fmt_varint_put(p, x->cpId);
+  if (HPCTRACE_HDR_FLAGS_GET_BIT(blk->flags, HPCTRACE_HDR_FLAGS_LCA_RECORDED_BIT_POS)) {
+    p = hpctrace_fmt_varint_put(p, x->dLCA);
+  }
+  if (HPCTRACE_HDR_FLAGS_GET_BIT(blk->flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS)) {
+    p = hpctrace_fmt_varint_put(p, x->metricId);
   }
 
-  return HPCFMT_OK;
+  blk->hdr.len += (p - start);
+  blk->hdr.numRecords++;
+  blk->hdr.lastTime = time;
+
+  return (blk->hdr.len + HPCTRACE_FMT_DatumMaxLen > HPCTRACE_FMT_BlockLen);
+}
+
+
+// Fills in the block header in front of the records and returns the
+// number of bytes to write, or 0 for an empty block.
+static size_t
+hpctrace_fmt_block_finish(hpctrace_fmt_block_t* blk)
+{
+  if (blk->hdr.numRecords == 0) {
+    return 0;
+  }
+
+  unsigned char* p = blk->buf;
+  p = hpctrace_fmt_be_put(p, blk->hdr.numRecords, sizeof(uint32_t));
+  p = hpctrace_fmt_be_put(p, blk->hdr.len, sizeof(uint32_t));
+  p = hpctrace_fmt_be_put(p, blk->hdr.firstTime, sizeof(uint64_t));
+  p = hpctrace_fmt_be_put(p, blk->hdr.lastTime, sizeof(uint64_t));
+
+  return HPCTRACE_FMT_BlockHdrLen + blk->hdr.len;
 }
 
 
 int
-hpctrace_fmt_datum_fwrite(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
-			  FILE* outfs)
+hpctrace_fmt_block_outbuf(hpctrace_fmt_block_t* blk, hpcio_outbuf_t* outbuf)
 {
-  HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(x->comp, outfs));
-  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(x->cpId, outfs));
-  if (HPCTRACE_HDR_FLAGS_GET_BIT(flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS)) {
-    HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(x->metricId, outfs));
+  size_t len = hpctrace_fmt_block_finish(blk);
+  if (len == 0) {
+    return HPCFMT_OK;
   }
 
-  return HPCFMT_OK;
+  ssize_t ret = hpcio_outbuf_write(outbuf, blk->buf, len);
+  hpctrace_fmt_block_init(blk, blk->flags);
+
+  return (ret == (ssize_t)len) ? HPCFMT_OK : HPCFMT_ERR;
 }
 
 
 int
-hpctrace_fmt_datum_fprint(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
-			  FILE* fs)
+hpctrace_fmt_block_fwrite(hpctrace_fmt_block_t* blk, FILE* outfs)
 {
-  fprintf(fs, "(%llu, %u", HPCTRACE_FMT_GET_TIME(x->comp), x->cpId);
-  if (HPCTRACE_HDR_FLAGS_GET_BIT(flags, HPCTRACE_HDR_FLAGS_LCA_RECORDED_BIT_POS)) {
-    fprintf(fs, ", %llu",  HPCTRACE_FMT_GET_DLCA(x->comp));
+  size_t len = hpctrace_fmt_block_finish(blk);
+  if (len == 0) {
+    return HPCFMT_OK;
   }
-  if (HPCTRACE_HDR_FLAGS_GET_BIT(flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS)) {
-    fprintf(fs, ", %u",  x->metricId);
+
+  size_t nw = fwrite(blk->buf, 1, len, outfs);
+  hpctrace_fmt_block_init(blk, blk->flags);
+
+  return (nw == len) ? HPCFMT_OK : HPCFMT_ERR;
+}
+
+
+int
+hpctrace_fmt_block_hdr_fread(hpctrace_fmt_block_hdr_t* bhdr, FILE* fs)
+{
+  int ret = hpcfmt_int4_fread(&(bhdr->numRecords), fs);
+  if (ret != HPCFMT_OK) {
+    return ret; // can be HPCFMT_EOF
   }
-  fputs(")\n", fs);
+  HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(bhdr->len), fs));
+  HPCFMT_ThrowIfError(hpcfmt_int8_fread(&(bhdr->firstTime), fs));
+  HPCFMT_ThrowIfError(hpcfmt_int8_fread(&(bhdr->lastTime), fs));
+
+  return HPCFMT_OK;
+}
+
+
+static int
+hpctrace_fmt_datum_fread_v2(hpctrace_fmt_datum_t* x, hpctrace_fmt_hdr_t* hdr,
+			    FILE* fs)
+{
+  while (hdr->blockRecordsLeft == 0) {
+    hpctrace_fmt_block_hdr_t bhdr;
+    int ret = hpctrace_fmt_block_hdr_fread(&bhdr, fs);
+    if (ret != HPCFMT_OK) {
+      return ret; // can be HPCFMT_EOF
+    }
+    hdr->blockRecordsLeft = bhdr.numRecords;
+    hdr->prevTime = bhdr.firstTime;
+  }
+
+  uint64_t zz, val;
+  HPCFMT_ThrowIfError(hpcfmt_varint_fread(&zz, fs));
+  int64_t delta = (int64_t)(zz >> 1) ^ -(int64_t)(zz & 1);
+  uint64_t time = hdr->prevTime + delta;
+  HPCTRACE_FMT_SET_TIME(x->comp, time);
+
+  HPCFMT_ThrowIfError(hpcfmt_varint_fread(&val, fs));
+  x->cpId = (uint32_t)val;
+
+  if (HPCTRACE_HDR_FLAGS_GET_BIT(hdr->flags, HPCTRACE_HDR_FLAGS_LCA_RECORDED_BIT_POS)) {
+    HPCFMT_ThrowIfError(hpcfmt_varint_fread(&val, fs));
+    x->dLCA = (uint32_t)val;
+    HPCTRACE_FMT_SET_DLCA(x->comp, x->dLCA);
+  }
+  else {
+    x->dLCA = HPCTRACE_FMT_DLCA_NULL;
+  }
+
+  if (HPCTRACE_HDR_FLAGS_GET_BIT(hdr->flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS)) {
+    HPCFMT_ThrowIfError(hpcfmt_varint_fread(&val, fs));
+    x->metricId = (uint32_t)val;
+  }
+  else {
+    x->metricId = HPCTRACE_FMT_MetricId_NULL;
+  }
+
+  hdr->prevTime = time;
+  hdr->blockRecordsLeft--;
+
   return HPCFMT_OK;
 }
 
@@ -1002,6 +1222,7 @@ hpcmetricDB_fmt_hdr_fread(hpcmetricDB_fmt_hdr_t* hdr, FILE* infs)
   if (nr != HPCMETRICDB_FMT_VersionLen) {
     return HPCFMT_ERR;
   }
+  strcpy(hdr->versionStr, version);
   hdr->version = atof(hdr->versionStr);
 
   nr = fread(&endian, 1, HPCMETRICDB_FMT_EndianLen, infs);
@@ -1009,8 +1230,18 @@ hpcmetricDB_fmt_hdr_fread(hpcmetricDB_fmt_hdr_t* hdr, FILE* infs)
     return HPCFMT_ERR;
   }
 
+  hdr->numMetrics = 0;
+  hdr->numProfiles = 0;
+  hdr->tocOffset = 0;
+
   HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(hdr->numNodes), infs));
-  HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(hdr->numMetrics), infs));
+  if (hdr->version < HPCMETRICDB_FMT_Version_10) {
+    HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(hdr->numMetrics), infs));
+  }
+  else {
+    HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(hdr->numProfiles), infs));
+    HPCFMT_ThrowIfError(hpcfmt_int8_fread(&(hdr->tocOffset), infs));
+  }
 
   return HPCFMT_OK;
 }
@@ -1022,16 +1253,26 @@ hpcmetricDB_fmt_hdr_fwrite(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs)
   int nw;
 
   nw = fwrite(HPCMETRICDB_FMT_Magic,   1, HPCMETRICDB_FMT_MagicLen, outfs);
-  if (nw != HPCTRACE_FMT_MagicLen) return HPCFMT_ERR;
+  if (nw != HPCMETRICDB_FMT_MagicLen) return HPCFMT_ERR;
 
-  nw = fwrite(HPCMETRICDB_FMT_Version, 1, HPCMETRICDB_FMT_VersionLen, outfs);
+  bool isAggregate = (hdr->version >= HPCMETRICDB_FMT_Version_10);
+  const char* version =
+    (isAggregate) ? HPCMETRICDB_FMT_Version10 : HPCMETRICDB_FMT_Version;
+
+  nw = fwrite(version, 1, HPCMETRICDB_FMT_VersionLen, outfs);
   if (nw != HPCMETRICDB_FMT_VersionLen) return HPCFMT_ERR;
 
   nw = fwrite(HPCMETRICDB_FMT_Endian,  1, HPCMETRICDB_FMT_EndianLen, outfs);
   if (nw != HPCMETRICDB_FMT_EndianLen) return HPCFMT_ERR;
 
   HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(hdr->numNodes, outfs));
-  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(hdr->numMetrics, outfs));
+  if (!isAggregate) {
+    HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(hdr->numMetrics, outfs));
+  }
+  else {
+    HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(hdr->numProfiles, outfs));
+    HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(hdr->tocOffset, outfs));
+  }
 
   return HPCFMT_OK;
 }
@@ -1041,11 +1282,85 @@ int
 hpcmetricDB_fmt_hdr_fprint(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs)
 {
   fprintf(outfs, "%s\n", HPCMETRICDB_FMT_Magic);
-  fprintf(outfs, "[hdr:...]\n");
+  fprintf(outfs, "[hdr:\n");
+  fprintf(outfs, "  (version: %s)\n", hdr->versionStr);
+  fprintf(outfs, "]\n");
 
   fprintf(outfs, "(num-nodes:   %u)\n", hdr->numNodes);
-  fprintf(outfs, "(num-metrics: %u)\n", hdr->numMetrics);
+  if (hdr->version < HPCMETRICDB_FMT_Version_10) {
+    fprintf(outfs, "(num-metrics: %u)\n", hdr->numMetrics);
+  }
+  else {
+    fprintf(outfs, "(num-profiles: %u)\n", hdr->numProfiles);
+    fprintf(outfs, "(toc-offset:  %"PRIu64")\n", hdr->tocOffset);
+  }
+
+  return HPCFMT_OK;
+}
+
+
+//***************************************************************************
+// [hpcprof-metricdb] table of contents
+//***************************************************************************
+
+int
+hpcmetricDB_fmt_tocEntry_fread(hpcmetricDB_fmt_tocEntry_t* x, FILE* infs,
+			       hpcfmt_alloc_fn alloc)
+{
+  HPCFMT_ThrowIfError(hpcfmt_str_fread(&(x->profileName), infs, alloc));
+  HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(x->numMetrics), infs));
+  HPCFMT_ThrowIfError(hpcfmt_int8_fread(&(x->offset), infs));
+  return HPCFMT_OK;
+}
+
+
+int
+hpcmetricDB_fmt_tocEntry_fwrite(hpcmetricDB_fmt_tocEntry_t* x, FILE* outfs)
+{
+  HPCFMT_ThrowIfError(hpcfmt_str_fwrite(x->profileName, outfs));
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(x->numMetrics, outfs));
+  HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(x->offset, outfs));
+  return HPCFMT_OK;
+}
+
+
+int
+hpcmetricDB_fmt_tocEntry_fprint(hpcmetricDB_fmt_tocEntry_t* x, FILE* outfs)
+{
+  fprintf(outfs, "[(profile: %s) (num-metrics: %u) (offset: %"PRIu64")]\n",
+	  x->profileName, x->numMetrics, x->offset);
+  return HPCFMT_OK;
+}
+
+
+void
+hpcmetricDB_fmt_tocEntry_free(hpcmetricDB_fmt_tocEntry_t* x,
+			      hpcfmt_free_fn dealloc)
+{
+  hpcfmt_str_free(x->profileName, dealloc);
+  x->profileName = NULL;
+}
+
+
+//***************************************************************************
+// [hpcprof-metricdb] profile data
+//***************************************************************************
 
+int
+hpcmetricDB_fmt_idx_fread(uint64_t* idx, uint32_t numMetrics, FILE* infs)
+{
+  for (uint32_t i = 0; i < numMetrics + 1; ++i) {
+    HPCFMT_ThrowIfError(hpcfmt_int8_fread(&idx[i], infs));
+  }
+  return HPCFMT_OK;
+}
+
+
+int
+hpcmetricDB_fmt_value_fread(uint32_t* nodeId, double* val, FILE* infs)
+{
+  HPCFMT_ThrowIfError(hpcfmt_int4_fread(nodeId, infs));
+  HPCFMT_ThrowIfError(hpcfmt_real8_fread(val, infs));
   return HPCFMT_OK;
 }
 
@@ -111,7 +111,7 @@ static const char HPCPROF_TmpFnmSfx[] = "tmp";
 // N.B.: The header string is 24 bytes of character data
 
 static const char HPCRUN_FMT_Magic[]   = "HPCRUN-profile____"; // 18 bytes
-static const char HPCRUN_FMT_Version[] = "03.00";              // 5 bytes
+static const char HPCRUN_FMT_Version[] = "04.00";              // 5 bytes
 static const char HPCRUN_FMT_Endian[]  = "b";                  // 1 byte
 
 static const int HPCRUN_FMT_MagicLen   = (sizeof(HPCRUN_FMT_Magic) - 1);
@@ -121,6 +121,8 @@ static const int HPCRUN_FMT_EndianLen  = (sizeof(HPCRUN_FMT_Endian) - 1);
 
 // currently supported versions
 static const double HPCRUN_FMT_Version_20 = 2.0;
+static const double HPCRUN_FMT_Version_30 = 3.0; // trace times in nanoseconds
+static const double HPCRUN_FMT_Version_40 = 4.0; // sparse cct node metrics
 
 
 typedef struct hpcrun_fmt_hdr_t {
@@ -551,11 +553,31 @@ hpcrun_fmt_cct_node_init(hpcrun_fmt_cct_node_t* x)
 }
 
 
+static inline bool
+hpcrun_fmt_doSparseMetrics(double fmtVersion)
+{
+  return (fmtVersion >= HPCRUN_FMT_Version_40);
+}
+
+
+// Metric values are read according to 'fmtVersion' (the file's
+// hpcrun_fmt_hdr_t version): dense before version 4.0; as a list of
+// (metric-id, value) pairs thereafter.  In either case, 'x->metrics'
+// holds a dense array of 'x->num_metrics' values.
 // N.B.: assumes space for metrics has been allocated
 extern int
 hpcrun_fmt_cct_node_fread(hpcrun_fmt_cct_node_t* x,
-			  epoch_flags_t flags, FILE* fs);
+			  epoch_flags_t flags, double fmtVersion, FILE* fs);
+
+// Like hpcrun_fmt_cct_node_fread, but decodes the node from the
+// in-memory image [*buf, end) and advances *buf past it.
+extern int
+hpcrun_fmt_cct_node_mread(hpcrun_fmt_cct_node_t* x,
+			  epoch_flags_t flags, double fmtVersion,
+			  const char** buf, const char* end);
 
+// Writes the current (HPCRUN_FMT_Version) layout: only non-zero
+// values of 'x->metrics' are written.
 extern int
 hpcrun_fmt_cct_node_fwrite(hpcrun_fmt_cct_node_t* x,
 			   epoch_flags_t flags, FILE* fs);
@@ -591,11 +613,17 @@ hpcrun_fmt_lip_fprint(lush_lip_t* x, FILE* fs, const char* pre);
 // Header sizes:
 // - version 1.00: 24 bytes
 // - version 1.01: 32 bytes: 24 + sizeof(hpctrace_hdr_flags_t)
+// - version 2.00: 32 bytes, as 1.01. The records are grouped into
+//   blocks (cf. [hpctrace] block) rather than stored one after another.
+//
+// Writers produce version 2.00; readers accept all of the above.
 
 static const char HPCTRACE_FMT_Magic[]   = "HPCRUN-trace______"; // 18 bytes
-static const char HPCTRACE_FMT_Version[] = "01.01";              // 5 bytes
+static const char HPCTRACE_FMT_Version[] = "02.00";              // 5 bytes
 static const char HPCTRACE_FMT_Endian[]  = "b";                  // 1 byte
 
+static const double HPCTRACE_FMT_Version_20 = 2.0; // block-framed records
+
 // Use of bit fields is not recommended as the order of fields 
 // is compiler and architecture dependent.
 /*
@@ -646,6 +674,10 @@ typedef struct hpctrace_fmt_hdr_t {
 
   hpctrace_hdr_flags_t flags;
 
+  // reader state for version 2.00, set up by hpctrace_fmt_hdr_fread()
+  uint32_t blockRecordsLeft; // records not yet read in the current block
+  uint64_t prevTime;         // time of the record read last
+
 } hpctrace_fmt_hdr_t;
 
 
@@ -705,25 +737,96 @@ typedef struct hpctrace_fmt_datum_t {
   hpctrace_fmt_time_dLCA_composite_t comp; // composite field that stores both time and dLCA
   uint32_t cpId; // call path id (CCT leaf id); cf. HPCRUN_FMT_CCTNodeId_NULL
   uint32_t metricId;
+  uint32_t dLCA; // only with HPCTRACE_HDR_FLAGS_LCA_RECORDED_BIT_POS (v2.0)
 } hpctrace_fmt_datum_t;
 
 
+// Reads the next record of a file of any version. 'hdr' must have been
+// filled in by hpctrace_fmt_hdr_fread() on the same stream.
+// Returns HPCFMT_EOF after the last record.
 int
-hpctrace_fmt_datum_fread(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
+hpctrace_fmt_datum_fread(hpctrace_fmt_datum_t* x, hpctrace_fmt_hdr_t* hdr,
 			 FILE* fs);
 
+// Records are written through hpctrace_fmt_block_t (cf. [hpctrace] block).
+
 int
-hpctrace_fmt_datum_outbuf(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
-			  hpcio_outbuf_t* outbuf);
+hpctrace_fmt_datum_fprint(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
+			  FILE* fs);
+
+
+//***************************************************************************
+// [hpctrace] block (version 2.00)
+//***************************************************************************
+
+// A block is a block header followed by the block's records:
+//   uint32 number of records
+//   uint32 length of the records, in bytes
+//   uint64 time of the first record
+//   uint64 time of the last record
+// The block headers form an index of the file: a reader looking for a
+// time reads one block header after another and skips the records of
+// every block that ends before it.
+//
+// Each record is a sequence of varints (cf. hpcfmt_varint_fread()):
+//   zigzag(time - time of the previous record in the block)
+//     (the first record's time is relative to the block's first time,
+//     so it is always 0)
+//   cpId
+//   dLCA, only with HPCTRACE_HDR_FLAGS_LCA_RECORDED_BIT_POS
+//   metricId, only with HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS
+// Samples arrive a few microseconds apart and cpIds are small, so a
+// record typically takes 4-6 bytes rather than 12 or 16.
+
+#define HPCTRACE_FMT_BlockHdrLen (2 * sizeof(uint32_t) + 2 * sizeof(uint64_t))
+
+// Most bytes of records in one block. Also bounds how many records are
+// lost if a process dies without closing its trace.
+#define HPCTRACE_FMT_BlockLen 4096
+
+// Longest encoding of one record: a 64-bit varint takes at most 10
+// bytes, a 32-bit one at most 5
+#define HPCTRACE_FMT_DatumMaxLen (10 + 5 + 5 + 5)
+
+typedef struct hpctrace_fmt_block_hdr_t {
+  uint32_t numRecords;
+  uint32_t len;
+  uint64_t firstTime;
+  uint64_t lastTime;
+} hpctrace_fmt_block_hdr_t;
+
+// A block being written. The block header is filled in when the block
+// is written out, so that header and records go out in one write.
+typedef struct hpctrace_fmt_block_t {
+  hpctrace_hdr_flags_t flags;
+  hpctrace_fmt_block_hdr_t hdr;
+  unsigned char buf[HPCTRACE_FMT_BlockHdrLen + HPCTRACE_FMT_BlockLen];
+} hpctrace_fmt_block_t;
+
+
+void
+hpctrace_fmt_block_init(hpctrace_fmt_block_t* blk, hpctrace_hdr_flags_t flags);
+
+// Appends a record to 'blk'. Returns true if 'blk' is full afterwards
+// and must be written out before the next record is added.
+bool
+hpctrace_fmt_block_add(hpctrace_fmt_block_t* blk, hpctrace_fmt_datum_t* x);
+
+// Writes out the records in 'blk', if any, and empties it.
+int
+hpctrace_fmt_block_outbuf(hpctrace_fmt_block_t* blk, hpcio_outbuf_t* outbuf);
 
 // N.B.: not async safe
 int
-hpctrace_fmt_datum_fwrite(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
-			  FILE* outfs);
+hpctrace_fmt_block_fwrite(hpctrace_fmt_block_t* blk, FILE* outfs);
 
+// Reads the next block header; returns HPCFMT_EOF after the last block.
+// The stream is left at the block's records: skip them with
+// fseek(fs, bhdr->len, SEEK_CUR), or read them with
+// hpctrace_fmt_datum_fread() after setting hdr->blockRecordsLeft and
+// hdr->prevTime from 'bhdr'.
 int
-hpctrace_fmt_datum_fprint(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
-			  FILE* fs);
+hpctrace_fmt_block_hdr_fread(hpctrace_fmt_block_hdr_t* bhdr, FILE* fs);
 
 
 //***************************************************************************
@@ -738,6 +841,9 @@ static const char HPCMETRICDB_FMT_Magic[]   = "HPCPROF-metricdb__"; // 18 bytes
 static const char HPCMETRICDB_FMT_Version[] = "00.10";              // 5 bytes
 static const char HPCMETRICDB_FMT_Endian[]  = "b";                  // 1 byte
 
+// version string of the aggregate db (hpcprof-mpi --metric-db-aggregate)
+static const char HPCMETRICDB_FMT_Version10[] = "01.00";            // 5 bytes
+
 #define HPCMETRICDB_FMT_MagicLenX   (sizeof(HPCMETRICDB_FMT_Magic) - 1)
 #define HPCMETRICDB_FMT_VersionLenX (sizeof(HPCMETRICDB_FMT_Version) - 1)
 #define HPCMETRICDB_FMT_EndianLenX  (sizeof(HPCMETRICDB_FMT_Endian) - 1)
@@ -750,8 +856,19 @@ static const int HPCMETRICDB_FMT_HeaderLen =
   (HPCMETRICDB_FMT_MagicLenX + HPCMETRICDB_FMT_VersionLenX
    + HPCMETRICDB_FMT_EndianLenX);
 
+// length of the complete version 1.0 header: the identification
+// string above followed by num-nodes (4), num-profiles (4) and
+// toc-offset (8)
+static const int HPCMETRICDB_FMT_HeaderLen_10 =
+  (HPCMETRICDB_FMT_HeaderLen + 4 + 4 + 8);
+
+// currently supported versions
+static const double HPCMETRICDB_FMT_Version_01 = 0.1;  // one dense db per profile
+static const double HPCMETRICDB_FMT_Version_10 = 1.0;  // sparse, aggregate db
 
 
+// N.B.: hpcmetricDB_fmt_hdr_fwrite() writes the version given by
+// 'version' (HPCMETRICDB_FMT_Version_01 or HPCMETRICDB_FMT_Version_10)
 typedef struct hpcmetricDB_fmt_hdr_t {
 
   char versionStr[sizeof(HPCMETRICDB_FMT_Version)];
@@ -759,8 +876,14 @@ typedef struct hpcmetricDB_fmt_hdr_t {
   char endian;
 
   uint32_t numNodes;
+
+  // version < 1.0
   uint32_t numMetrics;
 
+  // version >= 1.0
+  uint32_t numProfiles;
+  uint64_t tocOffset;
+
 } hpcmetricDB_fmt_hdr_t;
 
 
@@ -773,6 +896,56 @@ hpcmetricDB_fmt_hdr_fwrite(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs);
 int
 hpcmetricDB_fmt_hdr_fprint(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs);
 
+
+//***************************************************************************
+// [hpcprof-metricdb] table of contents (version >= 1.0)
+//***************************************************************************
+
+// One entry per profile in the db.  'offset' is the file offset of
+// the profile's data: a metric index of (numMetrics + 1) 8-byte
+// entries followed by the profile's (node-id, value) pairs.  The
+// pairs of metric i are pairs [index[i], index[i+1]) and are sorted
+// by node-id; nodes with a zero value are omitted.
+
+typedef struct hpcmetricDB_fmt_tocEntry_t {
+
+  char* profileName;
+  uint32_t numMetrics;
+  uint64_t offset;
+
+} hpcmetricDB_fmt_tocEntry_t;
+
+
+static const size_t HPCMETRICDB_FMT_IdxEntryLen = 8;
+static const size_t HPCMETRICDB_FMT_ValueLen    = 4 + 8; // node-id, value
+
+
+int
+hpcmetricDB_fmt_tocEntry_fread(hpcmetricDB_fmt_tocEntry_t* x, FILE* infs,
+			       hpcfmt_alloc_fn alloc);
+
+int
+hpcmetricDB_fmt_tocEntry_fwrite(hpcmetricDB_fmt_tocEntry_t* x, FILE* outfs);
+
+int
+hpcmetricDB_fmt_tocEntry_fprint(hpcmetricDB_fmt_tocEntry_t* x, FILE* outfs);
+
+void
+hpcmetricDB_fmt_tocEntry_free(hpcmetricDB_fmt_tocEntry_t* x,
+			      hpcfmt_free_fn dealloc);
+
+
+//***************************************************************************
+// [hpcprof-metricdb] profile data (version >= 1.0)
+//***************************************************************************
+
+// N.B.: assumes space for (numMetrics + 1) entries in 'idx'
+int
+hpcmetricDB_fmt_idx_fread(uint64_t* idx, uint32_t numMetrics, FILE* infs);
+
+int
+hpcmetricDB_fmt_value_fread(uint32_t* nodeId, double* val, FILE* infs);
+
 // --------------------------------------------------------------------------
 // additional sampling info
 // --------------------------------------------------------------------------
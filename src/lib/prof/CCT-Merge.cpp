@@ -99,6 +99,12 @@ MergeContext::MergeContext(Tree* cct, bool doTrackCPIds)
 }
 
 
+MergeContext::~MergeContext()
+{
+  clearDynChildIndex();
+}
+
+
 void
 MergeContext::fillCPIdSet(Tree* cct)
 {
@@ -113,6 +119,105 @@ MergeContext::fillCPIdSet(Tree* cct)
 }
 
 
+ADynNode*
+MergeContext::findDynChild(ANode* x, const ADynNode& y_dyn)
+{
+  // The index only reproduces the first (exact) merge condition of
+  // ADynNode::isMergable.  The second holds only if y_dyn is
+  // structured, which is rare during merges.
+  if (y_dyn.structure()) {
+    return x->findDynChild(y_dyn);
+  }
+
+  DynChildIndex* idx = NULL;
+
+  DynChildIndexMap::iterator it = m_dynChildIdxMap.find(x);
+  if (it != m_dynChildIdxMap.end()) {
+    idx = it->second;
+  }
+  else if (x->childCount() >= DynChildIndexMinFanOut) {
+    idx = new DynChildIndex;
+    buildDynChildIndex(x, *idx);
+    m_dynChildIdxMap.insert(std::make_pair(x, idx));
+  }
+  else {
+    return x->findDynChild(y_dyn);
+  }
+
+  DynChildIndex::iterator fnd = idx->find(makeDynChildKey(y_dyn));
+  if (fnd == idx->end()) {
+    return NULL;
+  }
+
+  // N.B.: candidates are in findDynChild() order; lush association
+  // classes must still be compared
+  std::vector<ADynNode*>& candidates = fnd->second;
+  for (uint i = 0; i < candidates.size(); ++i) {
+    if (ADynNode::isMergable(*candidates[i], y_dyn)) {
+      return candidates[i];
+    }
+  }
+  return NULL;
+}
+
+
+void
+MergeContext::noteDynChild(ANode* x, ADynNode* x_child)
+{
+  DynChildIndexMap::iterator it = m_dynChildIdxMap.find(x);
+  if (it != m_dynChildIdxMap.end()) {
+    (*it->second)[makeDynChildKey(*x_child)].push_back(x_child);
+  }
+}
+
+
+void
+MergeContext::clearDynChildIndex()
+{
+  for (DynChildIndexMap::iterator it = m_dynChildIdxMap.begin();
+       it != m_dynChildIdxMap.end(); ++it) {
+    delete it->second;
+  }
+  m_dynChildIdxMap.clear();
+}
+
+
+MergeContext::DynChildKey
+MergeContext::makeDynChildKey(const ADynNode& x)
+{
+  DynChildKey key;
+  key.lmIP = x.lmIP_real();
+  key.lmId = x.lmId_real();
+  key.pathLen = lush_assoc_info__get_path_len(x.assocInfo());
+  key.isLeaf = x.isLeaf();
+
+  const lush_lip_t* lip = x.lip();
+  key.hasLip = (lip != NULL);
+  key.lip[0] = (lip) ? lip->data8[0] : 0;
+  key.lip[1] = (lip) ? lip->data8[1] : 0;
+  return key;
+}
+
+
+// buildDynChildIndex: visit z's direct ADynNode descendents in the
+// same order as ANode::findDynChild
+void
+MergeContext::buildDynChildIndex(ANode* z, DynChildIndex& idx)
+{
+  for (ANodeChildIterator it(z); it.Current(); ++it) {
+    ANode* x = it.current();
+
+    ADynNode* x_dyn = dynamic_cast<ADynNode*>(x);
+    if (x_dyn) {
+      idx[makeDynChildKey(*x_dyn)].push_back(x_dyn);
+    }
+    else {
+      buildDynChildIndex(x, idx);
+    }
+  }
+}
+
+
 //***************************************************************************
 // MergeEffect
 //***************************************************************************
@@ -165,3 +270,138 @@ MergeEffect::dump(const MergeEffectList& effctLst,
 
 } // namespace Prof
 
+
+
+//***************************************************************************
+// unit test
+//***************************************************************************
+
+// Merges two profiles whose roots have a high fan-out (a dispatch loop
+// with thousands of call sites), each call site with one statement
+// leaf.  y holds 'fanOut' call sites; half of them are also in x, and
+// both are in random order.  For each fan-out, reports the time of
+// Tree::merge (which indexes x's children) and of the same merge using
+// the linear ANode::findDynChild, and checks that both produce the
+// same children.
+//
+// build with UNIT_TEST defined, linking lib/prof, lib/xml, lib/support
+// and lib/prof-lean.
+
+// #define UNIT_TEST
+#ifdef UNIT_TEST
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "CallPath-Profile.hpp"
+
+static Prof::CallPath::Profile*
+makeFanOutProfile(uint ipBeg, uint fanOut, uint seed)
+{
+  using namespace Prof;
+
+  CallPath::Profile* prof = CallPath::Profile::make(0);
+  CCT::ANode* root = prof->cct()->root();
+
+  std::vector<uint> ips;
+  for (uint i = 0; i < fanOut; ++i) {
+    ips.push_back(ipBeg + i);
+  }
+  std::mt19937 rng(seed);
+  std::shuffle(ips.begin(), ips.end(), rng);
+
+  Metric::IData metrics(0);
+  for (uint i = 0; i < ips.size(); ++i) {
+    VMA ip = 0x1000 + 0x10 * ips[i];
+    CCT::ANode* call = new CCT::Call(root, 0, lush_assoc_info_NULL, 1, ip,
+				     0, NULL, metrics);
+    new CCT::Stmt(call, 0, lush_assoc_info_NULL, 1, ip + 4, 0, NULL,
+		  metrics);
+  }
+  return prof;
+}
+
+
+// mergeLinear: Tree::merge of one level (with leaves moved along)
+// before MergeContext indexed children
+static void
+mergeLinear(Prof::CCT::ANode* x, Prof::CCT::ANode* y)
+{
+  using namespace Prof;
+
+  for (CCT::ANodeChildIterator it(y); it.Current(); /* */) {
+    CCT::ADynNode* y_child = dynamic_cast<CCT::ADynNode*>(it.current());
+    it++;
+
+    CCT::ADynNode* x_child = x->findDynChild(*y_child);
+    if (!x_child) {
+      y_child->unlink();
+      y_child->link(x);
+    }
+  }
+}
+
+
+static double
+secondsSince(std::chrono::steady_clock::time_point t0)
+{
+  std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+  return dt.count();
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  using namespace Prof;
+
+  int nErr = 0;
+  for (uint fanOut = 1000; fanOut <= 16000; fanOut *= 2) {
+    // x: call sites [0, fanOut); y: [fanOut/2, fanOut + fanOut/2)
+    CallPath::Profile* x1 = makeFanOutProfile(0, fanOut, 1);
+    CallPath::Profile* y1 = makeFanOutProfile(fanOut / 2, fanOut, 2);
+    CallPath::Profile* x2 = makeFanOutProfile(0, fanOut, 1);
+    CallPath::Profile* y2 = makeFanOutProfile(fanOut / 2, fanOut, 2);
+
+    std::chrono::steady_clock::time_point t0 =
+      std::chrono::steady_clock::now();
+    mergeLinear(x1->cct()->root(), y1->cct()->root());
+    double tmLinear = secondsSince(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    CCT::MergeEffectList* effcts = x2->cct()->merge(y2->cct(), 0);
+    double tmIndexed = secondsSince(t0);
+    delete effcts;
+
+    // compare children in order
+    bool isEq = (x1->cct()->root()->childCount()
+		 == x2->cct()->root()->childCount());
+    CCT::ANodeChildIterator it1(x1->cct()->root());
+    CCT::ANodeChildIterator it2(x2->cct()->root());
+    for ( ; isEq && it1.Current(); it1++, it2++) {
+      CCT::ADynNode* n1 = dynamic_cast<CCT::ADynNode*>(it1.current());
+      CCT::ADynNode* n2 = dynamic_cast<CCT::ADynNode*>(it2.current());
+      isEq = (n1->lmIP() == n2->lmIP()
+	      && n1->childCount() == n2->childCount());
+    }
+    if (!isEq) {
+      nErr++;
+    }
+
+    printf("fan-out %6u: linear %8.3fs  indexed %8.3fs  (%.0fx) %s\n",
+	   fanOut, tmLinear, tmIndexed, tmLinear / tmIndexed,
+	   isEq ? "" : "MISMATCH");
+
+    delete x1;
+    delete y1;
+    delete x2;
+    delete y2;
+  }
+
+  return nErr;
+}
+
+#endif // UNIT_TEST
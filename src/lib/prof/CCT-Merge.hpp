@@ -68,6 +68,7 @@
 #include <vector>
 #include <list>
 #include <set>
+#include <unordered_map>
 
 //*************************** User Include Files ****************************
 
@@ -140,6 +141,8 @@ namespace Prof {
 namespace CCT {
 
 class Tree;
+class ANode;
+class ADynNode;
 
 enum {
   // -------------------------------------------------------
@@ -168,6 +171,7 @@ public:
 
 public:
   MergeContext(Tree* cct, bool doTrackCPIds);
+  ~MergeContext();
 
   // -------------------------------------------------------
   // 
@@ -254,10 +258,67 @@ public:
     return newId;
   }
 
+  // -------------------------------------------------------
+  // Child index: For an interior node x with high fan-out, an index
+  // of x's direct ADynNode descendents (cf. ANode::findDynChild),
+  // keyed by the fields that ADynNode::isMergable compares exactly.
+  // Indices are built on demand and dropped after each Tree::merge.
+  // -------------------------------------------------------
+
+  // findDynChild: equivalent to x->findDynChild(y_dyn)
+  ADynNode*
+  findDynChild(ANode* x, const ADynNode& y_dyn);
+
+  // noteDynChild: x_child has just been linked as the last child of x
+  void
+  noteDynChild(ANode* x, ADynNode* x_child);
+
+  void
+  clearDynChildIndex();
+
 private:
   void
   fillCPIdSet(Tree* cct);
 
+  struct DynChildKey {
+    bool operator==(const DynChildKey& y) const
+    {
+      return (lmIP == y.lmIP && lmId == y.lmId && isLeaf == y.isLeaf
+	      && pathLen == y.pathLen && hasLip == y.hasLip
+	      && lip[0] == y.lip[0] && lip[1] == y.lip[1]);
+    }
+
+    uint64_t lmIP;
+    uint64_t lip[2];
+    uint lmId;
+    uint pathLen;
+    bool isLeaf;
+    bool hasLip;
+  };
+
+  struct DynChildKeyHash {
+    size_t operator()(const DynChildKey& x) const
+    {
+      uint64_t h = x.lmIP * 0x9e3779b97f4a7c15ULL;
+      h ^= ((uint64_t)x.lmId << 32) ^ ((uint64_t)x.pathLen << 1) ^ x.isLeaf;
+      h ^= x.lip[0] + (x.lip[1] << 7);
+      return (size_t)(h ^ (h >> 29));
+    }
+  };
+
+  typedef std::unordered_map<DynChildKey, std::vector<ADynNode*>,
+			     DynChildKeyHash> DynChildIndex;
+  typedef std::unordered_map<const ANode*, DynChildIndex*> DynChildIndexMap;
+
+  // fan-out at or above which findDynChild() builds an index
+  static const uint DynChildIndexMinFanOut = 16;
+
+  static DynChildKey
+  makeDynChildKey(const ADynNode& x);
+
+  static void
+  buildDynChildIndex(ANode* z, DynChildIndex& idx);
+
 private:
   const Tree* m_cct;
 
@@ -265,6 +326,8 @@ private:
 
   bool m_isTrackingCPIds;
   CPIdSet m_cpIdSet;
+
+  DynChildIndexMap m_dynChildIdxMap;
 };
 
 } // namespace CCT
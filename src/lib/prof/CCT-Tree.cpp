@@ -76,6 +76,8 @@ using std::set;
 
 #include <typeinfo>
 
+#include <algorithm>
+
 //*************************** User Include Files ****************************
 
 #include <include/gcc-attr.h>
@@ -83,6 +85,7 @@ using std::set;
 
 #include "CCT-Tree.hpp"
 #include "CallPath-Profile.hpp" // for CCT::Tree::metadata()
+#include "Metric-AExprCode.hpp"
 
 #include <lib/xml/xml.hpp> 
 
@@ -148,7 +151,7 @@ namespace CCT {
 Tree::Tree(const CallPath::Profile* metadata)
   : m_root(NULL), m_metadata(metadata),
     m_maxDenseId(0), m_nodeidMap(NULL),
-    m_mergeCtxt(NULL)
+    m_metricColumns(NULL), m_mergeCtxt(NULL)
 {
 }
 
@@ -158,6 +161,7 @@ Tree::~Tree()
   delete m_root;
   m_metadata = NULL;
   delete m_nodeidMap;
+  delete m_metricColumns; // after the nodes attached to it
   delete m_mergeCtxt;
 }
 
@@ -209,6 +213,8 @@ Tree::merge(const Tree* y, uint x_newMetricBegIdx, uint mrgFlag, uint oFlag)
   MergeEffectList* mrgEffects =
     x_root->mergeDeep(y_root, x_newMetricBegIdx, *m_mergeCtxt, oFlag);
 
+  m_mergeCtxt->clearDynChildIndex();
+
   DIAG_If(0 /*public diag level*/) {
     verifyUniqueCPIds();
   }
@@ -239,6 +245,49 @@ Tree::makeDensePreorderIds()
 }
 
 
+void
+Tree::makeMetricColumns()
+{
+  if (m_metricColumns || !m_root) {
+    return;
+  }
+  DIAG_Assert(m_maxDenseId > 0, "Prof::CCT::Tree::makeMetricColumns(): no dense ids");
+
+  m_metricColumns = new Metric::ColumnStore(m_maxDenseId + 1);
+
+  for (ANodeIterator it(m_root); it.Current(); ++it) {
+    ANode* n = it.current();
+    DIAG_Assert(n->id() <= m_maxDenseId, "Prof::CCT::Tree::makeMetricColumns(): " << DIAG_UnexpectedInput);
+    n->attachMetrics(m_metricColumns, n->id());
+  }
+}
+
+
+static bool
+isIdLess(const ANode* x, const ANode* y)
+{
+  return (x->id() < y->id());
+}
+
+
+void
+Tree::renumberUniqueIds()
+{
+  std::vector<ANode*> nodes;
+  for (ANodeIterator it(m_root); it.Current(); ++it) {
+    nodes.push_back(it.current());
+  }
+  std::sort(nodes.begin(), nodes.end(), isIdLess);
+
+  for (uint i = 0; i < nodes.size(); ++i) {
+    nodes[i]->renewId();
+  }
+
+  delete m_nodeidMap;
+  m_nodeidMap = NULL;
+}
+
+
 ANode*
 Tree::findNode(uint nodeId) const
 {
@@ -450,9 +499,18 @@ ANode::zeroMetricsDeep(uint mBegId, uint mEndId)
     return; // short circuit
   }
 
+  // The rows of a tree's column store belong to its nodes (or to
+  // deleted ones), so for a root, zero whole columns.
+  Metric::ColumnStore* store = (!parent()) ? metricStore() : NULL;
+  if (store) {
+    store->zeroColumns(mBegId, mEndId);
+  }
+
   for (ANodeIterator it(this); it.Current(); ++it) {
     ANode* n = it.current();
-    n->zeroMetrics(mBegId, mEndId);
+    if (!store || n->metricStore() != store) {
+      n->zeroMetrics(mBegId, mEndId);
+    }
   }
 }
 
@@ -476,11 +534,41 @@ ANode::aggregateMetricsIncl(const VMAIntervalSet& ivalset)
   }
 
   const ANode* root = this;
+
+  // If the subtree lives in one column store, aggregate one column at
+  // a time over the (node, parent) rows in post order.
+  Metric::ColumnStore* store = metricStore();
+  if (store) {
+    Metric::ColumnStore::RowPairVec rows;
+    ANodeIterator it(root, NULL/*filter*/, false/*leavesOnly*/,
+		     IteratorStack::PostOrder);
+    for (ANode* n = NULL; (n = it.current()); ++it) {
+      if (n->metricStore() != store) {
+	store = NULL;
+	break;
+      }
+      if (n != root) {
+	rows.push_back(std::make_pair(n->metricRow(),
+				      n->parent()->metricRow()));
+      }
+    }
+
+    if (store) {
+      for (VMAIntervalSet::const_iterator it1 = ivalset.begin();
+	   it1 != ivalset.end(); ++it1) {
+	const VMAInterval& ival = *it1;
+	store->addRows(rows, (uint)ival.beg(), (uint)ival.end());
+      }
+      return;
+    }
+  }
+
   ANodeIterator it(root, NULL/*filter*/, false/*leavesOnly*/,
 		   IteratorStack::PostOrder);
   for (ANode* n = NULL; (n = it.current()); ++it) {
     if (n != root) {
       ANode* n_parent = n->parent();
+      const Metric::IData& n_mdata = *n;
       
       for (VMAIntervalSet::const_iterator it1 = ivalset.begin();
 	   it1 != ivalset.end(); ++it1) {
@@ -488,7 +576,7 @@ ANode::aggregateMetricsIncl(const VMAIntervalSet& ivalset)
 	uint mBegId = (uint)ival.beg(), mEndId = (uint)ival.end();
 
 	for (uint mId = mBegId; mId < mEndId; ++mId) {
-	  double mVal = n->demandMetric(mId, mEndId/*size*/);
+	  double mVal = n_mdata.demandMetric(mId, mEndId/*size*/);
 	  n_parent->demandMetric(mId, mEndId/*size*/) += mVal;
 	}
       }
@@ -579,6 +667,7 @@ ANode::aggregateMetricsExcl(AProcNode* frame, const VMAIntervalSet& ivalset)
   // -------------------------------------------------------
   if (typeid(*n) == typeid(CCT::Stmt) || isInlineMacro) {
     ANode* n_parent = n->parent();
+    const Metric::IData& n_mdata = *n;
 
     for (VMAIntervalSet::const_iterator it = ivalset.begin();
         it != ivalset.end(); ++it) {
@@ -586,7 +675,7 @@ ANode::aggregateMetricsExcl(AProcNode* frame, const VMAIntervalSet& ivalset)
       uint mBegId = (uint)ival.beg(), mEndId = (uint)ival.end();
 
       for (uint mId = mBegId; mId < mEndId; ++mId) {
-        double mVal = n->demandMetric(mId, mEndId/*size*/);
+        double mVal = n_mdata.demandMetric(mId, mEndId/*size*/);
         n_parent->demandMetric(mId, mEndId/*size*/) += mVal;
         if (frame && frame != n_parent) {
           frame->demandMetric(mId, mEndId/*size*/) += mVal;
@@ -608,31 +697,47 @@ ANode::computeMetrics(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
   // N.B. pre-order walk assumes point-wise metrics
   // Cf. Analysis::Flat::Driver::computeDerivedBatch().
 
-  for (ANodeIterator it(this); it.Current(); ++it) {
-    ANode* n = it.current();
-    n->computeMetricsMe(mMgr, mBegId, mEndId, doFinal);
-  }
-}
-
-
-void
-ANode::computeMetricsMe(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
-			bool doFinal)
-{
+  // Lower the metrics to one code sequence, in metric order, that
+  // does for a node what evalNF() and eval() of each metric's
+  // expression do; then run it over blocks of nodes.
   uint numMetrics = mMgr.size();
 
+  Metric::AExprCode code;
   for (uint mId = mBegId; mId < mEndId; ++mId) {
     const Metric::ADesc* m = mMgr.metric(mId);
     const Metric::DerivedDesc* mm = dynamic_cast<const Metric::DerivedDesc*>(m);
     if (mm && mm->expr()) {
       const Metric::AExpr* expr = mm->expr();
-      expr->evalNF(*this);
+      expr->compileNF(code);
       if (doFinal) {
-	double val = expr->eval(*this);
-	demandMetric(mId, numMetrics/*size*/) = val;
+	expr->compile(code);
+	code.emit(Metric::AExprCode::OpStore, mId);
       }
     }
   }
+
+  if (code.empty()) {
+    return;
+  }
+
+  std::vector<double> scratch;
+  Metric::IData* block[Metric::AExprCode::BlockSz];
+  uint n = 0;
+
+  for (ANodeIterator it(this); it.Current(); ++it) {
+    ANode* x = it.current();
+    if (doFinal) {
+      x->ensureMetricsSize(numMetrics);
+    }
+    block[n++] = x;
+    if (n == Metric::AExprCode::BlockSz) {
+      code.eval(block, n, scratch);
+      n = 0;
+    }
+  }
+  if (n > 0) {
+    code.eval(block, n, scratch);
+  }
 }
 
 
@@ -647,39 +752,35 @@ ANode::computeMetricsIncr(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
   // N.B. pre-order walk assumes point-wise metrics
   // Cf. Analysis::Flat::Driver::computeDerivedBatch().
 
-  for (ANodeIterator it(this); it.Current(); ++it) {
-    ANode* n = it.current();
-    n->computeMetricsIncrMe(mMgr, mBegId, mEndId, fn);
-  }
-}
-
-
-void
-ANode::computeMetricsIncrMe(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
-			    Metric::AExprIncr::FnTy fn)
-{
+  // cf. computeMetrics()
+  Metric::AExprCode code;
   for (uint mId = mBegId; mId < mEndId; ++mId) {
     const Metric::ADesc* m = mMgr.metric(mId);
     const Metric::DerivedIncrDesc* mm =
       dynamic_cast<const Metric::DerivedIncrDesc*>(m);
     if (mm && mm->expr()) {
-      const Metric::AExprIncr* expr = mm->expr();
-      switch (fn) {
-        case Metric::AExprIncr::FnInit:
-	  expr->initialize(*this); break;
-        case Metric::AExprIncr::FnInitSrc:
-	  expr->initializeSrc(*this); break;
-        case Metric::AExprIncr::FnAccum:
-	  expr->accumulate(*this); break;
-        case Metric::AExprIncr::FnCombine:
-	  expr->combine(*this); break;
-        case Metric::AExprIncr::FnFini:
-	  expr->finalize(*this); break;
-        default:
-	  DIAG_Die(DIAG_UnexpectedInput);
-      }
+      mm->expr()->compile(fn, code);
     }
   }
+
+  if (code.empty()) {
+    return;
+  }
+
+  std::vector<double> scratch;
+  Metric::IData* block[Metric::AExprCode::BlockSz];
+  uint n = 0;
+
+  for (ANodeIterator it(this); it.Current(); ++it) {
+    block[n++] = it.current();
+    if (n == Metric::AExprCode::BlockSz) {
+      code.eval(block, n, scratch);
+      n = 0;
+    }
+  }
+  if (n > 0) {
+    code.eval(block, n, scratch);
+  }
 }
 
 
@@ -690,6 +791,7 @@ ANode::pruneByMetrics(const Metric::Mgr& mMgr, const VMAIntervalSet& ivalset,
 {
   for (ANodeChildIterator it(this); it.Current(); /* */) {
     ANode* x = it.current();
+    const Metric::IData& x_mdata = *x; // N.B.: reads leave columns alone
     it++; // advance iterator -- it is pointing at 'x'
 
 
@@ -713,7 +815,7 @@ ANode::pruneByMetrics(const Metric::Mgr& mMgr, const VMAIntervalSet& ivalset,
 	
 	double total = root->metric(mId); // root->metric(m->partner()->id());
 	
-	double pct = x->metric(mId) * 100 / total;
+	double pct = x_mdata.metric(mId) * 100 / total;
 	if (pct >= thresholdPct) {
 	  isImportant = true;
 	  break;
@@ -847,7 +949,7 @@ ANode::mergeDeep(ANode* y, uint x_newMetricBegIdx, MergeContext& mrgCtxt,
 
     MergeEffectList* effctLst1 = NULL;
 
-    ADynNode* x_child_dyn = x->findDynChild(*y_child_dyn);
+    ADynNode* x_child_dyn = mrgCtxt.findDynChild(x, *y_child_dyn);
 
 #define MERGE_ACTION 0
 #define MERGE_ERROR 0
@@ -869,6 +971,7 @@ ANode::mergeDeep(ANode* y, uint x_newMetricBegIdx, MergeContext& mrgCtxt,
 	effctLst1 = y_child->mergeDeep_fixInsert(x_newMetricBegIdx, mrgCtxt);
 
 	y_child->link(x);
+	mrgCtxt.noteDynChild(x, y_child_dyn);
       }
     }
     else {
@@ -933,7 +1036,10 @@ ANode::mergeMe(const ANode& y, MergeContext* GCC_ATTR_UNUSED mrgCtxt,
   }
 
   for (uint x_i = metricBegIdx, y_i = 0; x_i < x_end; ++x_i, ++y_i) {
-    x->metric(x_i) += y.metric(y_i);
+    double y_val = y.metric(y_i);
+    if (y_val != 0.0) { // N.B.: keep columnar blocks sparse
+      x->metric(x_i) += y_val;
+    }
   }
   
   MergeEffect noopEffect;
@@ -139,7 +139,8 @@ public:
     OFlg_LeafMetricsOnly = (1 << 1), // Write metrics only at leaves (outdated)
     OFlg_Debug           = (1 << 2), // Debug: show xtra source line info
     OFlg_DebugAll        = (1 << 3), // Debug: (may be invalid format)
-    OFlg_StructId        = (1 << 4)  // Add hpcstruct node id (for debug)
+    OFlg_StructId        = (1 << 4), // Add hpcstruct node id (for debug)
+    OFlg_MetricDBAggregate = (1 << 5) // Metric db is hpcprof-metricdb 01.00
   };
 
 
@@ -191,6 +192,14 @@ public:
   uint
   maxDenseId() const
   { return m_maxDenseId; }
+
+  // renumberUniqueIds: gives every node a fresh unique id, in
+  // ascending order of its current id.  Profiles that are read
+  // concurrently draw ids from one interleaved sequence; renumbering
+  // them one after another in file order restores the relative order
+  // of ids that a serial read produces (cf. Analysis::CallPath::read).
+  void
+  renumberUniqueIds();
  
   // -------------------------------------------------------
   // nodeId -> ANode map (built on demand)
@@ -199,6 +208,22 @@ public:
   ANode*
   findNode(uint nodeId) const;
 
+  // -------------------------------------------------------
+  // columnar metrics (only used when explicitly requested)
+  // -------------------------------------------------------
+
+  // makeMetricColumns: moves the metrics of each node into a column
+  // store owned by the tree, at the row given by its dense id.
+  // Assumes makeDensePreorderIds(); ids may be remade afterward.
+  // Nodes created or moved here from another tree afterward keep
+  // private metrics.
+  void
+  makeMetricColumns();
+
+  Metric::ColumnStore*
+  metricColumns() const
+  { return m_metricColumns; }
+
   // -------------------------------------------------------
   // 
   // -------------------------------------------------------
@@ -250,6 +275,9 @@ private:
   uint m_maxDenseId;
   mutable NodeIdToANodeMap* m_nodeidMap;
 
+  // columnar metrics
+  Metric::ColumnStore* m_metricColumns;
+
   // merge information, cached here for performance
   MergeContext* m_mergeCtxt;
 };
@@ -320,19 +348,15 @@ public:
   ANode(ANodeTy type, ANode* parent, Struct::ACodeNode* strct = NULL)
     : NonUniformDegreeTreeNode(parent),
       Metric::IData(),
-      m_type(type), m_id(s_nextUniqueId), m_strct(strct)
-  {
-    s_nextUniqueId += 2; // cf. HPCRUN_FMT_RetainIdFlag
-  }
+      m_type(type), m_id(nextUniqueId()), m_strct(strct)
+  { }
 
   ANode(ANodeTy type,
 	ANode* parent, Struct::ACodeNode* strct, const Metric::IData& metrics)
     : NonUniformDegreeTreeNode(parent),
       Metric::IData(metrics),
-      m_type(type), m_id(s_nextUniqueId), m_strct(strct)
-  {
-    s_nextUniqueId += 2; // cf. HPCRUN_FMT_RetainIdFlag
-  }
+      m_type(type), m_id(nextUniqueId()), m_strct(strct)
+  { }
 
   virtual ~ANode()
   { }
@@ -341,10 +365,9 @@ public:
   ANode(const ANode& x)
     : NonUniformDegreeTreeNode(NULL),
       Metric::IData(x),
-      m_type(x.m_type), m_id(s_nextUniqueId), m_strct(x.m_strct)
+      m_type(x.m_type), m_id(nextUniqueId()), m_strct(x.m_strct)
   {
     zeroLinks();
-    s_nextUniqueId += 2; // cf. HPCRUN_FMT_RetainIdFlag
   }
 
   // deep copy of internals (but without children)
@@ -355,8 +378,7 @@ public:
       //NonUniformDegreeTreeNode::operator=(x);
       Metric::IData::operator=(x);
       m_type = x.m_type;
-      m_id = s_nextUniqueId;
-      s_nextUniqueId += 2;
+      m_id = nextUniqueId();
       // m_id: skip
       m_strct = x.m_strct;
     }
@@ -388,6 +410,11 @@ public:
   id(uint id)
   { m_id = id; }
 
+  // renewId: replaces the id with the next unique id
+  void
+  renewId()
+  { m_id = nextUniqueId(); }
+
   
   // 'name()' is overridden by some derived classes
   virtual const std::string&
@@ -529,27 +556,17 @@ private:
 public:
   // computeMetrics: compute this subtree's Metric::DerivedDesc metric
   //   values for metric ids [mBegId, mEndId)
-  // computeMetricsMe: same, but for the node (not the subtree)
   void
   computeMetrics(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
 		 bool doFinal);
 
-  void
-  computeMetricsMe(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
-		   bool doFinal);
-
 
   // computeMetricsIncr: compute this subtree's Metric::DerivedIncrDesc metric
   //   values for metric ids [mBegId, mEndId)
-  // computeMetricsIncrMe: same, but for the node (not the subtree)
   void
   computeMetricsIncr(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
 		     Metric::AExprIncr::FnTy fn);
 
-  void
-  computeMetricsIncrMe(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
-		       Metric::AExprIncr::FnTy fn);
-
   // pruneByMetrics: TODO: make this static for consistency
   void
   pruneByMetrics(const Metric::Mgr& mMgr, const VMAIntervalSet& ivalset,
@@ -679,6 +696,13 @@ protected:
 
 
 private:
+  // N.B.: profiles may be read concurrently (cf. Analysis::CallPath::read)
+  static uint
+  nextUniqueId()
+  {
+    return __sync_fetch_and_add(&s_nextUniqueId, 2); // cf. HPCRUN_FMT_RetainIdFlag
+  }
+
   static uint s_nextUniqueId;
   
 protected:
@@ -80,6 +80,8 @@ using std::string;
 
 #include <stdint.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
@@ -105,6 +107,7 @@ using namespace xml;
 
 
 #include <lib/prof-lean/hpcfmt.h>
+#include <lib/prof-lean/hpcio-pack.h>
 #include <lib/prof-lean/hpcrun-fmt.h>
 #include <lib/prof-lean/hpcrun-metric.h>
 
@@ -195,7 +198,13 @@ Profile::merge(Profile& y, int mergeTy, uint mrgFlag)
   Profile& x = (*this);
 
   DIAG_Assert(!y.m_structure, "Profile::merge: source profile should not have structure yet!");
-  DIAG_Assert(y.m_fmtVersion == x.m_fmtVersion, "Error: cannot merge two different versions of measurement");
+  // Versions that differ only in their on-disk cct-node encoding
+  // (e.g., 03.00 and 04.00) describe equivalent measurements; versions
+  // with different trace time units do not.
+  DIAG_Assert(x.m_fmtVersion == 0.0 || y.m_fmtVersion == 0.0
+	      || ((x.m_fmtVersion < HPCRUN_FMT_Version_30)
+		  == (y.m_fmtVersion < HPCRUN_FMT_Version_30)),
+	      "Error: cannot merge two different versions of measurement");
 
   // -------------------------------------------------------
   // merge name, flags, etc
@@ -223,9 +232,6 @@ Profile::merge(Profile& y, int mergeTy, uint mrgFlag)
     y.m_measurementGranularity = x.m_measurementGranularity;
   }
 
-  DIAG_WMsgIf(x.m_fmtVersion != y.m_fmtVersion,
-	      "CallPath::Profile::merge(): ignoring incompatible versions: "
-	      << x.m_fmtVersion << " vs. " << y.m_fmtVersion);
   DIAG_WMsgIf(x.m_flags.bits != y.m_flags.bits,
 	      "CallPath::Profile::merge(): ignoring incompatible flags: "
 	      << x.m_flags.bits << " vs. " << y.m_flags.bits);
@@ -411,7 +417,14 @@ Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
 
   DIAG_MsgIf(0, "Profile::merge_fixTrace: " << m_traceFileName);
 
-  string traceFileNameTmp = m_traceFileName + "." + HPCPROF_TmpFnmSfx;
+  // a trace in a pack file is rewritten next to the pack
+  char traceFileNameUnpacked[PATH_MAX];
+  if (hpcio_pack_unpacked_name(m_traceFileName.c_str(), traceFileNameUnpacked,
+			       sizeof(traceFileNameUnpacked)) != 0) {
+    DIAG_Throw("trace file name too long: " << m_traceFileName);
+  }
+  string traceFileNameTmp =
+    string(traceFileNameUnpacked) + "." + HPCPROF_TmpFnmSfx;
 
   char* infsBuf = new char[HPCIO_RWBufferSz];
   char* outfsBuf = new char[HPCIO_RWBufferSz];
@@ -429,6 +442,7 @@ Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
   DIAG_AssertWarn(ret == 0, inFnm << ": Profile::merge_fixTrace: setvbuf!");
 
   hpctrace_fmt_hdr_t hdr;
+  hpctrace_fmt_block_t block;
   ret = hpctrace_fmt_hdr_fread(&hdr, infs);
   if (ret == HPCFMT_ERR) {
     std::string errorString;
@@ -462,10 +476,14 @@ Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
   ret = hpctrace_fmt_hdr_fwrite(hdr.flags, outfs);
   if (ret == HPCFMT_ERR) goto badwrite;
 
+  // the result is written in the current format whatever the version
+  // of the measurement file
+  hpctrace_fmt_block_init(&block, hdr.flags);
+
   while ( !feof(infs) ) {
     // 1. Read trace record (exit on EOF)
     hpctrace_fmt_datum_t datum;
-    ret = hpctrace_fmt_datum_fread(&datum, hdr.flags, infs);
+    ret = hpctrace_fmt_datum_fread(&datum, &hdr, infs);
     if (ret == HPCFMT_EOF) {
       break;
     } else if (ret == HPCFMT_ERR) {
@@ -487,10 +505,15 @@ Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
     datum.cpId = cctId_new;
 
     // 3. Write new trace record
-    ret = hpctrace_fmt_datum_fwrite(&datum, hdr.flags, outfs);
-    if (ret == HPCFMT_ERR) goto badwrite;
+    if (hpctrace_fmt_block_add(&block, &datum)) {
+      ret = hpctrace_fmt_block_fwrite(&block, outfs);
+      if (ret == HPCFMT_ERR) goto badwrite;
+    }
   }
 
+  ret = hpctrace_fmt_block_fwrite(&block, outfs);
+  if (ret == HPCFMT_ERR) goto badwrite;
+
   hpcio_fclose(infs);
   hpcio_fclose(outfs);
 
@@ -873,9 +896,16 @@ Profile::writeXML_hdr(std::ostream& os, uint metricBeg, uint metricEnd,
       }
       os << " db-glob=\"" << m->dbFileGlob() << "\""
 	 << " db-id=\"" << m->dbId() << "\""
-	 << " db-num-metrics=\"" << m->dbNumMetrics() << "\""
-	 << " db-header-sz=\"" << HPCMETRICDB_FMT_HeaderLen << "\""
-	 << "/>\n";
+	 << " db-num-metrics=\"" << m->dbNumMetrics() << "\"";
+      if (oFlags & CCT::Tree::OFlg_MetricDBAggregate) {
+	// sparse, aggregate db files; see hpcrun-fmt.txt
+	os << " db-version=\"" << HPCMETRICDB_FMT_Version10 << "\""
+	   << " db-header-sz=\"" << HPCMETRICDB_FMT_HeaderLen_10 << "\"";
+      }
+      else {
+	os << " db-header-sz=\"" << HPCMETRICDB_FMT_HeaderLen << "\"";
+      }
+      os << "/>\n";
     }
   }
   os << "  </MetricDBTable>\n";
@@ -1013,18 +1043,69 @@ Profile::make(const char* fnm, uint rFlags, FILE* outfs)
     prof_abort(-1);
   }
 
-  char* fsBuf = new char[HPCIO_RWBufferSz];
-  ret = setvbuf(fs, fsBuf, _IOFBF, HPCIO_RWBufferSz);
-  DIAG_AssertWarn(ret == 0, "Profile::make: setvbuf!");
-
   rFlags |= RFlg_HpcrunData; // TODO: for now assume an hpcrun file (verify!)
 
   Profile* prof = NULL;
-  ret = fmt_fread(prof, fs, rFlags, fnm, fnm, outfs);
+
+  // Map the file and decode it in place.  The (small) header, metric
+  // table and load map are read through a stream over the mapping;
+  // CCT nodes are decoded directly from it.  If the file cannot be
+  // mapped, fall back to buffered stdio.
+  struct stat fsStat;
+  void* img = MAP_FAILED;
+  size_t imgSz = 0;
+  if (fstat(fileno(fs), &fsStat) == 0 && S_ISREG(fsStat.st_mode)
+      && fsStat.st_size > 0) {
+    imgSz = fsStat.st_size;
+    img = mmap(NULL, imgSz, PROT_READ, MAP_PRIVATE, fileno(fs), 0);
+  }
+
+  FILE* imgfs = NULL;
+  if (img != MAP_FAILED) {
+    madvise(img, imgSz, MADV_SEQUENTIAL);
+    imgfs = fmemopen(img, imgSz, "r");
+  }
+
+  // fmt_fread reports malformed input by throwing; release the mapping
+  // or stream (and its buffer) before passing the exception on.
+  if (imgfs) {
+    hpcio_fclose(fs);
+
+    try {
+      ret = fmt_fread(prof, imgfs, rFlags, fnm, fnm, outfs,
+		      (const char*)img, imgSz);
+    }
+    catch (...) {
+      fclose(imgfs);
+      munmap(img, imgSz);
+      throw;
+    }
+
+    fclose(imgfs);
+    munmap(img, imgSz);
+  }
+  else {
+    if (img != MAP_FAILED) {
+      munmap(img, imgSz);
+    }
+
+    char* fsBuf = new char[HPCIO_RWBufferSz];
+    ret = setvbuf(fs, fsBuf, _IOFBF, HPCIO_RWBufferSz);
+    DIAG_AssertWarn(ret == 0, "Profile::make: setvbuf!");
+
+    try {
+      ret = fmt_fread(prof, fs, rFlags, fnm, fnm, outfs);
+    }
+    catch (...) {
+      hpcio_fclose(fs);
+      delete[] fsBuf;
+      throw;
+    }
   
-  hpcio_fclose(fs);
+    hpcio_fclose(fs);
 
-  delete[] fsBuf;
+    delete[] fsBuf;
+  }
 
   return prof;
 }
@@ -1032,7 +1113,8 @@ Profile::make(const char* fnm, uint rFlags, FILE* outfs)
 
 int
 Profile::fmt_fread(Profile* &prof, FILE* infs, uint rFlags,
-		   std::string ctxtStr, const char* filename, FILE* outfs)
+		   std::string ctxtStr, const char* filename, FILE* outfs,
+		   const char* infsImg, size_t infsImgSz)
 {
   int ret;
 
@@ -1071,7 +1153,7 @@ Profile::fmt_fread(Profile* &prof, FILE* infs, uint rFlags,
 
     try {
       ret = fmt_epoch_fread(myprof, infs, rFlags, hdr,
-			    ctxtStr, filename, outfs);
+			    ctxtStr, filename, outfs, infsImg, infsImgSz);
       if (ret == HPCFMT_EOF) {
 	break;
       }
@@ -1116,7 +1198,7 @@ int
 Profile::fmt_epoch_fread(Profile* &prof, FILE* infs, uint rFlags,
 			 const hpcrun_fmt_hdr_t& hdr,
 			 std::string ctxtStr, const char* filename,
-			 FILE* outfs)
+			 FILE* outfs, const char* infsImg, size_t infsImgSz)
 {
   using namespace Prof;
 
@@ -1464,7 +1546,8 @@ Profile::fmt_epoch_fread(Profile* &prof, FILE* infs, uint rFlags,
   // ------------------------------------------------------------
   // cct
   // ------------------------------------------------------------
-  fmt_cct_fread(*prof, infs, rFlags, metricTbl, ctxtStr, outfs);
+  fmt_cct_fread(*prof, infs, rFlags, metricTbl, ctxtStr, outfs,
+		infsImg, infsImgSz);
 
 
   hpcrun_fmt_epochHdr_free(&ehdr, free);
@@ -1481,7 +1564,8 @@ Profile::fmt_epoch_fread(Profile* &prof, FILE* infs, uint rFlags,
 int
 Profile::fmt_cct_fread(Profile& prof, FILE* infs, uint rFlags,
 		       const metric_tbl_t& metricTbl,
-		       std::string ctxtStr, FILE* outfs)
+		       std::string ctxtStr, FILE* outfs,
+		       const char* infsImg, size_t infsImgSz)
 {
   DIAG_Assert(infs, "Bad file descriptor!");
 
@@ -1527,11 +1611,30 @@ Profile::fmt_cct_fread(Profile& prof, FILE* infs, uint rFlags,
 
   CCTIdToCCTNodeMap localCCTNodeMap;
 
+  // If available, decode nodes directly from the in-memory image,
+  // beginning at the current position of 'infs'.
+  const char* img = NULL;
+  const char* imgEnd = NULL;
+  if (infsImg) {
+    off_t imgOff = ftello(infs);
+    DIAG_Assert(imgOff >= 0 && (size_t)imgOff <= infsImgSz,
+		"Profile::fmt_cct_fread: bad image offset!");
+    img = infsImg + imgOff;
+    imgEnd = infsImg + infsImgSz;
+  }
+
   for (uint i = 0; i < numNodes; ++i) {
     // ----------------------------------------------------------
     // Read the node
     // ----------------------------------------------------------
-    ret = hpcrun_fmt_cct_node_fread(&nodeFmt, prof.m_flags, infs);
+    if (img) {
+      ret = hpcrun_fmt_cct_node_mread(&nodeFmt, prof.m_flags,
+				      prof.m_fmtVersion, &img, imgEnd);
+    }
+    else {
+      ret = hpcrun_fmt_cct_node_fread(&nodeFmt, prof.m_flags,
+				      prof.m_fmtVersion, infs);
+    }
     if (ret != HPCFMT_OK) {
       DIAG_Throw("Error reading CCT node " << nodeFmt.id);
     }
@@ -1620,6 +1723,12 @@ Profile::fmt_cct_fread(Profile& prof, FILE* infs, uint rFlags,
     localCCTNodeMap.insert(std::make_pair(nodeFmt.id, node));
   }
 
+  // Resynchronize 'infs' with the nodes decoded from the image
+  if (img) {
+    int ret1 = fseeko(infs, img - infsImg, SEEK_SET);
+    DIAG_Assert(ret1 == 0, "Profile::fmt_cct_fread: fseeko!");
+  }
+
   if (outfs) {
     fprintf(outfs, "]\n");
   }
@@ -2130,3 +2239,169 @@ fmt_cct_makeNode(hpcrun_fmt_cct_node_t& n_fmt, const Prof::CCT::ANode& n,
   }
 }
 
+
+//***************************************************************************
+// unit test
+//***************************************************************************
+
+// Measures the read throughput of Profile::make, which decodes the
+// mapped file in place, against the buffered stdio path it falls back
+// to (fmt_fread over a setvbuf stream), on large synthetic hpcrun
+// profiles.  Also checks that a profile truncated within its CCT, for
+// which fmt_fread throws, leaves no stream or mapping behind.
+//
+// build with UNIT_TEST defined, linking lib/prof, lib/xml, lib/support
+// and lib/prof-lean.
+
+// #define UNIT_TEST
+#ifdef UNIT_TEST
+
+#include <cstdlib>
+
+#include <dirent.h>
+#include <sys/time.h>
+
+#include "CallPath-TestProfile.hpp"
+
+static void
+writeTestProfile(const char* fnm, uint numNodes)
+{
+  Prof::CallPath::TestProfileOpts opts;
+  opts.numNodes = numNodes;
+  opts.numMetrics = 3;
+  opts.shapeSeed = numNodes;
+  opts.valueSeed = numNodes;
+
+  FILE* fs = fopen(fnm, "w");
+  Prof::CallPath::writeTestProfile(fs, opts);
+  fclose(fs);
+}
+
+
+static double
+timeNow()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+
+static Prof::CallPath::Profile*
+readStdio(const char* fnm)
+{
+  using Prof::CallPath::Profile;
+
+  FILE* fs = hpcio_fopen_r(fnm);
+  char* fsBuf = new char[HPCIO_RWBufferSz];
+  setvbuf(fs, fsBuf, _IOFBF, HPCIO_RWBufferSz);
+
+  Profile* prof = NULL;
+  Profile::fmt_fread(prof, fs, Profile::RFlg_HpcrunData, fnm, fnm, NULL);
+
+  hpcio_fclose(fs);
+  delete[] fsBuf;
+  return prof;
+}
+
+
+// number of open descriptors plus number of mappings
+static uint
+countResources()
+{
+  uint n = 0;
+  DIR* dir = opendir("/proc/self/fd");
+  while (readdir(dir)) {
+    n++;
+  }
+  closedir(dir);
+
+  FILE* fs = fopen("/proc/self/maps", "r");
+  int c;
+  while ((c = fgetc(fs)) != EOF) {
+    n += (c == '\n');
+  }
+  fclose(fs);
+  return n;
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  using Prof::CallPath::Profile;
+
+  char fnm[] = "/tmp/callpath-profile-XXXXXX";
+  close(mkstemp(fnm));
+
+  int nErr = 0;
+
+  printf("%10s %10s %12s %12s %8s\n", "nodes", "MB", "stdio MB/s",
+	 "mmap MB/s", "speedup");
+  for (uint numNodes = 250000; numNodes <= 2000000; numNodes *= 2) {
+    writeTestProfile(fnm, numNodes);
+    struct stat st;
+    stat(fnm, &st);
+    double mb = st.st_size / (1024.0 * 1024.0);
+
+    // warm the page cache, then take the best of three
+    delete readStdio(fnm);
+
+    double tStdio = 1e9, tMmap = 1e9;
+    for (int k = 0; k < 3; ++k) {
+      double t0 = timeNow();
+      Profile* prof1 = readStdio(fnm);
+      double t1 = timeNow();
+      Profile* prof2 = Profile::make(fnm, 0, NULL);
+      double t2 = timeNow();
+
+      tStdio = std::min(tStdio, t1 - t0);
+      tMmap = std::min(tMmap, t2 - t1);
+
+      uint n1 = prof1->cct()->makeDensePreorderIds();
+      uint n2 = prof2->cct()->makeDensePreorderIds();
+      if (n1 != n2) {
+	printf("node counts differ: %u vs %u\n", n1, n2);
+	nErr++;
+      }
+      delete prof1;
+      delete prof2;
+    }
+
+    printf("%10u %10.1f %12.1f %12.1f %8.2f\n", numNodes, mb, mb / tStdio,
+	   mb / tMmap, tStdio / tMmap);
+  }
+
+  // a truncated profile: fmt_fread throws while reading the CCT
+  writeTestProfile(fnm, 100000);
+  struct stat st;
+  stat(fnm, &st);
+  truncate(fnm, st.st_size / 2);
+
+  uint nRsrc = countResources();
+  for (int k = 0; k < 8; ++k) {
+    bool isThrown = false;
+    try {
+      Profile* prof = Profile::make(fnm, 0, NULL);
+      delete prof;
+    }
+    catch (const Diagnostics::Exception&) {
+      isThrown = true;
+    }
+    if (!isThrown) {
+      printf("truncated profile: no exception\n");
+      nErr++;
+    }
+  }
+  uint nRsrcAfter = countResources();
+  printf("truncated profile: %u descriptors+mappings before, %u after\n",
+	 nRsrc, nRsrcAfter);
+  if (nRsrcAfter != nRsrc) {
+    nErr++;
+  }
+
+  unlink(fnm);
+  return nErr;
+}
+
+#endif // UNIT_TEST
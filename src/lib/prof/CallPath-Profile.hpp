@@ -293,20 +293,28 @@ public:
   // appropriate Prof::Profile::CallPath objects.  If 'outfs' is
   // non-null, a textual form of the data is echoed to 'outfs' for
   // human inspection.
+  //
+  // If 'infsImg' is non-null, 'infs' must be a stream over the
+  // in-memory image [infsImg, infsImg + infsImgSz) (e.g., a
+  // memory-mapped file; cf. fmemopen()).  CCT nodes are then decoded
+  // directly from the image rather than through 'infs'.
 
   static int
   fmt_fread(Profile* &prof, FILE* infs, uint rFlags,
-	    std::string ctxtStr, const char* filename, FILE* outfs);
+	    std::string ctxtStr, const char* filename, FILE* outfs,
+	    const char* infsImg = NULL, size_t infsImgSz = 0);
 
   static int
   fmt_epoch_fread(Profile* &prof, FILE* infs, uint rFlags,
 		  const hpcrun_fmt_hdr_t& hdr,
-		  std::string ctxtStr, const char* filename, FILE* outfs);
+		  std::string ctxtStr, const char* filename, FILE* outfs,
+		  const char* infsImg = NULL, size_t infsImgSz = 0);
 
   static int
   fmt_cct_fread(Profile& prof, FILE* infs, uint rFlags,
 		const metric_tbl_t& metricTbl,
-		std::string ctxtStr, FILE* outfs);
+		std::string ctxtStr, FILE* outfs,
+		const char* infsImg = NULL, size_t infsImgSz = 0);
 
 
   // fmt_*_fwrite(): Write the appropriate object as hpcrun_fmt to the
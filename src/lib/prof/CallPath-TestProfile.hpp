@@ -0,0 +1,236 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+
+//***************************************************************************
+//
+// Prof::CallPath::writeTestProfile
+//
+// Writes a synthetic hpcrun-fmt profile for the unit tests of the
+// profile readers, mergers and streams.  Only code under UNIT_TEST
+// includes this file.
+//
+// A profile has 'numNodes' CCT nodes.  Its tree shape and the placement
+// of its non-zero metric values depend only on 'shapeSeed'; the values
+// and the per-metric sample statistics depend only on 'valueSeed'.  So
+// profiles with the same shape seed always have the same size.  Each
+// node's parent is one of the 64 nodes before it.  Metric values are
+// non-zero at the leaves.
+//
+// If 'isOverlapping', call sites come from a small set shared by all
+// profiles and carry a logical-unwind path length of 1 or 2, so the
+// profiles overlap when merged and some siblings differ only in their
+// lush path length.  A quarter of the interior nodes then also have
+// non-zero values.  Otherwise every node has its own call site.
+//
+//***************************************************************************
+
+#ifndef prof_Prof_CallPath_TestProfile_hpp
+#define prof_Prof_CallPath_TestProfile_hpp
+
+//************************ System Include Files ******************************
+
+#include <vector>
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+//************************* User Include Files *******************************
+
+#include <include/uint.h>
+
+#include <lib/prof-lean/hpcfmt.h>
+#include <lib/prof-lean/hpcrun-fmt.h>
+
+
+//****************************************************************************
+
+namespace Prof {
+
+namespace CallPath {
+
+struct TestProfileOpts {
+  TestProfileOpts()
+    : numNodes(1000), numMetrics(2), shapeSeed(0), valueSeed(0),
+      isOverlapping(false), mpiRank(-1), tid(-1)
+  { }
+
+  uint numNodes;
+  uint numMetrics; // at most 4
+  uint shapeSeed;
+  uint valueSeed;
+  bool isOverlapping;
+  int mpiRank;     // header's mpi-rank, if >= 0
+  int tid;         // header's thread-id, if >= 0
+};
+
+
+// a small LCG, so profiles do not depend on (or disturb) rand()
+static inline uint
+testProfileRand(uint64_t& x)
+{
+  x = x * 6364136223846793005ull + 1442695040888963407ull;
+  return (uint)(x >> 33);
+}
+
+
+static inline void
+writeTestProfile(FILE* fs, const TestProfileOpts& opts)
+{
+  const uint numNodes = opts.numNodes;
+  const uint numMetrics = opts.numMetrics;
+
+  // 1. header
+  char rankStr[16], tidStr[16];
+  snprintf(rankStr, sizeof(rankStr), "%d", opts.mpiRank);
+  snprintf(tidStr, sizeof(tidStr), "%d", opts.tid);
+  if (opts.mpiRank >= 0 && opts.tid >= 0) {
+    hpcrun_fmt_hdr_fwrite(fs, HPCRUN_FMT_NV_prog, "synthetic",
+			  HPCRUN_FMT_NV_mpiRank, rankStr,
+			  HPCRUN_FMT_NV_tid, tidStr, NULL);
+  }
+  else if (opts.mpiRank >= 0) {
+    hpcrun_fmt_hdr_fwrite(fs, HPCRUN_FMT_NV_prog, "synthetic",
+			  HPCRUN_FMT_NV_mpiRank, rankStr, NULL);
+  }
+  else {
+    hpcrun_fmt_hdr_fwrite(fs, HPCRUN_FMT_NV_prog, "synthetic", NULL);
+  }
+
+  epoch_flags_t flags;
+  flags.bits = 0;
+  flags.fields.isLogicalUnwind = opts.isOverlapping;
+  hpcrun_fmt_epochHdr_fwrite(fs, flags, 1, NULL);
+
+  // 2. metric table
+  const char* metricNms[] = { "CYCLES", "INSTRUCTIONS", "L2_MISSES",
+			      "GPU_OPS" };
+  hpcfmt_int4_fwrite(numMetrics, fs);
+  for (uint i = 0; i < numMetrics; ++i) {
+    metric_desc_t mdesc = metricDesc_NULL;
+    mdesc.flags = hpcrun_metricFlags_NULL;
+    mdesc.name = const_cast<char*>(metricNms[i]);
+    mdesc.description = const_cast<char*>("");
+    mdesc.flags.fields.ty = MetricFlags_Ty_Raw;
+    mdesc.flags.fields.valFmt = MetricFlags_ValFmt_Int;
+    mdesc.period = 1;
+    metric_aux_info_t aux_info;
+    memset(&aux_info, 0, sizeof(aux_info));
+    aux_info.num_samples = 1000 + opts.valueSeed * 10 + i;
+    aux_info.threshold_mean = 100 * (i + 1);
+    hpcrun_fmt_metricDesc_fwrite(&mdesc, &aux_info, fs);
+  }
+
+  // 3. load map
+  const char* lmNms[] = { "/synthetic/a.out", "/synthetic/libx.so" };
+  hpcfmt_int4_fwrite(2, fs);
+  for (uint i = 0; i < 2; ++i) {
+    loadmap_entry_t lm_entry;
+    lm_entry.id = i + 1;
+    lm_entry.name = const_cast<char*>(lmNms[i]);
+    lm_entry.flags = 0;
+    hpcrun_fmt_loadmapEntry_fwrite(&lm_entry, fs);
+  }
+
+  // 4. cct: node 0 is the root; parents precede their children
+  uint64_t shape = opts.shapeSeed + 1;
+  uint64_t value = opts.valueSeed + 1;
+
+  std::vector<uint> parent(numNodes, 0);
+  std::vector<bool> isLeaf(numNodes, true);
+  for (uint i = 1; i < numNodes; ++i) {
+    parent[i] = (i < 64) ? 0 : (i - 1 - testProfileRand(shape) % 64);
+    isLeaf[parent[i]] = false;
+  }
+
+  hpcfmt_int8_fwrite(numNodes, fs);
+
+  std::vector<hpcrun_metricVal_t> metrics(numMetrics + 1);
+  hpcrun_fmt_cct_node_t nodeFmt;
+  nodeFmt.num_metrics = numMetrics;
+  nodeFmt.metrics = &metrics[0];
+
+  for (uint i = 0; i < numNodes; ++i) {
+    int id = 2 * (i + 1);
+    nodeFmt.id = isLeaf[i] ? -id : id;
+    nodeFmt.id_parent = (i == 0) ? HPCRUN_FMT_CCTNodeId_NULL
+      : 2 * (parent[i] + 1);
+    nodeFmt.as_info = lush_assoc_info_NULL;
+    nodeFmt.lip = lush_lip_NULL;
+    if (i == 0) {
+      nodeFmt.lm_id = HPCRUN_FMT_LMId_NULL;
+      nodeFmt.lm_ip = HPCRUN_FMT_LMIp_NULL;
+    }
+    else if (opts.isOverlapping) {
+      nodeFmt.lm_id = 1 + testProfileRand(shape) % 2;
+      nodeFmt.lm_ip = 0x1000 + 0x10 * (testProfileRand(shape) % 8);
+      nodeFmt.as_info.u.len = 1 + testProfileRand(shape) % 2;
+    }
+    else {
+      nodeFmt.lm_id = 1;
+      nodeFmt.lm_ip = 0x1000 + 0x10 * i;
+    }
+
+    bool hasValues = (i > 0 && isLeaf[i]);
+    if (i > 0 && !isLeaf[i] && opts.isOverlapping) {
+      hasValues = (testProfileRand(shape) % 4 == 0);
+    }
+    for (uint j = 0; j < numMetrics; ++j) {
+      metrics[j].i = hasValues ? (1 + testProfileRand(value) % 100) : 0;
+    }
+    hpcrun_fmt_cct_node_fwrite(&nodeFmt, flags, fs);
+  }
+}
+
+
+} // namespace CallPath
+
+} // namespace Prof
+
+//****************************************************************************
+
+#endif /* prof_Prof_CallPath_TestProfile_hpp */
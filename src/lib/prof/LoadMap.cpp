@@ -120,7 +120,8 @@ LoadMap::lm_insert(LoadMap::LM* x)
 LoadMap::LMSet_nm::iterator
 LoadMap::lm_find(const std::string& nm) const
 {
-  static LoadMap::LM key;
+  // N.B.: not static; load maps may be merged concurrently
+  LoadMap::LM key;
   key.name(nm);
 
   LMSet_nm::iterator fnd = m_lm_byName.find(&key);
@@ -67,6 +67,7 @@ using std::endl;
 #include <include/uint.h>
 
 #include "Metric-AExpr.hpp"
+#include "Metric-AExprCode.hpp"
 
 #include <lib/support/diagnostics.h>
 #include <lib/support/NaN.h>
@@ -113,6 +114,34 @@ AExpr::dump_opands(std::ostream& os, AExpr** opands, uint sz, const char* sep)
 }
 
 
+void
+AExpr::compileNF(AExprCode& code) const
+{
+  compile(code);
+  code.emit(AExprCode::OpStore, m_accumId[0]);
+}
+
+
+void
+AExpr::compile_opands(AExprCode& code, AExpr** opands, uint sz)
+{
+  for (uint i = 0; i < sz; ++i) {
+    opands[i]->compile(code);
+  }
+}
+
+
+// cf. evalStdDevNF()
+void
+AExpr::compileStdDevNF(AExprCode& code, AExpr** opands, uint sz) const
+{
+  compile_opands(code, opands, sz);
+  code.emit(AExprCode::OpSumSquares, sz);
+  code.emit(AExprCode::OpStore, m_accumId[0]);
+  code.emit(AExprCode::OpStore, m_accumId[1]);
+}
+
+
 // ----------------------------------------------------------------------
 // class Const
 // ----------------------------------------------------------------------
@@ -125,6 +154,13 @@ Const::dumpMe(std::ostream& os) const
 }
 
 
+void
+Const::compile(AExprCode& code) const
+{
+  code.emitConst(m_c);
+}
+
+
 // ----------------------------------------------------------------------
 // class Neg
 // ----------------------------------------------------------------------
@@ -139,6 +175,14 @@ Neg::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Neg::compile(AExprCode& code) const
+{
+  m_expr->compile(code);
+  code.emit(AExprCode::OpNeg);
+}
+
+
 std::ostream&
 Neg::dumpMe(std::ostream& os) const
 {
@@ -161,6 +205,13 @@ Var::dumpMe(std::ostream& os) const
 }
 
 
+void
+Var::compile(AExprCode& code) const
+{
+  code.emit(AExprCode::OpVar, m_metricId);
+}
+
+
 // ----------------------------------------------------------------------
 // class Power
 // ----------------------------------------------------------------------
@@ -177,6 +228,15 @@ Power::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Power::compile(AExprCode& code) const
+{
+  m_base->compile(code);
+  m_exponent->compile(code);
+  code.emit(AExprCode::OpPower);
+}
+
+
 std::ostream&
 Power::dumpMe(std::ostream& os) const
 {
@@ -209,6 +269,15 @@ Divide::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Divide::compile(AExprCode& code) const
+{
+  m_numerator->compile(code);
+  m_denominator->compile(code);
+  code.emit(AExprCode::OpDivide);
+}
+
+
 std::ostream&
 Divide::dumpMe(std::ostream& os) const
 {
@@ -237,6 +306,15 @@ Minus::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Minus::compile(AExprCode& code) const
+{
+  m_minuend->compile(code);
+  m_subtrahend->compile(code);
+  code.emit(AExprCode::OpMinus);
+}
+
+
 std::ostream&
 Minus::dumpMe(std::ostream& os) const
 {
@@ -271,6 +349,14 @@ Plus::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Plus::compile(AExprCode& code) const
+{
+  compile_opands(code, m_opands, m_sz);
+  code.emit(AExprCode::OpPlus, m_sz);
+}
+
+
 std::ostream&
 Plus::dumpMe(std::ostream& os) const
 {
@@ -308,6 +394,14 @@ Times::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Times::compile(AExprCode& code) const
+{
+  compile_opands(code, m_opands, m_sz);
+  code.emit(AExprCode::OpTimes, m_sz);
+}
+
+
 std::ostream&
 Times::dumpMe(std::ostream& os) const
 {
@@ -345,6 +439,14 @@ Max::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Max::compile(AExprCode& code) const
+{
+  compile_opands(code, m_opands, m_sz);
+  code.emit(AExprCode::OpMax, m_sz);
+}
+
+
 std::ostream&
 Max::dumpMe(std::ostream& os) const
 {
@@ -386,6 +488,14 @@ Min::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Min::compile(AExprCode& code) const
+{
+  compile_opands(code, m_opands, m_sz);
+  code.emit(AExprCode::OpMin, m_sz);
+}
+
+
 std::ostream&
 Min::dumpMe(std::ostream& os) const
 {
@@ -419,6 +529,23 @@ Mean::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Mean::compile(AExprCode& code) const
+{
+  compile_opands(code, m_opands, m_sz);
+  code.emit(AExprCode::OpMean, m_sz);
+}
+
+// cf. evalNF(): the accumulator holds the sum
+void
+Mean::compileNF(AExprCode& code) const
+{
+  compile_opands(code, m_opands, m_sz);
+  code.emit(AExprCode::OpPlus, m_sz);
+  code.emit(AExprCode::OpStore, m_accumId[0]);
+}
+
+
 std::ostream&
 Mean::dumpMe(std::ostream& os) const
 {
@@ -453,6 +580,20 @@ StdDev::eval(const Metric::IData& mdata) const
 }
 
 
+void
+StdDev::compile(AExprCode& code) const
+{
+  compile_opands(code, m_opands, m_sz);
+  code.emit(AExprCode::OpStdDev, m_sz);
+}
+
+void
+StdDev::compileNF(AExprCode& code) const
+{
+  compileStdDevNF(code, m_opands, m_sz);
+}
+
+
 std::ostream&
 StdDev::dumpMe(std::ostream& os) const
 {
@@ -492,6 +633,20 @@ CoefVar::eval(const Metric::IData& mdata) const
 }
 
 
+void
+CoefVar::compile(AExprCode& code) const
+{
+  compile_opands(code, m_opands, m_sz);
+  code.emit(AExprCode::OpCoefVar, m_sz);
+}
+
+void
+CoefVar::compileNF(AExprCode& code) const
+{
+  compileStdDevNF(code, m_opands, m_sz);
+}
+
+
 std::ostream&
 CoefVar::dumpMe(std::ostream& os) const
 {
@@ -531,6 +686,20 @@ RStdDev::eval(const Metric::IData& mdata) const
 }
 
 
+void
+RStdDev::compile(AExprCode& code) const
+{
+  compile_opands(code, m_opands, m_sz);
+  code.emit(AExprCode::OpRStdDev, m_sz);
+}
+
+void
+RStdDev::compileNF(AExprCode& code) const
+{
+  compileStdDevNF(code, m_opands, m_sz);
+}
+
+
 std::ostream&
 RStdDev::dumpMe(std::ostream& os) const
 {
@@ -553,6 +722,13 @@ NumSource::dumpMe(std::ostream& os) const
 }
 
 
+void
+NumSource::compile(AExprCode& code) const
+{
+  code.emitConst((double)m_numSrc);
+}
+
+
 //****************************************************************************
 
 
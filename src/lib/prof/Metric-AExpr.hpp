@@ -103,6 +103,8 @@ namespace Prof {
 
 namespace Metric {
 
+class AExprCode;
+
 // ----------------------------------------------------------------------
 // class AExpr
 //   The base class for all concrete evaluation classes
@@ -147,6 +149,16 @@ public:
     return z;
   }
 
+  // compile: append code leaving the finalized value on the stack
+  //   (cf. eval() and Metric::AExprCode)
+  virtual void
+  compile(AExprCode& code) const = 0;
+
+  // compileNF: append code storing the non-finalized values into
+  //   the accumulators (cf. evalNF())
+  virtual void
+  compileNF(AExprCode& code) const;
+
 
   static bool
   isok(double x)
@@ -319,6 +331,12 @@ protected:
   }
 
 
+  static void
+  compile_opands(AExprCode& code, AExpr** opands, uint sz);
+
+  void
+  compileStdDevNF(AExprCode& code, AExpr** opands, uint sz) const;
+
   static void
   dump_opands(std::ostream& os, AExpr** opands, uint sz,
 	      const char* sep = ", ");
@@ -349,6 +367,9 @@ public:
   eval(const Metric::IData& GCC_ATTR_UNUSED mdata) const
   { return m_c; }
 
+  virtual void
+  compile(AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -390,6 +411,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -435,6 +459,9 @@ public:
   eval(const Metric::IData& mdata) const
   { return mdata.demandMetric(m_metricId); }
 
+  virtual void
+  compile(AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -490,6 +517,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr:
@@ -540,6 +570,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprCode& code) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -587,6 +620,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprCode& code) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -631,6 +667,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprCode& code) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -681,6 +720,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprCode& code) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -727,6 +769,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprCode& code) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -776,6 +821,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprCode& code) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -825,6 +873,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprCode& code) const;
+
   virtual double
   evalNF(Metric::IData& mdata) const
   {
@@ -833,6 +884,9 @@ public:
     return z;
   }
 
+  virtual void
+  compileNF(AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr:
@@ -886,10 +940,16 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprCode& code) const;
+
   virtual double
   evalNF(Metric::IData& mdata) const
   { return evalStdDevNF(mdata, m_opands, m_sz); }
 
+  virtual void
+  compileNF(AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -952,10 +1012,16 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprCode& code) const;
+
   virtual double
   evalNF(Metric::IData& mdata) const
   { return evalStdDevNF(mdata, m_opands, m_sz); }
 
+  virtual void
+  compileNF(AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -1018,10 +1084,16 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprCode& code) const;
+
   virtual double
   evalNF(Metric::IData& mdata) const
   { return evalStdDevNF(mdata, m_opands, m_sz); }
 
+  virtual void
+  compileNF(AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -1086,6 +1158,9 @@ public:
   eval(const Metric::IData& GCC_ATTR_UNUSED mdata) const
   { return (double)m_numSrc; }
 
+  virtual void
+  compile(AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
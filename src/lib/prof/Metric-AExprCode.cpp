@@ -0,0 +1,815 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+// ----------------------------------------------------------------------
+//
+//   lowered evaluation expressions: emission and the column interpreter
+//
+// ----------------------------------------------------------------------
+
+//************************ System Include Files ******************************
+
+#include <iostream>
+using std::endl;
+
+#include <algorithm>
+
+#include <cmath>
+#include <cfloat>
+
+//************************* User Include Files *******************************
+
+#include <include/uint.h>
+
+#include "Metric-AExprCode.hpp"
+
+#include <lib/support/diagnostics.h>
+#include <lib/support/NaN.h>
+
+
+//************************ Forward Declarations ******************************
+
+#define EPSILON  (0.000001)
+
+//****************************************************************************
+
+namespace Prof {
+
+namespace Metric {
+
+const uint AExprCode::BlockSz;
+
+static const char* opNames[] = {
+  "const", "var", "num-src", "store",
+  "neg", "power", "divide", "minus", "plus", "times", "min", "max",
+  "mean", "stddev", "coefvar", "r-stddev", "sum-squares",
+  "add", "square", "min-obs", "mean-fin", "stddev-fin", "coefvar-fin",
+  "r-stddev-fin"
+};
+
+
+void
+AExprCode::emit(Op op, uint arg)
+{
+  uint pops = 0, pushes = 1;
+  switch (op) {
+    case OpConst:
+    case OpVar:
+    case OpNumSrc:
+      break;
+    case OpStore:
+      pops = 1; pushes = 0; break;
+    case OpNeg:
+    case OpSquare:
+      pops = 1; break;
+    case OpPower:
+    case OpDivide:
+    case OpMinus:
+    case OpAdd:
+    case OpMinObs:
+    case OpMeanFin:
+      pops = 2; break;
+    case OpMax:
+      DIAG_Assert(arg > 0, "AExprCode: max() of nothing");
+      pops = arg; break;
+    case OpPlus:
+    case OpTimes:
+    case OpMin:
+    case OpMean:
+    case OpStdDev:
+    case OpCoefVar:
+    case OpRStdDev:
+      pops = arg; break;
+    case OpSumSquares:
+      pops = arg; pushes = 2; break;
+    case OpStdDevFin:
+    case OpCoefVarFin:
+    case OpRStdDevFin:
+      pops = 3; pushes = 2; break;
+    default:
+      DIAG_Die(DIAG_UnexpectedInput);
+  }
+  DIAG_Assert(pops <= m_depth, "AExprCode: stack underflow");
+
+  m_depth = m_depth - pops + pushes;
+  m_maxDepth = std::max(m_maxDepth, m_depth);
+
+  Instr instr = { op, arg };
+  m_code.push_back(instr);
+}
+
+
+void
+AExprCode::emitConst(double c)
+{
+  m_consts.push_back(c);
+  emit(OpConst, m_consts.size() - 1);
+}
+
+
+//****************************************************************************
+
+// Welford's running mean and variance of [x_1 ... x_n], as
+// AExpr::evalVariance() computes it, for each row
+static void
+evalVariance(double* x_mean, double* x_var, const double* opands, uint sz,
+	     uint n)
+{
+  for (uint i = 0; i < n; ++i) {
+    x_mean[i] = 0.0;
+    x_var[i] = 0.0;
+  }
+  for (uint j = 0; j < sz; ++j) {
+    const double* t = opands + j * AExprCode::BlockSz;
+    for (uint i = 0; i < n; ++i) {
+      double delta = t[i] - x_mean[i];
+      x_mean[i] += delta / (j + 1);
+      x_var[i] += delta * (t[i] - x_mean[i]);
+    }
+  }
+  for (uint i = 0; i < n; ++i) {
+    x_var[i] = x_var[i] / sz;
+  }
+}
+
+
+// the finalization common to the AExprIncr standard deviations
+// (AExprIncr::finalizeStdDev()): a1 becomes the stddev, a2 the mean
+static void
+finalizeStdDev(double* a1, double* a2, const double* numSrc, uint n)
+{
+  for (uint i = 0; i < n; ++i) {
+    if (numSrc[i] > 0) {
+      double mean = a1[i] / numSrc[i];
+      double z1 = (mean * mean);
+      double z2 = a2[i] / numSrc[i];
+      a1[i] = sqrt(z2 - z1);
+      a2[i] = mean;
+    }
+  }
+}
+
+
+void
+AExprCode::eval(Metric::IData* const* data, uint n,
+		std::vector<double>& scratch) const
+{
+  DIAG_Assert(n <= BlockSz, "AExprCode::eval: block too large");
+
+  // the stack, followed by two temporaries
+  uint tmp = m_maxDepth;
+  if (scratch.size() < (tmp + 2) * BlockSz) {
+    scratch.resize((tmp + 2) * BlockSz);
+  }
+  double* stk = &scratch[0];
+  uint top = 0;
+
+  // read through const objects so that loads do not materialize
+  // column store blocks (cf. IData::metric())
+  const Metric::IData* const* cdata = data;
+
+#define slot(s) (stk + (s) * BlockSz)
+
+  for (uint pc = 0; pc < m_code.size(); ++pc) {
+    const Instr& instr = m_code[pc];
+    uint arg = instr.arg;
+
+    switch (instr.op) {
+      case OpConst: {
+	double c = m_consts[arg];
+	double* z = slot(top++);
+	for (uint i = 0; i < n; ++i) {
+	  z[i] = c;
+	}
+	break;
+      }
+      case OpVar: {
+	double* z = slot(top++);
+	for (uint i = 0; i < n; ++i) {
+	  z[i] = cdata[i]->demandMetric(arg);
+	}
+	break;
+      }
+      case OpNumSrc: {
+	double* z = slot(top++);
+	for (uint i = 0; i < n; ++i) {
+	  z[i] = (uint) cdata[i]->demandMetric(arg);
+	}
+	break;
+      }
+      case OpStore: {
+	const double* x = slot(--top);
+	for (uint i = 0; i < n; ++i) {
+	  data[i]->storeMetric(arg, x[i]);
+	}
+	break;
+      }
+
+      case OpNeg: {
+	double* z = slot(top - 1);
+	for (uint i = 0; i < n; ++i) {
+	  z[i] = -z[i];
+	}
+	break;
+      }
+      case OpSquare: {
+	double* z = slot(top - 1);
+	for (uint i = 0; i < n; ++i) {
+	  z[i] = z[i] * z[i];
+	}
+	break;
+      }
+      case OpPower: {
+	double* z = slot(top - 2);
+	const double* e = slot(--top);
+	for (uint i = 0; i < n; ++i) {
+	  z[i] = pow(z[i], e[i]);
+	}
+	break;
+      }
+      case OpDivide: {
+	double* z = slot(top - 2);
+	const double* d = slot(--top);
+	for (uint i = 0; i < n; ++i) {
+	  double q = c_FP_NAN_d;
+	  if (!(c_isnan_d(d[i]) || c_isinf_d(d[i])) && d[i] != 0.0) {
+	    q = z[i] / d[i];
+	  }
+	  z[i] = q;
+	}
+	break;
+      }
+      case OpMinus: {
+	double* z = slot(top - 2);
+	const double* s = slot(--top);
+	for (uint i = 0; i < n; ++i) {
+	  z[i] = z[i] - s[i];
+	}
+	break;
+      }
+      case OpAdd: {
+	double* z = slot(top - 2);
+	const double* s = slot(--top);
+	for (uint i = 0; i < n; ++i) {
+	  z[i] = z[i] + s[i];
+	}
+	break;
+      }
+      case OpMinObs: {
+	double* z = slot(top - 2);
+	const double* s = slot(--top);
+	for (uint i = 0; i < n; ++i) {
+	  if (s[i] != DBL_MIN && s[i] != 0.0) {
+	    z[i] = (z[i] == DBL_MIN) ? s[i] : std::min(z[i], s[i]);
+	  }
+	}
+	break;
+      }
+      case OpMeanFin: {
+	double* z = slot(top - 2);
+	const double* numSrc = slot(--top);
+	for (uint i = 0; i < n; ++i) {
+	  if (numSrc[i] > 0) {
+	    z[i] = z[i] / numSrc[i];
+	  }
+	}
+	break;
+      }
+
+      case OpPlus:
+      case OpMean:
+      case OpTimes: {
+	// the n-ary operators leave their result in place of the
+	// first operand
+	top = top - arg;
+	double* z = slot(top++);
+	bool isTimes = (instr.op == OpTimes);
+	double z0 = isTimes ? 1.0 : 0.0;
+	if (arg == 0) {
+	  for (uint i = 0; i < n; ++i) {
+	    z[i] = z0;
+	  }
+	}
+	else {
+	  for (uint i = 0; i < n; ++i) {
+	    z[i] = isTimes ? (z0 * z[i]) : (z0 + z[i]);
+	  }
+	}
+	for (uint j = 1; j < arg; ++j) {
+	  const double* x = z + j * BlockSz;
+	  if (isTimes) {
+	    for (uint i = 0; i < n; ++i) {
+	      z[i] *= x[i];
+	    }
+	  }
+	  else {
+	    for (uint i = 0; i < n; ++i) {
+	      z[i] += x[i];
+	    }
+	  }
+	}
+	if (instr.op == OpMean) {
+	  for (uint i = 0; i < n; ++i) {
+	    z[i] = z[i] / (double) arg;
+	  }
+	}
+	break;
+      }
+      case OpMax: {
+	top = top - arg;
+	double* z = slot(top++);
+	for (uint j = 1; j < arg; ++j) {
+	  const double* x = z + j * BlockSz;
+	  for (uint i = 0; i < n; ++i) {
+	    z[i] = std::max(z[i], x[i]);
+	  }
+	}
+	break;
+      }
+      case OpMin: {
+	// observational min: zeros do not count (cf. Min::eval())
+	top = top - arg;
+	double* z = slot(top++);
+	if (arg == 0) {
+	  for (uint i = 0; i < n; ++i) {
+	    z[i] = DBL_MAX;
+	  }
+	}
+	else {
+	  for (uint i = 0; i < n; ++i) {
+	    z[i] = (z[i] != 0.0) ? std::min(DBL_MAX, z[i]) : DBL_MAX;
+	  }
+	}
+	for (uint j = 1; j < arg; ++j) {
+	  const double* x = z + j * BlockSz;
+	  for (uint i = 0; i < n; ++i) {
+	    if (x[i] != 0.0) {
+	      z[i] = std::min(z[i], x[i]);
+	    }
+	  }
+	}
+	for (uint i = 0; i < n; ++i) {
+	  if (z[i] == DBL_MAX) { z[i] = DBL_MIN; }
+	}
+	break;
+      }
+      case OpStdDev:
+      case OpCoefVar:
+      case OpRStdDev: {
+	top = top - arg;
+	double* z = slot(top++);
+	double* x_mean = slot(tmp);
+	double* x_var = slot(tmp + 1);
+	evalVariance(x_mean, x_var, z, arg, n);
+	for (uint i = 0; i < n; ++i) {
+	  double sdev = sqrt(x_var[i]);
+	  if (instr.op == OpStdDev) {
+	    z[i] = sdev;
+	  }
+	  else {
+	    double r = 0.0;
+	    if (x_mean[i] > EPSILON) {
+	      r = (instr.op == OpCoefVar) ? (sdev / x_mean[i])
+		: (sdev / x_mean[i]) * 100;
+	    }
+	    z[i] = r;
+	  }
+	}
+	break;
+      }
+      case OpSumSquares: {
+	top = top - arg;
+	double* z = slot(top);
+	double* z1 = slot(tmp);     // sum
+	double* z2 = slot(tmp + 1); // sum of squares
+	for (uint i = 0; i < n; ++i) {
+	  z1[i] = 0.0;
+	  z2[i] = 0.0;
+	}
+	for (uint j = 0; j < arg; ++j) {
+	  const double* x = z + j * BlockSz;
+	  for (uint i = 0; i < n; ++i) {
+	    z1[i] += x[i];
+	    z2[i] += (x[i] * x[i]);
+	  }
+	}
+	std::copy(z2, z2 + n, slot(top++));
+	std::copy(z1, z1 + n, slot(top++));
+	break;
+      }
+      case OpStdDevFin:
+      case OpCoefVarFin:
+      case OpRStdDevFin: {
+	// [a1, a2, n] -> [a2', a1']: the accumulators, finalized
+	top = top - 3;
+	double* a1 = slot(top);
+	double* a2 = slot(top + 1);
+	const double* numSrc = slot(top + 2);
+	finalizeStdDev(a1, a2, numSrc, n);
+	if (instr.op != OpStdDevFin) {
+	  for (uint i = 0; i < n; ++i) {
+	    double sdev = a1[i], mean = a2[i];
+	    double z = 0.0;
+	    if (mean > EPSILON) {
+	      z = (instr.op == OpCoefVarFin) ? (sdev / mean)
+		: (sdev / mean) * 100;
+	    }
+	    a1[i] = z;
+	  }
+	}
+	std::copy(a1, a1 + n, slot(tmp));
+	std::copy(a2, a2 + n, slot(top++));
+	std::copy(slot(tmp), slot(tmp) + n, slot(top++));
+	break;
+      }
+
+      default:
+	DIAG_Die(DIAG_UnexpectedInput);
+    }
+  }
+
+#undef slot
+
+  DIAG_Assert(top == m_depth, "AExprCode::eval: stack mismatch");
+}
+
+
+std::ostream&
+AExprCode::dump(std::ostream& os) const
+{
+  for (uint pc = 0; pc < m_code.size(); ++pc) {
+    const Instr& instr = m_code[pc];
+    os << pc << ": " << opNames[instr.op];
+    if (instr.op == OpConst) {
+      os << " " << m_consts[instr.arg];
+    }
+    else if (instr.op == OpVar || instr.op == OpNumSrc
+	     || instr.op == OpStore
+	     || (OpPlus <= instr.op && instr.op <= OpSumSquares)) {
+      os << " " << instr.arg;
+    }
+    os << endl;
+  }
+  return os;
+}
+
+
+void
+AExprCode::ddump() const
+{
+  dump(std::cerr);
+}
+
+
+//****************************************************************************
+
+} // namespace Metric
+
+} // namespace Prof
+
+
+//***************************************************************************
+// unit test
+//***************************************************************************
+
+// Checks AExprCode against the interpreters.  Builds random AExpr
+// trees over random inputs, including 0, -0, NaN, infinities and
+// extreme values (so Divide sees zero divisors and Power, StdDev etc.
+// see NaN), evaluates them per node with evalNF()/eval() and as
+// compiled code over node blocks, and requires bit-identical results
+// (any NaN matches any NaN).  Does the same for each function of each
+// AExprIncr, then reports the time of both evaluators for 100 derived
+// metrics over 1M nodes.
+//
+// build with UNIT_TEST defined, linking lib/prof, lib/xml, lib/support
+// and lib/prof-lean.
+
+// #define UNIT_TEST
+#ifdef UNIT_TEST
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Metric-AExpr.hpp"
+#include "Metric-AExprIncr.hpp"
+
+using namespace Prof::Metric;
+
+static std::mt19937_64 rng(7);
+
+static const uint NumVars = 12;
+
+static double
+randValue()
+{
+  static const double specials[] = {
+    0.0, -0.0, 1.0, -1.0, DBL_MIN, DBL_MAX, 1e-7, 2.5, -3.75, 1e300,
+    NAN, INFINITY, -INFINITY
+  };
+  if (rng() % 4 == 0) {
+    return specials[rng() % (sizeof(specials) / sizeof(specials[0]))];
+  }
+  return (double)((int64_t)(rng() % 2000) - 500) / 7.0;
+}
+
+
+static AExpr*
+randExpr(int depth);
+
+static AExpr**
+randOperands(int depth, uint& n)
+{
+  n = 1 + rng() % 4;
+  AExpr** opands = new AExpr*[n];
+  for (uint i = 0; i < n; ++i) {
+    opands[i] = randExpr(depth);
+  }
+  return opands;
+}
+
+
+static AExpr*
+randExpr(int depth)
+{
+  uint n;
+  int k = (depth <= 0) ? rng() % 3 : rng() % 16;
+  switch (k) {
+    case 0:  return new Const(randValue());
+    case 1:
+    case 2:  return new Var("v", rng() % NumVars);
+    case 3:  return new Neg(randExpr(depth - 1));
+    case 4:  return new Power(randExpr(depth - 1), randExpr(depth - 1));
+    case 5:  return new Divide(randExpr(depth - 1), randExpr(depth - 1));
+    case 6:  return new Minus(randExpr(depth - 1), randExpr(depth - 1));
+    case 7:  { AExpr** x = randOperands(depth - 1, n); return new Plus(x, n); }
+    case 8:  { AExpr** x = randOperands(depth - 1, n); return new Times(x, n); }
+    case 9:  { AExpr** x = randOperands(depth - 1, n); return new Min(x, n); }
+    case 10: { AExpr** x = randOperands(depth - 1, n); return new Max(x, n); }
+    case 11: { AExpr** x = randOperands(depth - 1, n); return new Mean(x, n); }
+    case 12: { AExpr** x = randOperands(depth - 1, n); return new StdDev(x, n); }
+    case 13: { AExpr** x = randOperands(depth - 1, n); return new CoefVar(x, n); }
+    case 14: { AExpr** x = randOperands(depth - 1, n); return new RStdDev(x, n); }
+    default: return new NumSource(rng() % 5);
+  }
+}
+
+
+static void
+randInputs(std::vector<IData>& data, uint maxSize, uint countId)
+{
+  for (uint i = 0; i < data.size(); ++i) {
+    uint sz = rng() % (maxSize + 1);
+    data[i].ensureMetricsSize(sz);
+    for (uint j = 0; j < sz; ++j) {
+      data[i].metric(j) = (j == countId) ? (double)(rng() % 4) : randValue();
+    }
+  }
+}
+
+
+static void
+evalBlocks(const AExprCode& code, std::vector<IData>& data)
+{
+  std::vector<double> scratch;
+  IData* block[AExprCode::BlockSz];
+  for (uint b = 0; b < data.size(); b += AExprCode::BlockSz) {
+    uint n = std::min<uint>(AExprCode::BlockSz, data.size() - b);
+    for (uint i = 0; i < n; ++i) {
+      block[i] = &data[b + i];
+    }
+    code.eval(block, n, scratch);
+  }
+}
+
+
+static bool
+sameMetrics(const IData& x, const IData& y)
+{
+  if (x.numMetrics() != y.numMetrics()) {
+    return false;
+  }
+  for (uint i = 0; i < x.numMetrics(); ++i) {
+    double a = x.metric(i), b = y.metric(i);
+    if (memcmp(&a, &b, sizeof(a)) != 0 && !(std::isnan(a) && std::isnan(b))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+// several metrics per code sequence; later ones may read the
+// accumulators of earlier ones
+static int
+testAExpr(uint numTests, uint numNodes)
+{
+  int bad = 0;
+  for (uint t = 0; t < numTests; ++t) {
+    uint numMetrics = 1 + rng() % 4;
+    bool doFinal = rng() % 2;
+    uint finalBeg = NumVars + 2 * numMetrics;
+
+    std::vector<AExpr*> exprs;
+    AExprCode code;
+    for (uint m = 0; m < numMetrics; ++m) {
+      AExpr* e = randExpr(3);
+      e->accumId(0, NumVars + 2 * m);
+      e->accumId(1, NumVars + 2 * m + 1);
+      e->compileNF(code);
+      if (doFinal) {
+	e->compile(code);
+	code.emit(AExprCode::OpStore, finalBeg + m);
+      }
+      exprs.push_back(e);
+    }
+
+    std::vector<IData> x(numNodes);
+    randInputs(x, NumVars, NumVars);
+    std::vector<IData> y(x);
+
+    for (uint i = 0; i < numNodes; ++i) {
+      for (uint m = 0; m < numMetrics; ++m) {
+	exprs[m]->evalNF(x[i]);
+	if (doFinal) {
+	  double v = exprs[m]->eval(x[i]);
+	  x[i].demandMetric(finalBeg + m) = v;
+	}
+      }
+    }
+    evalBlocks(code, y);
+
+    for (uint i = 0; i < numNodes; ++i) {
+      if (!sameMetrics(x[i], y[i]) && bad++ < 3) {
+	exprs[0]->dump(std::cerr);
+	std::cerr << endl;
+	code.dump(std::cerr);
+      }
+    }
+    for (uint m = 0; m < numMetrics; ++m) {
+      delete exprs[m];
+    }
+  }
+  return bad;
+}
+
+
+static int
+testAExprIncr(uint numTests, uint numNodes)
+{
+  const uint accum0 = 0, accum1 = 1, src0 = 2, src1 = 3, numSrcId = 4;
+
+  int bad = 0;
+  for (uint t = 0; t < numTests; ++t) {
+    AExprIncr* e;
+    int k = rng() % 8;
+    switch (k) {
+      case 0:  e = new MinIncr(accum0, src0); break;
+      case 1:  e = new MaxIncr(accum0, src0); break;
+      case 2:  e = new SumIncr(accum0, src0); break;
+      case 3:  e = new MeanIncr(accum0, src0); break;
+      case 4:  e = new StdDevIncr(accum0, accum1, src0); break;
+      case 5:  e = new CoefVarIncr(accum0, accum1, src0); break;
+      case 6:  e = new RStdDevIncr(accum0, accum1, src0); break;
+      default: e = new NumSourceIncr(accum0, src0); break;
+    }
+    AExprIncr::FnTy fn = (AExprIncr::FnTy)(rng() % 5);
+    bool hasSrc1 = (4 <= k && k <= 6);
+    if (hasSrc1 && (fn == AExprIncr::FnCombine || rng() % 2)) {
+      e->srcId(1, src1);
+    }
+    e->numSrcFxd(rng() % 4);
+    e->numSrcVarId(numSrcId);
+
+    AExprCode code;
+    e->compile(fn, code);
+
+    std::vector<IData> x(numNodes);
+    randInputs(x, numSrcId + 1, numSrcId);
+    std::vector<IData> y(x);
+
+    for (uint i = 0; i < numNodes; ++i) {
+      switch (fn) {
+	case AExprIncr::FnInit:    e->initialize(x[i]); break;
+	case AExprIncr::FnInitSrc: e->initializeSrc(x[i]); break;
+	case AExprIncr::FnAccum:   e->accumulate(x[i]); break;
+	case AExprIncr::FnCombine: e->combine(x[i]); break;
+	case AExprIncr::FnFini:    e->finalize(x[i]); break;
+      }
+    }
+    evalBlocks(code, y);
+
+    for (uint i = 0; i < numNodes; ++i) {
+      if (!sameMetrics(x[i], y[i]) && bad++ < 3) {
+	std::cerr << "incr " << k << " fn " << fn << endl;
+	code.dump(std::cerr);
+      }
+    }
+    delete e;
+  }
+  return bad;
+}
+
+
+static void
+timeAExpr(uint numNodes, uint numMetrics)
+{
+  std::vector<IData> data(numNodes);
+  for (uint i = 0; i < numNodes; ++i) {
+    data[i].ensureMetricsSize(NumVars + 2 * numMetrics);
+    for (uint j = 0; j < NumVars; ++j) {
+      data[i].metric(j) = (double)(rng() % 1000);
+    }
+  }
+
+  std::vector<AExpr*> exprs;
+  AExprCode code;
+  for (uint m = 0; m < numMetrics; ++m) {
+    AExpr* e = randExpr(3);
+    e->accumId(0, NumVars + m);
+    e->accumId(1, NumVars + numMetrics + m);
+    e->compileNF(code);
+    exprs.push_back(e);
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint i = 0; i < numNodes; ++i) {
+    for (uint m = 0; m < numMetrics; ++m) {
+      exprs[m]->evalNF(data[i]);
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  evalBlocks(code, data);
+  auto t2 = std::chrono::steady_clock::now();
+
+  printf("%u metrics over %u nodes: interpreter %.2fs, code %.2fs\n",
+	 numMetrics, numNodes,
+	 std::chrono::duration<double>(t1 - t0).count(),
+	 std::chrono::duration<double>(t2 - t1).count());
+
+  for (uint m = 0; m < numMetrics; ++m) {
+    delete exprs[m];
+  }
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  int bad = testAExpr(2000, 300);
+  printf("AExpr: %d mismatches\n", bad);
+
+  int badIncr = testAExprIncr(3000, 300);
+  printf("AExprIncr: %d mismatches\n", badIncr);
+
+  timeAExpr(1000000, 100);
+
+  return (bad || badIncr) ? 1 : 0;
+}
+
+#endif // UNIT_TEST
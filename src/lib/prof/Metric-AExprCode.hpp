@@ -0,0 +1,192 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// class Prof::Metric::AExprCode
+//
+// Derived metric expressions (AExpr) and the steps of incremental
+// ones (AExprIncr) lowered to a flat code for a stack machine whose
+// values are columns: one metric value for each of a block of up to
+// BlockSz nodes.  Each instruction runs as a loop over the block, so
+// evaluating an expression for a block costs one dispatch per
+// operator rather than a virtual call per operator per node, and the
+// loops themselves are simple enough to vectorize.
+//
+// Instructions reproduce the interpreters' arithmetic operation for
+// operation, so results match AExpr::eval()/evalNF() and the
+// AExprIncr functions exactly.  Stores write through to the nodes
+// before the next instruction, so the code for several metrics can be
+// concatenated when later metrics read earlier ones.
+//
+//***************************************************************************
+
+#ifndef prof_Prof_Metric_AExprCode_hpp
+#define prof_Prof_Metric_AExprCode_hpp
+
+//************************ System Include Files ******************************
+
+#include <iostream>
+#include <vector>
+
+//************************* User Include Files *******************************
+
+#include <include/uint.h>
+
+#include "Metric-IData.hpp"
+
+#include <lib/support/Unique.hpp>
+
+
+//************************ Forward Declarations ******************************
+
+//****************************************************************************
+
+namespace Prof {
+
+namespace Metric {
+
+class AExprCode
+  : public Unique // disable copying, for now
+{
+public:
+  // N.B.: stack effects are given as [operands] -> [results], top last
+  enum Op {
+    // operands
+    OpConst,      // [] -> [constant 'arg']
+    OpVar,        // [] -> [metric 'arg']
+    OpNumSrc,     // [] -> [(uint) metric 'arg']
+    OpStore,      // [x] -> [], x is stored to metric 'arg'
+
+    // AExpr operators; 'arg' is the operand count of n-ary ones
+    OpNeg,        // [x] -> [-x]
+    OpPower,      // [b, e] -> [b ** e]
+    OpDivide,     // [n, d] -> [n / d]
+    OpMinus,      // [m, s] -> [m - s]
+    OpPlus,       // [x_1 ... x_n] -> [sum]
+    OpTimes,      // [x_1 ... x_n] -> [product]
+    OpMin,        // [x_1 ... x_n] -> [min]
+    OpMax,        // [x_1 ... x_n] -> [max]
+    OpMean,       // [x_1 ... x_n] -> [mean]
+    OpStdDev,     // [x_1 ... x_n] -> [stddev]
+    OpCoefVar,    // [x_1 ... x_n] -> [coefvar]
+    OpRStdDev,    // [x_1 ... x_n] -> [r-stddev]
+    OpSumSquares, // [x_1 ... x_n] -> [sum of squares, sum]
+
+    // AExprIncr steps
+    OpAdd,        // [a, s] -> [a + s]
+    OpSquare,     // [x] -> [x * x]
+    OpMinObs,     // [a, s] -> [observational min] (cf. MinIncr)
+    OpMeanFin,    // [a, n] -> [a / n]
+    OpStdDevFin,  // [a1, a2, n] -> [mean, stddev]
+    OpCoefVarFin, // [a1, a2, n] -> [mean, coefvar]
+    OpRStdDevFin  // [a1, a2, n] -> [mean, r-stddev]
+  };
+
+  static const uint BlockSz = 256;
+
+public:
+  AExprCode()
+    : m_depth(0), m_maxDepth(0)
+  { }
+
+  ~AExprCode()
+  { }
+
+  // ------------------------------------------------------------
+  // code generation (cf. AExpr::compile() and AExprIncr::compile())
+  // ------------------------------------------------------------
+
+  void
+  emit(Op op, uint arg = 0);
+
+  void
+  emitConst(double c);
+
+  bool
+  empty() const
+  { return m_code.empty(); }
+
+  // ------------------------------------------------------------
+  // evaluation
+  // ------------------------------------------------------------
+
+  // eval: run the code for each of data[0, n), where n <= BlockSz.
+  //   'scratch' holds the stack and may be reused across calls.
+  void
+  eval(Metric::IData* const* data, uint n, std::vector<double>& scratch) const;
+
+  // ------------------------------------------------------------
+  //
+  // ------------------------------------------------------------
+
+  std::ostream&
+  dump(std::ostream& os = std::cerr) const;
+
+  void
+  ddump() const;
+
+private:
+  struct Instr {
+    Op op;
+    uint arg;
+  };
+
+  std::vector<Instr> m_code;
+  std::vector<double> m_consts;
+
+  uint m_depth;    // stack depth after the last instruction
+  uint m_maxDepth; // stack slots needed, including temporaries
+};
+
+
+} // namespace Metric
+
+} // namespace Prof
+
+//****************************************************************************
+
+#endif /* prof_Prof_Metric_AExprCode_hpp */
@@ -60,6 +60,7 @@ using std::endl;
 #include <algorithm>
 
 #include <cmath>
+#include <cfloat>
 
 //************************* User Include Files *******************************
 
@@ -102,6 +103,73 @@ AExprIncr::toString() const
 }
 
 
+void
+AExprIncr::compileNumSrc(AExprCode& code) const
+{
+  if (hasNumSrcVar()) {
+    code.emit(AExprCode::OpNumSrc, m_numSrcVarId);
+  }
+  else {
+    code.emitConst((double)m_numSrcFxd);
+  }
+}
+
+
+// cf. initializeStdDev(), ..., finalizeStdDev()
+void
+AExprIncr::compileStdDev(FnTy fn, AExprCode& code,
+			 AExprCode::Op finalizeOp) const
+{
+  switch (fn) {
+    case FnInit:
+      code.emitConst(0.0);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      code.emitConst(0.0);
+      code.emit(AExprCode::OpStore, m_accumId[1]);
+      break;
+    case FnInitSrc:
+      code.emitConst(0.0);
+      code.emit(AExprCode::OpStore, m_srcId[0]);
+      if (isSetSrc(1)) {
+	code.emitConst(0.0);
+	code.emit(AExprCode::OpStore, m_srcId[1]);
+      }
+      break;
+    case FnAccum:
+      code.emit(AExprCode::OpVar, m_accumId[0]);
+      code.emit(AExprCode::OpVar, m_srcId[0]);
+      code.emit(AExprCode::OpAdd);
+      code.emit(AExprCode::OpVar, m_accumId[1]);
+      code.emit(AExprCode::OpVar, m_srcId[0]);
+      code.emit(AExprCode::OpSquare);
+      code.emit(AExprCode::OpAdd);
+      code.emit(AExprCode::OpStore, m_accumId[1]);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      break;
+    case FnCombine:
+      code.emit(AExprCode::OpVar, m_accumId[0]);
+      code.emit(AExprCode::OpVar, m_srcId[0]);
+      code.emit(AExprCode::OpAdd);
+      code.emit(AExprCode::OpVar, m_accumId[1]);
+      code.emit(AExprCode::OpVar, m_srcId[1]);
+      code.emit(AExprCode::OpAdd);
+      code.emit(AExprCode::OpStore, m_accumId[1]);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      break;
+    case FnFini:
+      code.emit(AExprCode::OpVar, m_accumId[0]);
+      code.emit(AExprCode::OpVar, m_accumId[1]);
+      compileNumSrc(code);
+      code.emit(finalizeOp);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      code.emit(AExprCode::OpStore, m_accumId[1]);
+      break;
+    default:
+      DIAG_Die(DIAG_UnexpectedInput);
+  }
+}
+
+
 // ----------------------------------------------------------------------
 // class MinIncr
 // ----------------------------------------------------------------------
@@ -114,6 +182,33 @@ MinIncr::dumpMe(std::ostream& os) const
 }
 
 
+void
+MinIncr::compile(FnTy fn, AExprCode& code) const
+{
+  switch (fn) {
+    case FnInit:
+    case FnInitSrc:
+      code.emitConst(DBL_MIN /* sic; see header */);
+      code.emit(AExprCode::OpStore,
+		(fn == FnInit) ? m_accumId[0] : m_srcId[0]);
+      break;
+    case FnAccum:
+    case FnCombine:
+      code.emit(AExprCode::OpVar, m_accumId[0]);
+      code.emit(AExprCode::OpVar, m_srcId[0]);
+      code.emit(AExprCode::OpMinObs);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      break;
+    case FnFini:
+      code.emit(AExprCode::OpVar, m_accumId[0]);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      break;
+    default:
+      DIAG_Die(DIAG_UnexpectedInput);
+  }
+}
+
+
 // ----------------------------------------------------------------------
 // class MaxIncr
 // ----------------------------------------------------------------------
@@ -126,6 +221,33 @@ MaxIncr::dumpMe(std::ostream& os) const
 }
 
 
+void
+MaxIncr::compile(FnTy fn, AExprCode& code) const
+{
+  switch (fn) {
+    case FnInit:
+    case FnInitSrc:
+      code.emitConst(0.0);
+      code.emit(AExprCode::OpStore,
+		(fn == FnInit) ? m_accumId[0] : m_srcId[0]);
+      break;
+    case FnAccum:
+    case FnCombine:
+      code.emit(AExprCode::OpVar, m_accumId[0]);
+      code.emit(AExprCode::OpVar, m_srcId[0]);
+      code.emit(AExprCode::OpMax, 2);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      break;
+    case FnFini:
+      code.emit(AExprCode::OpVar, m_accumId[0]);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      break;
+    default:
+      DIAG_Die(DIAG_UnexpectedInput);
+  }
+}
+
+
 // ----------------------------------------------------------------------
 // class SumIncr
 // ----------------------------------------------------------------------
@@ -138,6 +260,33 @@ SumIncr::dumpMe(std::ostream& os) const
 }
 
 
+void
+SumIncr::compile(FnTy fn, AExprCode& code) const
+{
+  switch (fn) {
+    case FnInit:
+    case FnInitSrc:
+      code.emitConst(0.0);
+      code.emit(AExprCode::OpStore,
+		(fn == FnInit) ? m_accumId[0] : m_srcId[0]);
+      break;
+    case FnAccum:
+    case FnCombine:
+      code.emit(AExprCode::OpVar, m_accumId[0]);
+      code.emit(AExprCode::OpVar, m_srcId[0]);
+      code.emit(AExprCode::OpAdd);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      break;
+    case FnFini:
+      code.emit(AExprCode::OpVar, m_accumId[0]);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      break;
+    default:
+      DIAG_Die(DIAG_UnexpectedInput);
+  }
+}
+
+
 // ----------------------------------------------------------------------
 // class MeanIncr
 // ----------------------------------------------------------------------
@@ -150,6 +299,35 @@ MeanIncr::dumpMe(std::ostream& os) const
 }
 
 
+void
+MeanIncr::compile(FnTy fn, AExprCode& code) const
+{
+  switch (fn) {
+    case FnInit:
+    case FnInitSrc:
+      code.emitConst(0.0);
+      code.emit(AExprCode::OpStore,
+		(fn == FnInit) ? m_accumId[0] : m_srcId[0]);
+      break;
+    case FnAccum:
+    case FnCombine:
+      code.emit(AExprCode::OpVar, m_accumId[0]);
+      code.emit(AExprCode::OpVar, m_srcId[0]);
+      code.emit(AExprCode::OpAdd);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      break;
+    case FnFini:
+      code.emit(AExprCode::OpVar, m_accumId[0]);
+      compileNumSrc(code);
+      code.emit(AExprCode::OpMeanFin);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      break;
+    default:
+      DIAG_Die(DIAG_UnexpectedInput);
+  }
+}
+
+
 // ----------------------------------------------------------------------
 // class StdDevIncr
 // ----------------------------------------------------------------------
@@ -162,6 +340,13 @@ StdDevIncr::dumpMe(std::ostream& os) const
 }
 
 
+void
+StdDevIncr::compile(FnTy fn, AExprCode& code) const
+{
+  compileStdDev(fn, code, AExprCode::OpStdDevFin);
+}
+
+
 // ----------------------------------------------------------------------
 // class CoefVarIncr
 // ----------------------------------------------------------------------
@@ -174,6 +359,13 @@ CoefVarIncr::dumpMe(std::ostream& os) const
 }
 
 
+void
+CoefVarIncr::compile(FnTy fn, AExprCode& code) const
+{
+  compileStdDev(fn, code, AExprCode::OpCoefVarFin);
+}
+
+
 // ----------------------------------------------------------------------
 // class RStdDevIncr
 // ----------------------------------------------------------------------
@@ -186,6 +378,13 @@ RStdDevIncr::dumpMe(std::ostream& os) const
 }
 
 
+void
+RStdDevIncr::compile(FnTy fn, AExprCode& code) const
+{
+  compileStdDev(fn, code, AExprCode::OpRStdDevFin);
+}
+
+
 // ----------------------------------------------------------------------
 // class NumSourceIncr
 // ----------------------------------------------------------------------
@@ -197,6 +396,29 @@ NumSourceIncr::dumpMe(std::ostream& os) const
   return os;
 }
 
+
+void
+NumSourceIncr::compile(FnTy fn, AExprCode& code) const
+{
+  switch (fn) {
+    case FnInit:
+      code.emitConst((double)numSrcFxd());
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      break;
+    case FnInitSrc:
+      break;
+    case FnAccum:
+    case FnCombine:
+    case FnFini:
+      // the accumulator only needs to exist
+      code.emit(AExprCode::OpVar, m_accumId[0]);
+      code.emit(AExprCode::OpStore, m_accumId[0]);
+      break;
+    default:
+      DIAG_Die(DIAG_UnexpectedInput);
+  }
+}
+
 //****************************************************************************
 
 } // namespace Metric
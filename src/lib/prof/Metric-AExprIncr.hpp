@@ -86,6 +86,7 @@
 
 #include "Metric-IData.hpp"
 #include "Metric-IDBExpr.hpp"
+#include "Metric-AExprCode.hpp"
 
 #include <lib/support/diagnostics.h>
 #include <lib/support/NaN.h>
@@ -173,6 +174,11 @@ public:
   virtual double
   finalize(Metric::IData& mdata) const = 0;
 
+  // compile: append code performing 'fn' on a block of nodes
+  //   (cf. Metric::AExprCode)
+  virtual void
+  compile(FnTy fn, AExprCode& code) const = 0;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -217,6 +223,10 @@ public:
   // srcId: input source for accumulate()
   // ------------------------------------------------------------
 
+  uint
+  srcId(int i) const
+  { return m_srcId[i]; }
+
   void
   srcId(int i, uint x)
   { m_srcId[i] = x; }
@@ -280,6 +290,10 @@ public:
   numSrcVarVar(const Metric::IData& mdata) const
   { return (uint)var(mdata, m_numSrcVarId); }
 
+  // compileNumSrc: append code leaving numSrc() on the stack
+  void
+  compileNumSrc(AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // R- or L-Value of variable reference (cf. AExpr::Var)
@@ -353,6 +367,10 @@ public:
   }
 
 
+  void
+  compileStdDev(FnTy fn, AExprCode& code, AExprCode::Op finalizeOp) const;
+
+
   double
   finalizeStdDev(Metric::IData& mdata) const
   {
@@ -471,6 +489,9 @@ public:
   finalize(Metric::IData& mdata) const
   { return accumVar(0, mdata); }
 
+  virtual void
+  compile(FnTy fn, AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -542,6 +563,9 @@ public:
   finalize(Metric::IData& mdata) const
   { return accumVar(0, mdata); }
 
+  virtual void
+  compile(FnTy fn, AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -613,6 +637,9 @@ public:
   finalize(Metric::IData& mdata) const
   { return accumVar(0, mdata); }
 
+  virtual void
+  compile(FnTy fn, AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -693,6 +720,9 @@ public:
     return z;
   }
 
+  virtual void
+  compile(FnTy fn, AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -762,6 +792,9 @@ public:
   finalize(Metric::IData& mdata) const
   { return finalizeStdDev(mdata); }
 
+  virtual void
+  compile(FnTy fn, AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -848,6 +881,9 @@ public:
     return z;
   }
 
+  virtual void
+  compile(FnTy fn, AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -934,6 +970,9 @@ public:
     return z;
   }
 
+  virtual void
+  compile(FnTy fn, AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -1015,6 +1054,9 @@ public:
   finalize(Metric::IData& mdata) const
   { return accumVar(0, mdata); }
 
+  virtual void
+  compile(FnTy fn, AExprCode& code) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
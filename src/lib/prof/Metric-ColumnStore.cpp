@@ -0,0 +1,175 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+// ----------------------------------------------------------------------
+//
+//   columnar metric storage
+//
+// ----------------------------------------------------------------------
+
+//************************ System Include Files ******************************
+
+#include <algorithm>
+
+//************************* User Include Files *******************************
+
+#include <include/uint.h>
+
+#include "Metric-ColumnStore.hpp"
+
+#include <lib/support/diagnostics.h>
+
+
+//************************ Forward Declarations ******************************
+
+//****************************************************************************
+
+namespace Prof {
+
+namespace Metric {
+
+const uint ColumnStore::BlockLg;
+const uint ColumnStore::BlockSz;
+
+
+ColumnStore::ColumnStore(uint numRows, uint numColumns)
+  : m_numRows(numRows), m_columns(numColumns)
+{
+}
+
+
+ColumnStore::~ColumnStore()
+{
+  zeroColumns(0, numColumns());
+}
+
+
+void
+ColumnStore::makeBlock(Column& c, uint b)
+{
+  uint numBlocks = (m_numRows + BlockSz - 1) >> BlockLg;
+  DIAG_Assert(b < numBlocks, "ColumnStore: row out of range");
+  if ( !(b < c.size()) ) {
+    // size the table for all rows at once
+    c.resize(numBlocks, NULL);
+  }
+  c[b] = new double[BlockSz](); // zero-initialized
+}
+
+
+void
+ColumnStore::zeroRow(uint row)
+{
+  for (uint col = 0; col < numColumns(); ++col) {
+    if (hasBlock(row, col)) {
+      ref(row, col) = 0.0;
+    }
+  }
+}
+
+
+void
+ColumnStore::zeroColumns(uint colBeg, uint colEnd)
+{
+  colEnd = std::min(colEnd, numColumns());
+  for (uint col = colBeg; col < colEnd; ++col) {
+    Column& c = m_columns[col];
+    for (uint b = 0; b < c.size(); ++b) {
+      delete[] c[b];
+    }
+    Column().swap(c);
+  }
+}
+
+
+void
+ColumnStore::addRows(const RowPairVec& rows, uint colBeg, uint colEnd)
+{
+  ensureColumns(colEnd);
+  for (uint col = colBeg; col < colEnd; ++col) {
+    for (RowPairVec::const_iterator it = rows.begin(); it != rows.end(); ++it) {
+      double x = get(it->first, col);
+      if (x != 0.0) {
+	ref(it->second, col) += x;
+      }
+    }
+  }
+}
+
+
+void
+ColumnStore::compact()
+{
+  for (uint col = 0; col < numColumns(); ++col) {
+    Column& c = m_columns[col];
+    for (uint b = 0; b < c.size(); ++b) {
+      double* blk = c[b];
+      if (blk && std::count(blk, blk + BlockSz, 0.0) == (long)BlockSz) {
+	delete[] blk;
+	c[b] = NULL;
+      }
+    }
+  }
+}
+
+
+size_t
+ColumnStore::numBlocks() const
+{
+  size_t n = 0;
+  for (uint col = 0; col < numColumns(); ++col) {
+    const Column& c = m_columns[col];
+    n += c.size() - std::count(c.begin(), c.end(), (double*)NULL);
+  }
+  return n;
+}
+
+
+//****************************************************************************
+
+} // namespace Metric
+
+} // namespace Prof
@@ -0,0 +1,226 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// class Prof::Metric::ColumnStore
+//
+// Metric values for a set of rows (e.g., the nodes of a CCT::Tree,
+// indexed by dense id) kept as one column per metric rather than one
+// vector per row.  A column is a table of fixed-size blocks of rows;
+// a block is allocated on the first write to it, and an unallocated
+// block reads as zeros, so a metric that is zero over most of the rows
+// costs little more than its block table.
+//
+// Metric::IData objects attached to a store are views of one of its
+// rows (cf. IData::attachMetrics()).
+//
+//***************************************************************************
+
+#ifndef prof_Prof_Metric_ColumnStore_hpp
+#define prof_Prof_Metric_ColumnStore_hpp
+
+//************************ System Include Files ******************************
+
+#include <vector>
+#include <utility>
+
+#include <cstddef>
+
+//************************* User Include Files *******************************
+
+#include <include/uint.h>
+
+#include <lib/support/Unique.hpp>
+
+
+//************************ Forward Declarations ******************************
+
+//****************************************************************************
+
+namespace Prof {
+
+namespace Metric {
+
+class ColumnStore
+  : public Unique // disable copying, for now
+{
+public:
+  static const uint BlockLg = 6;
+  static const uint BlockSz = (1 << BlockLg); // rows per block
+
+  // a pair of rows (src, dst); cf. addRows()
+  typedef std::pair<uint, uint> RowPair;
+  typedef std::vector<RowPair> RowPairVec;
+
+public:
+  // ------------------------------------------------------------
+  // Create/Destroy
+  // ------------------------------------------------------------
+  ColumnStore(uint numRows = 0, uint numColumns = 0);
+
+  ~ColumnStore();
+
+  // ------------------------------------------------------------
+  // Shape
+  // ------------------------------------------------------------
+
+  uint
+  numRows() const
+  { return m_numRows; }
+
+  // makeRow: returns a new row of zeros
+  uint
+  makeRow()
+  { return m_numRows++; }
+
+  uint
+  numColumns() const
+  { return m_columns.size(); }
+
+  // ensureColumns: ensures at least 'n' columns, adding zero columns
+  // at the end
+  void
+  ensureColumns(uint n)
+  {
+    if (n > m_columns.size()) {
+      m_columns.resize(n);
+    }
+  }
+
+  // insertColumnsBefore: inserts 'n' zero columns at the beginning
+  void
+  insertColumnsBefore(uint n)
+  { m_columns.insert(m_columns.begin(), n, Column()); }
+
+  // ------------------------------------------------------------
+  // Values
+  // ------------------------------------------------------------
+
+  double
+  get(uint row, uint col) const
+  {
+    const Column& c = m_columns[col];
+    uint b = (row >> BlockLg);
+    return (b < c.size() && c[b]) ? c[b][row & (BlockSz - 1)] : 0.0;
+  }
+
+  // ref: returns a reference to the value, allocating its block
+  double&
+  ref(uint row, uint col)
+  {
+    Column& c = m_columns[col];
+    uint b = (row >> BlockLg);
+    if ( !(b < c.size() && c[b]) ) {
+      makeBlock(c, b);
+    }
+    return c[b][row & (BlockSz - 1)];
+  }
+
+  // set: as ref(row, col) = x, but a zero stored into an unallocated
+  // block leaves it unallocated
+  void
+  set(uint row, uint col, double x)
+  {
+    if (x != 0.0 || hasBlock(row, col)) {
+      ref(row, col) = x;
+    }
+  }
+
+  bool
+  hasBlock(uint row, uint col) const
+  {
+    const Column& c = m_columns[col];
+    uint b = (row >> BlockLg);
+    return (b < c.size() && c[b]);
+  }
+
+  // ------------------------------------------------------------
+  // Column operations
+  // ------------------------------------------------------------
+
+  // zeroRow: zeros 'row' in every column
+  void
+  zeroRow(uint row);
+
+  // zeroColumns: zeros columns [colBeg, colEnd) in every row,
+  // releasing their blocks
+  void
+  zeroColumns(uint colBeg, uint colEnd);
+
+  // addRows: for each column in [colBeg, colEnd) and then for each
+  // (src, dst) in 'rows', in order: col[dst] += col[src].  E.g., with
+  // (node, parent) pairs in post order this computes inclusive values.
+  void
+  addRows(const RowPairVec& rows, uint colBeg, uint colEnd);
+
+  // compact: releases blocks that hold only zeros
+  void
+  compact();
+
+  // numBlocks: the number of allocated blocks
+  size_t
+  numBlocks() const;
+
+private:
+  typedef std::vector<double*> Column; // blocks
+
+  void
+  makeBlock(Column& c, uint b);
+
+private:
+  uint m_numRows;
+  std::vector<Column> m_columns;
+};
+
+
+} // namespace Metric
+
+} // namespace Prof
+
+//****************************************************************************
+
+#endif /* prof_Prof_Metric_ColumnStore_hpp */
@@ -90,6 +90,72 @@ namespace Metric {
 // IData
 //***************************************************************************
 
+IData&
+IData::operator=(const IData& x)
+{
+  if (&x == this) {
+    return *this;
+  }
+
+  if (m_store) {
+    uint sz = x.numMetrics();
+    m_store->ensureColumns(sz);
+    for (uint i = 0; i < numMetrics(); ++i) {
+      m_store->set(m_row, i, (i < sz) ? x.metric(i) : 0.0);
+    }
+  }
+  else {
+    x.copyMetrics(m_metrics);
+  }
+  return *this;
+}
+
+
+void
+IData::copyMetrics(MetricVec& x) const
+{
+  if (m_store) {
+    x.resize(numMetrics());
+    for (uint i = 0; i < x.size(); ++i) {
+      x[i] = metric(i);
+    }
+  }
+  else {
+    x = m_metrics;
+  }
+}
+
+
+void
+IData::attachMetrics(ColumnStore* store, uint row)
+{
+  detachMetrics();
+
+  store->ensureColumns(m_metrics.size());
+  for (uint i = 0; i < m_metrics.size(); ++i) {
+    store->set(row, i, m_metrics[i]);
+  }
+  MetricVec().swap(m_metrics); // release
+
+  m_store = store;
+  m_row = row;
+}
+
+
+void
+IData::detachMetrics()
+{
+  if (!m_store) {
+    return;
+  }
+
+  copyMetrics(m_metrics);
+  m_store->zeroRow(m_row);
+  m_store = NULL;
+  m_row = 0;
+}
+
+
 std::string
 IData::toStringMetrics(int oFlags, const char* pfx) const
 {
@@ -76,6 +76,8 @@
 
 #include <include/uint.h>
 
+#include "Metric-ColumnStore.hpp"
+
 #include <lib/support/diagnostics.h>
 
 
@@ -95,6 +97,11 @@ namespace Metric {
 // Optimized for the two expected common cases:
 //   1. no metrics (hpcstruct's using Prof::Struct::Tree)
 //   2. a known number of metrics (which may then be expanded)
+//
+// Metrics are kept in a private vector unless attached to a row of a
+// ColumnStore (cf. CCT::Tree::makeMetricColumns()), in which case the
+// accessors below are views of that row.  All rows of a store have
+// the same number of metrics.
 //***************************************************************************
 
 class IData {
@@ -107,25 +114,26 @@ public:
   // Create/Destroy
   // --------------------------------------------------------
   IData(size_t size = 0)
+    : m_store(NULL), m_row(0)
   {
     ensureMetricsSize(size);
   }
 
+  // N.B.: a row of a store is not reclaimed; the store's owner frees
+  // the store after the objects attached to it
   virtual ~IData()
   {
   }
   
+  // N.B.: a copy has private metrics
   IData(const IData& x)
-    : m_metrics(x.m_metrics)
+    : m_store(NULL), m_row(0)
   {
+    x.copyMetrics(m_metrics);
   }
   
   IData&
-  operator=(const IData& x)
-  {
-    m_metrics = x.m_metrics;
-    return *this;
-  }
+  operator=(const IData& x);
 
   // --------------------------------------------------------
   // Metrics
@@ -152,20 +160,21 @@ public:
 
   bool
   hasMetric(size_t mId) const
-  { return (m_metrics[mId] != 0.0); }
+  { return (metric(mId) != 0.0); }
 
   bool
   hasMetricSlow(size_t mId) const
-  { return (mId < m_metrics.size() && hasMetric(mId)); }
+  { return (mId < numMetrics() && hasMetric(mId)); }
 
 
   double
   metric(size_t mId) const
-  { return m_metrics[mId]; }
+  { return (m_store) ? m_store->get(m_row, mId) : m_metrics[mId]; }
 
+  // N.B.: for an attached object, materializes the value's block
   double&
   metric(size_t mId)
-  { return m_metrics[mId]; }
+  { return (m_store) ? m_store->ref(m_row, mId) : m_metrics[mId]; }
 
 
   double
@@ -184,21 +193,46 @@ public:
     return metric(mId);
   }
 
+  // storeMetric: demandMetric(mId) = x, except that, for an attached
+  // object, storing a zero does not materialize the value's block
+  void
+  storeMetric(size_t mId, double x)
+  {
+    ensureMetricsSize(mId + 1);
+    if (m_store) {
+      m_store->set(m_row, mId, x);
+    }
+    else {
+      m_metrics[mId] = x;
+    }
+  }
+
 
   // zeroMetrics: takes bounds of the form [mBegId, mEndId)
   // N.B.: does not have demandZeroMetrics() semantics
   void
   zeroMetrics(uint mBegId, uint mEndId)
   {
+    if (m_store) {
+      for (uint i = mBegId; i < mEndId; ++i) {
+	m_store->set(m_row, i, 0.0);
+      }
+      return;
+    }
     for (uint i = mBegId; i < mEndId; ++i) {
       metric(i) = 0.0;
     }
   }
 
 
+  // N.B.: detaches an attached object
   void
   clearMetrics()
   {
+    if (m_store) {
+      m_store->zeroRow(m_row);
+      m_store = NULL;
+    }
     m_metrics.clear();;
   }
 
@@ -206,19 +240,49 @@ public:
   void
   ensureMetricsSize(size_t size) const
   {
-    if (size > m_metrics.size())
+    if (m_store) {
+      m_store->ensureColumns(size);
+    }
+    else if (size > m_metrics.size()) {
       m_metrics.resize(size, 0.0 /*value*/); // inserts at end
+    }
   }
 
+  // N.B.: the other rows of a store do not move, so an attached object
+  // is first detached
   void
   insertMetricsBefore(size_t numMetrics) 
   {
+    detachMetrics();
     m_metrics.insert(m_metrics.begin(), numMetrics, 0.0);
   }
   
   uint
   numMetrics() const
-  { return m_metrics.size(); }
+  { return (m_store) ? m_store->numColumns() : m_metrics.size(); }
+
+
+  // --------------------------------------------------------
+  // Columnar storage
+  // --------------------------------------------------------
+
+  // attachMetrics: moves the metrics into (the zero) row 'row' of
+  // 'store', after which the accessors are views of that row
+  void
+  attachMetrics(ColumnStore* store, uint row);
+
+  // detachMetrics: moves the metrics of an attached object back into
+  // a private vector; otherwise a no-op
+  void
+  detachMetrics();
+
+  ColumnStore*
+  metricStore() const
+  { return m_store; }
+
+  uint
+  metricRow() const
+  { return m_row; }
 
 
   // --------------------------------------------------------
@@ -246,7 +310,13 @@ public:
 
   
 private:
-  mutable MetricVec m_metrics;
+  void
+  copyMetrics(MetricVec& x) const;
+
+private:
+  mutable MetricVec m_metrics; // empty when attached
+  ColumnStore* m_store;        // does not own
+  uint m_row;
 };
 
 //***************************************************************************
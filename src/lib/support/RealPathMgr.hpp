@@ -64,6 +64,7 @@
 
 #include <string>
 #include <map>
+#include <mutex>
 #include <iostream>
 
 #include <cctype>
@@ -147,6 +148,7 @@ private:
 
   std::string m_searchPaths;
   mutable MyMap m_cache;
+  mutable std::mutex m_cacheLock; // profiles may be read concurrently
 };
 
 
@@ -0,0 +1,359 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   stdio streams over a sequence of bounded MPI messages
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+//**************************** MPI Include Files ****************************
+
+#include <mpi.h>
+
+//************************* System Include Files ****************************
+
+#include <algorithm>
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib> // getenv(), atoll()
+#include <cstring>
+
+#include <sys/types.h>
+
+//*************************** User Include Files ****************************
+
+#include "ChunkedStream.hpp"
+
+#include <lib/support/diagnostics.h>
+
+
+//*************************** Forward Declarations **************************
+
+#define DEFAULT_CHUNK_SIZE (4 * 1024 * 1024)
+
+//***************************************************************************
+
+
+namespace ParallelAnalysis {
+
+//***************************************************************************
+// private
+//***************************************************************************
+
+// Two chunk buffers per stream: the writer fills one while the other
+// is in flight; the reader parses one while the other is received.
+struct ChunkedStream {
+  MPI_Comm comm;
+  int rank; // peer
+  int tag;
+
+  size_t chunkSz;
+  char* buf[2];
+  MPI_Request req[2];
+
+  int cur;     // buffer being filled/read
+  size_t pos;  // writer: bytes filled; reader: bytes read
+  size_t len;  // reader: bytes in 'cur'
+  bool isLast; // reader: 'cur' is the last chunk
+  bool isCur;  // reader: 'cur' has been received
+};
+
+
+static ChunkedStream*
+ChunkedStream_new(int rank, int tag, MPI_Comm comm)
+{
+  ChunkedStream* s = new ChunkedStream;
+  s->comm = comm;
+  s->rank = rank;
+  s->tag = tag;
+  s->chunkSz = chunkSize();
+  for (int i = 0; i < 2; ++i) {
+    s->buf[i] = new char[s->chunkSz];
+    s->req[i] = MPI_REQUEST_NULL;
+  }
+  s->cur = 0;
+  s->pos = 0;
+  s->len = 0;
+  s->isLast = false;
+  s->isCur = false;
+  return s;
+}
+
+
+static void
+ChunkedStream_delete(ChunkedStream* s)
+{
+  for (int i = 0; i < 2; ++i) {
+    delete[] s->buf[i];
+  }
+  delete s;
+}
+
+
+// ------------------------------------------------------------
+// writer
+// ------------------------------------------------------------
+
+// sendChunk: sends the filled part of 'cur', then waits for the other
+// buffer's send so that it may be filled next
+static void
+sendChunk(ChunkedStream* s)
+{
+  MPI_Isend(s->buf[s->cur], (int)s->pos, MPI_BYTE, s->rank, s->tag,
+	    s->comm, &s->req[s->cur]);
+
+  s->cur = 1 - s->cur;
+  s->pos = 0;
+  MPI_Wait(&s->req[s->cur], MPI_STATUS_IGNORE);
+}
+
+
+static ssize_t
+sendStream_write(void* cookie, const char* data, size_t size)
+{
+  ChunkedStream* s = (ChunkedStream*)cookie;
+
+  size_t left = size;
+  while (left > 0) {
+    size_t n = std::min(left, s->chunkSz - s->pos);
+    memcpy(s->buf[s->cur] + s->pos, data, n);
+    s->pos += n;
+    data += n;
+    left -= n;
+
+    if (s->pos == s->chunkSz) {
+      sendChunk(s);
+    }
+  }
+  return size;
+}
+
+
+static int
+sendStream_close(void* cookie)
+{
+  ChunkedStream* s = (ChunkedStream*)cookie;
+
+  sendChunk(s); // the last chunk is short, possibly empty
+  MPI_Waitall(2, s->req, MPI_STATUSES_IGNORE);
+
+  ChunkedStream_delete(s);
+  return 0;
+}
+
+
+// ------------------------------------------------------------
+// reader
+// ------------------------------------------------------------
+
+static void
+postRecv(ChunkedStream* s, int i)
+{
+  MPI_Irecv(s->buf[i], (int)s->chunkSz, MPI_BYTE, s->rank, s->tag,
+	    s->comm, &s->req[i]);
+}
+
+
+// recvChunk: completes the receive into 'cur' and, unless it is the
+// last chunk, posts the receive for the next one
+static void
+recvChunk(ChunkedStream* s)
+{
+  MPI_Status mpistat;
+  MPI_Wait(&s->req[s->cur], &mpistat);
+
+  int count = 0;
+  MPI_Get_count(&mpistat, MPI_BYTE, &count);
+  s->len = count;
+  s->pos = 0;
+  s->isLast = (s->len < s->chunkSz);
+  s->isCur = true;
+
+  if (!s->isLast) {
+    postRecv(s, 1 - s->cur);
+  }
+}
+
+
+static ssize_t
+recvStream_read(void* cookie, char* data, size_t size)
+{
+  ChunkedStream* s = (ChunkedStream*)cookie;
+
+  size_t done = 0;
+  while (done < size) {
+    if (s->pos == s->len) {
+      if (s->isCur) {
+	if (s->isLast) {
+	  break; // EOF
+	}
+	s->cur = 1 - s->cur;
+      }
+      recvChunk(s);
+      continue;
+    }
+
+    size_t n = std::min(size - done, s->len - s->pos);
+    memcpy(data + done, s->buf[s->cur] + s->pos, n);
+    s->pos += n;
+    done += n;
+  }
+  return done;
+}
+
+
+static int
+recvStream_close(void* cookie)
+{
+  ChunkedStream* s = (ChunkedStream*)cookie;
+
+  // N.B.: drain the stream through its last chunk rather than cancel
+  // the pending receive.  A reader that stops exactly at the end of the
+  // data (e.g. fmt_fread) has not seen the empty last chunk, which
+  // would otherwise remain queued and open the next stream on this tag.
+  while (!(s->isCur && s->isLast)) {
+    if (s->isCur) {
+      s->cur = 1 - s->cur;
+    }
+    recvChunk(s);
+  }
+
+  ChunkedStream_delete(s);
+  return 0;
+}
+
+
+//***************************************************************************
+// interface
+//***************************************************************************
+
+// set once by initChunkSize(), before any stream is opened
+static size_t s_chunkSz = 0;
+
+
+void
+initChunkSize(MPI_Comm comm)
+{
+  int myRank;
+  MPI_Comm_rank(comm, &myRank);
+
+  unsigned long long chunkSz = DEFAULT_CHUNK_SIZE;
+
+  if (myRank == 0) {
+    const char* str = getenv("HPCPROF_CHUNK_SIZE");
+    if (str) {
+      long long sz = atoll(str);
+      if (sz > 0 && sz <= INT_MAX) {
+	chunkSz = sz;
+      }
+      else {
+	DIAG_WMsgIf(1, "ignoring invalid HPCPROF_CHUNK_SIZE '" << str << "'");
+      }
+    }
+  }
+
+  // every rank must use rank 0's value (cf. ChunkedStream.hpp)
+  MPI_Bcast(&chunkSz, 1, MPI_UNSIGNED_LONG_LONG, 0, comm);
+  s_chunkSz = chunkSz;
+}
+
+
+size_t
+chunkSize()
+{
+  DIAG_Assert(s_chunkSz > 0,
+	      "ParallelAnalysis::chunkSize: initChunkSize() not called");
+  return s_chunkSz;
+}
+
+
+FILE*
+openSendStream(int dest, int tag, MPI_Comm comm)
+{
+  ChunkedStream* s = ChunkedStream_new(dest, tag, comm);
+
+  cookie_io_functions_t fns;
+  fns.read  = NULL;
+  fns.write = sendStream_write;
+  fns.seek  = NULL;
+  fns.close = sendStream_close;
+
+  FILE* fs = fopencookie(s, "w", fns);
+  DIAG_Assert(fs, "ParallelAnalysis::openSendStream: fopencookie failed");
+  return fs;
+}
+
+
+FILE*
+openRecvStream(int src, int tag, MPI_Comm comm)
+{
+  ChunkedStream* s = ChunkedStream_new(src, tag, comm);
+  postRecv(s, s->cur);
+
+  cookie_io_functions_t fns;
+  fns.read  = recvStream_read;
+  fns.write = NULL;
+  fns.seek  = NULL;
+  fns.close = recvStream_close;
+
+  FILE* fs = fopencookie(s, "r", fns);
+  DIAG_Assert(fs, "ParallelAnalysis::openRecvStream: fopencookie failed");
+  return fs;
+}
+
+
+//***************************************************************************
+
+} // namespace ParallelAnalysis
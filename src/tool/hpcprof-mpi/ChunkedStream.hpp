@@ -0,0 +1,119 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   stdio streams over a sequence of bounded MPI messages
+//
+// Description:
+//   A chunked stream carries its bytes from one rank to another as
+//   messages of at most chunkSize() bytes, all with the same tag; the
+//   last message is shorter than chunkSize() (and may be empty).  The
+//   writer sends each chunk as it fills, so serialization overlaps
+//   the transfer; the reader posts the receive for the next chunk
+//   before parsing the current one.  Sizes are never passed to MPI as
+//   a whole, so streams are not limited to 2 GB.
+//
+//   Both ends must use the same chunk size; initChunkSize() takes it
+//   from rank 0.
+//
+//***************************************************************************
+
+#ifndef ChunkedStream_hpp
+#define ChunkedStream_hpp
+
+//**************************** MPI Include Files ****************************
+
+#include <mpi.h>
+
+//************************* System Include Files ****************************
+
+#include <cstdio>
+#include <cstddef>
+
+//*************************** User Include Files ****************************
+
+//*************************** Forward Declarations **************************
+
+//***************************************************************************
+
+namespace ParallelAnalysis {
+
+// initChunkSize: sets the chunk size of every rank in 'comm' to rank
+// 0's $HPCPROF_CHUNK_SIZE, if set; otherwise 4 MB.  Collective; call
+// once at startup, before any stream is opened.
+void
+initChunkSize(MPI_Comm comm = MPI_COMM_WORLD);
+
+
+// chunkSize: bytes per chunk, as set by initChunkSize()
+size_t
+chunkSize();
+
+
+// openSendStream: returns a write-only stream to rank 'dest'.
+// fclose() sends the last chunk and waits for all sends to complete.
+FILE*
+openSendStream(int dest, int tag, MPI_Comm comm = MPI_COMM_WORLD);
+
+
+// openRecvStream: returns a read-only stream from rank 'src', which
+// reaches EOF after the last chunk.  N.B.: closing it before EOF
+// receives and discards the rest of the stream, so that none of it
+// can be taken for a later stream with the same tag.
+FILE*
+openRecvStream(int src, int tag, MPI_Comm comm = MPI_COMM_WORLD);
+
+} // namespace ParallelAnalysis
+
+
+//***************************************************************************
+
+#endif // ChunkedStream_hpp
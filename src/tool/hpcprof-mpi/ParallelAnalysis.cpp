@@ -77,6 +77,7 @@ using std::string;
 #include <include/uint.h>
 
 #include "ParallelAnalysis.hpp"
+#include "ChunkedStream.hpp"
 
 #include <lib/analysis/CallPath.hpp>
 #include <lib/analysis/Util.hpp>
@@ -122,6 +123,24 @@ broadcast_sizet
 } 
 
 
+// broadcast_bytes: MPI_Bcast takes an int count, so broadcast 'size'
+// bytes in pieces of at most chunkSize()
+static void
+broadcast_bytes
+(
+  uint8_t* buf,
+  size_t size,
+  MPI_Comm comm
+)
+{
+  size_t chunkSz = chunkSize();
+  for (size_t off = 0; off < size; off += chunkSz) {
+    size_t n = std::min(chunkSz, size - off);
+    MPI_Bcast(buf + off, (int)n, MPI_BYTE, 0, comm);
+  }
+}
+
+
 
 //***************************************************************************
 // interface functions
@@ -148,7 +167,7 @@ broadcast
     buf = (uint8_t *)malloc(size * sizeof(uint8_t));
   }
 
-  MPI_Bcast(buf, size, MPI_BYTE, 0, comm);
+  broadcast_bytes(buf, size, comm);
 
   if (myRank != 0) {
     profile = unpackProfile(buf, size);
@@ -178,7 +197,7 @@ broadcast
     buf = (uint8_t *)malloc(size * sizeof(uint8_t));
   }
 
-  MPI_Bcast(buf, size, MPI_BYTE, 0, comm);
+  broadcast_bytes(buf, size, comm);
 
   if (myRank != 0) {
     StringSet *rhs = unpackStringSet(buf, size);
@@ -194,29 +213,29 @@ void
 packSend(Prof::CallPath::Profile* profile,
 	 int dest, int myRank, MPI_Comm comm)
 {
-  uint8_t* profileBuf = NULL;
-  size_t profileBufSz = 0;
-  packProfile(*profile, &profileBuf, &profileBufSz);
-  MPI_Send(profileBuf, (int)profileBufSz, MPI_BYTE, dest, myRank, comm);
-  free(profileBuf);
+  // stream the profile to dest as it is written (cf. packProfile())
+  FILE* fs = openSendStream(dest, myRank, comm);
+
+  uint wFlags = Prof::CallPath::Profile::WFlg_VirtualMetrics;
+  Prof::CallPath::Profile::fmt_fwrite(*profile, fs, wFlags);
+
+  fclose(fs);
 }
 
 void
 recvMerge(Prof::CallPath::Profile* profile,
 	  int src, int myRank, MPI_Comm comm)
 {
-  // probe src
-  MPI_Status mpistat;
-  MPI_Probe(src, src, comm, &mpistat);
-  int profileBufSz;
-  MPI_Get_count(&mpistat, MPI_BYTE, &profileBufSz);
+  // read the profile from src as it arrives (cf. unpackProfile())
+  FILE* fs = openRecvStream(src, src, comm);
+
+  Prof::CallPath::Profile* new_profile = NULL;
+  uint rFlags = Prof::CallPath::Profile::RFlg_VirtualMetrics;
+  Prof::CallPath::Profile::fmt_fread(new_profile, fs, rFlags,
+				     "(ParallelAnalysis::recvMerge)",
+				     NULL, NULL);
 
-  // receive profile from src
-  uint8_t *profileBuf = new uint8_t[profileBufSz];
-  MPI_Recv(profileBuf, profileBufSz, MPI_BYTE, src, src, comm, &mpistat);
-  Prof::CallPath::Profile* new_profile =
-    unpackProfile(profileBuf, (size_t)profileBufSz);
-  delete[] profileBuf;
+  fclose(fs);
 
   if (DBG_CCT_MERGE) {
     string pfx0 = "[" + StrUtil::toStr(myRank) + "]";
@@ -272,31 +291,20 @@ void
 packSend(StringSet *stringSet,
 	 int dest, int myRank, MPI_Comm comm)
 {
-  uint8_t* stringSetBuf = NULL;
-  size_t stringSetBufSz = 0;
-  packStringSet(*stringSet, &stringSetBuf, &stringSetBufSz);
-  MPI_Send(stringSetBuf, (int)stringSetBufSz, MPI_BYTE, 
-	   dest, myRank, comm);
-  free(stringSetBuf);
+  FILE* fs = openSendStream(dest, myRank, comm);
+  StringSet::fmt_fwrite(*stringSet, fs);
+  fclose(fs);
 }
 
 void
 recvMerge(StringSet *stringSet,
 	  int src, int myRank, MPI_Comm comm)
 {
-  // determine size of incoming packed directory set from src
-  MPI_Status mpistat;
-  MPI_Probe(src, src, comm, &mpistat);
-  int stringSetBufSz = 0;
-  MPI_Get_count(&mpistat, MPI_BYTE, &stringSetBufSz);
-
-  // receive new stringSet from src
-  uint8_t *stringSetBuf = new uint8_t[stringSetBufSz];
-  MPI_Recv(stringSetBuf, stringSetBufSz, MPI_BYTE, 
-	   src, src, comm, &mpistat);
-  StringSet *new_stringSet =
-    unpackStringSet(stringSetBuf, (size_t) stringSetBufSz);
-  delete[] stringSetBuf;
+  FILE* fs = openRecvStream(src, src, comm);
+  StringSet *new_stringSet = NULL;
+  StringSet::fmt_fread(new_stringSet, fs);
+  fclose(fs);
+
   *stringSet += *new_stringSet;
   delete new_stringSet;
 }
@@ -327,7 +335,7 @@ unpackProfile(uint8_t* buffer, size_t bufferSz)
   uint rFlags = Prof::CallPath::Profile::RFlg_VirtualMetrics;
   Prof::CallPath::Profile::fmt_fread(prof, fs, rFlags,
 				     "(ParallelAnalysis::unpackProfile)",
-				     NULL, NULL);
+				     NULL, NULL, (const char*)buffer, bufferSz);
 
   fclose(fs);
   return prof;
@@ -382,7 +390,7 @@ packMetrics(const Prof::CallPath::Profile& profile,
   DIAG_Assert(packedMetrics.numMetrics() == mDrvdEnd - mDrvdBeg, "");
 
   for (Prof::CCT::ANodeIterator it(cct.root()); it.Current(); ++it) {
-    Prof::CCT::ANode* n = it.current();
+    const Prof::CCT::ANode* n = it.current();
     for (uint mId1 = 0, mId2 = mDrvdBeg; mId2 < mDrvdEnd; ++mId1, ++mId2) {
       packedMetrics.idx(n->id(), mId1) = n->metric(mId2);
     }
@@ -404,9 +412,9 @@ unpackMetrics(Prof::CallPath::Profile& profile,
   DIAG_Assert(packedMetrics.numMetrics() == mEndId - mBegId, "");
 
   for (uint nodeId = 1; nodeId < packedMetrics.numNodes(); ++nodeId) {
+    Prof::CCT::ANode* n = cct.findNode(nodeId);
     for (uint mId1 = 0, mId2 = mBegId; mId2 < mEndId; ++mId1, ++mId2) {
-      Prof::CCT::ANode* n = cct.findNode(nodeId);
-      n->demandMetric(mId2) = packedMetrics.idx(nodeId, mId1);
+      n->storeMetric(mId2, packedMetrics.idx(nodeId, mId1));
     }
   }
 
@@ -423,3 +431,224 @@ unpackMetrics(Prof::CallPath::Profile& profile,
 //***************************************************************************
 
 } // namespace ParallelAnalysis
+
+
+//***************************************************************************
+// unit test
+//***************************************************************************
+
+// Streams synthetic profiles to rank 0 over chunked streams, as
+// packSend()/recvMerge() do.  Each rank sends its profile twice in a
+// row on its tag.  Rank 0 reads each one with fmt_fread, which stops
+// at the end of the profile rather than at EOF, and closes the stream.
+// It then checks that the profile re-serializes to the same bytes as
+// the profile unpackProfile() reads from the sent bytes in memory.
+// Then each rank sends, twice, a payload of exactly three chunks,
+// which rank 0 reads exactly and closes without reaching EOF, so the
+// empty last chunk is still in flight (the sender delays it) when the
+// next stream on the tag is opened.  A chunk size given as argv[1]
+// tests other sizes; by default it divides the profile's size.  The
+// test finally checks that no message is left unreceived.
+//
+// build with UNIT_TEST defined, linking ChunkedStream.cpp, lib/analysis,
+// lib/prof, lib/xml, lib/support and lib/prof-lean; run with
+// mpirun -np <n>, n >= 2.
+
+// #define UNIT_TEST
+#ifdef UNIT_TEST
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+#include <lib/prof/CallPath-TestProfile.hpp>
+
+using namespace ParallelAnalysis;
+
+// makeProfile: a profile of 'numNodes' nodes whose shape depends only
+// on 'numNodes' and whose metric values depend on 'seed', so every
+// rank's profile has the same size
+static Prof::CallPath::Profile*
+makeProfile(uint numNodes, uint seed)
+{
+  char* buf = NULL;
+  size_t bufSz = 0;
+  FILE* fs = open_memstream(&buf, &bufSz);
+
+  Prof::CallPath::TestProfileOpts opts;
+  opts.numNodes = numNodes;
+  opts.valueSeed = seed;
+  Prof::CallPath::writeTestProfile(fs, opts);
+  fclose(fs);
+
+  Prof::CallPath::Profile* prof = unpackProfile((uint8_t*)buf, bufSz);
+  free(buf);
+  return prof;
+}
+
+
+// exactChunkSize: the largest chunk size of at most a third of
+// 'size' that divides it, or a third of 'size' if there is none
+static size_t
+exactChunkSize(size_t size)
+{
+  for (size_t sz = size / 3; sz >= 64; --sz) {
+    if (size % sz == 0) {
+      return sz;
+    }
+  }
+  return size / 3;
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  MPI_Init(&argc, &argv);
+
+  MPI_Comm comm = MPI_COMM_WORLD;
+  int myRank, numRanks;
+  MPI_Comm_rank(comm, &myRank);
+  MPI_Comm_size(comm, &numRanks);
+
+  const uint numNodes = 20000;
+  const int numRounds = 2;
+
+  Prof::CallPath::Profile* prof = makeProfile(numNodes, myRank);
+  uint8_t* buf = NULL;
+  size_t bufSz = 0;
+  packProfile(*prof, &buf, &bufSz);
+
+  // N.B.: initChunkSize() takes rank 0's $HPCPROF_CHUNK_SIZE; only
+  // rank 0 sets it, so the broadcast is what the other ranks see
+  if (myRank == 0) {
+    long sz = (argc > 1) ? atol(argv[1]) : (long)exactChunkSize(bufSz);
+    setenv("HPCPROF_CHUNK_SIZE", StrUtil::toStr(sz).c_str(), 1);
+  }
+  initChunkSize(comm);
+  size_t chunkSz = chunkSize();
+
+  std::vector<char> fsBuf(chunkSz);
+
+  int bad = 0;
+  if (myRank != 0) {
+    for (int k = 0; k < numRounds; ++k) {
+      FILE* fs = openSendStream(0, myRank, comm);
+      uint wFlags = Prof::CallPath::Profile::WFlg_VirtualMetrics;
+      Prof::CallPath::Profile::fmt_fwrite(*prof, fs, wFlags);
+      fflush(fs);
+      usleep(100000); // leave the last chunk in flight
+      fclose(fs);
+    }
+  }
+  else {
+    if (numRanks < 2) {
+      fprintf(stderr, "run with mpirun -np <n>, n >= 2\n");
+    }
+    for (int src = 1; src < numRanks; ++src) {
+      // the bytes 'src' sends, read back from memory
+      Prof::CallPath::Profile* sent = makeProfile(numNodes, src);
+      uint8_t* sentBuf = NULL;
+      size_t sentBufSz = 0;
+      packProfile(*sent, &sentBuf, &sentBufSz);
+      Prof::CallPath::Profile* expect = unpackProfile(sentBuf, sentBufSz);
+      uint8_t* expectBuf = NULL;
+      size_t expectBufSz = 0;
+      packProfile(*expect, &expectBuf, &expectBufSz);
+
+      for (int k = 0; k < numRounds; ++k) {
+	// stdio reads whole chunks, as the stream receives them
+	FILE* fs = openRecvStream(src, src, comm);
+	setvbuf(fs, &fsBuf[0], _IOFBF, chunkSz);
+
+	Prof::CallPath::Profile* recvd = NULL;
+	uint rFlags = Prof::CallPath::Profile::RFlg_VirtualMetrics;
+	try {
+	  Prof::CallPath::Profile::fmt_fread(recvd, fs, rFlags, "(unit test)",
+					     NULL, NULL);
+	}
+	catch (...) {
+	  recvd = NULL;
+	}
+	fclose(fs);
+
+	bool ok = false;
+	if (recvd) {
+	  uint8_t* recvdBuf = NULL;
+	  size_t recvdBufSz = 0;
+	  packProfile(*recvd, &recvdBuf, &recvdBufSz);
+	  ok = (recvdBufSz == expectBufSz
+		&& memcmp(recvdBuf, expectBuf, expectBufSz) == 0);
+	  free(recvdBuf);
+	  delete recvd;
+	}
+	if (!ok) {
+	  fprintf(stderr, "rank %d, profile %d: mismatch\n", src, k);
+	  MPI_Abort(comm, 1); // the senders may be blocked for good
+	}
+      }
+      free(expectBuf);
+      delete expect;
+      free(sentBuf);
+      delete sent;
+    }
+  }
+
+  // exact multiples of the chunk size, closed before EOF
+  size_t payloadSz = 3 * chunkSz;
+  std::vector<char> payload(payloadSz);
+  for (int k = 0; k < numRounds; ++k) {
+    if (myRank != 0) {
+      memset(&payload[0], 'a' + (myRank + k) % 26, payloadSz);
+      FILE* fs = openSendStream(0, myRank, comm);
+      fwrite(&payload[0], 1, payloadSz, fs);
+      fflush(fs);
+      usleep(100000); // leave the last chunk in flight
+      fclose(fs);
+      continue;
+    }
+    for (int src = 1; src < numRanks; ++src) {
+      FILE* fs = openRecvStream(src, src, comm);
+      setvbuf(fs, NULL, _IONBF, 0);
+      size_t n = fread(&payload[0], 1, payloadSz, fs);
+      fclose(fs);
+
+      char c = 'a' + (src + k) % 26;
+      bool ok = (n == payloadSz);
+      for (size_t i = 0; ok && i < payloadSz; ++i) {
+	ok = (payload[i] == c);
+      }
+      if (!ok) {
+	fprintf(stderr, "rank %d, payload %d: mismatch\n", src, k);
+	MPI_Abort(comm, 1); // the senders may be blocked for good
+      }
+    }
+  }
+
+  MPI_Barrier(comm);
+  int isLeft = 0;
+  MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, comm, &isLeft, MPI_STATUS_IGNORE);
+  if (isLeft) {
+    fprintf(stderr, "rank %d: message left unreceived\n", myRank);
+    bad++;
+  }
+
+  int numBad = 0;
+  MPI_Reduce(&bad, &numBad, 1, MPI_INT, MPI_SUM, 0, comm);
+  if (myRank == 0) {
+    printf("%d ranks, profile %zu bytes, chunk %zu bytes%s: %s\n",
+	   numRanks, bufSz, chunkSz,
+	   (bufSz % chunkSz == 0) ? " (exact multiple)" : "",
+	   (numBad == 0) ? "ok" : "FAILED");
+  }
+
+  free(buf);
+  delete prof;
+  MPI_Finalize();
+  return (numBad == 0) ? 0 : 1;
+}
+
+#endif // UNIT_TEST
@@ -201,6 +201,9 @@ namespace ParallelAnalysis {
 
 // ------------------------------------------------------------------------
 // recvMerge: merge profile on rank_y into profile on rank_x
+//
+// Profiles and string sets are streamed in chunks (cf. ChunkedStream.hpp)
+// so that packing, transfer and unpacking overlap.
 // ------------------------------------------------------------------------
 
 void
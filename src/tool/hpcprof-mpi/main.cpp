@@ -75,6 +75,8 @@ using std::string;
 #include <vector>
 using std::vector;
 
+#include <map>
+
 #include <cstdlib> // getenv()
 #include <cmath>   // ceil()
 #include <climits> // UCHAR_MAX, PATH_MAX
@@ -87,6 +89,7 @@ using std::vector;
 
 #include "Args.hpp"
 #include "ParallelAnalysis.hpp"
+#include "ChunkedStream.hpp"
 
 #include <lib/analysis/CallPath.hpp>
 #include <lib/analysis/Util.hpp>
@@ -105,6 +108,30 @@ using std::vector;
 
 //*************************** Forward Declarations ***************************
 
+// MetricDB: with --metric-db-aggregate, the thread-level metric
+// database for the profiles of one group that are processed by this
+// rank (hpcprof-metricdb format version >= 1.0).  Profiles are appended as they are processed; the
+// table of contents and final header are written by closeMetricDB().
+struct MetricDB {
+  struct TocEntry {
+    string   profileName;
+    uint32_t numMetrics;
+    uint64_t offset;
+  };
+
+  string   fnm;
+  FILE*    fs;
+  uint64_t offset; // end of data written so far
+  uint32_t numNodes;
+  vector<TocEntry> toc;
+};
+
+typedef std::map<uint, MetricDB*> MetricDBMap; // group-id -> MetricDB
+
+// size of blocks used to write metric values
+static const size_t MetricDBBlockSz = (1 << 20);
+
+
 static int
 realmain(int argc, char* const* argv);
 
@@ -148,7 +175,7 @@ static void
 makeThreadMetrics_Lcl(Prof::CallPath::Profile& profGbl,
 		      const string& profileFile,
 		      const Analysis::Args& args, uint groupId, uint groupMax,
-		      int myRank);
+		      MetricDBMap& metricDBs, int myRank);
 
 static string
 makeDBFileName(const string& dbDir, uint groupId, const string& profileFile);
@@ -157,6 +184,20 @@ static void
 writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
 	       const string& metricDBFnm);
 
+static string
+makeAggregateDBFileName(const string& dbDir, uint groupId, int myRank);
+
+static MetricDB*
+openMetricDB(const string& metricDBFnm, uint numNodes);
+
+static void
+closeMetricDB(MetricDB* metricDB);
+
+static void
+writeAggregateMetricsDB(Prof::CallPath::Profile& profGbl,
+			uint mBegId, uint mEndId,
+			const string& profileFile, MetricDB& metricDB);
+
 
 static void
 writeStructure(const Prof::Struct::Tree& structure, const char* baseNm,
@@ -252,6 +293,9 @@ realmain(int argc, char* const* argv)
   MPI_Comm_rank(MPI_COMM_WORLD, &myRank); 
   MPI_Comm_size(MPI_COMM_WORLD, &numRanks);
 
+  // all ranks stream with rank 0's chunk size
+  ParallelAnalysis::initChunkSize(MPI_COMM_WORLD);
+
   // -------------------------------------------------------
   // 0. Debugging hook
   // -------------------------------------------------------
@@ -308,7 +352,8 @@ realmain(int argc, char* const* argv)
   Analysis::Util::UIntVec* groupMap =
     (nArgs.groupMax > 1) ? nArgs.groupMap : NULL;
 
-  profLcl = Analysis::CallPath::read(*nArgs.paths, groupMap, mergeTy, rFlags);
+  profLcl = Analysis::CallPath::read(*nArgs.paths, groupMap, mergeTy, rFlags,
+				     0 /*mrgFlags*/, args.prof_nThreads);
 
   // -------------------------------------------------------
   // 1b. Create canonical CCT (metrics merged by <group>.<name>.*)
@@ -360,6 +405,9 @@ realmain(int argc, char* const* argv)
 
   // N.B.: Dense ids are assigned w.r.t. Prof::CCT::...::cmpByStructureInfo()
   profGbl->cct()->makeDensePreorderIds();
+  if (args.prof_metricColumns) {
+    profGbl->cct()->makeMetricColumns();
+  }
 
   // -------------------------------------------------------
   // 2a. Create summary metrics for canonical CCT
@@ -663,10 +711,18 @@ makeThreadMetrics(Prof::CallPath::Profile& profGbl,
 		  const vector<uint>& groupIdToGroupSizeMap,
 		  int myRank, int numRanks)
 {
+  MetricDBMap metricDBs;
+
   for (uint i = 0; i < nArgs.paths->size(); ++i) {
     string& fnm = (*nArgs.paths)[i];
     uint groupId = (*nArgs.groupMap)[i];
-    makeThreadMetrics_Lcl(profGbl, fnm, args, groupId, nArgs.groupMax, myRank);
+    makeThreadMetrics_Lcl(profGbl, fnm, args, groupId, nArgs.groupMax,
+			  metricDBs, myRank);
+  }
+
+  for (MetricDBMap::iterator it = metricDBs.begin();
+       it != metricDBs.end(); ++it) {
+    closeMetricDB(it->second);
   }
 }
 
@@ -879,7 +935,7 @@ static void
 makeThreadMetrics_Lcl(Prof::CallPath::Profile& profGbl,
 		      const string& profileFile,
 		      const Analysis::Args& args, uint groupId, uint groupMax,
-		      int myRank)
+		      MetricDBMap& metricDBs, int myRank)
 {
   Prof::Metric::Mgr* mMgrGbl = profGbl.metricMgr();
   Prof::CCT::Tree* cctGbl = profGbl.cct();
@@ -945,8 +1001,18 @@ makeThreadMetrics_Lcl(Prof::CallPath::Profile& profGbl,
     // write local sampled metric values into database
     // -------------------------------------------------------
 
-    string dbFnm = makeDBFileName(args.db_dir, groupId, profileFile);
-    writeMetricsDB(profGbl, mBeg, mEnd, dbFnm);
+    if (args.db_metricDBAggregate) {
+      MetricDB*& metricDB = metricDBs[groupId];
+      if (!metricDB) {
+	string dbFnm = makeAggregateDBFileName(args.db_dir, groupId, myRank);
+	metricDB = openMetricDB(dbFnm, cctGbl->maxDenseId());
+      }
+      writeAggregateMetricsDB(profGbl, mBeg, mEnd, profileFile, *metricDB);
+    }
+    else {
+      string dbFnm = makeDBFileName(args.db_dir, groupId, profileFile);
+      writeMetricsDB(profGbl, mBeg, mEnd, dbFnm);
+    }
 
     // -------------------------------------------------------
     // reinitialize metric values for next time
@@ -1011,6 +1077,7 @@ writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
 
   // 1. header
   hpcmetricDB_fmt_hdr_t hdr;
+  hdr.version = HPCMETRICDB_FMT_Version_01;
   hdr.numNodes = numNodes;
   hdr.numMetrics = mEndId - mBegId; // [mBegId mEndId)
 
@@ -1047,6 +1114,220 @@ badwrite:
 }
 
 
+static string
+makeAggregateDBFileName(const string& dbDir, uint groupId, int myRank)
+{
+  string grpStr = StrUtil::toStr(groupId);
+  string rankStr = StrUtil::toStr(myRank);
+
+  string fnm = grpStr + ".rank-" + rankStr + "." + HPCPROF_MetricDBSfx;
+
+  string metricDBFnm = dbDir + "/" + fnm;
+  return metricDBFnm;
+}
+
+
+static void
+metricDBWriteError(const string& metricDBFnm)
+{
+  std::string errorString;
+  hpcrun_getFileErrorString(metricDBFnm, errorString);
+
+  DIAG_EMsg("failed writing profile result file" << 
+	    errorString << "; aborting."); 
+  prof_abort(-1);
+}
+
+
+static void
+metricDBWrite(MetricDB& metricDB, const std::vector<uint8_t>& buf)
+{
+  if (buf.empty()) {
+    return;
+  }
+  size_t nw = fwrite(&buf[0], 1, buf.size(), metricDB.fs);
+  if (nw != buf.size()) {
+    metricDBWriteError(metricDB.fnm);
+  }
+  metricDB.offset += buf.size();
+}
+
+
+static inline void
+metricDBPack4(std::vector<uint8_t>& buf, uint32_t val)
+{
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    buf.push_back((uint8_t)(val >> shift));
+  }
+}
+
+
+static inline void
+metricDBPack8(std::vector<uint8_t>& buf, uint64_t val)
+{
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    buf.push_back((uint8_t)(val >> shift));
+  }
+}
+
+
+static MetricDB*
+openMetricDB(const string& metricDBFnm, uint numNodes)
+{
+  FILE* fs = hpcio_fopen_w(metricDBFnm.c_str(), 1);
+  if (!fs) {
+    std::string errorString;
+    hpcrun_getFileErrorString(metricDBFnm, errorString);
+
+    DIAG_EMsg("failed opening profile result file for writing " << 
+	      errorString << "; aborting."); 
+
+    prof_abort(-1);
+  }
+  DIAG_MsgIf(0, "openMetricDB: " << metricDBFnm);
+
+  MetricDB* metricDB = new MetricDB;
+  metricDB->fnm = metricDBFnm;
+  metricDB->fs = fs;
+  metricDB->numNodes = numNodes;
+
+  // provisional header; rewritten by closeMetricDB()
+  hpcmetricDB_fmt_hdr_t hdr;
+  hdr.version = HPCMETRICDB_FMT_Version_10;
+  hdr.numNodes = numNodes;
+  hdr.numProfiles = 0;
+  hdr.tocOffset = 0;
+
+  int ret = hpcmetricDB_fmt_hdr_fwrite(&hdr, fs);
+  if (ret == HPCFMT_ERR) {
+    metricDBWriteError(metricDBFnm);
+  }
+
+  metricDB->offset = ftello(fs);
+
+  return metricDB;
+}
+
+
+static void
+closeMetricDB(MetricDB* metricDB)
+{
+  FILE* fs = metricDB->fs;
+
+  // 1. table of contents
+  hpcmetricDB_fmt_hdr_t hdr;
+  hdr.version = HPCMETRICDB_FMT_Version_10;
+  hdr.numNodes = metricDB->numNodes;
+  hdr.numProfiles = metricDB->toc.size();
+  hdr.tocOffset = metricDB->offset;
+
+  int ret;
+  for (uint i = 0; i < metricDB->toc.size(); ++i) {
+    MetricDB::TocEntry& e = metricDB->toc[i];
+
+    hpcmetricDB_fmt_tocEntry_t entry;
+    entry.profileName = const_cast<char*>(e.profileName.c_str());
+    entry.numMetrics = e.numMetrics;
+    entry.offset = e.offset;
+
+    ret = hpcmetricDB_fmt_tocEntry_fwrite(&entry, fs);
+    if (ret == HPCFMT_ERR) goto badwrite;
+  }
+
+  // 2. final header
+  if (fseeko(fs, 0, SEEK_SET) != 0) goto badwrite;
+
+  ret = hpcmetricDB_fmt_hdr_fwrite(&hdr, fs);
+  if (ret == HPCFMT_ERR) goto badwrite;
+
+  hpcio_fclose(fs);
+  delete metricDB;
+  return;
+
+badwrite:
+  metricDBWriteError(metricDB->fnm);
+}
+
+
+// [mBegId, mEndId)
+static void
+writeAggregateMetricsDB(Prof::CallPath::Profile& profGbl,
+			uint mBegId, uint mEndId,
+			const string& profileFile, MetricDB& metricDB)
+{
+  const Prof::CCT::Tree& cct = *(profGbl.cct());
+
+  uint numNodes = metricDB.numNodes;
+  uint numMetrics = mEndId - mBegId; // [mBegId mEndId)
+
+  DIAG_Assert(cct.maxDenseId() == numNodes, "");
+  DIAG_MsgIf(0, "writeAggregateMetricsDB: " << profileFile);
+
+  // -------------------------------------------------------
+  // index nodes by id and count non-zero values of each metric
+  // -------------------------------------------------------
+  vector<Prof::CCT::ANode*> nodes(numNodes + 1, NULL);
+  vector<uint64_t> metricIdx(numMetrics + 1, 0);
+
+  for (Prof::CCT::ANodeIterator it(cct.root()); it.Current(); ++it) {
+    Prof::CCT::ANode* n = it.current();
+    nodes[n->id()] = n;
+    for (uint mId1 = 0, mId2 = mBegId; mId2 < mEndId; ++mId1, ++mId2) {
+      if (n->hasMetricSlow(mId2)) {
+	metricIdx[mId1 + 1]++;
+      }
+    }
+  }
+
+  for (uint mId1 = 0; mId1 < numMetrics; ++mId1) {
+    metricIdx[mId1 + 1] += metricIdx[mId1];
+  }
+
+  MetricDB::TocEntry tocEntry;
+  tocEntry.profileName =
+    FileUtil::rmSuffix(FileUtil::basename(profileFile.c_str()));
+  tocEntry.numMetrics = numMetrics;
+  tocEntry.offset = metricDB.offset;
+  metricDB.toc.push_back(tocEntry);
+
+  // -------------------------------------------------------
+  // write data
+  // -------------------------------------------------------
+  std::vector<uint8_t> buf;
+  buf.reserve(MetricDBBlockSz + HPCMETRICDB_FMT_ValueLen);
+
+  // 1. metric index
+  for (uint mId1 = 0; mId1 < numMetrics + 1; ++mId1) {
+    metricDBPack8(buf, metricIdx[mId1]);
+  }
+
+  // 2. metric values: the non-zero (node-id, value) pairs of each
+  //    metric, in node-id order.  cf. ParallelAnalysis::packMetrics
+  for (uint mId2 = mBegId; mId2 < mEndId; ++mId2) {
+    for (uint nodeId = 1; nodeId < numNodes + 1; ++nodeId) {
+      const Prof::CCT::ANode* n = nodes[nodeId];
+      if (!n || !n->hasMetricSlow(mId2)) {
+	continue;
+      }
+
+      hpcfmt_byte8_union_t mval;
+      mval.r8 = n->metric(mId2);
+      DIAG_MsgIf(0,  "  " << nodeId << " -> " << mval.r8);
+
+      metricDBPack4(buf, nodeId);
+      metricDBPack8(buf, mval.i8);
+
+      if (buf.size() >= MetricDBBlockSz) {
+	metricDBWrite(metricDB, buf);
+	buf.clear();
+      }
+    }
+  }
+
+  metricDBWrite(metricDB, buf);
+}
+
+
 //***************************************************************************
 
 static void
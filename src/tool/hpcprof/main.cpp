@@ -182,7 +182,8 @@ realmain(int argc, char* const* argv)
   uint mrgFlags = (Prof::CCT::MrgFlg_NormalizeTraceFileY);
 
   Prof::CallPath::Profile* prof =
-    Analysis::CallPath::read(*nArgs.paths, groupMap, mergeTy, rFlags, mrgFlags);
+    Analysis::CallPath::read(*nArgs.paths, groupMap, mergeTy, rFlags, mrgFlags,
+			     args.prof_nThreads);
 
   prof->disable_redundancy(args.remove_redundancy);
 
@@ -221,6 +222,14 @@ realmain(int argc, char* const* argv)
   // -------------------------------------------------------
 
   if (Analysis::Args::MetricFlg_isSum(args.prof_metrics)) {
+    // N.B.: with --metric-columns, keep the canonical CCT's metrics in
+    // columns for the summary passes; dense ids are remade after
+    // normalization.
+    if (args.prof_metricColumns) {
+      prof->cct()->makeDensePreorderIds();
+      prof->cct()->makeMetricColumns();
+    }
+
     makeMetrics(*prof, args, nArgs);
   }
 
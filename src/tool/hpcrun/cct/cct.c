@@ -71,6 +71,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <assert.h>
 
 //*************************** User Include Files ****************************
@@ -78,7 +79,6 @@
 #include <memory/hpcrun-malloc.h>
 #include <hpcrun/metrics.h>
 #include <messages/messages.h>
-#include <lib/prof-lean/splay-macros.h>
 #include <lib/prof-lean/hpcrun-fmt.h>
 #include <lib/prof-lean/hpcrun-fmt.h>
 #include <lib/prof-lean/spinlock.h>
@@ -95,8 +95,17 @@
 
 //***************************** concrete data structure definition **********
 
+// index of a node in the node arena (see below); 0 is the null node
+typedef uint32_t cct_index_t;
+
 struct cct_node_t {
 
+ // bundle abstract address components into a data type
+  cct_addr_t addr;
+
+  // metrics of this node, by kind (see cct2metrics.h)
+  metric_data_list_t* metrics;
+
   // ---------------------------------------------------------
   // a persistent node id is assigned for each node. this id
   // is used both to reassemble a tree when reading it from 
@@ -105,27 +114,278 @@ struct cct_node_t {
   // node in the path.
   // ---------------------------------------------------------
   int32_t persistent_id;
-  
- // bundle abstract address components into a data type
-  cct_addr_t addr;
 
-  bool is_leaf;
-  
+  // this node's own arena index
+  cct_index_t self;
+
   // ---------------------------------------------------------
   // tree structure
   // ---------------------------------------------------------
 
   // parent node and the beginning of the child list
   // vi3: also used as a next pointer for freelist of trees
-  struct cct_node_t* parent;
-  struct cct_node_t* children;
+  cct_index_t parent;
+  cct_index_t children;
 
-  // left and right pointers for splay tree of siblings
-  struct cct_node_t* left;
-  struct cct_node_t* right;
+  // left and right links for splay tree of siblings
+  cct_index_t left;
+  cct_index_t right;
 
+  // hash table of the children, once there are enough of them
+  // (see child table section); 0 if none
+  uint32_t table;
+
+  // children inserted so far, while there is no table
+  uint16_t nkids;
+
+  bool is_leaf;
 };
 
+//***************************** node arena **********************************
+//
+// Nodes are carved out of fixed-size slabs instead of being allocated
+// one at a time, and refer to one another by 32-bit arena index
+// rather than by pointer.  Index i names node (i & CCT_SLAB_MASK) of
+// slab (i >> CCT_SLAB_LOG).  Slabs are numbered process-wide, so an
+// index means the same node in every thread (trees are merged across
+// threads); each thread fills its own slab.  Slab 0 is never
+// allocated, so index 0 is the null node.
+//
+// A finishing thread hands the unused tail of its slab back (see
+// hpcrun_cct_release_slab) and threads take spare tails before new
+// slabs, so thread churn consumes the arena by nodes actually used
+// rather than by a slab per thread.  Spare tails are chained through
+// their first node: left holds the end of the tail, right the next one.
+//
+
+#define CCT_SLAB_LOG   11
+#define CCT_SLAB_NODES (1 << CCT_SLAB_LOG)
+#define CCT_SLAB_MASK  (CCT_SLAB_NODES - 1)
+#define CCT_MAX_SLABS  (1 << 18)
+
+static cct_node_t* cct_slabs[CCT_MAX_SLABS];
+static atomic_uint_least32_t cct_num_slabs = ATOMIC_VAR_INIT(1);
+
+static __thread cct_index_t cct_slab_next = 0;
+static __thread cct_index_t cct_slab_end = 0;
+
+static cct_index_t cct_spare_slabs = 0;
+static spinlock_t cct_spare_lock = SPINLOCK_UNLOCKED;
+
+static inline cct_node_t*
+cct_node_at(cct_index_t i)
+{
+  return i ? &cct_slabs[i >> CCT_SLAB_LOG][i & CCT_SLAB_MASK] : NULL;
+}
+
+static inline cct_index_t
+cct_node_index(cct_node_t* node)
+{
+  return node ? node->self : 0;
+}
+
+static bool
+cct_arena_take_spare(void)
+{
+  spinlock_lock(&cct_spare_lock);
+  cct_index_t spare = cct_spare_slabs;
+  if (spare) {
+    cct_node_t* first = cct_node_at(spare);
+    cct_spare_slabs = first->right;
+    cct_slab_next = spare;
+    cct_slab_end = first->left;
+  }
+  spinlock_unlock(&cct_spare_lock);
+  return spare != 0;
+}
+
+static cct_node_t*
+cct_arena_alloc(void)
+{
+  if (cct_slab_next == cct_slab_end && !cct_arena_take_spare()) {
+    uint32_t slab = atomic_fetch_add_explicit(&cct_num_slabs, 1,
+					      memory_order_relaxed);
+    if (slab >= CCT_MAX_SLABS) {
+      hpcrun_abort("hpcrun: calling context tree node arena is full (%ld nodes)",
+		   (long) CCT_MAX_SLABS * CCT_SLAB_NODES);
+    }
+    cct_slabs[slab] = hpcrun_malloc(CCT_SLAB_NODES * sizeof(cct_node_t));
+    if (cct_slabs[slab] == NULL) {
+      hpcrun_abort("hpcrun: out of memory for calling context tree nodes");
+    }
+    cct_slab_next = slab << CCT_SLAB_LOG;
+    cct_slab_end = cct_slab_next + CCT_SLAB_NODES;
+  }
+
+  cct_index_t i = cct_slab_next++;
+  cct_node_t* node = cct_node_at(i);
+  node->self = i;
+  node->table = 0;
+  return node;
+}
+
+void
+hpcrun_cct_release_slab(void)
+{
+  if (cct_slab_next == cct_slab_end) {
+    return;
+  }
+
+  cct_node_t* first = cct_node_at(cct_slab_next);
+  first->left = cct_slab_end;
+
+  spinlock_lock(&cct_spare_lock);
+  first->right = cct_spare_slabs;
+  cct_spare_slabs = cct_slab_next;
+  spinlock_unlock(&cct_spare_lock);
+
+  cct_slab_next = cct_slab_end = 0;
+}
+
+//***************************** child table *********************************
+//
+// Sibling sets are splay trees threaded through the left and right
+// links.  A node whose fan-out reaches CCT_CHILD_TABLE_MIN also gets
+// an open-addressed hash table of its children, so that looking up a
+// child that is already there does not walk (or restructure) a deep
+// splay tree.  The splay tree remains the sibling set proper; the
+// table is an index into it, updated on insertion and rebuilt after
+// any other change to the set.  Tables are named by a 32-bit handle
+// to keep the node small; if handles run out, nodes just go without.
+//
+
+#define CCT_CHILD_TABLE_MIN 16
+#define CCT_MAX_TABLES      (1 << 16)
+#define CCT_NO_TABLE        UINT16_MAX
+
+typedef struct cct_child_table_t {
+  uint32_t mask;
+  uint32_t count;
+  cct_index_t slot[];
+} cct_child_table_t;
+
+static cct_child_table_t* cct_tables[CCT_MAX_TABLES];
+static atomic_uint_least32_t cct_num_tables = ATOMIC_VAR_INIT(1);
+
+static inline uint32_t
+cct_addr_hash(cct_addr_t* addr)
+{
+  uint64_t h = ((uint64_t) addr->ip_norm.lm_id << 48) + addr->ip_norm.lm_ip;
+  return (uint32_t) ((h * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+static void
+child_table_put(cct_child_table_t* t, cct_node_t* child)
+{
+  uint32_t i = cct_addr_hash(&child->addr) & t->mask;
+  while (t->slot[i]) {
+    i = (i + 1) & t->mask;
+  }
+  t->slot[i] = child->self;
+  t->count++;
+}
+
+static void
+child_table_fill(cct_child_table_t* t, cct_node_t* sibs)
+{
+  if (!sibs) return;
+  child_table_put(t, sibs);
+  child_table_fill(t, cct_node_at(sibs->left));
+  child_table_fill(t, cct_node_at(sibs->right));
+}
+
+static size_t
+sibling_count(cct_node_t* sibs)
+{
+  if (!sibs) return 0;
+  return 1 + sibling_count(cct_node_at(sibs->left))
+    + sibling_count(cct_node_at(sibs->right));
+}
+
+//
+// (re)index the current children of node, creating or growing
+// its table as needed
+//
+static void
+child_table_rebuild(cct_node_t* node)
+{
+  size_t n = sibling_count(cct_node_at(node->children));
+  cct_child_table_t* t = node->table ? cct_tables[node->table] : NULL;
+
+  if (t == NULL) {
+    if (n < CCT_CHILD_TABLE_MIN) {
+      node->nkids = n;
+      return;
+    }
+    if (node->nkids == CCT_NO_TABLE
+	|| atomic_load_explicit(&cct_num_tables, memory_order_relaxed) >= CCT_MAX_TABLES) {
+      node->nkids = CCT_NO_TABLE;
+      return;
+    }
+    uint32_t handle = atomic_fetch_add_explicit(&cct_num_tables, 1,
+						memory_order_relaxed);
+    if (handle >= CCT_MAX_TABLES) {
+      node->nkids = CCT_NO_TABLE;
+      return;
+    }
+    node->table = handle;
+  }
+
+  // keep the load factor between 1/4 and 1/2
+  if (t == NULL || 2 * (n + 1) > t->mask + 1) {
+    size_t size = 4 * CCT_CHILD_TABLE_MIN;
+    while (size < 4 * n) size *= 2;
+    t = hpcrun_malloc(sizeof(cct_child_table_t) + size * sizeof(cct_index_t));
+    if (t == NULL) {
+      node->table = 0;
+      node->nkids = CCT_NO_TABLE;
+      return;
+    }
+    t->mask = size - 1;
+    cct_tables[node->table] = t;
+  }
+  memset(t->slot, 0, (t->mask + 1) * sizeof(cct_index_t));
+  t->count = 0;
+  child_table_fill(t, cct_node_at(node->children));
+}
+
+//
+// note that child, already linked into node's sibling set, is new
+//
+static void
+child_table_add(cct_node_t* node, cct_node_t* child)
+{
+  if (node->table) {
+    cct_child_table_t* t = cct_tables[node->table];
+    if (2 * (t->count + 1) <= t->mask + 1) {
+      child_table_put(t, child);
+    }
+    else {
+      child_table_rebuild(node);
+    }
+  }
+  else if (node->nkids != CCT_NO_TABLE
+	   && ++node->nkids >= CCT_CHILD_TABLE_MIN) {
+    child_table_rebuild(node);
+  }
+}
+
+static cct_node_t*
+child_table_find(cct_node_t* node, cct_addr_t* addr)
+{
+  cct_child_table_t* t = cct_tables[node->table];
+  uint32_t i = cct_addr_hash(addr) & t->mask;
+  cct_index_t c;
+  while ((c = t->slot[i])) {
+    cct_node_t* child = cct_node_at(c);
+    if (cct_addr_eq(addr, &(child->addr))) {
+      return child;
+    }
+    i = (i + 1) & t->mask;
+  }
+  return NULL;
+}
+
 #if 0
 //
 // cache of info from most recent splay
@@ -155,31 +415,36 @@ new_persistent_id()
 static cct_node_t*
 cct_node_create(cct_addr_t* addr, cct_node_t* parent)
 {
-  size_t sz = sizeof(cct_node_t);
-  cct_node_t *node;
-
-  // FIXME: when multiple epochs really work, this will always be freeable.
-  // WARN ME (krentel) if/when we really use freeable memory.
-  if (ENABLED(FREEABLE)) {
-    node = hpcrun_malloc_freeable(sz);
-  }
-  else {
-//    node = hpcrun_malloc(sz);
-    node = hpcrun_cct_node_alloc();
+  // nodes always come from the arena: they are named by arena index,
+  // so hpcrun_malloc_freeable is not an option here.
+  cct_node_t *node = hpcrun_cct_node_alloc();
+
+  // a recycled node keeps its arena index and its table handle
+  cct_index_t self = node->self;
+  uint32_t table = node->table;
+
+  memset(node, 0, sizeof(cct_node_t));
+
+  node->self = self;
+  node->table = table;
+  if (table) {
+    cct_child_table_t* t = cct_tables[table];
+    memset(t->slot, 0, (t->mask + 1) * sizeof(cct_index_t));
+    t->count = 0;
   }
 
-  memset(node, 0, sz);
-
   node->addr.as_info = addr->as_info; // LUSH
   node->addr.ip_norm = addr->ip_norm;
   node->addr.lip = addr->lip;         // LUSH
 
   node->persistent_id = new_persistent_id();
 
-  node->parent = parent;
-  node->children = NULL;
-  node->left = NULL;
-  node->right = NULL;
+  node->parent = cct_node_index(parent);
+  node->children = 0;
+  node->left = 0;
+  node->right = 0;
+  node->nkids = 0;
+  node->metrics = NULL;
 
   node->is_leaf = false;
 
@@ -199,19 +464,55 @@ cct_node_create(cct_addr_t* addr, cct_node_t* parent)
 //     type of key in splay tree   = cct_addr_t
 //
 
-#define l_lt(a, b) cct_addr_lt(a, &(b))
-#define l_gt(a, b) cct_addr_gt(a, &(b))
-
+// NOTE: this is GENERAL_SPLAY_TREE from splay-macros.h, spelled out
+//       because the left and right links are arena indices
+//
 static cct_node_t*
 splay(cct_node_t* cct, cct_addr_t* addr)
 {
-  GENERAL_SPLAY_TREE(cct_node_t, cct, addr, addr, addr, left, right, l_lt, l_gt);
+  cct_node_t dummy_node;
+  cct_node_t *ltree_max, *rtree_min, *yy;
+
+  if (cct == NULL) return NULL;
+
+  ltree_max = rtree_min = &dummy_node;
+  for (;;) {
+    if (cct_addr_lt(addr, &(cct->addr))) {
+      if ((yy = cct_node_at(cct->left)) == NULL)
+	break;
+      if (cct_addr_lt(addr, &(yy->addr))) {
+	cct->left = yy->right;
+	yy->right = cct->self;
+	cct = yy;
+	if ((yy = cct_node_at(cct->left)) == NULL)
+	  break;
+      }
+      rtree_min->left = cct->self;
+      rtree_min = cct;
+    } else if (cct_addr_gt(addr, &(cct->addr))) {
+      if ((yy = cct_node_at(cct->right)) == NULL)
+	break;
+      if (cct_addr_gt(addr, &(yy->addr))) {
+	cct->right = yy->left;
+	yy->left = cct->self;
+	cct = yy;
+	if ((yy = cct_node_at(cct->right)) == NULL)
+	  break;
+      }
+      ltree_max->right = cct->self;
+      ltree_max = cct;
+    } else
+      break;
+    cct = yy;
+  }
+  ltree_max->right = cct->left;
+  rtree_min->left = cct->right;
+  cct->left = dummy_node.right;
+  cct->right = dummy_node.left;
+
   return cct;
 }
 
-#undef l_lt
-#undef l_gt
-
 //
 // helper for walking functions
 // 
@@ -226,8 +527,8 @@ walk_child_lrs(cct_node_t* cct,
 {
   if (!cct) return;
 
-  walk_child_lrs(cct->left, op, arg, level, wf);
-  walk_child_lrs(cct->right, op, arg, level, wf);
+  walk_child_lrs(cct_node_at(cct->left), op, arg, level, wf);
+  walk_child_lrs(cct_node_at(cct->right), op, arg, level, wf);
   wf(cct, op, arg, level);
 }
 
@@ -235,8 +536,8 @@ static void
 walkset_l(cct_node_t* cct, cct_op_t fn, cct_op_arg_t arg, size_t level)
 {
   if (! cct) return;
-  walkset_l(cct->left, fn, arg, level);
-  walkset_l(cct->right, fn, arg, level);
+  walkset_l(cct_node_at(cct->left), fn, arg, level);
+  walkset_l(cct_node_at(cct->right), fn, arg, level);
   fn(cct, arg, level);
 }
 
@@ -266,7 +567,7 @@ static void
 walk_path_l(cct_node_t* node, cct_op_t op, cct_op_arg_t arg, size_t level)
 {
   if (! node) return;
-  walk_path_l(node->parent, op, arg, level+1);
+  walk_path_l(cct_node_at(node->parent), op, arg, level+1);
   op(node, arg, level);
 }
 
@@ -426,22 +727,22 @@ hpcrun_cct_top_new(uint16_t lmid, uintptr_t lmip)
 cct_node_t*
 hpcrun_cct_parent(cct_node_t* x)
 {
-  return x? x->parent : NULL;
+  return x? cct_node_at(x->parent) : NULL;
 }
 
 cct_node_t*
 hpcrun_cct_children(cct_node_t* x)
 {
-    return x? x->children : NULL;
+    return x? cct_node_at(x->children) : NULL;
 }
 
 cct_node_t*
 hpcrun_leftmost_child(cct_node_t* x)
 {
-  cct_node_t *leftmost = x->children;
+  cct_node_t *leftmost = cct_node_at(x->children);
   if (leftmost != NULL) {
     for (;;) {
-      cct_node_t *more_left = leftmost->left;
+      cct_node_t *more_left = cct_node_at(leftmost->left);
       if (more_left == NULL) break;
       leftmost = more_left;
     }
@@ -467,6 +768,18 @@ hpcrun_cct_is_leaf(cct_node_t* node)
   return node ? (node->is_leaf) || (!(node->children)) : false;
 }
 
+metric_data_list_t*
+hpcrun_cct_metrics(cct_node_t* node)
+{
+  return node ? node->metrics : NULL;
+}
+
+void
+hpcrun_cct_set_metrics(cct_node_t* node, metric_data_list_t* metrics)
+{
+  node->metrics = metrics;
+}
+
 //
 // NOTE: having no children is not exactly the same as being a leaf
 //       A leaf represents a full path. There might be full paths
@@ -525,7 +838,16 @@ hpcrun_cct_insert_addr(cct_node_t* node, cct_addr_t* frm)
   if ( ! node)
     return NULL;
 
-  cct_node_t* found    = splay(node->children, frm);
+  cct_node_t* found;
+  if (node->table) {
+    // a wide node: a hit needs no splay, and a miss just falls through
+    found = child_table_find(node, frm);
+    if (found) {
+      return found;
+    }
+  }
+
+  found = splay(cct_node_at(node->children), frm);
     //
     // !! SPECIAL CASE for cct splay !!
     // !! The splay tree (represented by the root) is the data structure for the set
@@ -534,7 +856,7 @@ hpcrun_cct_insert_addr(cct_node_t* node, cct_addr_t* frm)
     // !! NOT the old (pre-splay) root node
     //
 
-  node->children = found;
+  node->children = cct_node_index(found);
  
   if (found && cct_addr_eq(frm, &(found->addr))){
     return found;
@@ -542,20 +864,20 @@ hpcrun_cct_insert_addr(cct_node_t* node, cct_addr_t* frm)
   //  cct_node_t* new = cct_node_create(frm->as_info, frm->ip_norm, frm->lip, node);
   cct_node_t* new = cct_node_create(frm, node);
 
-  node->children = new;
-  if (! found){
-    return new;
-  }
-  if (cct_addr_lt(frm, &(found->addr))){
-    new->left = found->left;
-    new->right = found;
-    found->left = NULL;
-  }
-  else { // addr > addr of found
-    new->left = found;
-    new->right = found->right;
-    found->right = NULL;
+  node->children = new->self;
+  if (found) {
+    if (cct_addr_lt(frm, &(found->addr))){
+      new->left = found->left;
+      new->right = found->self;
+      found->left = 0;
+    }
+    else { // addr > addr of found
+      new->left = found->self;
+      new->right = found->right;
+      found->right = 0;
+    }
   }
+  child_table_add(node, new);
   return new;
 }
 
@@ -573,20 +895,22 @@ hpcrun_cct_delete_addr(cct_node_t* node, cct_addr_t* frm)
 {
   if(!node) return NULL;
 
-  cct_node_t* found = splay(node->children, frm);
+  cct_node_t* found = splay(cct_node_at(node->children), frm);
 
-  node->children = found;
+  node->children = cct_node_index(found);
 
   if(!found || !cct_addr_eq(frm, &(found->addr))) 
     return NULL;
 
-  if(node->children->left == NULL) {
-    node->children = node->children->right;
-    return found;
+  if(found->left == 0) {
+    node->children = found->right;
   }
-  node->children->left = splay(node->children->left, frm);
-  node->children->left->right = node->children->right;
-  node->children = node->children->left;
+  else {
+    cct_node_t* left = splay(cct_node_at(found->left), frm);
+    left->right = found->right;
+    node->children = left->self;
+  }
+  child_table_rebuild(node);
   return found;
 }
 
@@ -595,7 +919,7 @@ cct_node_t*
 hpcrun_cct_insert_path_return_leaf(cct_node_t *root, cct_node_t *path)
 {
   if(!path || ! path->parent) return root;
-  root = hpcrun_cct_insert_path_return_leaf(root, path->parent);
+  root = hpcrun_cct_insert_path_return_leaf(root, cct_node_at(path->parent));
   return hpcrun_cct_insert_addr(root, &(path->addr));
 }
 
@@ -607,13 +931,13 @@ hpcrun_cct_insert_path_return_leaf(cct_node_t *root, cct_node_t *path)
 void
 hpcrun_cct_delete_self(cct_node_t *cct)
 {
-  hpcrun_cct_delete_addr(cct->parent, &cct->addr);
+  hpcrun_cct_delete_addr(cct_node_at(cct->parent), &cct->addr);
   // FIXME vi3: I think below should be added, because of freelist
   // cause previous function remove node from parent tree,
   // but do not remove parent, left and right
-  cct->left = NULL;
-  cct->right = NULL;
-  cct->parent = NULL;
+  cct->left = 0;
+  cct->right = 0;
+  cct->parent = 0;
   hpcrun_cct_node_free(cct);
 }
 
@@ -639,26 +963,25 @@ hpcrun_cct_terminate_path(cct_node_t* node)
 cct_node_t*
 hpcrun_cct_insert_node(cct_node_t* target, cct_node_t* src)
 {
-  src->parent = target;
+  src->parent = target->self;
 
-  cct_node_t* found = splay(target->children, &(src->addr));
-  target->children = src;
-  if (! found) {
-    return src;
-  }
-  
-  // NOTE: Assume equality cannot happen
+  cct_node_t* found = splay(cct_node_at(target->children), &(src->addr));
+  target->children = src->self;
+  if (found) {
+    // NOTE: Assume equality cannot happen
 
-  if (cct_addr_lt(&(src->addr), &(found->addr))){
-    src->left = found->left;
-    src->right = found;
-    found->left = NULL;
-  }
-  else { // addr > addr of found
-    src->left = found;
-    src->right = found->right;
-    found->right = NULL;
+    if (cct_addr_lt(&(src->addr), &(found->addr))){
+      src->left = found->left;
+      src->right = found->self;
+      found->left = 0;
+    }
+    else { // addr > addr of found
+      src->left = found->self;
+      src->right = found->right;
+      found->right = 0;
+    }
   }
+  child_table_add(target, src);
   return src;
 }
 
@@ -702,7 +1025,7 @@ void
 hpcrun_cct_walk_child_1st_w_level(cct_node_t* cct, cct_op_t op, cct_op_arg_t arg, size_t level)
 {
   if (!cct) return;
-  walk_child_lrs(cct->children, op, arg, level+1,
+  walk_child_lrs(cct_node_at(cct->children), op, arg, level+1,
 		 hpcrun_cct_walk_child_1st_w_level);
   op(cct, arg, level);
 }
@@ -715,7 +1038,7 @@ hpcrun_cct_walk_node_1st_w_level(cct_node_t* cct, cct_op_t op, cct_op_arg_t arg,
 {
   if (!cct) return;
   op(cct, arg, level);
-  walk_child_lrs(cct->children, op, arg, level+1,
+  walk_child_lrs(cct_node_at(cct->children), op, arg, level+1,
 		 hpcrun_cct_walk_node_1st_w_level);
 }
 
@@ -726,7 +1049,7 @@ void
 hpcrun_cct_walkset(cct_node_t* cct, cct_op_t fn, cct_op_arg_t arg)
 {
   if(!cct->children) return;
-  walkset_l(cct->children, fn, arg, 0);
+  walkset_l(cct_node_at(cct->children), fn, arg, 0);
 }
 
 //
@@ -838,7 +1161,11 @@ hpcrun_cct_find_addr(cct_node_t* cct, cct_addr_t* addr)
   if ( ! cct)
     return NULL;
 
-  cct_node_t* found    = splay(cct->children, addr);
+  if (cct->table) {
+    return child_table_find(cct, addr);
+  }
+
+  cct_node_t* found    = splay(cct_node_at(cct->children), addr);
     //
     // !! SPECIAL CASE for cct splay !!
     // !! The splay tree (represented by the root) is the data structure for the set
@@ -847,7 +1174,7 @@ hpcrun_cct_find_addr(cct_node_t* cct, cct_addr_t* addr)
     // !! NOT the old (pre-splay) root node
     //
 
-  cct->children = found;
+  cct->children = cct_node_index(found);
  
   if (found && cct_addr_eq(addr, &(found->addr))){
     return found;
@@ -872,11 +1199,11 @@ walkset_l_merge(cct_node_t* cct, cct_op_merge_t fn, cct_op_arg_t arg, size_t lev
   // if node is NULL, the return NULL
   if (! cct) return NULL;
   // if left should be disconnected
-  if (! walkset_l_merge(cct->left, fn, arg, level))
-    cct->left = NULL;
+  if (! walkset_l_merge(cct_node_at(cct->left), fn, arg, level))
+    cct->left = 0;
   // if right should be disconnected
-  if(! walkset_l_merge(cct->right, fn, arg, level))
-    cct->right = NULL;
+  if(! walkset_l_merge(cct_node_at(cct->right), fn, arg, level))
+    cct->right = 0;
   // fn is going to decide if cct should be disconnected from parent or not
   return fn(cct, arg, level);
 }
@@ -886,8 +1213,9 @@ hpcrun_cct_walkset_merge(cct_node_t* cct, cct_op_merge_t fn, cct_op_arg_t arg)
 {
   if(! cct->children) return;
   // should children be disconnected
-  if(! walkset_l_merge(cct->children, fn, arg, 0))
-    cct->children = NULL;
+  if(! walkset_l_merge(cct_node_at(cct->children), fn, arg, 0))
+    cct->children = 0;
+  child_table_rebuild(cct);
 }
 
 
@@ -913,7 +1241,7 @@ static void
 attach_to_a(cct_node_t* node, cct_op_arg_t arg, size_t l)
 {
   cct_node_t* targ = (cct_node_t*) arg;
-  node->parent = targ;
+  node->parent = targ->self;
 }
 
 //
@@ -936,7 +1264,9 @@ hpcrun_cct_merge(cct_node_t* cct_a, cct_node_t* cct_b,
     // whole cct->children splay tree is used as kids of cct_a,
     // enough to disconnect children from cct_b (that's why hpcrun_cct_walkset is called)
     hpcrun_cct_walkset(cct_b, attach_to_a, (cct_op_arg_t) cct_a);
-    cct_b->children = NULL;
+    cct_b->children = 0;
+    child_table_rebuild(cct_a);
+    child_table_rebuild(cct_b);
   }
   else {
     mjarg_t local = (mjarg_t) {.targ = cct_a, .fn = merge, .arg = arg};
@@ -969,9 +1299,9 @@ merge_or_join(cct_node_t* n, cct_op_arg_t a, size_t l)
     // and the return value is NULL (indicates that n is goint to be disconnected from previous cct_b tree)
 
     // add left to freelist, if needed
-    hpcrun_cct_node_free(n->left);
+    hpcrun_cct_node_free(cct_node_at(n->left));
     // add right to freelist, if needed
-    hpcrun_cct_node_free(n->right);
+    hpcrun_cct_node_free(cct_node_at(n->right));
 
     cct_disjoint_union_cached(targ, n);
     return NULL;
@@ -1003,7 +1333,7 @@ cct_disjoint_union_cached(cct_node_t* target, cct_node_t* src)
   }
     
   cct_addr_t* addr = hpcrun_cct_addr(src);
-  cct_node_t* found    = splay(target->children, addr);  // FIXME: vi3: is it possible that splay returns something which address is not equal to addre
+  cct_node_t* found    = splay(cct_node_at(target->children), addr);  // FIXME: vi3: is it possible that splay returns something which address is not equal to addre
     //
     // !! SPECIAL CASE for cct splay !!
     // !! The splay tree (represented by the root) is the data structure for the set
@@ -1011,31 +1341,29 @@ cct_disjoint_union_cached(cct_node_t* target, cct_node_t* src)
     // !! the parent's children pointer must point to the NEW root node
     // !! NOT the old (pre-splay) root node
     //
-  if (!found) {
-    target->children = src;
-    src->parent = target;
-    return;
-  }
-
-  if (cct_addr_lt(addr, &(found->addr))){
-    src->left = found->left;
-    src->right = found;
-    found->left = NULL;
-  }
-  else { // addr > addr of found
-    src->left = found;
-    src->right = found->right;
-    found->right = NULL;
+  if (found) {
+    if (cct_addr_lt(addr, &(found->addr))){
+      src->left = found->left;
+      src->right = found->self;
+      found->left = 0;
+    }
+    else { // addr > addr of found
+      src->left = found->self;
+      src->right = found->right;
+      found->right = 0;
+    }
   }
-  target->children = src;
-  src->parent = target;
+  target->children = src->self;
+  src->parent = target->self;
+  child_table_add(target, src);
 }
 
 
 // FIXME: only temporary function, until hpcrun_merge is repaired
 void
 cct_remove_my_subtree(cct_node_t* cct){
-  cct->children = NULL;
+  cct->children = 0;
+  child_table_rebuild(cct);
 //  printf("CHILDREN: %p\tLEFT: %p\tRIGHT: %p\n", cct->children, cct->left, cct->right);
 }
 
@@ -1043,7 +1371,7 @@ cct_remove_my_subtree(cct_node_t* cct){
 // FIXME: is this proper place for handling memory leaks caused by cct_node_t
 // frelist manipulation
 
-__thread cct_node_t* cct_node_freelist_head = NULL;
+static __thread cct_index_t cct_node_freelist_head = 0;
 
 // vi3: functions used for manipulation of freelist of trees
 void
@@ -1051,23 +1379,23 @@ add_node_to_freelist(cct_node_t* cct){
   // parent is used as a next pointer
   if(cct){
     cct->parent = cct_node_freelist_head;
-    cct_node_freelist_head = cct;
+    cct_node_freelist_head = cct->self;
   }
 }
 
 // vi3: remove root of first tree in the freelist
 cct_node_t*
 remove_node_from_freelist(){
-  cct_node_t* first_root = cct_node_freelist_head;
+  cct_node_t* first_root = cct_node_at(cct_node_freelist_head);
   if(!first_root){
     return NULL;
   }
   // new head is free_root's next (parent pointer is used for now)
   cct_node_freelist_head = first_root->parent;
 
-  cct_node_t* children = first_root->children;
-  cct_node_t* left = first_root->left;
-  cct_node_t* right = first_root->right;
+  cct_node_t* children = cct_node_at(first_root->children);
+  cct_node_t* left = cct_node_at(first_root->left);
+  cct_node_t* right = cct_node_at(first_root->right);
 
   add_node_to_freelist(children);
   add_node_to_freelist(left);
@@ -1083,7 +1411,7 @@ remove_node_from_freelist(){
 cct_node_t*
 hpcrun_cct_node_alloc(){
   cct_node_t* cct_new = remove_node_from_freelist();
-  return cct_new ? cct_new : (cct_node_t*)hpcrun_malloc(sizeof(cct_node_t));
+  return cct_new ? cct_new : cct_arena_alloc();
 }
 
 
@@ -1108,7 +1436,8 @@ hpcrun_cct_set_children(cct_node_t* cct, cct_node_t* children)
 {
   if(!cct)
     return;
-  cct->children = children;
+  cct->children = cct_node_index(children);
+  child_table_rebuild(cct);
 }
 
 void
@@ -1116,6 +1445,209 @@ hpcrun_cct_set_parent(cct_node_t* cct, cct_node_t* parent)
 {
   if(!cct)
     return;
-  cct->parent = parent;
+  cct->parent = cct_node_index(parent);
+}
+
+
+
+//
+// ******** unit test: memory and throughput on synthetic backtraces
+//
+// Inserts synthetic call paths top-down, as hpcrun_cct_insert_backtrace
+// does, into one tree.  Paths descend a random call graph; one frame
+// near the root dispatches to thousands of callees, to exercise the
+// child table.  Reports nodes, bytes per node (everything taken from
+// hpcrun_malloc), and frames inserted per second, then checks that
+// replaying the paths creates nothing new and that the walkers and
+// hpcrun_cct_fwrite see every node.  Finally runs many short threads
+// that each build a small tree, and checks that releasing their slabs
+// keeps the arena from growing a slab per thread.
+//
+// build with UNIT_TEST 1, linking -pthread
+//
+
+#define UNIT_TEST 0
+
+#if UNIT_TEST
+
+#include <time.h>
+#include <pthread.h>
+
+#define BENCH_FUNCS      4096
+#define BENCH_CALLEES    6
+#define BENCH_DISPATCH   4000
+
+static atomic_size_t bench_bytes = ATOMIC_VAR_INIT(0);
+static size_t bench_written = 0;
+
+void*
+hpcrun_malloc(size_t size)
+{
+  atomic_fetch_add(&bench_bytes, size);
+  return malloc(size);
+}
+
+int debug_flag_get(dbg_category flag) { return 0; }
+void hpcrun_pmsg(const char* tag, const char *fmt, ...) { }
+void hpcrun_emsg(const char *fmt, ...) { }
+void messages_donothing(void) { }
+void hpcrun_abort_w_info(void (*info)(void), const char *fmt, ...) { abort(); }
+lush_lip_t lush_lip_NULL;
+
+ip_normalized_t
+hpcrun_normalize_ip(void* unnormalized_ip, load_module_t* lm)
+{
+  return (ip_normalized_t) { .lm_id = 1, .lm_ip = (uintptr_t) unnormalized_ip };
+}
+
+size_t hpcio_be8_fwrite(uint64_t* val, FILE* fs) { return 8; }
+int hpcrun_get_num_kind_metrics(void) { return 0; }
+void hpcrun_metric_set_dense_copy(cct_metric_data_t* dest,
+				  metric_data_list_t* list, int num_metrics) { }
+
+metric_data_list_t*
+hpcrun_get_metric_data_list_specific(cct2metrics_t **map, cct_node_id_t cct_id)
+{
+  return NULL;
+}
+
+int
+hpcrun_fmt_cct_node_fwrite(hpcrun_fmt_cct_node_t* x, epoch_flags_t flags,
+			   FILE* fs)
+{
+  bench_written++;
+  return HPCFMT_OK;
 }
 
+static uint64_t
+bench_rand(uint64_t* seed)
+{
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 7;
+  *seed ^= *seed << 17;
+  return *seed;
+}
+
+//
+// the return address of call site k in function f
+//
+static uintptr_t
+bench_site(uint64_t f, uint64_t k)
+{
+  return 0x400000 + f * 0x1000 + k * 0x10;
+}
+
+static int
+bench_path(uint64_t* seed, int max_depth, cct_addr_t* path)
+{
+  int depth = max_depth / 4 + bench_rand(seed) % (3 * max_depth / 4);
+  uint64_t f = 0;
+  for (int d = 0; d < depth; d++) {
+    uint64_t k;
+    if (d == 2) {
+      k = bench_rand(seed) % BENCH_DISPATCH;
+      f = (f + k) % BENCH_FUNCS;
+    }
+    else {
+      // skewed choice among a few callees
+      k = __builtin_ctzll(bench_rand(seed) | (1ULL << (BENCH_CALLEES - 1)));
+      f = (f * 31 + k * 7 + 1) % BENCH_FUNCS;
+    }
+    path[d] = (cct_addr_t) NON_LUSH_ADDR_INI(1, bench_site(f, k));
+  }
+  return depth;
+}
+
+static size_t
+bench_insert(cct_node_t* root, long npaths, int max_depth, uint64_t seed)
+{
+  cct_addr_t path[max_depth];
+  size_t frames = 0;
+  for (long i = 0; i < npaths; i++) {
+    int depth = bench_path(&seed, max_depth, path);
+    cct_node_t* node = root;
+    for (int d = 0; d < depth; d++) {
+      node = hpcrun_cct_insert_addr(node, &path[d]);
+    }
+    hpcrun_cct_terminate_path(node);
+    frames += depth;
+  }
+  return frames;
+}
+
+static double
+bench_elapsed(struct timespec* beg)
+{
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - beg->tv_sec) + 1e-9 * (end.tv_nsec - beg->tv_nsec);
+}
+
+static void*
+bench_churn_thread(void* arg)
+{
+  cct_node_t* root = hpcrun_cct_new();
+  bench_insert(root, 20, 16, (uintptr_t) arg);
+  hpcrun_cct_release_slab();
+  return NULL;
+}
+
+//
+// run nthreads short threads, a few at a time, and return the number
+// of slabs they took
+//
+static uint32_t
+bench_churn(int nthreads)
+{
+  uint32_t before = atomic_load(&cct_num_slabs);
+  for (int i = 0; i < nthreads; i += 4) {
+    pthread_t t[4];
+    for (int j = 0; j < 4; j++) {
+      pthread_create(&t[j], NULL, bench_churn_thread, (void*) (uintptr_t) (i + j + 1));
+    }
+    for (int j = 0; j < 4; j++) {
+      pthread_join(t[j], NULL);
+    }
+  }
+  return atomic_load(&cct_num_slabs) - before;
+}
+
+int
+main(int argc, char **argv)
+{
+  long npaths = (argc > 1) ? atol(argv[1]) : 200000;
+  int max_depth = (argc > 2) ? atoi(argv[2]) : 64;
+  struct timespec beg;
+
+  cct_node_t* root = hpcrun_cct_new();
+
+  clock_gettime(CLOCK_MONOTONIC, &beg);
+  size_t frames = bench_insert(root, npaths, max_depth, 42);
+  double secs = bench_elapsed(&beg);
+
+  size_t nodes = hpcrun_cct_num_nodes(root, true);
+  size_t bytes = atomic_load(&bench_bytes);
+  printf("%ld paths, %zu frames: %zu nodes, %zu bytes (%.1f per node)\n",
+	 npaths, frames, nodes, bytes, (double) bytes / nodes);
+  printf("insert: %.1f Mframes/s\n", frames / secs / 1e6);
+
+  clock_gettime(CLOCK_MONOTONIC, &beg);
+  frames = bench_insert(root, npaths, max_depth, 42);
+  secs = bench_elapsed(&beg);
+  printf("replay: %.1f Mframes/s\n", frames / secs / 1e6);
+
+  int ok = (hpcrun_cct_num_nodes(root, true) == nodes);
+  epoch_flags_t flags = { .bits = 0 };
+  hpcrun_cct_fwrite(NULL, root, stdout, flags);
+  ok = ok && (bench_written == nodes);
+
+  int nthreads = 20000;
+  uint32_t slabs = bench_churn(nthreads);
+  printf("churn: %d threads took %u slabs\n", nthreads, slabs);
+  ok = ok && (slabs < nthreads / 10);
+
+  printf("%s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
+
+#endif
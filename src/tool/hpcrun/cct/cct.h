@@ -140,6 +140,9 @@ extern cct_node_t* hpcrun_leftmost_child(cct_node_t* node);
 extern int32_t hpcrun_cct_persistent_id(cct_node_t* node);
 extern cct_addr_t* hpcrun_cct_addr(cct_node_t* node);
 extern bool hpcrun_cct_is_leaf(cct_node_t* node);
+// metrics of the node, or NULL if none (see cct2metrics.h)
+extern metric_data_list_t* hpcrun_cct_metrics(cct_node_t* node);
+extern void hpcrun_cct_set_metrics(cct_node_t* node, metric_data_list_t* metrics);
 extern cct_node_t* hpcrun_cct_insert_path_return_leaf(cct_node_t *root, cct_node_t *path);
 extern void hpcrun_cct_delete_self(cct_node_t *node);
 //
@@ -298,10 +301,11 @@ extern void hpcrun_cct_merge(cct_node_t* cct_a, cct_node_t* cct_b,
 
 
 // FIXME: This should not be here vi3: allocation and free cct_node_t
-extern __thread cct_node_t* cct_node_freelist_head;
 
 cct_node_t* hpcrun_cct_node_alloc();
 void hpcrun_cct_node_free(cct_node_t *cct);
+// give the unused part of this thread's node slab back for other threads
+void hpcrun_cct_release_slab(void);
 // remove Children from cct
 void cct_remove_my_subtree(cct_node_t* cct);
 
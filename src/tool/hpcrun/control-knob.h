@@ -16,7 +16,8 @@
   macro(HPCRUN_SANITIZER_DATA_FLOW_HASH)  \
   macro(HPCRUN_SANITIZER_GPU_ANALYSIS_BLOCKS)  \
   macro(HPCRUN_CUDA_DEVICE_BUFFER_SIZE)  \
-  macro(HPCRUN_CUDA_DEVICE_SEMAPHORE_SIZE)
+  macro(HPCRUN_CUDA_DEVICE_SEMAPHORE_SIZE)  \
+  macro(HPCRUN_GPU_TRACE_WORKERS)
 
 typedef enum {
 #define DEFINE_ENUM_KNOBS(knob_name)  \
@@ -37,6 +37,8 @@ typedef struct core_profile_trace_data_t {
   FILE* hpcrun_file;
   void* trace_buffer;
   hpcio_outbuf_t *trace_outbuf;
+  struct hpcio_pack_member_s *trace_member; // with HPCRUN_PACK, else NULL
+  struct hpctrace_fmt_block_t *trace_block; // records not yet in trace_outbuf
 
   // ----------------------------------------
   // Perf support
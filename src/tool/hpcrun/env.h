@@ -84,9 +84,15 @@ extern const char* HPCRUN_OPT_LUSH_AGENTS;
 extern const char* HPCRUN_OUT_PATH;
 
 extern const char* HPCRUN_TRACE;
+extern const char* HPCRUN_TRACE_CLOCK;
+extern const char* HPCRUN_TRACE_ASYNC;
+
+extern const char* HPCRUN_PACK;
 
 extern const char* HPCRUN_EVENT_LIST;
 extern const char* HPCRUN_MEMSIZE;
 extern const char* HPCRUN_LOW_MEMSIZE;
 
+extern const char* HPCRUN_UNWIND_PRECOMPUTE;
+
 #endif /* hpcrun_env_h */
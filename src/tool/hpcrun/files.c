@@ -128,6 +128,10 @@
 #include "loadmap.h"
 #include "sample_prob.h"
 
+#include <memory/hpcrun-malloc.h>
+
+#include <lib/prof-lean/hpcfmt.h>
+#include <lib/prof-lean/hpcio-pack.h>
 #include <lib/prof-lean/spinlock.h>
 #include <lib/prof-lean/vdso.h>
 #include <lib/prof-lean/crypto-hash.h> // Calculate a hash for vdso
@@ -139,7 +143,8 @@
 //***************************************************************
 
 // directory/progname-rank-thread-hostid-pid-gen.suffix
-#define FILENAME_TEMPLATE  "%s/%s-%06u-%03d-" HOSTID_FORMAT "-%u-%d.%s"
+#define MEMBER_TEMPLATE    "%s-%06u-%03d-" HOSTID_FORMAT "-%u-%d.%s"
+#define FILENAME_TEMPLATE  "%s/" MEMBER_TEMPLATE
 
 #define FILES_RANDOM_GEN  4
 #define FILES_MAX_GEN     11
@@ -183,6 +188,11 @@ static int log_rename_ret = 0;
 
 static int vdso_written = 0; // for coordination across fork
 
+// With HPCRUN_PACK, the profiles and traces of the process go into one
+// pack file.  Its members are named like the files they replace, with
+// the (host, pid, gen) of the pack's early name.
+static hpcio_pack_t *pack = NULL;
+
 char vdso_hash_str[HASH_LENGTH * 2];
 //***************************************************************
 // private operations
@@ -206,6 +216,8 @@ hpcrun_files_init(void)
     log_done = 0;
     log_rename_done = 0;
     log_rename_ret = 0;
+    // the parent's pack is the parent's to close
+    pack = NULL;
   }
 }
 
@@ -499,6 +511,125 @@ hpcrun_rename_log_file_early(int rank)
 }
 
 
+// Open the pack file on first use.  Must hold the files lock.
+//
+// Returns: the pack, else die on failure.
+static hpcio_pack_t *
+hpcrun_files_pack(void)
+{
+  if (pack == NULL) {
+    int fd = hpcrun_open_file(0, 0, HPCIO_PACK_FnmSfx, FILES_EARLY);
+    if (hpcio_pack_open(&pack, fd, hpcrun_malloc) != HPCFMT_OK) {
+      hpcrun_abort("hpctoolkit: unable to write %s file: %s",
+		   HPCIO_PACK_FnmSfx, strerror(errno));
+    }
+  }
+  return pack;
+}
+
+
+// Name of the member that stands for the file (rank, thread, suffix).
+static void
+hpcrun_files_member_name(char *name, int rank, int thread, const char *suffix)
+{
+  snprintf(name, PATH_MAX, MEMBER_TEMPLATE, executable_name, rank, thread,
+	   earlyid.host, mypid, earlyid.gen, suffix);
+}
+
+
+static hpcio_pack_member_t *
+hpcrun_open_member(int rank, int thread, const char *suffix)
+{
+  char name[PATH_MAX];
+  hpcio_pack_member_t *member;
+
+  spinlock_lock(&files_lock);
+  hpcrun_files_init();
+  hpcio_pack_t *p = hpcrun_files_pack();
+  hpcrun_files_member_name(name, rank, thread, suffix);
+  spinlock_unlock(&files_lock);
+
+  member = hpcio_pack_member_open(p, name);
+  if (member == NULL) {
+    hpcrun_abort("hpctoolkit: unable to add %s to %s file: %s",
+		 name, HPCIO_PACK_FnmSfx, strerror(errno));
+  }
+
+  return member;
+}
+
+
+// Returns: true if profiles and traces go into a pack file.
+bool
+hpcrun_files_packed(void)
+{
+  return getenv(HPCRUN_PACK) != NULL && hpcrun_sample_prob_active();
+}
+
+
+// Returns: pack member for a trace, named for MPI rank 0 until renamed.
+hpcio_pack_member_t *
+hpcrun_open_trace_member(int thread)
+{
+  return hpcrun_open_member(0, thread, HPCRUN_TraceFnmSfx);
+}
+
+
+// Returns: pack member for a profile.
+hpcio_pack_member_t *
+hpcrun_open_profile_member(int rank, int thread)
+{
+  return hpcrun_open_member(rank, thread, HPCRUN_ProfileFnmSfx);
+}
+
+
+// The pack counterpart of hpcrun_rename_trace_file().
+//
+// Returns: 0 on success, else -1 on failure.
+int
+hpcrun_rename_trace_member(hpcio_pack_member_t *member, int rank, int thread)
+{
+  char name[PATH_MAX];
+
+  if (rank == 0) {
+    return 0;
+  }
+
+  spinlock_lock(&files_lock);
+  hpcrun_files_member_name(name, rank, thread, HPCRUN_TraceFnmSfx);
+  spinlock_unlock(&files_lock);
+
+  return (hpcio_pack_member_rename(member, name) == HPCFMT_OK) ? 0 : -1;
+}
+
+
+// Write the index of the pack file, if any, close and rename it.  Call
+// after the last profile is written.
+//
+// Returns: 0 on success, else -1 on failure.
+int
+hpcrun_close_pack_file(int rank)
+{
+  int ret = 0;
+
+  spinlock_lock(&files_lock);
+  if (pack != NULL && mypid == getpid()) {
+    if (hpcio_pack_close(&pack) != HPCFMT_OK) {
+      EMSG("hpctoolkit: unable to write index of %s file",
+	   HPCIO_PACK_FnmSfx);
+      ret = -1;
+    }
+    hpcrun_rename_log_file_early(rank);
+    if (hpcrun_rename_file(rank, 0, HPCIO_PACK_FnmSfx) != 0) {
+      ret = -1;
+    }
+  }
+  spinlock_unlock(&files_lock);
+
+  return ret;
+}
+
+
 // Returns: 0 on success, else -1 on failure.
 int
 hpcrun_rename_log_file(int rank)
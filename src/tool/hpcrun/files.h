@@ -47,6 +47,10 @@
 #ifndef files_h
 #define files_h
 
+#include <stdbool.h>
+
+#include <lib/prof-lean/hpcio-pack.h>
+
 
 //*****************************************************************************
 // forward declarations
@@ -66,6 +70,13 @@ int hpcrun_open_profile_file(int rank, int thread);
 int hpcrun_rename_log_file(int rank);
 int hpcrun_rename_trace_file(int rank, int thread);
 
+// pack file (HPCRUN_PACK): one file for all threads of the process
+bool hpcrun_files_packed(void);
+hpcio_pack_member_t *hpcrun_open_trace_member(int thread);
+hpcio_pack_member_t *hpcrun_open_profile_member(int rank, int thread);
+int hpcrun_rename_trace_member(hpcio_pack_member_t *member, int rank, int thread);
+int hpcrun_close_pack_file(int rank);
+
 // storing the hash of the vdso for the current process
 extern char vdso_hash_str[];
 void hpcrun_save_vdso();
@@ -75,6 +75,15 @@
 // 6. The bottom of this file has code for an interactive, stand-alone
 // client for testing hpcfnbounds in server mode.
 //
+// 7. If HPCRUN_FNBOUNDS_CACHE names a directory, answers are cached
+// there, keyed by the file's ELF build-id (or a hash of its contents)
+// and the server command, and are shared by all processes
+// using the directory.  Entries are written to a temporary file and
+// renamed into place, so concurrent writers are safe (last one wins
+// with an identical answer).  The array of addresses starts on a page
+// boundary, so hits are mmapped read-only exactly like an answer from
+// the server (and unmapped the same way) and never reach the server.
+//
 // Todo:
 //
 
@@ -122,7 +131,9 @@ char	*outfile;
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/wait.h>
+#include <elf.h>
 #include <err.h>
+#include <limits.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <sched.h>
@@ -170,6 +181,23 @@ static int fdin = -1;
 static pid_t my_pid;
 static pid_t server_pid = 0;
 
+// Persistent cache (cf. note 7); NULL if disabled
+static char *cache_dir = NULL;
+
+#define CACHE_MAGIC    0x686663616368ULL  // "hfcach"
+#define CACHE_VERSION  2
+#define CACHE_SUFFIX   ".fnb"
+
+struct fnbounds_cache_hdr {
+  uint64_t magic;
+  uint64_t version;
+  uint64_t num_entries;
+  uint64_t reference_offset;
+  uint64_t is_relocatable;
+  uint64_t data_offset;  // page-aligned offset of the addresses
+  uint64_t reserved[2];
+};
+
 #if 0
 // Limit on memory use at which we restart the server in Meg.
 #define SERVER_MEM_LIMIT  140
@@ -350,6 +378,228 @@ mmap_anon(size_t size)
 }
 
 
+//*****************************************************************
+// Persistent Cache
+//*****************************************************************
+
+static uint64_t
+fnv1a_hash(uint64_t hash, const void *buf, size_t len)
+{
+  const unsigned char *p = (const unsigned char *) buf;
+
+  for (size_t i = 0; i < len; i++) {
+    hash ^= p[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+#define FNV1A_INIT  0xcbf29ce484222325ULL
+
+
+// Reads the GNU build-id note of the (64-bit) ELF file 'fd' into
+// 'id' as a hex string.  Returns: length of the build-id in bytes,
+// or 0 if there is none.
+static int
+elf_build_id(int fd, char *id, size_t id_size)
+{
+  Elf64_Ehdr ehdr;
+  if (pread(fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr)
+      || memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0
+      || ehdr.e_ident[EI_CLASS] != ELFCLASS64
+      || ehdr.e_phentsize != sizeof(Elf64_Phdr)) {
+    return 0;
+  }
+
+  for (int i = 0; i < ehdr.e_phnum; i++) {
+    Elf64_Phdr phdr;
+    off_t off = ehdr.e_phoff + i * sizeof(Elf64_Phdr);
+    if (pread(fd, &phdr, sizeof(phdr), off) != sizeof(phdr)) {
+      return 0;
+    }
+    if (phdr.p_type != PT_NOTE) {
+      continue;
+    }
+
+    char notes[1024];
+    size_t len = phdr.p_filesz < sizeof(notes) ? phdr.p_filesz : sizeof(notes);
+    if (pread(fd, notes, len, phdr.p_offset) != (ssize_t) len) {
+      continue;
+    }
+
+    size_t pos = 0;
+    while (pos + sizeof(Elf64_Nhdr) <= len) {
+      Elf64_Nhdr *nhdr = (Elf64_Nhdr *) &notes[pos];
+      size_t name_pos = pos + sizeof(Elf64_Nhdr);
+      size_t desc_pos = name_pos + ((nhdr->n_namesz + 3) & ~3);
+      size_t next_pos = desc_pos + ((nhdr->n_descsz + 3) & ~3);
+      if (next_pos > len) {
+	break;
+      }
+      if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4
+	  && memcmp(&notes[name_pos], "GNU", 4) == 0
+	  && 2 * nhdr->n_descsz + 1 <= id_size) {
+	const unsigned char *desc = (const unsigned char *) &notes[desc_pos];
+	for (size_t j = 0; j < nhdr->n_descsz; j++) {
+	  snprintf(&id[2 * j], 3, "%02x", desc[j]);
+	}
+	return nhdr->n_descsz;
+      }
+      pos = next_pos;
+    }
+  }
+
+  return 0;
+}
+
+
+// Hashes the contents of the regular file 'fd' of 'size' bytes into
+// 'hash'.  Returns: SUCCESS or FAILURE.
+static int
+file_content_hash(int fd, size_t size, uint64_t *hash)
+{
+  if (size == 0) {
+    return FAILURE;
+  }
+
+  void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (addr == MAP_FAILED) {
+    return FAILURE;
+  }
+  *hash = fnv1a_hash(FNV1A_INIT, addr, size);
+  munmap(addr, size);
+
+  return SUCCESS;
+}
+
+
+// Computes the cache file name for 'fname' into 'path'.  The key is
+// the build-id of 'fname', or if it has none, a hash of its contents
+// and its size.  (Device, inode and mtime are not unique across hosts
+// sharing the cache over NFS.)  The key is qualified by a hash of the
+// server command, as different servers may give different answers.
+// Returns: SUCCESS or FAILURE.
+static int
+cache_path(const char *fname, char *path, size_t path_size)
+{
+  char key[2 * 64 + 1];
+  int ret = FAILURE;
+
+  int fd = open(fname, O_RDONLY);
+  if (fd < 0) {
+    return FAILURE;
+  }
+
+  if (elf_build_id(fd, key, sizeof(key)) > 0) {
+    ret = SUCCESS;
+  }
+  else {
+    struct stat st;
+    uint64_t hash;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+	&& file_content_hash(fd, st.st_size, &hash) == SUCCESS) {
+      snprintf(key, sizeof(key), "c%016lx-%lx",
+	       (unsigned long) hash, (unsigned long) st.st_size);
+      ret = SUCCESS;
+    }
+  }
+  close(fd);
+
+  if (ret == SUCCESS) {
+    uint64_t srv = fnv1a_hash(FNV1A_INIT, server, strlen(server));
+    int n = snprintf(path, path_size, "%s/%s-%08lx" CACHE_SUFFIX, cache_dir,
+		     key, (unsigned long) (srv & 0xffffffff));
+    if (n < 0 || (size_t) n >= path_size) {
+      ret = FAILURE;
+    }
+  }
+
+  return ret;
+}
+
+
+// Returns: pointer to the cached array of addresses (mmapped
+// read-only, page-aligned, of length fh->mmap_size) and fills in the
+// file header, or else NULL on a miss.
+static void *
+cache_lookup(const char *path, struct fnbounds_file_header *fh)
+{
+  struct fnbounds_cache_hdr hdr;
+  struct stat st;
+  void *addr = NULL;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  // the data offset must be page-aligned here too (the directory may
+  // be shared with hosts of a smaller page size)
+  if (fstat(fd, &st) == 0
+      && pread(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr)
+      && hdr.magic == CACHE_MAGIC && hdr.version == CACHE_VERSION
+      && hdr.num_entries > 0
+      && hdr.data_offset == page_align(hdr.data_offset)
+      && (uint64_t) st.st_size
+         == hdr.data_offset + hdr.num_entries * sizeof(void *)) {
+    size_t len = hdr.num_entries * sizeof(void *);
+    void *base = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd,
+		      hdr.data_offset);
+    if (base != MAP_FAILED) {
+      addr = base;
+      fh->num_entries = hdr.num_entries;
+      fh->reference_offset = hdr.reference_offset;
+      fh->is_relocatable = hdr.is_relocatable;
+      fh->mmap_size = page_align(len);
+    }
+  }
+  close(fd);
+
+  return addr;
+}
+
+
+// Atomically adds the answer 'addr' for 'fh' to the cache as 'path'.
+static void
+cache_insert(const char *path, void *addr, struct fnbounds_file_header *fh)
+{
+  char tmp_path[PATH_MAX];
+  int n = snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path,
+		   (int) getpid());
+  if (n < 0 || (size_t) n >= sizeof(tmp_path)) {
+    return;
+  }
+
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    TMSG(FNBOUNDS_CLIENT, "cache: unable to create %s", tmp_path);
+    return;
+  }
+
+  struct fnbounds_cache_hdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = CACHE_MAGIC;
+  hdr.version = CACHE_VERSION;
+  hdr.num_entries = fh->num_entries;
+  hdr.reference_offset = fh->reference_offset;
+  hdr.is_relocatable = fh->is_relocatable;
+  hdr.data_offset = page_align(sizeof(hdr));
+
+  int ok = (write_all(fd, &hdr, sizeof(hdr)) == SUCCESS
+	    && lseek(fd, hdr.data_offset, SEEK_SET) == (off_t) hdr.data_offset
+	    && write_all(fd, addr, fh->num_entries * sizeof(void *)) == SUCCESS);
+  close(fd);
+
+  if (!ok || rename(tmp_path, path) != 0) {
+    unlink(tmp_path);
+    TMSG(FNBOUNDS_CLIENT, "cache: unable to write %s", path);
+    return;
+  }
+
+  TMSG(FNBOUNDS_CLIENT, "cache: added %s", path);
+}
+
+
 //*****************************************************************
 // Signal Handler
 //*****************************************************************
@@ -527,6 +777,18 @@ hpcrun_syserv_init(void)
 
   AMSG("fnbounds: %s", server);
 
+  cache_dir = getenv("HPCRUN_FNBOUNDS_CACHE");
+  if (cache_dir != NULL) {
+    if (cache_dir[0] == '\0'
+	|| (mkdir(cache_dir, 0755) != 0 && errno != EEXIST)) {
+      EMSG("FNBOUNDS_CLIENT: unable to use cache directory '%s'", cache_dir);
+      cache_dir = NULL;
+    }
+    else {
+      AMSG("fnbounds cache: %s", cache_dir);
+    }
+  }
+
 #if 0
   // limit on server memory usage in Meg
   char *str = getenv("HPCRUN_SERVER_MEMSIZE");
@@ -603,6 +865,17 @@ hpcrun_syserv_query(const char *fname, struct fnbounds_file_header *fh)
     return NULL;
   }
 
+  char cache_file[PATH_MAX];
+  bool use_cache = (cache_dir != NULL
+		    && cache_path(fname, cache_file, sizeof(cache_file)) == SUCCESS);
+  if (use_cache) {
+    addr = cache_lookup(cache_file, fh);
+    if (addr != NULL) {
+      TMSG(FNBOUNDS_CLIENT, "cache hit: %s -> %s", fname, cache_file);
+      return addr;
+    }
+  }
+
   if (client_status != SYSERV_ACTIVE || my_pid != getpid()) {
     launch_server();
   }
@@ -688,6 +961,10 @@ hpcrun_syserv_query(const char *fname, struct fnbounds_file_header *fh)
   fh->is_relocatable = fnb_info.is_relocatable;
   fh->mmap_size = mmap_size;
 
+  if (use_cache && fh->num_entries > 0) {
+    cache_insert(cache_file, addr, fh);
+  }
+
   if (ENABLED(FNBOUNDS_CLIENT)) {
     gettimeofday(&now, NULL);
   }
@@ -54,10 +54,11 @@
 // local includes
 //*****************************************************************************
 
-#include <lib/prof-lean/splay-uint64.h>
+#include <lib/prof-lean/hashtable-uint64.h>
+
+#include <hpcrun/memory/hpcrun-malloc.h>
 
 #include "gpu-correlation-id-map.h"
-#include "gpu-splay-allocator.h"
 
 
 
@@ -71,25 +72,25 @@
 
 
 #define st_insert				\
-  typed_splay_insert(correlation_id)
+  typed_hashtable_insert(correlation_id)
 
 #define st_lookup				\
-  typed_splay_lookup(correlation_id)
+  typed_hashtable_lookup(correlation_id)
 
 #define st_delete				\
-  typed_splay_delete(correlation_id)
+  typed_hashtable_delete(correlation_id)
 
 #define st_forall				\
-  typed_splay_forall(correlation_id)
+  typed_hashtable_forall(correlation_id)
 
 #define st_count				\
-  typed_splay_count(correlation_id)
+  typed_hashtable_count(correlation_id)
 
 #define st_alloc(free_list)			\
-  typed_splay_alloc(free_list, gpu_correlation_id_map_entry_t)
+  typed_hashtable_alloc(&map, free_list, gpu_correlation_id_map_entry_t)
 
 #define st_free(free_list, node)		\
-  typed_splay_free(free_list, node)
+  typed_hashtable_free(free_list, node)
 
 
 
@@ -97,19 +98,18 @@
 // type declarations
 //*****************************************************************************
 
-#undef typed_splay_node
-#define typed_splay_node(correlation_id) gpu_correlation_id_map_entry_t
+#undef typed_hashtable_node
+#define typed_hashtable_node(correlation_id) gpu_correlation_id_map_entry_t
 
-typedef struct typed_splay_node(correlation_id) {
-  struct typed_splay_node(correlation_id) *left;
-  struct typed_splay_node(correlation_id) *right;
+typedef struct typed_hashtable_node(correlation_id) {
+  struct typed_hashtable_node(correlation_id) *next;
   uint64_t gpu_correlation_id; // key
 
   uint64_t host_correlation_id;
   uint32_t device_id;
   uint64_t start;
   uint64_t end;
-} typed_splay_node(correlation_id); 
+} typed_hashtable_node(correlation_id); 
 
 
 
@@ -119,7 +119,8 @@ typedef struct typed_splay_node(correlation_id) {
 // local data
 //******************************************************************************
 
-static gpu_correlation_id_map_entry_t *map_root = NULL;
+static hashtable_uint64_t map =
+  HASHTABLE_UINT64_INITIALIZER(hpcrun_malloc_safe, NULL);
 
 static gpu_correlation_id_map_entry_t *free_list = NULL;
 
@@ -129,7 +130,7 @@ static gpu_correlation_id_map_entry_t *free_list = NULL;
 // private operations
 //*****************************************************************************
 
-typed_splay_impl(correlation_id)
+typed_hashtable_impl(correlation_id)
 
 
 static gpu_correlation_id_map_entry_t *
@@ -169,7 +170,7 @@ gpu_correlation_id_map_lookup
 )
 {
   uint64_t correlation_id = gpu_correlation_id;
-  gpu_correlation_id_map_entry_t *result = st_lookup(&map_root, correlation_id);
+  gpu_correlation_id_map_entry_t *result = st_lookup(&map, correlation_id);
 
   PRINT("correlation_id map lookup: id=0x%lx (record %p)\n", 
        correlation_id, result);
@@ -185,7 +186,7 @@ gpu_correlation_id_map_insert
  uint64_t host_correlation_id
 )
 {
-  if (st_lookup(&map_root, gpu_correlation_id)) { 
+  if (st_lookup(&map, gpu_correlation_id)) { 
     // fatal error: correlation_id already present; a
     // correlation should be inserted only once.
     assert(0);
@@ -193,7 +194,7 @@ gpu_correlation_id_map_insert
     gpu_correlation_id_map_entry_t *entry = 
       gpu_correlation_id_map_entry_new(gpu_correlation_id, host_correlation_id);
 
-    st_insert(&map_root, entry);
+    st_insert(&map, entry);
 
     PRINT("correlation_id_map insert: correlation_id=0x%lx external_id=%ld (entry=%p)\n", 
 	  gpu_correlation_id, host_correlation_id, entry);
@@ -211,7 +212,7 @@ gpu_correlation_id_map_external_id_replace
 {
   PRINT("correlation_id map replace: id=0x%x\n", gpu_correlation_id);
 
-  gpu_correlation_id_map_entry_t *entry = st_lookup(&map_root, gpu_correlation_id);
+  gpu_correlation_id_map_entry_t *entry = st_lookup(&map, gpu_correlation_id);
   if (entry) {
     entry->host_correlation_id = host_correlation_id;
   }
@@ -224,7 +225,7 @@ gpu_correlation_id_map_delete
  uint32_t gpu_correlation_id
 )
 {
-  gpu_correlation_id_map_entry_t *node = st_delete(&map_root, gpu_correlation_id);
+  gpu_correlation_id_map_entry_t *node = st_delete(&map, gpu_correlation_id);
   st_free(&free_list, node);
 }
 
@@ -241,7 +242,7 @@ gpu_correlation_id_map_kernel_update
   uint64_t correlation_id = gpu_correlation_id;
   PRINT("correlation_id map replace: id=0x%lx\n", correlation_id);
 
-  gpu_correlation_id_map_entry_t *entry = st_lookup(&map_root, correlation_id);
+  gpu_correlation_id_map_entry_t *entry = st_lookup(&map, correlation_id);
   if (entry) {
     entry->device_id = device_id;
     entry->start = start;
@@ -301,5 +302,5 @@ gpu_correlation_id_map_count
  void
 )
 {
-  return st_count(map_root);
+  return st_count(&map);
 }
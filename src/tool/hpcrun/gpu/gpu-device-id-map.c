@@ -53,13 +53,12 @@
 // local includes
 //******************************************************************************
 
-#include <lib/prof-lean/splay-uint64.h>
+#include <lib/prof-lean/hashtable-uint64.h>
 
 #include <hpcrun/messages/messages.h>
 #include <hpcrun/memory/hpcrun-malloc.h>
 
 #include "gpu-device-id-map.h"
-#include "gpu-splay-allocator.h"
 
 
 //******************************************************************************
@@ -71,36 +70,35 @@
 #include "gpu-print.h"
 
 #define st_insert				\
-  typed_splay_insert(device_id)
+  typed_hashtable_insert(device_id)
 
 #define st_lookup				\
-  typed_splay_lookup(device_id)
+  typed_hashtable_lookup(device_id)
 
 #define st_delete				\
-  typed_splay_delete(device_id)
+  typed_hashtable_delete(device_id)
 
 #define st_forall				\
-  typed_splay_forall(device_id)
+  typed_hashtable_forall(device_id)
 
 #define st_count				\
-  typed_splay_count(device_id)
+  typed_hashtable_count(device_id)
 
 #define st_alloc(free_list)			\
-  typed_splay_alloc(free_list, gpu_device_id_map_entry_t)
+  typed_hashtable_alloc(&map, free_list, gpu_device_id_map_entry_t)
 
 #define st_free(free_list, node)		\
-  typed_splay_free(free_list, node)
+  typed_hashtable_free(free_list, node)
 
 
 //******************************************************************************
 // type declarations
 //******************************************************************************
-#undef typed_splay_node
-#define typed_splay_node(correlation_id) gpu_device_id_map_entry_t
+#undef typed_hashtable_node
+#define typed_hashtable_node(correlation_id) gpu_device_id_map_entry_t
 
-typedef struct typed_splay_node(device_id) { 
-  struct gpu_device_id_map_entry_t *left;
-  struct gpu_device_id_map_entry_t *right;
+typedef struct typed_hashtable_node(device_id) { 
+  struct gpu_device_id_map_entry_t *next;
   uint64_t device_id;
 
   // average properties
@@ -111,21 +109,22 @@ typedef struct typed_splay_node(device_id) {
   uint32_t fan_speed;
   uint32_t temperature;
   uint32_t power;
-} typed_splay_node(device_id); 
+} typed_hashtable_node(device_id); 
 
 
 //******************************************************************************
 // local data
 //******************************************************************************
 
-static gpu_device_id_map_entry_t *map_root = NULL;
+static hashtable_uint64_t map =
+  HASHTABLE_UINT64_INITIALIZER(hpcrun_malloc_safe, NULL);
 static gpu_device_id_map_entry_t *free_list = NULL;
 
 //******************************************************************************
 // private operations
 //******************************************************************************
 
-typed_splay_impl(device_id)
+typed_hashtable_impl(device_id)
 
 
 static gpu_device_id_map_entry_t *
@@ -158,7 +157,7 @@ gpu_device_id_map_lookup
  uint32_t device_id
 )
 {
-  gpu_device_id_map_entry_t *result = st_lookup(&map_root, device_id);
+  gpu_device_id_map_entry_t *result = st_lookup(&map, device_id);
 
   TMSG(DEFER_CTXT, "event map lookup: event=0x%lx (record %p)", 
        device_id, result);
@@ -174,11 +173,11 @@ gpu_device_id_map_insert
  uint32_t core_clock_rate
 )
 {
-  gpu_device_id_map_entry_t *entry = st_lookup(&map_root, device_id);
+  gpu_device_id_map_entry_t *entry = st_lookup(&map, device_id);
 
   if (!entry) {
     entry = gpu_device_id_map_entry_new(device_id);
-    st_insert(&map_root, entry);
+    st_insert(&map, entry);
   }
 
   if (core_clock_rate != 0) {
@@ -196,7 +195,7 @@ gpu_device_id_map_delete
  uint32_t device_id
 )
 {
-  gpu_device_id_map_entry_t *node = st_delete(&map_root, device_id);
+  gpu_device_id_map_entry_t *node = st_delete(&map, device_id);
   st_free(&free_list, node);
 }
 
@@ -53,13 +53,12 @@
 // local includes
 //******************************************************************************
 
-#include <lib/prof-lean/splay-uint64.h>
+#include <lib/prof-lean/hashtable-uint64.h>
 
 #include <hpcrun/messages/messages.h>
 #include <hpcrun/memory/hpcrun-malloc.h>
 
 #include "gpu-event-id-map.h"
-#include "gpu-splay-allocator.h"
 
 
 //******************************************************************************
@@ -71,55 +70,55 @@
 #include "gpu-print.h"
 
 #define st_insert				\
-  typed_splay_insert(event_id)
+  typed_hashtable_insert(event_id)
 
 #define st_lookup				\
-  typed_splay_lookup(event_id)
+  typed_hashtable_lookup(event_id)
 
 #define st_delete				\
-  typed_splay_delete(event_id)
+  typed_hashtable_delete(event_id)
 
 #define st_forall				\
-  typed_splay_forall(event_id)
+  typed_hashtable_forall(event_id)
 
 #define st_count				\
-  typed_splay_count(event_id)
+  typed_hashtable_count(event_id)
 
 #define st_alloc(free_list)			\
-  typed_splay_alloc(free_list, gpu_event_id_map_entry_t)
+  typed_hashtable_alloc(&map, free_list, gpu_event_id_map_entry_t)
 
 #define st_free(free_list, node)		\
-  typed_splay_free(free_list, node)
+  typed_hashtable_free(free_list, node)
 
 
 //******************************************************************************
 // type declarations
 //******************************************************************************
-#undef typed_splay_node
-#define typed_splay_node(correlation_id) gpu_event_id_map_entry_t
+#undef typed_hashtable_node
+#define typed_hashtable_node(correlation_id) gpu_event_id_map_entry_t
 
-typedef struct typed_splay_node(event_id) { 
-  struct gpu_event_id_map_entry_t *left;
-  struct gpu_event_id_map_entry_t *right;
+typedef struct typed_hashtable_node(event_id) { 
+  struct gpu_event_id_map_entry_t *next;
   uint64_t event_id;
 
   uint32_t context_id;
   uint32_t stream_id;
-} typed_splay_node(event_id); 
+} typed_hashtable_node(event_id); 
 
 
 //******************************************************************************
 // local data
 //******************************************************************************
 
-static gpu_event_id_map_entry_t *map_root = NULL;
+static hashtable_uint64_t map =
+  HASHTABLE_UINT64_INITIALIZER(hpcrun_malloc_safe, NULL);
 static gpu_event_id_map_entry_t *free_list = NULL;
 
 //******************************************************************************
 // private operations
 //******************************************************************************
 
-typed_splay_impl(event_id)
+typed_hashtable_impl(event_id)
 
 
 static gpu_event_id_map_entry_t *
@@ -154,7 +153,7 @@ gpu_event_id_map_lookup
  uint32_t event_id
 )
 {
-  gpu_event_id_map_entry_t *result = st_lookup(&map_root, event_id);
+  gpu_event_id_map_entry_t *result = st_lookup(&map, event_id);
 
   TMSG(DEFER_CTXT, "event map lookup: event=0x%lx (record %p)", 
        event_id, result);
@@ -188,7 +187,7 @@ gpu_event_id_map_insert
   } else {
     entry = gpu_event_id_map_entry_new(event_id, context_id, stream_id);
 
-    st_insert(&map_root, entry);
+    st_insert(&map, entry);
 
     PRINT("event_id_map insert: event_id=0x%lx\n", event_id);
   }
@@ -201,7 +200,7 @@ gpu_event_id_map_delete
  uint32_t event_id
 )
 {
-  gpu_event_id_map_entry_t *node = st_delete(&map_root, event_id);
+  gpu_event_id_map_entry_t *node = st_delete(&map, event_id);
   st_free(&free_list, node);
 }
 
@@ -52,10 +52,11 @@
 // local includes
 //******************************************************************************
 
-#include <lib/prof-lean/splay-uint64.h>
+#include <lib/prof-lean/hashtable-uint64.h>
+
+#include <hpcrun/memory/hpcrun-malloc.h>
 
 #include "gpu-function-id-map.h"
-#include "gpu-splay-allocator.h"
 
 //******************************************************************************
 // macros
@@ -67,25 +68,25 @@
 
 
 #define st_insert				\
-  typed_splay_insert(function_id)
+  typed_hashtable_insert(function_id)
 
 #define st_lookup				\
-  typed_splay_lookup(function_id)
+  typed_hashtable_lookup(function_id)
 
 #define st_delete				\
-  typed_splay_delete(function_id)
+  typed_hashtable_delete(function_id)
 
 #define st_forall				\
-  typed_splay_forall(function_id)
+  typed_hashtable_forall(function_id)
 
 #define st_count				\
-  typed_splay_count(function_id)
+  typed_hashtable_count(function_id)
 
 #define st_alloc(free_list)			\
-  typed_splay_alloc(free_list, typed_splay_node(function_id))
+  typed_hashtable_alloc(&map, free_list, typed_hashtable_node(function_id))
 
 #define st_free(free_list, node)		\
-  typed_splay_free(free_list, node)
+  typed_hashtable_free(free_list, node)
 
 
 
@@ -93,23 +94,23 @@
 // type declarations
 //******************************************************************************
 
-#undef typed_splay_node
-#define typed_splay_node(function_id) gpu_function_id_map_entry_t
+#undef typed_hashtable_node
+#define typed_hashtable_node(function_id) gpu_function_id_map_entry_t
 
-typedef struct typed_splay_node(function_id) {
-  struct typed_splay_node(function_id) *left;
-  struct typed_splay_node(function_id) *right;
+typedef struct typed_hashtable_node(function_id) {
+  struct typed_hashtable_node(function_id) *next;
 
   uint64_t function_id; // key
   ip_normalized_t pc;
-} typed_splay_node(function_id); 
+} typed_hashtable_node(function_id); 
 
 
 //******************************************************************************
 // local data
 //******************************************************************************
 
-static gpu_function_id_map_entry_t *map_root = NULL;
+static hashtable_uint64_t map =
+  HASHTABLE_UINT64_INITIALIZER(hpcrun_malloc_safe, NULL);
 
 static gpu_function_id_map_entry_t *free_list = NULL;
 
@@ -118,7 +119,7 @@ static gpu_function_id_map_entry_t *free_list = NULL;
 // private operations
 //******************************************************************************
 
-typed_splay_impl(function_id)
+typed_hashtable_impl(function_id)
 
 
 static gpu_function_id_map_entry_t *
@@ -159,7 +160,7 @@ gpu_function_id_map_lookup
  uint64_t function_id
 )
 {
-  gpu_function_id_map_entry_t *result = st_lookup(&map_root, function_id);
+  gpu_function_id_map_entry_t *result = st_lookup(&map, function_id);
 
   PRINT("function_id_map lookup: id=0x%lx (entry %p)", function_id, result);
 
@@ -174,7 +175,7 @@ gpu_function_id_map_insert
  ip_normalized_t pc
 )
 {
-  if (st_lookup(&map_root, function_id)) { 
+  if (st_lookup(&map, function_id)) { 
     // fatal error: function_id already present; a
     // correlation should be inserted only once.
     assert(0);
@@ -182,7 +183,7 @@ gpu_function_id_map_insert
     gpu_function_id_map_entry_t *entry = 
       gpu_function_id_map_entry_new(function_id, pc); 
 
-    st_insert(&map_root, entry);
+    st_insert(&map, entry);
   }
 }
 
@@ -193,7 +194,7 @@ gpu_function_id_map_delete
  uint64_t function_id
 )
 {
-  gpu_function_id_map_entry_t *node = st_delete(&map_root, function_id);
+  gpu_function_id_map_entry_t *node = st_delete(&map, function_id);
   st_free(&free_list, node);
 }
 
@@ -217,6 +218,6 @@ gpu_function_id_map_count
  void
 )
 {
-  return st_count(map_root);
+  return st_count(&map);
 }
 
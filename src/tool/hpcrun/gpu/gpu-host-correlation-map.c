@@ -54,13 +54,14 @@
 // local includes
 //******************************************************************************
 
-#include <lib/prof-lean/splay-uint64.h>
+#include <lib/prof-lean/hashtable-uint64.h>
+
+#include <hpcrun/memory/hpcrun-malloc.h>
 
 #include <hpcrun/cct/cct.h>
 
 #include "gpu-host-correlation-map.h"
 #include "gpu-op-placeholders.h"
-#include "gpu-splay-allocator.h"
 
 
 
@@ -74,25 +75,25 @@
 
 
 #define st_insert				\
-  typed_splay_insert(host_correlation)
+  typed_hashtable_insert(host_correlation)
 
 #define st_lookup				\
-  typed_splay_lookup(host_correlation)
+  typed_hashtable_lookup(host_correlation)
 
 #define st_delete				\
-  typed_splay_delete(host_correlation)
+  typed_hashtable_delete(host_correlation)
 
 #define st_forall				\
-  typed_splay_forall(host_correlation)
+  typed_hashtable_forall(host_correlation)
 
 #define st_count				\
-  typed_splay_count(host_correlation)
+  typed_hashtable_count(host_correlation)
 
 #define st_alloc(free_list)			\
-  typed_splay_alloc(free_list, gpu_host_correlation_map_entry_t)
+  typed_hashtable_alloc(&map, free_list, gpu_host_correlation_map_entry_t)
 
 #define st_free(free_list, node)		\
-  typed_splay_free(free_list, node)
+  typed_hashtable_free(free_list, node)
 
 
 
@@ -100,12 +101,11 @@
 // type declarations
 //******************************************************************************
 
-#undef typed_splay_node
-#define typed_splay_node(host_correlation) gpu_host_correlation_map_entry_t
+#undef typed_hashtable_node
+#define typed_hashtable_node(host_correlation) gpu_host_correlation_map_entry_t
 
-typedef struct typed_splay_node(host_correlation) {
-  struct typed_splay_node(host_correlation) *left;
-  struct typed_splay_node(host_correlation) *right;
+typedef struct typed_hashtable_node(host_correlation) {
+  struct typed_hashtable_node(host_correlation) *next;
 
   uint64_t host_correlation_id; // key
 
@@ -117,7 +117,7 @@ typedef struct typed_splay_node(host_correlation) {
 
   int samples;
   int total_samples;
-} typed_splay_node(host_correlation); 
+} typed_hashtable_node(host_correlation); 
 
 
 
@@ -125,7 +125,8 @@ typedef struct typed_splay_node(host_correlation) {
 // local data
 //******************************************************************************
 
-static gpu_host_correlation_map_entry_t *map_root = NULL;
+static hashtable_uint64_t map =
+  HASHTABLE_UINT64_INITIALIZER(hpcrun_malloc_safe, NULL);
 
 static gpu_host_correlation_map_entry_t *free_list = NULL;
 
@@ -135,7 +136,7 @@ static gpu_host_correlation_map_entry_t *free_list = NULL;
 // private operations
 //******************************************************************************
 
-typed_splay_impl(host_correlation)
+typed_hashtable_impl(host_correlation)
 
 
 static gpu_host_correlation_map_entry_t *
@@ -198,7 +199,7 @@ gpu_host_correlation_map_lookup
  uint64_t host_correlation_id
 )
 {
-  gpu_host_correlation_map_entry_t *result = st_lookup(&map_root, host_correlation_id);
+  gpu_host_correlation_map_entry_t *result = st_lookup(&map, host_correlation_id);
 
   PRINT("host_correlation_map lookup: id=0x%lx (entry %p)", host_correlation_id, result);
 
@@ -215,7 +216,7 @@ gpu_host_correlation_map_insert
  gpu_activity_channel_t *activity_channel
 )
 {
-  if (st_lookup(&map_root, host_correlation_id)) { 
+  if (st_lookup(&map, host_correlation_id)) { 
     // fatal error: host_correlation id already present; a
     // correlation should be inserted only once.
     assert(0);
@@ -224,7 +225,7 @@ gpu_host_correlation_map_insert
       gpu_host_correlation_map_entry_new(host_correlation_id, gpu_op_ccts, 
 					 cpu_submit_time, activity_channel);
 
-    st_insert(&map_root, entry);
+    st_insert(&map, entry);
 
     PRINT("host_correlation_map insert: correlation_id=0x%lx "
 	 "activity_channel=%p (entry=%p)", 
@@ -245,7 +246,7 @@ gpu_host_correlation_map_samples_increase
   PRINT("correlation_map samples update: correlation_id=0x%lx (update %d)", 
 	host_correlation_id, val);
 
-  gpu_host_correlation_map_entry_t *entry = st_lookup(&map_root, host_correlation_id);
+  gpu_host_correlation_map_entry_t *entry = st_lookup(&map, host_correlation_id);
 
   if (entry) {
     entry->samples += val;
@@ -268,7 +269,7 @@ gpu_host_correlation_map_total_samples_update
   PRINT("correlation_map total samples update: correlation_id=0x%lx (update %d)",
        host_correlation_id, val);
 
-  gpu_host_correlation_map_entry_t *entry = st_lookup(&map_root, host_correlation_id);
+  gpu_host_correlation_map_entry_t *entry = st_lookup(&map, host_correlation_id);
 
   if (entry) {
     entry->total_samples = val;
@@ -285,7 +286,7 @@ gpu_host_correlation_map_delete
  uint64_t host_correlation_id
 )
 {
-  gpu_host_correlation_map_entry_t *node = st_delete(&map_root, host_correlation_id);
+  gpu_host_correlation_map_entry_t *node = st_delete(&map, host_correlation_id);
   st_free(&free_list, node);
 }
 
@@ -342,5 +343,5 @@ gpu_host_correlation_map_count
  void
 )
 {
-  return st_count(map_root);
+  return st_count(&map);
 }
@@ -45,15 +45,8 @@
 // system includes
 //******************************************************************************
 
+#include <stdbool.h>
 #include <string.h>
-#include <pthread.h>
-
-
-//******************************************************************************
-// macros
-//******************************************************************************
-
-#define SECONDS_UNTIL_WAKEUP 2
 
 
 
@@ -108,8 +101,6 @@
 
 typedef struct gpu_trace_channel_t {
   bistack_t bistacks[2];
-  pthread_mutex_t mutex;
-  pthread_cond_t cond;
   uint64_t count;
 } gpu_trace_channel_t;
 
@@ -122,16 +113,17 @@ typedef struct gpu_trace_channel_t {
 // implement bidirectional channels for traces
 typed_bichannel_impl(gpu_trace_item_t)
 
-static void
-gpu_trace_channel_signal_consumer_when_full
+static bool
+gpu_trace_channel_full
 (
  gpu_trace_channel_t *trace_channel
 )
 {
   if (trace_channel->count++ > CHANNEL_FILL_COUNT) {
     trace_channel->count = 0;
-    gpu_trace_channel_signal_consumer(trace_channel);
+    return true;
   }
+  return false;
 }
 
 
@@ -153,14 +145,13 @@ gpu_trace_channel_alloc
 
   channel_init(channel);
 
-  pthread_mutex_init(&channel->mutex, NULL);
-  pthread_cond_init(&channel->cond, NULL);
-
   return channel;
 }
 
 
-void
+// returns true when enough items have accumulated since the last
+// notification that the consumer should be woken
+bool
 gpu_trace_channel_produce
 (
  gpu_trace_channel_t *channel,
@@ -173,7 +164,7 @@ gpu_trace_channel_produce
 
   channel_push(channel, bichannel_direction_forward, cti);
   
-  gpu_trace_channel_signal_consumer_when_full(channel);
+  return gpu_trace_channel_full(channel);
 }
 
 
@@ -181,7 +172,7 @@ void
 gpu_trace_channel_consume
 (
  gpu_trace_channel_t *channel,
- thread_data_t *td, 
+ gpu_trace_t *trace,
  gpu_trace_item_consume_fn_t trace_item_consume
 )
 {
@@ -195,34 +186,8 @@ gpu_trace_channel_consume
   for (;;) {
     gpu_trace_item_t *ti = channel_pop(channel, bichannel_direction_forward);
     if (!ti) break;
-    gpu_trace_item_consume(trace_item_consume, td, ti);
+    gpu_trace_item_consume(trace_item_consume, trace, ti);
     gpu_trace_item_free(channel, ti);
   }
 }
 
-
-void
-gpu_trace_channel_await
-(
- gpu_trace_channel_t *channel
-)
-{
-  struct timespec time;
-  clock_gettime(CLOCK_REALTIME, &time); // get current time
-  time.tv_sec += SECONDS_UNTIL_WAKEUP;
-
-  // wait for a signal or for a few seconds. periodically waking
-  // up avoids missing a signal.
-  pthread_cond_timedwait(&channel->cond, &channel->mutex, &time); 
-}
-
-
-void
-gpu_trace_channel_signal_consumer
-(
- gpu_trace_channel_t *trace_channel
-)
-{
-  pthread_cond_signal(&trace_channel->cond);
-}
-
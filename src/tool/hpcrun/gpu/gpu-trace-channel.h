@@ -46,6 +46,14 @@
 
 
 
+//******************************************************************************
+// system includes
+//******************************************************************************
+
+#include <stdbool.h>
+
+
+
 //******************************************************************************
 // local includes
 //******************************************************************************
@@ -73,7 +81,7 @@ gpu_trace_channel_alloc
 );
 
 
-void
+bool
 gpu_trace_channel_produce
 (
  gpu_trace_channel_t *channel,
@@ -85,24 +93,9 @@ void
 gpu_trace_channel_consume
 (
  gpu_trace_channel_t *channel,
- thread_data_t *td, 
+ gpu_trace_t *trace,
  gpu_trace_item_consume_fn_t trace_item_consume
 );
 
 
-void
-gpu_trace_channel_await
-(
- gpu_trace_channel_t *channel
-);
-
-
-void
-gpu_trace_channel_signal_consumer
-(
- gpu_trace_channel_t *trace_channel
-);
-
-
-
 #endif
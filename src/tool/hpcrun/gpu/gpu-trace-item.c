@@ -88,11 +88,11 @@ void
 gpu_trace_item_consume
 (
  gpu_trace_item_consume_fn_t trace_item_consume,
- thread_data_t *td,
+ gpu_trace_t *trace,
  gpu_trace_item_t *ti
 )
 {
-  trace_item_consume(td, ti->call_path_leaf, ti->start, ti->end);
+  trace_item_consume(trace, ti->call_path_leaf, ti->start, ti->end);
 }
 
 
@@ -68,7 +68,7 @@
 
 typedef struct cct_node_t cct_node_t; 
 
-typedef struct thread_data_t thread_data_t; 
+typedef struct gpu_trace_t gpu_trace_t; 
 
 
 
@@ -89,7 +89,7 @@ typedef struct gpu_trace_item_t {
 
 typedef void (*gpu_trace_item_consume_fn_t)
 (
- thread_data_t *td,
+ gpu_trace_t *trace,
  cct_node_t *call_path_leaf,
  uint64_t start_time,
  uint64_t end_time
@@ -116,7 +116,7 @@ void
 gpu_trace_item_consume
 (
  gpu_trace_item_consume_fn_t trace_item_consume,
- thread_data_t *td,
+ gpu_trace_t *trace,
  gpu_trace_item_t *ti
 );
 
@@ -42,10 +42,11 @@
 // ******************************************************* EndRiceCopyright *
 
 //******************************************************************************
-// local includes
+// system includes
 //******************************************************************************
 
 #include <pthread.h>
+#include <time.h>
 
 
 
@@ -64,11 +65,12 @@
 #include <lib/prof-lean/stdatomic.h>
 
 #include <hpcrun/cct/cct.h>
+#include <hpcrun/control-knob.h>
+#include <hpcrun/memory/hpcrun-malloc.h>
 #include <hpcrun/thread_data.h>
 #include <hpcrun/threadmgr.h>
 #include <hpcrun/trace.h>
 
-#include "gpu-context-id-map.h"
 #include "gpu-monitoring.h"
 #include "gpu-trace.h"
 #include "gpu-trace-channel.h"
@@ -80,19 +82,44 @@
 // macros
 //******************************************************************************
 
+#define UNIT_TEST 0
+
 #define DEBUG 0
 
 #include "gpu-print.h"
 
+#define GPU_TRACE_WORKERS_DEFAULT 4
+
+#define SECONDS_UNTIL_WAKEUP 2
+
 
 
 //******************************************************************************
 // type declarations
 //******************************************************************************
 
-typedef struct gpu_trace_t {
+//------------------------------------------------------------------------------
+// a trace worker multiplexes the trace channels of many streams. each
+// stream is bound to exactly one worker for its lifetime, so the items
+// of a stream are consumed by a single thread in the order produced.
+//------------------------------------------------------------------------------
+typedef struct gpu_trace_worker_t {
   pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool pending;                     // guarded by mutex
+  _Atomic(gpu_trace_t *) traces;    // streams served; push only
+} gpu_trace_worker_t;
+
+
+typedef struct gpu_trace_t {
+  gpu_trace_t *next;                // next stream of the same worker
   gpu_trace_channel_t *trace_channel;
+  gpu_trace_worker_t *worker;
+  thread_data_t *td;                // per-stream profile and trace
+  uint64_t stream_start;
+  uint64_t last_end;
+  bool first;
 } gpu_trace_t;
 
 typedef void *(*pthread_start_routine_t)(void *);
@@ -105,11 +132,17 @@ typedef void *(*pthread_start_routine_t)(void *);
 
 static _Atomic(bool) stop_trace_flag;
 
-static atomic_ullong stream_counter;
-
 static atomic_ullong stream_id;
 
-static __thread uint64_t stream_start = 0;
+static atomic_uint stream_counter;
+
+static gpu_trace_worker_t *workers;
+
+static unsigned int workers_max;
+
+static unsigned int workers_started;
+
+static pthread_mutex_t workers_lock = PTHREAD_MUTEX_INITIALIZER;
 
 
 
@@ -120,20 +153,21 @@ static __thread uint64_t stream_start = 0;
 static void
 stream_start_set
 (
+ gpu_trace_t *trace,
  uint64_t start_time
 )
 {
-  if (!stream_start) stream_start = start_time;
+  if (!trace->stream_start) trace->stream_start = start_time;
 }
 
 
 static uint64_t
 stream_start_get
 (
- void
+ gpu_trace_t *trace
 )
 {
-  return stream_start;
+  return trace->stream_start;
 }
 
 
@@ -144,7 +178,13 @@ gpu_trace_alloc
 )
 {
   gpu_trace_t *trace = hpcrun_malloc_safe(sizeof(gpu_trace_t));
+  trace->next = NULL;
   trace->trace_channel = gpu_trace_channel_alloc();
+  trace->worker = NULL;
+  trace->td = NULL;
+  trace->stream_start = 0;
+  trace->last_end = 0;
+  trace->first = true;
   return trace;
 }
 
@@ -215,16 +255,14 @@ gpu_trace_stream_append
 static void
 gpu_trace_first
 (
- thread_data_t* td,
+ gpu_trace_t *trace,
  cct_node_t *no_activity,
  uint64_t start
 )
 {
-  static __thread bool first = true;
-
-  if (first) {
-    first = false;
-    gpu_trace_stream_append(td, no_activity, start - 1);
+  if (trace->first) {
+    trace->first = false;
+    gpu_trace_stream_append(trace->td, no_activity, start - 1);
   }
 }
 
@@ -232,19 +270,18 @@ gpu_trace_first
 static uint64_t
 gpu_trace_start_adjust
 (
+ gpu_trace_t *trace,
  uint64_t start,
  uint64_t end
 )
 {
-  static __thread uint64_t last_end = 0;
-
-  if (start < last_end) {
+  if (start < trace->last_end) {
     // If we have a hardware measurement error (Power9),
     // set the offset as the end of the last activity
-    start = last_end + 1;
+    start = trace->last_end + 1;
   }
 
-  last_end = end;
+  trace->last_end = end;
 
   return start;
 }
@@ -253,12 +290,13 @@ gpu_trace_start_adjust
 static void
 consume_one_trace_item
 (
- thread_data_t* td,
+ gpu_trace_t *trace,
  cct_node_t *call_path,
  uint64_t start_time,
  uint64_t end_time
 )
 {
+  thread_data_t *td = trace->td;
 
   cct_node_t *leaf = gpu_trace_cct_insert_context(td, call_path);
 
@@ -267,9 +305,9 @@ consume_one_trace_item
   uint64_t start = gpu_trace_time(start_time);
   uint64_t end   = gpu_trace_time(end_time);
 
-  stream_start_set(start_time);
+  stream_start_set(trace, start_time);
 
-  start = gpu_trace_start_adjust(start, end);
+  start = gpu_trace_start_adjust(trace, start, end);
 
   int frequency = gpu_monitoring_trace_sample_frequency_get();
 
@@ -278,8 +316,8 @@ consume_one_trace_item
   if (frequency != -1) {
     uint64_t cur_start = start_time;
     uint64_t cur_end = end_time;
-    uint64_t intervals = (cur_start - stream_start_get() - 1) / frequency + 1;
-    uint64_t pivot = intervals * frequency + stream_start;
+    uint64_t intervals = (cur_start - stream_start_get(trace) - 1) / frequency + 1;
+    uint64_t pivot = intervals * frequency + stream_start_get(trace);
 
     if (pivot <= cur_end && pivot >= cur_start) {
       // only trace when the pivot is within the range
@@ -293,7 +331,7 @@ consume_one_trace_item
   }
 
   if (append) {
-    gpu_trace_first(td, no_activity, start);
+    gpu_trace_first(trace, no_activity, start);
     
     gpu_trace_stream_append(td, leaf, start);
     
@@ -304,71 +342,182 @@ consume_one_trace_item
 }
 
 
+static int
+gpu_trace_stream_id
+(
+ void
+)
+{
+  // FIXME: this is a bad way to compute a stream id 
+  int id = 500 + atomic_fetch_add(&stream_id, 1);
+
+  return id;
+}
+
+
+static void
+gpu_trace_stream_acquire
+(
+ gpu_trace_t *trace
+)
+{
+  int id = gpu_trace_stream_id();
+
+  hpcrun_threadMgr_non_compact_data_get(id, NULL, &trace->td);
+}
+
+
+static void
+gpu_trace_stream_release
+(
+ gpu_trace_t *trace
+)
+{
+  hpcrun_set_thread_data(trace->td);
+
+  epoch_t *epoch = TD_GET(core_profile_trace_data.epoch);
+
+  int no_separator = 1;
+  hpcrun_threadMgr_data_put(epoch, trace->td, no_separator);
+}
+
+
 static void
 gpu_trace_activities_process
 (
- thread_data_t *td,
- gpu_trace_t *thread_args
+ gpu_trace_t *trace
 )
 {
-  gpu_trace_channel_consume(thread_args->trace_channel, td, 
+  // a stream's thread data is created lazily by the worker that owns it
+  if (trace->td == NULL) gpu_trace_stream_acquire(trace);
+
+  // the hpcrun trace and cct operations below consult the current
+  // thread's data; point it at the stream being drained
+  hpcrun_set_thread_data(trace->td);
+
+  gpu_trace_channel_consume(trace->trace_channel, trace,
 			    consume_one_trace_item);
 }
 
 
 static void
-gpu_trace_activities_await
+gpu_trace_worker_signal
 (
- gpu_trace_t* thread_args
+ gpu_trace_worker_t *worker
 )
 {
-  gpu_trace_channel_await(thread_args->trace_channel);
+  pthread_mutex_lock(&worker->mutex);
+  worker->pending = true;
+  pthread_cond_signal(&worker->cond);
+  pthread_mutex_unlock(&worker->mutex);
 }
 
 
-static int
-gpu_trace_stream_id
+static void
+gpu_trace_worker_await
 (
- void
+ gpu_trace_worker_t *worker
 )
 {
-  // FIXME: this is a bad way to compute a stream id 
-  int id = 500 + atomic_fetch_add(&stream_id, 1);
+  pthread_mutex_lock(&worker->mutex);
 
-  return id;
+  if (!worker->pending && !atomic_load(&stop_trace_flag)) {
+    struct timespec time;
+    clock_gettime(CLOCK_REALTIME, &time); // get current time
+    time.tv_sec += SECONDS_UNTIL_WAKEUP;
+
+    // wait for a signal or for a few seconds. periodically waking
+    // up picks up streams whose channels have not filled yet.
+    pthread_cond_timedwait(&worker->cond, &worker->mutex, &time);
+  }
+  worker->pending = false;
+
+  pthread_mutex_unlock(&worker->mutex);
 }
 
 
-static thread_data_t *
-gpu_trace_stream_acquire
+static void *
+gpu_trace_worker_record
+(
+ gpu_trace_worker_t *worker
+)
+{
+  for (;;) {
+    // sample the flag before draining so that items produced before
+    // gpu_trace_fini are consumed by the final pass
+    bool stop = atomic_load(&stop_trace_flag);
+
+    gpu_trace_t *trace = atomic_load(&worker->traces);
+    for (; trace; trace = trace->next) {
+      gpu_trace_activities_process(trace);
+    }
+
+    if (stop) break;
+
+    gpu_trace_worker_await(worker);
+  }
+
+  gpu_trace_t *trace = atomic_load(&worker->traces);
+  for (; trace; trace = trace->next) {
+    if (trace->td) gpu_trace_stream_release(trace);
+  }
+
+  return NULL;
+}
+
+
+static gpu_trace_worker_t *
+gpu_trace_worker_get
 (
  void
 )
 {
-  thread_data_t* td = NULL;
+  unsigned int index = atomic_fetch_add(&stream_counter, 1) % workers_max;
 
-  int id = gpu_trace_stream_id();
+  gpu_trace_worker_t *worker = &workers[index];
+
+  pthread_mutex_lock(&workers_lock);
+
+  // workers are started on demand; a program with few streams never
+  // pays for more threads than it has streams
+  while (workers_started <= index) {
+    gpu_trace_worker_t *w = &workers[workers_started];
+
+    pthread_mutex_init(&w->mutex, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    w->pending = false;
+    atomic_store(&w->traces, NULL);
 
-  hpcrun_threadMgr_non_compact_data_get(id, NULL, &td);
+    // Create a new thread for the worker without libmonitor watching
+    monitor_disable_new_threads();
+
+    pthread_create(&w->thread, NULL,
+		   (pthread_start_routine_t) gpu_trace_worker_record, w);
+
+    monitor_enable_new_threads();
+
+    workers_started++;
+  }
 
-  hpcrun_set_thread_data(td);
+  pthread_mutex_unlock(&workers_lock);
 
-  return td;
+  return worker;
 }
 
 
 static void
-gpu_trace_stream_release
+gpu_trace_worker_attach
 (
- thread_data_t *td
+ gpu_trace_worker_t *worker,
+ gpu_trace_t *trace
 )
 {
-  epoch_t *epoch = TD_GET(core_profile_trace_data.epoch);
-
-  int no_separator = 1;
-  hpcrun_threadMgr_data_put(epoch, td, no_separator);
+  trace->worker = worker;
 
-  atomic_fetch_add(&stream_counter, -1);
+  gpu_trace_t *head = atomic_load(&worker->traces);
+  do {
+    trace->next = head;
+  } while (!atomic_compare_exchange_weak(&worker->traces, &head, trace));
 }
 
 
@@ -386,27 +535,13 @@ gpu_trace_init
   atomic_store(&stop_trace_flag, false);
   atomic_store(&stream_counter, 0);
   atomic_store(&stream_id, 0);
-}
-
 
-void *
-gpu_trace_record
-(
- gpu_trace_t *thread_args
-)
-{
-  thread_data_t* td = gpu_trace_stream_acquire();
-
-  while (!atomic_load(&stop_trace_flag)) {
-    gpu_trace_activities_process(td, thread_args);
-    gpu_trace_activities_await(thread_args);
+  if (workers == NULL) {
+    int n = control_knob_value_get_int(HPCRUN_GPU_TRACE_WORKERS);
+    workers_max = (n > 0) ? n : GPU_TRACE_WORKERS_DEFAULT;
+    workers = hpcrun_malloc_safe(workers_max * sizeof(gpu_trace_worker_t));
+    workers_started = 0;
   }
-
-  gpu_trace_activities_process(td, thread_args);
-
-  gpu_trace_stream_release(td);
-
-  return NULL;
 }
 
 
@@ -420,9 +555,30 @@ gpu_trace_fini
 
   atomic_store(&stop_trace_flag, true);
 
-  gpu_context_stream_map_signal_all();
+  pthread_mutex_lock(&workers_lock);
+
+  unsigned int i;
+  for (i = 0; i < workers_started; i++) {
+    gpu_trace_worker_signal(&workers[i]);
+  }
+
+  // each worker drains its channels and writes its streams before exiting
+  for (i = 0; i < workers_started; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+
+  // the streams have been released; forget them together with their
+  // workers so that a restarted worker never revisits them
+  for (i = 0; i < workers_started; i++) {
+    gpu_trace_worker_t *w = &workers[i];
+    atomic_store(&w->traces, NULL);
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->mutex);
+  }
 
-  while (atomic_load(&stream_counter));
+  workers_started = 0;
+
+  pthread_mutex_unlock(&workers_lock);
 }
 
 
@@ -432,18 +588,9 @@ gpu_trace_create
  void
 )
 {
-  // Init variables
   gpu_trace_t *trace = gpu_trace_alloc();
 
-  // Create a new thread for the stream without libmonitor watching
-  monitor_disable_new_threads();
-
-  atomic_fetch_add(&stream_counter, 1);
-
-  pthread_create(&trace->thread, NULL, (pthread_start_routine_t) gpu_trace_record, 
-		 trace);
-
-  monitor_enable_new_threads();
+  gpu_trace_worker_attach(gpu_trace_worker_get(), trace);
 
   return trace;
 }
@@ -456,7 +603,9 @@ gpu_trace_produce
  gpu_trace_item_t *ti
 )
 {
-  gpu_trace_channel_produce(t->trace_channel, ti);
+  if (gpu_trace_channel_produce(t->trace_channel, ti)) {
+    gpu_trace_worker_signal(t->worker);
+  }
 }
 
 
@@ -466,5 +615,333 @@ gpu_trace_signal_consumer
  gpu_trace_t *t
 )
 {
-  gpu_trace_channel_signal_consumer(t->trace_channel);
+  gpu_trace_worker_signal(t->worker);
 }
+
+
+
+//******************************************************************************
+// unit test
+//******************************************************************************
+
+// Several producer threads each create a few streams and produce
+// synthetic trace items into them, standing in for the monitoring
+// threads of a GPU runtime.  Only two workers are allowed, so streams
+// of different producers are multiplexed onto the same worker.  The
+// hpcrun cct, trace and thread-manager operations are replaced by
+// stubs that log what the workers append to each stream.  After
+// gpu_trace_fini, every stream must hold all of its items, in order
+// and with no items of other streams, must have been released exactly
+// once, and no worker may still list it.  The whole sequence runs
+// twice to check that a restarted pool starts from empty worker lists.
+//
+// build with UNIT_TEST set to 1, linking gpu-trace-channel.c,
+// gpu-trace-item.c, lib/prof-lean/bichannel.c and
+// lib/prof-lean/bistack.c.
+
+#if UNIT_TEST
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define UT_PRODUCERS 8
+#define UT_STREAMS   4     // per producer
+#define UT_ITEMS     5000  // per stream
+#define UT_ROUNDS    2
+
+#define UT_NO_ACTIVITY ((cct_node_t *) 0x1)
+
+typedef struct ut_stream_t {
+  thread_data_t td;                 // first: stands for the stream's data
+  epoch_t epoch;
+  int released;
+  int num_appends;
+  cct_node_t *nodes[1 + 2 * UT_ITEMS];
+  uint64_t times[1 + 2 * UT_ITEMS];
+} ut_stream_t;
+
+static __thread thread_data_t *ut_current_td;
+
+static atomic_uint ut_num_released;
+
+
+static thread_data_t *
+ut_get_thread_data
+(
+ void
+)
+{
+  return ut_current_td;
+}
+
+
+thread_data_t *(*hpcrun_get_thread_data)(void) = ut_get_thread_data;
+
+
+void
+hpcrun_set_thread_data
+(
+ thread_data_t *td
+)
+{
+  ut_current_td = td;
+}
+
+
+void *
+hpcrun_malloc_safe
+(
+ size_t size
+)
+{
+  return malloc(size);
+}
+
+
+int
+control_knob_value_get_int
+(
+ control_category c
+)
+{
+  return 2;
+}
+
+
+uint32_t
+gpu_monitoring_trace_sample_frequency_get
+(
+ void
+)
+{
+  return -1;
+}
+
+
+void
+monitor_disable_new_threads
+(
+ void
+)
+{
+}
+
+
+void
+monitor_enable_new_threads
+(
+ void
+)
+{
+}
+
+
+void
+hpcrun_threadMgr_non_compact_data_get
+(
+ int id,
+ cct_ctxt_t *thr_ctxt,
+ thread_data_t **data
+)
+{
+  ut_stream_t *s = calloc(1, sizeof(ut_stream_t));
+  s->td.core_profile_trace_data.epoch = &s->epoch;
+  *data = &s->td;
+}
+
+
+void
+hpcrun_threadMgr_data_put
+(
+ epoch_t *epoch,
+ thread_data_t *data,
+ int no_separator
+)
+{
+  ((ut_stream_t *) data)->released++;
+  atomic_fetch_add(&ut_num_released, 1);
+}
+
+
+cct_node_t *
+hpcrun_cct_bundle_get_no_activity_node
+(
+ cct_bundle_t *bundle
+)
+{
+  return UT_NO_ACTIVITY;
+}
+
+
+cct_node_t *
+hpcrun_cct_insert_path_return_leaf
+(
+ cct_node_t *root,
+ cct_node_t *path
+)
+{
+  return path;
+}
+
+
+void
+hpcrun_trace_append_stream
+(
+ core_profile_trace_data_t *cptd,
+ cct_node_t *node,
+ uint metric_id,
+ uint32_t dLCA,
+ uint64_t nanotime
+)
+{
+  ut_stream_t *s = (ut_stream_t *)
+    ((char *) cptd - offsetof(ut_stream_t, td.core_profile_trace_data));
+
+  if (s->num_appends < 1 + 2 * UT_ITEMS) {
+    s->nodes[s->num_appends] = node;
+    s->times[s->num_appends] = nanotime;
+  }
+  s->num_appends++;
+}
+
+
+static gpu_trace_t *ut_traces[UT_PRODUCERS * UT_STREAMS];
+
+
+static cct_node_t *
+ut_leaf
+(
+ int stream
+)
+{
+  return (cct_node_t *) (uintptr_t) (0x1000 + stream);
+}
+
+
+static void *
+ut_producer
+(
+ void *arg
+)
+{
+  int p = (int) (uintptr_t) arg;
+
+  int i;
+  for (i = 0; i < UT_STREAMS; i++) {
+    ut_traces[p * UT_STREAMS + i] = gpu_trace_create();
+  }
+
+  // interleave the items of this producer's streams
+  int k;
+  for (k = 0; k < UT_ITEMS; k++) {
+    for (i = 0; i < UT_STREAMS; i++) {
+      int stream = p * UT_STREAMS + i;
+      uint64_t start = 10 * (k + 1);
+      gpu_trace_item_t ti;
+      gpu_trace_item_produce(&ti, start, start, start + 5, ut_leaf(stream));
+      gpu_trace_produce(ut_traces[stream], &ti);
+    }
+  }
+
+  for (i = 0; i < UT_STREAMS; i++) {
+    gpu_trace_signal_consumer(ut_traces[p * UT_STREAMS + i]);
+  }
+
+  return NULL;
+}
+
+
+static int
+ut_check_stream
+(
+ int stream
+)
+{
+  ut_stream_t *s = (ut_stream_t *) ut_traces[stream]->td;
+
+  if (s == NULL) {
+    printf("stream %d: never drained\n", stream);
+    return 1;
+  }
+  if (s->released != 1) {
+    printf("stream %d: released %d times\n", stream, s->released);
+    return 1;
+  }
+  if (s->num_appends != 1 + 2 * UT_ITEMS) {
+    printf("stream %d: %d appends, expected %d\n", stream, s->num_appends,
+	   1 + 2 * UT_ITEMS);
+    return 1;
+  }
+  if (s->nodes[0] != UT_NO_ACTIVITY || s->times[0] != 10 - 1) {
+    printf("stream %d: bad leading no-activity record\n", stream);
+    return 1;
+  }
+
+  int k;
+  for (k = 0; k < UT_ITEMS; k++) {
+    uint64_t start = 10 * (k + 1);
+    if (s->nodes[1 + 2 * k] != ut_leaf(stream)
+	|| s->times[1 + 2 * k] != start
+	|| s->nodes[2 + 2 * k] != UT_NO_ACTIVITY
+	|| s->times[2 + 2 * k] != start + 5 + 1) {
+      printf("stream %d: item %d out of order or misattributed\n", stream, k);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+
+int
+main
+(
+ int argc,
+ char **argv
+)
+{
+  int errors = 0;
+
+  int round;
+  for (round = 0; round < UT_ROUNDS; round++) {
+    atomic_store(&ut_num_released, 0);
+
+    gpu_trace_init();
+
+    pthread_t producers[UT_PRODUCERS];
+    int p;
+    for (p = 0; p < UT_PRODUCERS; p++) {
+      pthread_create(&producers[p], NULL, ut_producer, (void *) (uintptr_t) p);
+    }
+    for (p = 0; p < UT_PRODUCERS; p++) {
+      pthread_join(producers[p], NULL);
+    }
+
+    gpu_trace_fini(NULL);
+
+    int i;
+    for (i = 0; i < UT_PRODUCERS * UT_STREAMS; i++) {
+      errors += ut_check_stream(i);
+    }
+    if (atomic_load(&ut_num_released) != UT_PRODUCERS * UT_STREAMS) {
+      printf("round %d: %u streams released, expected %d\n", round,
+	     atomic_load(&ut_num_released), UT_PRODUCERS * UT_STREAMS);
+      errors++;
+    }
+    for (i = 0; i < (int) workers_max; i++) {
+      if (atomic_load(&workers[i].traces) != NULL) {
+	printf("round %d: worker %d still lists streams\n", round, i);
+	errors++;
+      }
+    }
+
+    printf("round %d: %d streams x %d items on %u workers: %s\n", round,
+	   UT_PRODUCERS * UT_STREAMS, UT_ITEMS, workers_max,
+	   errors ? "FAILED" : "ok");
+  }
+
+  return errors != 0;
+}
+
+#endif
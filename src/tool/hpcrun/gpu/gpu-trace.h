@@ -100,13 +100,6 @@ gpu_trace_create
 );
 
 
-void *
-gpu_trace_record
-(
- gpu_trace_t *thread_args
-);
-
-
 void 
 gpu_trace_produce
 (
@@ -57,6 +57,7 @@
 
 #include <lib/prof-lean/hpcfmt.h>
 #include <lib/prof-lean/spinlock.h>
+#include <lib/prof-lean/stdatomic.h>
 
 #define LOADMAP_DEBUG 0
 
@@ -68,6 +69,30 @@ static hpcrun_loadmap_t* s_loadmap_ptr = NULL;
 static dso_info_t* s_dso_free_list = NULL;
 
 
+// An immutable array of the address ranges of currently mapped load
+// modules, sorted by start address.  A new index is built by every
+// hpcrun_loadmap_map()/unmap() and published with an atomic pointer
+// swap so that hpcrun_loadmap_findByAddr() can binary-search it
+// without a lock (e.g., from a signal handler).
+//
+// N.B.: A reader may still hold a replaced index; therefore replaced
+// indices are never freed.  Load maps change rarely relative to
+// lookups.
+
+typedef struct loadmap_addr_entry_t {
+  void* start_addr;
+  void* end_addr;
+  load_module_t* lm;
+} loadmap_addr_entry_t;
+
+typedef struct loadmap_addr_index_t {
+  int size;
+  loadmap_addr_entry_t entries[];
+} loadmap_addr_index_t;
+
+static _Atomic(loadmap_addr_index_t*) s_addr_index = ATOMIC_VAR_INIT(NULL);
+
+
 /* locking functions to ensure that loadmaps are consistent */
 static spinlock_t loadmap_lock = SPINLOCK_UNLOCKED;
 
@@ -289,27 +314,79 @@ hpcrun_loadmap_print(hpcrun_loadmap_t* loadmap)
 
 //***************************************************************************
 
+// Rebuilds and publishes the address index from the load map.
+// Writers are serialized by their callers (cf. FNBOUNDS_LOCK).
+static void
+hpcrun_loadmap_addrIndex_rebuild()
+{
+  int size = 0;
+  for (load_module_t* x = s_loadmap_ptr->lm_head; (x); x = x->next) {
+    if (x->dso_info) {
+      size++;
+    }
+  }
+
+  loadmap_addr_index_t* idx =
+    hpcrun_malloc(sizeof(loadmap_addr_index_t)
+		  + size * sizeof(loadmap_addr_entry_t));
+  if (idx == NULL) {
+    EMSG("loadmap address index: allocation failed!!");
+    atomic_store_explicit(&s_addr_index, NULL, memory_order_release);
+    return;
+  }
+
+  // insertion sort by start address: the load map is short and is
+  // mostly sorted already; avoids qsort() (which may malloc)
+  int n = 0;
+  for (load_module_t* x = s_loadmap_ptr->lm_head; (x); x = x->next) {
+    if (!x->dso_info) {
+      continue;
+    }
+    int i = n++;
+    for ( ; i > 0 && idx->entries[i - 1].start_addr > x->dso_info->start_addr;
+	  --i) {
+      idx->entries[i] = idx->entries[i - 1];
+    }
+    idx->entries[i].start_addr = x->dso_info->start_addr;
+    idx->entries[i].end_addr   = x->dso_info->end_addr;
+    idx->entries[i].lm         = x;
+  }
+  idx->size = n;
+
+  atomic_store_explicit(&s_addr_index, idx, memory_order_release);
+}
+
+
 load_module_t*
 hpcrun_loadmap_findByAddr(void* begin, void* end)
 {
   TMSG(LOADMAP, "find by address %p -- %p", begin, end);
-  for (load_module_t* x = s_loadmap_ptr->lm_head; (x); x = x->next) {
-    TMSG(LOADMAP, "\tload module %s", x->name);
-    if (x->dso_info) {
-      TMSG(LOADMAP, "\t\t [%lx, %lx) table [%lx, %lx)", 
-	   (uintptr_t) x->dso_info->start_addr,
-	   (uintptr_t) x->dso_info->end_addr,
-	   ((uintptr_t) x->dso_info->table ? ((uintptr_t) x->dso_info->table[0] + 
-				  x->dso_info->start_to_ref_dist) : -1),
-	   ((uintptr_t) x->dso_info->table ? ((uintptr_t) x->dso_info->table[x->dso_info->nsymbols -1] +
-				  x->dso_info->start_to_ref_dist) : -1)
-	   );
-      if (x->dso_info->start_addr <= begin && end <= x->dso_info->end_addr) {
-	TMSG(LOADMAP, "       --->%s", x->name);
-	return x;
-      }
+
+  loadmap_addr_index_t* idx =
+    atomic_load_explicit(&s_addr_index, memory_order_acquire);
+  if (idx == NULL) {
+    TMSG(LOADMAP, "       --->(NOT FOUND)");
+    return NULL;
+  }
+
+  // find the last entry with start_addr <= begin
+  int lo = 0, hi = idx->size; // [lo, hi)
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (idx->entries[mid].start_addr <= begin) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
     }
   }
+
+  if (lo > 0 && end <= idx->entries[lo - 1].end_addr) {
+    load_module_t* x = idx->entries[lo - 1].lm;
+    TMSG(LOADMAP, "       --->%s", x->name);
+    return x;
+  }
+
   TMSG(LOADMAP, "       --->(NOT FOUND)");
   return NULL;
 }
@@ -452,6 +529,8 @@ hpcrun_loadmap_map(dso_info_t* dso)
 
   }
 
+  hpcrun_loadmap_addrIndex_rebuild();
+
   hpcrun_loadmap_notify_map(lm);
 
   TMSG(LOADMAP, "hpcrun_loadmap_map: '%s' size=%d %s",
@@ -499,6 +578,8 @@ hpcrun_loadmap_unmap(load_module_t* lm)
           lm->name, old_dso->start_addr, old_dso->end_addr);
 #endif
 
+  hpcrun_loadmap_addrIndex_rebuild();
+
   hpcrun_loadmap_notify_unmap(lm);
 }
 
@@ -525,6 +606,8 @@ hpcrun_initLoadmap()
   s_loadmap_ptr = &s_loadmap;
   hpcrun_loadmap_init(s_loadmap_ptr);
 
+  atomic_store_explicit(&s_addr_index, NULL, memory_order_release);
+
   s_dso_free_list = NULL;
 }
 
@@ -193,7 +193,9 @@ extern void hpcrun_loadmap_print(hpcrun_loadmap_t* loadmap);
 // ---------------------------------------------------------
 
 // hpcrun_loadmap_findByAddr: Find the (currently mapped) load module
-//   that 'contains' the address range [begin, end]
+//   that 'contains' the address range [begin, end].  Lock-free:
+//   binary-searches a sorted address index published by
+//   hpcrun_loadmap_map() and hpcrun_loadmap_unmap().
 load_module_t*
 hpcrun_loadmap_findByAddr(void* begin, void* end);
 
@@ -85,6 +85,7 @@
 #include "env.h"
 #include "loadmap.h"
 #include "files.h"
+#include "rank.h"
 #include "fnbounds_interface.h"
 #include "fnbounds_table_interface.h"
 #include "hpcrun_dlfns.h"
@@ -123,6 +124,7 @@
 #include "write_data.h"
 #include "sample-sources/itimer.h"
 #include <utilities/token-iter.h>
+#include <utilities/hpcrun-nanotime.h>
 
 #include <memory/hpcrun-malloc.h>
 #include <memory/mmap.h>
@@ -498,6 +500,9 @@ hpcrun_init_internal(bool is_child)
   hpcrun_options__init(&opts);
   hpcrun_options__getopts(&opts);
 
+  // select the clock for trace records (and GPU activity timestamps)
+  hpcrun_nanotime_init(getenv(HPCRUN_TRACE_CLOCK));
+
   hpcrun_trace_init(); // this must go after thread initialization
   hpcrun_trace_open(&(TD_GET(core_profile_trace_data)));
 
@@ -739,6 +744,12 @@ hpcrun_fini_internal()
     // write all threads' profile data and close trace file
     hpcrun_threadMgr_data_fini(hpcrun_get_thread_data());
 
+    // with HPCRUN_PACK, the profiles and traces are all in now
+    if (hpcrun_files_packed()) {
+      int rank = hpcrun_get_rank();
+      hpcrun_close_pack_file((rank >= 0) ? rank : 0);
+    }
+
     fnbounds_fini();
     hpcrun_stats_print_summary();
     messages_fini();
@@ -856,6 +867,9 @@ hpcrun_thread_fini(epoch_t *epoch)
   thread_data_t* td = hpcrun_get_thread_data();
   hpcrun_threadMgr_data_put(epoch, td, add_separator);
 
+  // this thread creates no more cct nodes
+  hpcrun_cct_release_slab();
+
   TMSG(PROCESS, "End of thread");
 }
 
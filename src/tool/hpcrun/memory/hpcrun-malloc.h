@@ -90,6 +90,7 @@ void* hpcrun_malloc_safe(size_t size);
 
 void hpcrun_memory_reinit(void);
 void hpcrun_reclaim_freeable_mem(void);
+long hpcrun_num_reclaims(void);
 void hpcrun_memory_summary(void);
 
 #if defined(__cplusplus)
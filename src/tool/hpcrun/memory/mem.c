@@ -268,6 +268,14 @@ hpcrun_reclaim_freeable_mem(void)
   TMSG(MALLOC, "%s: %d", __func__, num_reclaims);
 }
 
+// Returns: the number of reclaims so far.  CCT nodes from before a
+// reclaim may have been overwritten.
+long
+hpcrun_num_reclaims(void)
+{
+  return num_reclaims;
+}
+
 //
 // Returns: address of non-freeable region at the high end,
 // else NULL on failure.
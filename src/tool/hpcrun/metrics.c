@@ -108,6 +108,7 @@ static metric_desc_list_t* pre_alloc = NULL;
 
 struct kind_info_t {
   int idx;     // current index in kind
+  int kind_idx; // index of kind in the metric data lists
   bool has_set_max;
   kind_info_t* link; // all kinds linked together in singly linked list
   // metric_tbl serves 2 purposes:
@@ -124,6 +125,7 @@ struct kind_info_t {
 
 static kind_info_t *first_kind = NULL;
 static kind_info_t **next_kind = &first_kind;
+static int num_kinds = 0;
 typedef enum { KIND_UNINITIALIZED, KIND_INITIALIZING, KIND_INITIALIZED } kind_state_t;
 static _Atomic(kind_state_t) kind_state = ATOMIC_VAR_INIT(KIND_UNINITIALIZED);
 static int num_kind_metrics;
@@ -138,16 +140,24 @@ kind_info_t*
 hpcrun_metrics_new_kind(void)
 {
   kind_info_t* rv = (kind_info_t*) hpcrun_malloc(sizeof(kind_info_t));
-  *rv = (kind_info_t) {.idx = 0, .metric_data = NULL, .has_set_max = 0, .link = NULL};
+  *rv = (kind_info_t) {.idx = 0, .kind_idx = num_kinds++, .metric_data = NULL,
+		       .has_set_max = 0, .link = NULL};
   *next_kind = rv;
   next_kind = &rv->link;
   return rv;
 }
 
+// The metrics of one cct node: one dense metric set per kind, indexed
+// by the kind's kind_idx, or NULL until the node gets a metric of that
+// kind.  A sample reaches its slot in constant time.  Some kinds are
+// created lazily (ompt, gpu) after lists already hang off cct nodes;
+// a list covers kinds [base, base + num_kinds) and chains an extension
+// list for any kind created after it was allocated.
 typedef struct metric_data_list_t {
-  struct metric_data_list_t* next;
-  kind_info_t *kind;
-  metric_set_t *metrics;
+  int base;
+  int num_kinds;
+  struct metric_data_list_t *more;
+  metric_set_t *kinds[];
 } metric_data_list_t;
 
 
@@ -432,22 +442,73 @@ hpcrun_set_new_metric_info(kind_info_t *kind, const char* name)
 }
 
 
+static metric_set_t *
+metric_set_new(kind_info_t *kind, void *(*alloc)(size_t))
+{
+  int n_metrics = hpcrun_get_num_metrics(kind);
+  metric_set_t *metrics = alloc(n_metrics * sizeof(hpcrun_metricVal_t));
+  memset(metrics, 0, n_metrics * sizeof(hpcrun_metricVal_t));
+  return metrics;
+}
+
+
+static metric_data_list_t *
+metric_data_list_new_from(int base, void *(*alloc)(size_t))
+{
+  int n = num_kinds - base;
+  size_t size = sizeof(metric_data_list_t) + n * sizeof(metric_set_t *);
+  metric_data_list_t *list = alloc(size);
+  memset(list, 0, size);
+  list->base = base;
+  list->num_kinds = n;
+  return list;
+}
+
+
+static metric_data_list_t *
+metric_data_list_new(void *(*alloc)(size_t))
+{
+  hpcrun_get_num_kind_metrics();
+  return metric_data_list_new_from(0, alloc);
+}
+
+
+//
+// return the slot of kind's metric set in list, chaining an extension
+// list for a kind newer than the list.  With alloc == NULL nothing is
+// allocated and NULL is returned if the kind is not covered.
+//
+static metric_set_t **
+metric_data_list_slot(metric_data_list_t *list, kind_info_t *kind,
+		      void *(*alloc)(size_t))
+{
+  int k = kind->kind_idx;
+  while (k >= list->base + list->num_kinds) {
+    if (list->more == NULL) {
+      if (alloc == NULL) {
+        return NULL;
+      }
+      list->more = metric_data_list_new_from(list->base + list->num_kinds, alloc);
+    }
+    list = list->more;
+  }
+  return &list->kinds[k - list->base];
+}
+
+
 //
 // return an lvalue from metric_set_t*
 //
 cct_metric_data_t*
 hpcrun_metric_set_loc(metric_data_list_t *rv, int id)
 {
-  metric_data_list_t *curr;
-  for (curr = rv; curr != NULL && curr->kind != metric_data[id].kind;
-    rv = curr, curr = curr->next);
-  if (curr == NULL) {
-    curr = hpcrun_new_metric_data_list(id);
-    rv->next = curr;
+  kind_info_t *kind = metric_data[id].kind;
+  metric_set_t **metrics = metric_data_list_slot(rv, kind, hpcrun_malloc);
+  if (*metrics == NULL) {
+    *metrics = metric_set_new(kind, hpcrun_malloc);
   }
-  rv = curr;
 
-  return &(rv->metrics->v1) + metric_data[id].id;
+  return &((*metrics)->v1) + metric_data[id].id;
 }
 
 
@@ -500,32 +561,17 @@ hpcrun_metric_std_inc(int metric_id, metric_data_list_t* set,
 metric_data_list_t *
 hpcrun_new_metric_data_list(int metric_id)
 {
-  metric_data_list_t *curr = hpcrun_malloc(sizeof(metric_data_list_t));
-  hpcrun_get_num_kind_metrics();
-  curr->kind = metric_data[metric_id].kind;
-  int n_metrics = hpcrun_get_num_metrics(curr->kind);
-  curr->metrics = hpcrun_malloc(n_metrics * sizeof(hpcrun_metricVal_t));
-  // FIXME(Keren): duplicate?
-  for (int i = 0; i < n_metrics; i++)
-    curr->metrics[i].v1 = curr->kind->null_metrics[i];
-  memset(curr->metrics, 0, n_metrics * sizeof(hpcrun_metricVal_t));
-  curr->next = NULL;
+  metric_data_list_t *curr = metric_data_list_new(hpcrun_malloc);
+  kind_info_t *kind = metric_data[metric_id].kind;
+  curr->kinds[kind->kind_idx] = metric_set_new(kind, hpcrun_malloc);
   return curr;
 }
 
 metric_data_list_t *
 hpcrun_new_metric_data_list_kind(kind_info_t *kind)
 {
-  metric_data_list_t *curr = hpcrun_malloc(sizeof(metric_data_list_t));
-  hpcrun_get_num_kind_metrics();
-  curr->kind = kind;
-  int n_metrics = hpcrun_get_num_metrics(curr->kind);
-  curr->metrics = hpcrun_malloc(n_metrics * sizeof(hpcrun_metricVal_t));
-  // FIXME(Keren): duplicate?
-  for (int i = 0; i < n_metrics; i++)
-    curr->metrics[i].v1 = curr->kind->null_metrics[i];
-  memset(curr->metrics, 0, n_metrics * sizeof(hpcrun_metricVal_t));
-  curr->next = NULL;
+  metric_data_list_t *curr = metric_data_list_new(hpcrun_malloc);
+  curr->kinds[kind->kind_idx] = metric_set_new(kind, hpcrun_malloc);
   return curr;
 }
 
@@ -533,16 +579,8 @@ hpcrun_new_metric_data_list_kind(kind_info_t *kind)
 metric_data_list_t *
 hpcrun_new_metric_data_list_kind_final(kind_info_t *kind)
 {
-  metric_data_list_t *curr = malloc(sizeof(metric_data_list_t));
-  hpcrun_get_num_kind_metrics();
-  curr->kind = kind;
-  int n_metrics = hpcrun_get_num_metrics(curr->kind);
-  curr->metrics = malloc(n_metrics * sizeof(hpcrun_metricVal_t));
-  // FIXME(Keren): duplicate?
-  for (int i = 0; i < n_metrics; i++)
-    curr->metrics[i].v1 = curr->kind->null_metrics[i];
-  memset(curr->metrics, 0, n_metrics * sizeof(hpcrun_metricVal_t));
-  curr->next = NULL;
+  metric_data_list_t *curr = metric_data_list_new(malloc);
+  curr->kinds[kind->kind_idx] = metric_set_new(kind, malloc);
   return curr;
 }
 
@@ -555,11 +593,13 @@ hpcrun_metric_set_dense_copy(cct_metric_data_t* dest,
 			     int num_metrics)
 {
   kind_info_t *curr_k;
-  metric_data_list_t *curr;
 
   for (curr_k = first_kind; curr_k != NULL; curr_k = curr_k->link) {
-    for (curr = list; curr != NULL && curr->kind != curr_k; curr = curr->next);
-    metric_set_t* actual = curr ? curr->metrics : (metric_set_t*) curr_k->null_metrics;
+    metric_set_t** slot = list ? metric_data_list_slot(list, curr_k, NULL) : NULL;
+    metric_set_t* actual = slot ? *slot : NULL;
+    if (actual == NULL) {
+      actual = (metric_set_t*) curr_k->null_metrics;
+    }
     memcpy((char*) dest, (char*) actual, curr_k->idx * sizeof(cct_metric_data_t));
     dest += curr_k->idx;
   }
@@ -572,21 +612,20 @@ hpcrun_metric_set_dense_copy(cct_metric_data_t* dest,
 metric_data_list_t *
 hpcrun_merge_cct_metrics(metric_data_list_t *dest_list, metric_data_list_t *source_list)
 {
-  metric_data_list_t *curr_source = NULL;
-  metric_data_list_t *curr_dest = NULL;
-
-  for (curr_source = source_list; curr_source != NULL; curr_source = curr_source->next) {
-    metric_data_list_t *rv = dest_list;
-    for (curr_dest = rv; curr_dest != NULL && curr_dest->kind != curr_source->kind;
-      rv = curr_dest, curr_dest = curr_dest->next);
-    // Allocate a new metric_data_list
-    if (curr_dest == NULL) {
-      curr_dest = hpcrun_new_metric_data_list_kind_final(curr_source->kind);
-      rv->next = curr_dest;
+  for (kind_info_t *kind = first_kind; kind != NULL; kind = kind->link) {
+    metric_set_t **slot = metric_data_list_slot(source_list, kind, NULL);
+    metric_set_t *source = slot ? *slot : NULL;
+    if (source == NULL) {
+      continue;
+    }
+    // Allocate a new metric set
+    metric_set_t **dest = metric_data_list_slot(dest_list, kind, malloc);
+    if (*dest == NULL) {
+      *dest = metric_set_new(kind, malloc);
     }
-    int n_metrics = hpcrun_get_num_metrics(curr_source->kind);
+    int n_metrics = hpcrun_get_num_metrics(kind);
     for (int i = 0; i < n_metrics; i++)
-      curr_dest->metrics[i].v1.i += curr_source->metrics[i].v1.i;
+      (*dest)[i].v1.i += source[i].v1.i;
   }
 
   return dest_list;
@@ -62,11 +62,6 @@
 //
 // TODO list:
 //
-// 2. In the second sample (after the real function), want to record
-// the sample without doing a full unwind (which is the same path as
-// the first sample).  This may require a little refactoring in the
-// sample event code.
-//
 // 3. When taking the user context, replace the syscall with the
 // assembler macros.  This may require a little refactoring of the
 // macros so that get context is just one line, not a #ifdef sequence.
@@ -152,6 +147,7 @@ ssize_t
 MONITOR_EXT_WRAP_NAME(read)(int fd, void *buf, size_t count)
 {
   ucontext_t uc;
+  sample_val_t smpl;
   ssize_t ret;
   int metric_id_read = hpcrun_metric_id_read();
   int save_errno;
@@ -163,7 +159,7 @@ MONITOR_EXT_WRAP_NAME(read)(int fd, void *buf, size_t count)
   // insert samples before and after the slow functions to make the
   // traces look better.
   getcontext(&uc);
-  hpcrun_sample_callpath(&uc, metric_id_read, 
+  smpl = hpcrun_sample_callpath(&uc, metric_id_read, 
         (hpcrun_metricVal_t) {.i=0}, 
         0, 1, NULL);
 
@@ -172,12 +168,11 @@ MONITOR_EXT_WRAP_NAME(read)(int fd, void *buf, size_t count)
   save_errno = errno;
   hpcrun_safe_enter();
 
-  // FIXME: the second sample should not do a full unwind.
   TMSG(IO, "read: fd: %d, buf: %p, count: %ld, actual: %ld",
        fd, buf, count, ret);
-  hpcrun_sample_callpath(&uc, metric_id_read, 
+  hpcrun_sample_callpath_again(&smpl, &uc, metric_id_read, 
         (hpcrun_metricVal_t) {.i=(ret > 0 ? ret : 0)}, 
-        0, 1, NULL);
+        0, 1);
   hpcrun_safe_exit();
 
   errno = save_errno;
@@ -189,6 +184,7 @@ ssize_t
 MONITOR_EXT_WRAP_NAME(write)(int fd, const void *buf, size_t count)
 {
   ucontext_t uc;
+  sample_val_t smpl;
   size_t ret;
   int metric_id_write = hpcrun_metric_id_write();
   int save_errno;
@@ -200,7 +196,7 @@ MONITOR_EXT_WRAP_NAME(write)(int fd, const void *buf, size_t count)
   // insert samples before and after the slow functions to make the
   // traces look better.
   getcontext(&uc);
-  hpcrun_sample_callpath(&uc, metric_id_write, 
+  smpl = hpcrun_sample_callpath(&uc, metric_id_write, 
             (hpcrun_metricVal_t) {.i=0}, 
             0, 1, NULL);
 
@@ -209,12 +205,11 @@ MONITOR_EXT_WRAP_NAME(write)(int fd, const void *buf, size_t count)
   save_errno = errno;
   hpcrun_safe_enter();
 
-  // FIXME: the second sample should not do a full unwind.
   TMSG(IO, "write: fd: %d, buf: %p, count: %ld, actual: %ld",
        fd, buf, count, ret);
-  hpcrun_sample_callpath(&uc, metric_id_write, 
+  hpcrun_sample_callpath_again(&smpl, &uc, metric_id_write, 
         (hpcrun_metricVal_t) {.i=(ret > 0 ? ret : 0)}, 
-        0, 1, NULL);
+        0, 1);
   hpcrun_safe_exit();
 
   errno = save_errno;
@@ -226,6 +221,7 @@ size_t
 MONITOR_EXT_WRAP_NAME(fread)(void *ptr, size_t size, size_t count, FILE *stream)
 {
   ucontext_t uc;
+  sample_val_t smpl;
   size_t ret;
   int metric_id_read = hpcrun_metric_id_read();
 
@@ -237,7 +233,7 @@ MONITOR_EXT_WRAP_NAME(fread)(void *ptr, size_t size, size_t count, FILE *stream)
   // traces look better.
 
   getcontext(&uc);
-  hpcrun_sample_callpath(&uc, metric_id_read, 
+  smpl = hpcrun_sample_callpath(&uc, metric_id_read, 
             (hpcrun_metricVal_t) {.i=0}, 
             0, 1, NULL);
 
@@ -245,12 +241,11 @@ MONITOR_EXT_WRAP_NAME(fread)(void *ptr, size_t size, size_t count, FILE *stream)
   ret = real_fread(ptr, size, count, stream);
   hpcrun_safe_enter();
 
-  // FIXME: the second sample should not do a full unwind.
   TMSG(IO, "fread: size: %ld, count: %ld, bytes: %ld, actual: %ld",
        size, count, count*size, ret*size);
-  hpcrun_sample_callpath(&uc, metric_id_read, 
+  hpcrun_sample_callpath_again(&smpl, &uc, metric_id_read, 
             (hpcrun_metricVal_t) {.i=ret*size}, 
-            0, 1, NULL);
+            0, 1);
   hpcrun_safe_exit();
 
   return ret;
@@ -262,6 +257,7 @@ MONITOR_EXT_WRAP_NAME(fwrite)(const void *ptr, size_t size, size_t count,
 			      FILE *stream)
 {
   ucontext_t uc;
+  sample_val_t smpl;
   size_t ret;
   int metric_id_write = hpcrun_metric_id_write();
 
@@ -272,7 +268,7 @@ MONITOR_EXT_WRAP_NAME(fwrite)(const void *ptr, size_t size, size_t count,
   // insert samples before and after the slow functions to make the
   // traces look better.
   getcontext(&uc);
-  hpcrun_sample_callpath(&uc, metric_id_write, 
+  smpl = hpcrun_sample_callpath(&uc, metric_id_write, 
             (hpcrun_metricVal_t) {.i=0}, 
             0, 1, NULL);
 
@@ -280,12 +276,11 @@ MONITOR_EXT_WRAP_NAME(fwrite)(const void *ptr, size_t size, size_t count,
   ret = real_fwrite(ptr, size, count, stream);
   hpcrun_safe_enter();
 
-  // FIXME: the second sample should not do a full unwind.
   TMSG(IO, "fwrite: size: %ld, count: %ld, bytes: %ld, actual: %ld",
        size, count, count*size, ret*size);
-  hpcrun_sample_callpath(&uc, metric_id_write, 
+  hpcrun_sample_callpath_again(&smpl, &uc, metric_id_write, 
             (hpcrun_metricVal_t) {.i=ret*size}, 
-            0, 1, NULL);
+            0, 1);
   hpcrun_safe_exit();
 
   return ret;
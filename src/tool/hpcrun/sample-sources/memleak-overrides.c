@@ -88,6 +88,8 @@
  * local include files
  *****************************************************************************/
 
+#include <include/gcc-attr.h>
+
 #include <sample-sources/memleak.h>
 #include <messages/messages.h>
 #include <safe-sampling.h>
@@ -123,6 +125,13 @@ typedef struct leakinfo_s {
 
 leakinfo_t leakinfo_NULL = { .magic = 0, .context = NULL, .bytes = 0 };
 
+// One shard of the footer table: a splay tree and its lock, on a cache
+// line of its own.
+typedef struct memleak_shard_s {
+  spinlock_t lock;
+  struct leakinfo_s *root;
+} GCC_ATTR_VAR_CACHE_ALIGN memleak_shard_t;
+
 typedef void *memalign_fcn(size_t, size_t);
 typedef void *valloc_fcn(size_t);
 typedef void *malloc_fcn(size_t);
@@ -140,6 +149,11 @@ typedef void *realloc_fcn(void *, size_t);
 #define MEMLEAK_MAGIC 0x68706374
 #define MEMLEAK_DEFAULT_PAGESIZE  4096
 
+// The blocks with a footer are kept in a table keyed by address, split
+// into shards by a hash of the address.
+#define MEMLEAK_SHARDS_LOG  8
+#define MEMLEAK_SHARDS  (1 << MEMLEAK_SHARDS_LOG)
+
 #define HPCRUN_MEMLEAK_PROB  "HPCRUN_MEMLEAK_PROB"
 #define DEFAULT_PROB  0.1
 
@@ -174,8 +188,13 @@ static int leak_detection_init = 0;    // default is uninitialized
 static int use_memleak_prob = 0;
 static float memleak_prob = 0.0;
 
-static struct leakinfo_s *memleak_tree_root = NULL;
-static spinlock_t memtree_lock = SPINLOCK_UNLOCKED;
+// Every thread that mallocs or frees a block with a footer goes
+// through this table, so one tree with one lock serializes all of
+// them.  With the shards, threads working on unrelated blocks rarely
+// share a lock or dirty the same cache lines by splaying.
+static memleak_shard_t memleak_shards[MEMLEAK_SHARDS] = {
+  [0 ... MEMLEAK_SHARDS - 1] = { .lock = SPINLOCK_UNLOCKED, .root = NULL }
+};
 
 static int leakinfo_size = sizeof(struct leakinfo_s);
 static long memleak_pagesize = MEMLEAK_DEFAULT_PAGESIZE;
@@ -197,6 +216,18 @@ static char *loc_name[4] = {
  *****************************************************************************/
 
 
+// Multiplicative hash of the block address.  The low bits are dropped
+// because malloc aligns blocks to at least 16 bytes.
+static inline memleak_shard_t *
+memleak_shard(void *memblock)
+{
+  uint64_t key = ((uintptr_t) memblock) >> 4;
+
+  return &memleak_shards[(key * 0x9E3779B97F4A7C15ULL)
+			 >> (64 - MEMLEAK_SHARDS_LOG)];
+}
+
+
 static struct leakinfo_s *
 splay(struct leakinfo_s *root, void *key)
 {
@@ -209,29 +240,30 @@ static void
 splay_insert(struct leakinfo_s *node)
 {
   void *memblock = node->memblock;
+  memleak_shard_t *shard = memleak_shard(memblock);
 
   node->left = node->right = NULL;
 
-  spinlock_lock(&memtree_lock);  
-  if (memleak_tree_root != NULL) {
-    memleak_tree_root = splay(memleak_tree_root, memblock);
-
-    if (memblock < memleak_tree_root->memblock) {
-      node->left = memleak_tree_root->left;
-      node->right = memleak_tree_root;
-      memleak_tree_root->left = NULL;
-    } else if (memblock > memleak_tree_root->memblock) {
-      node->left = memleak_tree_root;
-      node->right = memleak_tree_root->right;
-      memleak_tree_root->right = NULL;
+  spinlock_lock(&shard->lock);
+  if (shard->root != NULL) {
+    shard->root = splay(shard->root, memblock);
+
+    if (memblock < shard->root->memblock) {
+      node->left = shard->root->left;
+      node->right = shard->root;
+      shard->root->left = NULL;
+    } else if (memblock > shard->root->memblock) {
+      node->left = shard->root;
+      node->right = shard->root->right;
+      shard->root->right = NULL;
     } else {
       TMSG(MEMLEAK, "memleak splay tree: unable to insert %p (already present)", 
 	   node->memblock);
       assert(0);
     }
   }
-  memleak_tree_root = node;
-  spinlock_unlock(&memtree_lock);  
+  shard->root = node;
+  spinlock_unlock(&shard->lock);
 }
 
 
@@ -239,34 +271,35 @@ static struct leakinfo_s *
 splay_delete(void *memblock)
 {
   struct leakinfo_s *result = NULL;
+  memleak_shard_t *shard = memleak_shard(memblock);
 
-  spinlock_lock(&memtree_lock);  
-  if (memleak_tree_root == NULL) {
-    spinlock_unlock(&memtree_lock);  
+  spinlock_lock(&shard->lock);
+  if (shard->root == NULL) {
+    spinlock_unlock(&shard->lock);
     TMSG(MEMLEAK, "memleak splay tree empty: unable to delete %p", memblock);
     return NULL;
   }
 
-  memleak_tree_root = splay(memleak_tree_root, memblock);
+  shard->root = splay(shard->root, memblock);
 
-  if (memblock != memleak_tree_root->memblock) {
-    spinlock_unlock(&memtree_lock);  
+  if (memblock != shard->root->memblock) {
+    spinlock_unlock(&shard->lock);
     TMSG(MEMLEAK, "memleak splay tree: %p not in tree", memblock);
     return NULL;
   }
 
-  result = memleak_tree_root;
+  result = shard->root;
 
-  if (memleak_tree_root->left == NULL) {
-    memleak_tree_root = memleak_tree_root->right;
-    spinlock_unlock(&memtree_lock);  
+  if (shard->root->left == NULL) {
+    shard->root = shard->root->right;
+    spinlock_unlock(&shard->lock);
     return result;
   }
 
-  memleak_tree_root->left = splay(memleak_tree_root->left, memblock);
-  memleak_tree_root->left->right = memleak_tree_root->right;
-  memleak_tree_root =  memleak_tree_root->left;
-  spinlock_unlock(&memtree_lock);  
+  shard->root->left = splay(shard->root->left, memblock);
+  shard->root->left->right = shard->root->right;
+  shard->root = shard->root->left;
+  spinlock_unlock(&shard->lock);
   return result;
 }
 
@@ -856,3 +889,124 @@ finish:
   }
   return appl_ptr;
 }
+
+
+/******************************************************************************
+ * unit test
+ *****************************************************************************/
+
+// Stress test of the footer table: N threads malloc and free through
+// the overrides, with stubs for the rest of hpcrun.  All blocks get a
+// footer (as with MEMLEAK_NO_HEADER), so every malloc and free goes
+// through the table.  Build the dynamic version and run:
+//
+//   memleak-stress [threads] [ops per thread]
+
+#define UNIT_TEST 0
+
+#if UNIT_TEST
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+#define STRESS_LIVE_BLOCKS  1024
+
+static __thread thread_data_t stress_td;
+static int stress_init = 0;
+
+static thread_data_t *stress_get_td(void) { return &stress_td; }
+static bool stress_td_avail(void) { return true; }
+
+thread_data_t *(*hpcrun_get_thread_data)(void) = stress_get_td;
+bool (*hpcrun_td_avail)(void) = stress_td_avail;
+
+bool hpcrun_is_initialized() { return stress_init; }
+int  debug_flag_get(dbg_category flag) { return flag == DBG_PREFIX(MEMLEAK_NO_HEADER); }
+void hpcrun_pmsg(const char *tag, const char *fmt, ...) { }
+void hpcrun_amsg(const char *fmt, ...) { }
+int  hpcrun_memleak_alloc_id() { return 0; }
+int  hpcrun_memleak_active() { return 1; }
+void hpcrun_free_inc(cct_node_t *node, int incr) { }
+
+sample_val_t
+hpcrun_sample_callpath(void *context, int metricId,
+		       hpcrun_metricVal_t metricIncr,
+		       int skipInner, int isSync, sampling_info_t *data)
+{
+  sample_val_t ret;
+  hpcrun_sample_val_init(&ret);
+  ret.sample_node = (cct_node_t *) context;
+  return ret;
+}
+
+static long
+stress_count(struct leakinfo_s *node)
+{
+  return (node == NULL) ? 0
+    : 1 + stress_count(node->left) + stress_count(node->right);
+}
+
+static long
+stress_blocks(void)
+{
+  long num = 0;
+  for (int i = 0; i < MEMLEAK_SHARDS; i++) {
+    num += stress_count(memleak_shards[i].root);
+  }
+  return num;
+}
+
+static void *
+stress_thread(void *arg)
+{
+  long ops = *(long *) arg;
+  void *live[STRESS_LIVE_BLOCKS] = { NULL };
+  unsigned int seed = (unsigned int) (uintptr_t) live;
+
+  for (long i = 0; i < ops; i++) {
+    int k = rand_r(&seed) % STRESS_LIVE_BLOCKS;
+    if (live[k] != NULL) {
+      free(live[k]);
+    }
+    live[k] = malloc(16 + rand_r(&seed) % 240);
+  }
+  for (int k = 0; k < STRESS_LIVE_BLOCKS; k++) {
+    free(live[k]);
+  }
+  return NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+  int nthreads = (argc > 1) ? atoi(argv[1]) : 8;
+  long ops = (argc > 2) ? atol(argv[2]) : 1000000;
+  pthread_t thr[nthreads];
+  struct timespec beg, end;
+
+  memleak_initialize();
+  stress_init = 1;
+  printf("memleak stress test\n");
+  long blocks = stress_blocks();
+
+  clock_gettime(CLOCK_MONOTONIC, &beg);
+  for (int i = 0; i < nthreads; i++) {
+    pthread_create(&thr[i], NULL, stress_thread, &ops);
+  }
+  for (int i = 0; i < nthreads; i++) {
+    pthread_join(thr[i], NULL);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double sec = (end.tv_sec - beg.tv_sec) + (end.tv_nsec - beg.tv_nsec) / 1e9;
+  printf("threads: %d  ops: %ld  time: %.3f sec  %.1f Mops/sec\n",
+	 nthreads, nthreads * ops, sec, nthreads * ops / sec / 1e6);
+
+  // the threads' stacks and TLS are kept for reuse
+  long left = stress_blocks() - blocks;
+  printf("%s: %ld blocks left\n", (left <= 2 * nthreads) ? "PASS" : "FAIL", left);
+  return 0;
+}
+
+#endif
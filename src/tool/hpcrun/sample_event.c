@@ -245,6 +245,8 @@ hpcrun_sample_callpath(void* context, int metricId,
   // --------------------------------------
 
   ret.sample_node = node;
+  ret.epoch = td->core_profile_trace_data.epoch;
+  ret.reclaims = hpcrun_num_reclaims();
 
   cct_addr_t *addr = hpcrun_cct_addr(node);
   ip_normalized_t leaf_ip = addr->ip_norm;
@@ -304,6 +306,71 @@ hpcrun_sample_callpath(void* context, int metricId,
   return ret;
 }
 
+sample_val_t
+hpcrun_sample_callpath_again(sample_val_t* prev, void* context, int metricId,
+			     hpcrun_metricVal_t metricIncr,
+			     int skipInner, int isSync)
+{
+  thread_data_t* td = hpcrun_get_thread_data();
+
+  // the nodes are gone if the epochs were flushed and the memory
+  // reclaimed in the meantime
+  if (prev->sample_node == NULL
+      || prev->epoch != td->core_profile_trace_data.epoch
+      || prev->reclaims != hpcrun_num_reclaims()) {
+    return hpcrun_sample_callpath(context, metricId, metricIncr,
+				  skipInner, isSync, NULL);
+  }
+
+  sample_val_t ret = *prev;
+
+  if (monitor_block_shootdown()) {
+    monitor_unblock_shootdown();
+    return ret;
+  }
+
+  if (! hpctoolkit_sampling_is_active()) {
+    return ret;
+  }
+
+  hpcrun_stats_num_samples_total_inc();
+
+  if (hpcrun_is_sampling_disabled()) {
+    TMSG(SAMPLE,"global suspension");
+    hpcrun_all_sources_stop();
+    monitor_unblock_shootdown();
+    return ret;
+  }
+
+  TMSG(SAMPLE_CALLPATH, "attempting sample at previous call path");
+  hpcrun_stats_num_samples_attempted_inc();
+
+  hpcrun_set_handling_sample(td);
+
+  // same metric update as hpcrun_cct_insert_backtrace_w_metric()
+  metric_data_list_t* mset = hpcrun_reify_metric_set(ret.sample_node, metricId);
+  metric_upd_proc_t* upd_proc = hpcrun_get_metric_proc(metricId);
+  if (upd_proc) {
+    upd_proc(metricId, mset, (cct_metric_data_t) metricIncr);
+  }
+
+  if (ret.trace_node != NULL && hpcrun_trace_isactive() && !isSync) {
+    hpcrun_trace_append(&td->core_profile_trace_data, ret.trace_node,
+			metricId, td->prev_dLCA);
+  }
+
+  hpcrun_clear_handling_sample(td);
+  if (TD_GET(mem_low) || ENABLED(FLUSH_EVERY_SAMPLE)) {
+    hpcrun_flush_epochs(&(TD_GET(core_profile_trace_data)));
+    hpcrun_reclaim_freeable_mem();
+  }
+
+  TMSG(SAMPLE_CALLPATH,"done w sample, return %p", ret.sample_node);
+  monitor_unblock_shootdown();
+
+  return ret;
+}
+
 static int const PTHREAD_CTXT_SKIP_INNER = 1;
 
 cct_node_t*
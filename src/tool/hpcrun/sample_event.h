@@ -93,6 +93,8 @@ extern void hpcrun_drop_sample(void);
 typedef struct sample_val_s {
   cct_node_t* sample_node; // CCT leaf representing innermost call path frame
   cct_node_t* trace_node;  // CCT leaf representing trace record
+  epoch_t* epoch;          // epoch and reclaim count when the nodes were
+  long reclaims;           //   taken, to tell if they are still valid
 } sample_val_t;
 
 
@@ -102,6 +104,8 @@ hpcrun_sample_val_init(sample_val_t* x)
   //memset(x, 0, sizeof(*x));
   x->sample_node = 0;
   x->trace_node = 0;
+  x->epoch = 0;
+  x->reclaims = 0;
 }
 
 
@@ -109,6 +113,17 @@ extern sample_val_t hpcrun_sample_callpath(void *context, int metricId,
 		                   hpcrun_metricVal_t metricIncr,
 				   int skipInner, int isSync, sampling_info_t *data);
 
+// Take another sample at the call path of 'prev', a sample from
+// hpcrun_sample_callpath() in the same thread, without unwinding: add
+// 'metricIncr' to its leaf and, if tracing, trace its leaf again.  If
+// the CCT has been flushed since 'prev', fall back to a full sample
+// with 'context'.  For overrides that sample before and after the
+// real function.
+extern sample_val_t hpcrun_sample_callpath_again(sample_val_t* prev,
+                                   void *context, int metricId,
+		                   hpcrun_metricVal_t metricIncr,
+				   int skipInner, int isSync);
+
 extern cct_node_t* hpcrun_gen_thread_ctxt(void *context);
 
 extern cct_node_t* hpcrun_sample_callpath_w_bt(void *context,
@@ -243,6 +243,8 @@ core_profile_trace_data_init(core_profile_trace_data_t * cptd, int id, cct_ctxt_
   cptd->hpcrun_file  = NULL;
   cptd->trace_buffer = NULL;
   cptd->trace_outbuf = NULL;
+  cptd->trace_member = NULL;
+  cptd->trace_block  = NULL;
 
   // ----------------------------------------
   // perf event support
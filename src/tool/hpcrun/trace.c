@@ -50,8 +50,12 @@
 
 #include <stdio.h>
 #include <sys/time.h>
+#include <sys/syscall.h>
 #include <assert.h>
 #include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <linux/futex.h>
 
 
 //*********************************************************************
@@ -77,12 +81,26 @@
 #include <lib/prof-lean/hpcrun-fmt.h>
 #include <lib/prof-lean/hpcio.h>
 #include <lib/prof-lean/hpcio-buffer.h>
+#include <lib/prof-lean/stdatomic.h>
+
+#include <utilities/hpcrun-nanotime.h>
+
+
+//*********************************************************************
+// macros
+//*********************************************************************
+
+// how long the trace writer sleeps when nobody wakes it
+#define TRACE_WRITER_POLL_NS (100 * 1000 * 1000)
+
 
 
 //*********************************************************************
 // type declarations
 //*********************************************************************
 
+typedef void *(*pthread_start_routine_t)(void *);
+
 
 
 //*********************************************************************
@@ -90,6 +108,7 @@
 //*********************************************************************
 
 static void hpcrun_trace_file_validate(int valid, char *op);
+static void hpcrun_trace_writer_start(void);
 static inline void hpcrun_trace_append_with_time_real(core_profile_trace_data_t *cptd, unsigned int call_path_id, uint metric_id, uint32_t dLCA, uint64_t nanotime);
 
 
@@ -99,6 +118,12 @@ static inline void hpcrun_trace_append_with_time_real(core_profile_trace_data_t
 
 static int tracing = 0;
 
+static int trace_outbuf_flags = HPCIO_OUTBUF_UNLOCKED;
+
+// bumped for every trace buffer handed to the writer; the writer
+// sleeps on it with futex()
+static _Atomic(int) trace_writer_wakeups;
+
 //*********************************************************************
 // interface operations
 //*********************************************************************
@@ -116,6 +141,10 @@ hpcrun_trace_init()
   if (getenv(HPCRUN_TRACE)) {
       tracing = 1;
       TMSG(TRACE, "Tracing is ON");
+
+      if (getenv(HPCRUN_TRACE_ASYNC)) {
+	hpcrun_trace_writer_start();
+      }
   }
 }
 
@@ -139,12 +168,21 @@ hpcrun_trace_open(core_profile_trace_data_t * cptd)
     // I think unlocked is ok here (we don't overlap any system
     // locks).  At any rate, locks only protect against threads, they
     // don't help with signal handlers (that's much harder).
-    fd = hpcrun_open_trace_file(cptd->id);
-    hpcrun_trace_file_validate(fd >= 0, "open");
     cptd->trace_buffer = hpcrun_malloc(HPCRUN_TraceBufferSz);
-    ret = hpcio_outbuf_attach(&cptd->trace_outbuf, fd, cptd->trace_buffer,
-			      HPCRUN_TraceBufferSz, HPCIO_OUTBUF_UNLOCKED,
-                              hpcrun_malloc);
+    if (hpcrun_files_packed()) {
+      cptd->trace_member = hpcrun_open_trace_member(cptd->id);
+      ret = hpcio_outbuf_attach_member(&cptd->trace_outbuf,
+				       cptd->trace_member, cptd->trace_buffer,
+				       HPCRUN_TraceBufferSz, trace_outbuf_flags,
+				       hpcrun_malloc);
+    }
+    else {
+      fd = hpcrun_open_trace_file(cptd->id);
+      hpcrun_trace_file_validate(fd >= 0, "open");
+      ret = hpcio_outbuf_attach(&cptd->trace_outbuf, fd, cptd->trace_buffer,
+				HPCRUN_TraceBufferSz, trace_outbuf_flags,
+				hpcrun_malloc);
+    }
     hpcrun_trace_file_validate(ret == HPCFMT_OK, "open");
 
     hpctrace_hdr_flags_t flags = hpctrace_hdr_flags_NULL;
@@ -163,6 +201,9 @@ hpcrun_trace_open(core_profile_trace_data_t * cptd)
     
     ret = hpctrace_fmt_hdr_outbuf(flags, cptd->trace_outbuf);
     hpcrun_trace_file_validate(ret == HPCFMT_OK, "write header to");
+
+    cptd->trace_block = hpcrun_malloc(sizeof(hpctrace_fmt_block_t));
+    hpctrace_fmt_block_init(cptd->trace_block, flags);
   }
   TMSG(TRACE, "Trace open done");
 }
@@ -181,11 +222,7 @@ void
 hpcrun_trace_append(core_profile_trace_data_t *cptd, cct_node_t* node, uint metric_id, uint32_t dLCA)
 {
   if (tracing && hpcrun_sample_prob_active()) {
-    struct timeval tv;
-    int ret = gettimeofday(&tv, NULL);
-    assert(ret == 0 && "in trace_append: gettimeofday failed!");
-    uint64_t nanotime = ((uint64_t)tv.tv_usec
-			  + (((uint64_t)tv.tv_sec) * 1000000)) * 1000;
+    uint64_t nanotime = hpcrun_nanotime();
 
     // mark the leaf of a call path recorded in a trace record for retention
     // so that the call path associated with the trace record can be recovered.
@@ -221,14 +258,32 @@ hpcrun_trace_close(core_profile_trace_data_t * cptd)
   if (tracing && hpcrun_sample_prob_active()) {
 
     TMSG(TRACE, "Trace active close code");
-    int ret = hpcio_outbuf_close(&cptd->trace_outbuf);
+    int ret = hpctrace_fmt_block_outbuf(cptd->trace_block, cptd->trace_outbuf);
+    if (ret != HPCFMT_OK) {
+      EMSG("unable to write the last trace records");
+    }
+
+    // final drain: with the writer thread, wait for it to write out
+    // the halves it was handed, then write the active half from this
+    // thread, so the records stay in order and none is left behind
+    ret = hpcio_outbuf_flush(cptd->trace_outbuf);
+    if (ret != HPCFMT_OK) {
+      EMSG("unable to write the trace buffer");
+    }
+
+    ret = hpcio_outbuf_close(&cptd->trace_outbuf);
     if (ret != HPCFMT_OK) {
       EMSG("unable to flush and close trace file");
     }
 
     int rank = hpcrun_get_rank();
     if (rank >= 0) {
-      hpcrun_rename_trace_file(rank, cptd->id);
+      if (cptd->trace_member != NULL) {
+	hpcrun_rename_trace_member(cptd->trace_member, rank, cptd->id);
+      }
+      else {
+	hpcrun_rename_trace_file(rank, cptd->id);
+      }
     }
   }
   TMSG(TRACE, "trace close done");
@@ -253,6 +308,9 @@ static inline void hpcrun_trace_append_with_time_real(core_profile_trace_data_t
     trace_datum.cpId = (uint32_t)call_path_id;
     //TODO: was not in GPU version
     trace_datum.metricId = (uint32_t)metric_id;
+    // encoded in full in the block when the LCA_RECORDED flag is set;
+    // the time composite only has room for a few bits
+    trace_datum.dLCA = dLCA;
     if (dLCA > HPCTRACE_FMT_DLCA_NULL)
       dLCA = HPCTRACE_FMT_DLCA_NULL;
 
@@ -262,22 +320,71 @@ static inline void hpcrun_trace_append_with_time_real(core_profile_trace_data_t
 #else
     trace_datum.comp = nanotime;
 #endif
-    
-    hpctrace_hdr_flags_t flags = hpctrace_hdr_flags_NULL;
-#ifdef DATACENTRIC_TRACE
-    HPCTRACE_HDR_FLAGS_SET_BIT(flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS, true);
-#else
-    HPCTRACE_HDR_FLAGS_SET_BIT(flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS, false);
-#endif
-    
-#if defined(LCA_TRACE) && (defined (HOST_CPU_x86_64) || defined (HOST_CPU_PPC))
-    HPCTRACE_HDR_FLAGS_SET_BIT(flags, HPCTRACE_HDR_FLAGS_LCA_RECORDED_BIT_POS, true);
-#else
-    HPCTRACE_HDR_FLAGS_SET_BIT(flags, HPCTRACE_HDR_FLAGS_LCA_RECORDED_BIT_POS, false);
-#endif
-    
-    int ret = hpctrace_fmt_datum_outbuf(&trace_datum, flags, cptd->trace_outbuf);
-    hpcrun_trace_file_validate(ret == HPCFMT_OK, "append");
+
+    // the record is only encoded here; the block goes to the outbuf
+    // once it is full (or when the trace is closed)
+    if (hpctrace_fmt_block_add(cptd->trace_block, &trace_datum)) {
+      int ret = hpctrace_fmt_block_outbuf(cptd->trace_block, cptd->trace_outbuf);
+      hpcrun_trace_file_validate(ret == HPCFMT_OK, "append");
+    }
+}
+
+
+// Wake the writer thread.  Called from hpcio_outbuf_write(), so
+// possibly inside a signal handler.
+static void
+hpcrun_trace_writer_notify(void)
+{
+  atomic_fetch_add(&trace_writer_wakeups, 1);
+  syscall(SYS_futex, (int *) &trace_writer_wakeups, FUTEX_WAKE_PRIVATE, 1,
+	  NULL, NULL, 0);
+}
+
+
+static void *
+hpcrun_trace_writer_loop(void *arg)
+{
+  for (;;) {
+    int seen = atomic_load(&trace_writer_wakeups);
+    if (hpcio_outbuf_async_drain() == 0) {
+      struct timespec timeout = { 0, TRACE_WRITER_POLL_NS };
+      syscall(SYS_futex, (int *) &trace_writer_wakeups, FUTEX_WAIT_PRIVATE,
+	      seen, &timeout, NULL, 0);
+    }
+  }
+  return NULL;
+}
+
+
+// Start the process's trace writer thread, which does the write()s for
+// the trace buffers of all application threads.  This runs again in a
+// forked child, whose parent's writer did not survive the fork.
+static void
+hpcrun_trace_writer_start(void)
+{
+  pthread_t thread;
+
+  atomic_store(&trace_writer_wakeups, 0);
+  hpcio_outbuf_async_init(hpcrun_trace_writer_notify);
+
+  // Create a new thread for the writer without libmonitor watching
+  monitor_disable_new_threads();
+
+  int ret = pthread_create(&thread, NULL,
+			   (pthread_start_routine_t) hpcrun_trace_writer_loop,
+			   NULL);
+
+  monitor_enable_new_threads();
+
+  if (ret == 0) {
+    trace_outbuf_flags = HPCIO_OUTBUF_UNLOCKED | HPCIO_OUTBUF_ASYNC;
+    TMSG(TRACE, "Trace writer thread started");
+  }
+  else {
+    hpcio_outbuf_async_init(NULL);
+    trace_outbuf_flags = HPCIO_OUTBUF_UNLOCKED;
+    EMSG("unable to start trace writer thread, writing traces synchronously");
+  }
 }
 
 
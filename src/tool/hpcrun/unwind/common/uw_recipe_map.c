@@ -80,7 +80,9 @@
 //---------------------------------------------------------------------
 #include <memory/hpcrun-malloc.h>
 #include <main.h>
+#include <env.h>
 #include "thread_data.h"
+#include "handling_sample.h"
 #include "uw_hash.h"
 #include "uw_recipe_map.h"
 #include "unwind-interval.h"
@@ -276,6 +278,11 @@ static cskiplist_t *unwinder_to_cskiplist[NUM_UNWINDERS];
 // and inserting entries into unwinder_to_cskiplist:
 static mem_alloc my_alloc = hpcrun_malloc;
 
+// when set (HPCRUN_UNWIND_PRECOMPUTE), build native unwind recipes for
+// every function of a load module when it is mapped rather than lazily
+// on the first sample that lands in each function
+static bool precompute_recipes = false;
+
 //******************************************************************************
 // String output
 //******************************************************************************
@@ -554,6 +561,84 @@ uw_recipe_map_repoison(uintptr_t start, uintptr_t end, unwinder_t uw)
   uw_recipe_map_poison(start, end, uw);
 }
 
+/*
+ * Build the recipe tree for [fcn_start, fcn_end) and insert it into the
+ * map as READY.  Called outside of signal context when a load module is
+ * mapped; a fault while decoding the function only forfeits that
+ * function, which is then left for lazy construction in
+ * uw_recipe_map_lookup.
+ */
+static void
+uw_recipe_map_precompute_fcn(thread_data_t *td, load_module_t *lm,
+			     uintptr_t fcn_start, uintptr_t fcn_end,
+			     unwinder_t uw)
+{
+  ilmstat_btuwi_pair_t *ilm_btui =
+    ilmstat_btuwi_pair_malloc(fcn_start, fcn_end, lm, FORTHCOMING, my_alloc);
+
+  sigjmp_buf_t *oldjmp = td->current_jmp_buf;       // store the outer sigjmp
+  td->current_jmp_buf  = &(td->bad_interval);
+
+  if (sigsetjmp(td->bad_interval.jb, 1) == 0) {
+    btuwi_status_t btuwi_stat =
+      build_intervals((char *)fcn_start, fcn_end - fcn_start, uw);
+    td->current_jmp_buf = oldjmp;   // restore the outer sigjmp
+    if (btuwi_stat.error != 0) {
+      TMSG(UW_RECIPE_MAP, "precompute: fcn range %p to %p: error %d",
+	   (void *)fcn_start, (void *)fcn_end, btuwi_stat.error);
+    }
+    ilm_btui->btuwi = bitree_uwi_rebalance(btuwi_stat.first, btuwi_stat.count);
+  } else {
+    td->current_jmp_buf = oldjmp;   // restore the outer sigjmp
+    TMSG(UW_RECIPE_MAP, "precompute: fail to get interval %p to %p",
+	 (void *)fcn_start, (void *)fcn_end);
+    ilmstat_btuwi_pair_free(ilm_btui, uw);
+    return;
+  }
+
+  atomic_store_explicit(&ilm_btui->stat, READY, memory_order_release);
+
+  csklnode_t *node = cskl_insert(unwinder_to_cskiplist[uw], ilm_btui, my_alloc);
+  if (ilm_btui != (ilmstat_btuwi_pair_t*)node->val) {
+    // a sample already raced us to this function; keep its entry
+    ilmstat_btuwi_pair_free(ilm_btui, uw);
+  }
+}
+
+
+/*
+ * Walk the fnbounds table of a freshly mapped load module and build the
+ * native unwind recipes for each of its functions, so that samples in
+ * this module never pay for interval construction in the signal handler.
+ */
+static void
+uw_recipe_map_precompute(load_module_t* lm, unwinder_t uw)
+{
+  dso_info_t *dso = lm->dso_info;
+  if (dso->table == NULL || dso->nsymbols < 2) return;
+
+  thread_data_t *td = hpcrun_get_thread_data();
+  long offset = dso->is_relocatable ? (long) dso->start_to_ref_dist : 0;
+  unsigned long n = 0;
+
+  TMSG(UW_RECIPE_MAP, "precompute %s: %lu functions", dso->name,
+       dso->nsymbols - 1);
+
+  for (unsigned long i = 0; i + 1 < dso->nsymbols; i++) {
+    uintptr_t fcn_start = (uintptr_t) dso->table[i] + offset;
+    uintptr_t fcn_end   = (uintptr_t) dso->table[i + 1] + offset;
+    if (fcn_start >= fcn_end) continue;
+    if (fcn_start < (uintptr_t) dso->start_addr ||
+	fcn_end > (uintptr_t) dso->end_addr) continue;
+    uw_recipe_map_precompute_fcn(td, lm, fcn_start, fcn_end, uw);
+    n++;
+  }
+
+  TMSG(UW_RECIPE_MAP, "precompute %s: built recipes for %lu functions",
+       dso->name, n);
+}
+
+
 static void
 uw_recipe_map_notify_map(load_module_t* lm)
 {
@@ -566,6 +651,18 @@ uw_recipe_map_notify_map(load_module_t* lm)
   for (uw = 0; uw < NUM_UNWINDERS; uw++)
     uw_recipe_map_unpoison((uintptr_t)start, (uintptr_t)end, uw);
 
+  // a module mapped from inside a sample handler (DLOPEN_RISKY, see
+  // fnbounds_get_loadModule) is left for lazy construction: building
+  // every recipe there would allocate without bound in signal context
+  if (precompute_recipes) {
+    if (hpcrun_is_handling_sample()) {
+      TMSG(UW_RECIPE_MAP, "precompute %s: skipped inside a sample",
+	   lm->dso_info->name);
+    } else {
+      uw_recipe_map_precompute(lm, NATIVE_UNWINDER);
+    }
+  }
+
   uw_recipe_map_report_and_dump("*** map: after unpoisoning", start, end);
 }
 
@@ -614,6 +711,7 @@ void
 uw_recipe_map_init(void)
 {
   hpcrun_set_real_siglongjmp();
+  precompute_recipes = (getenv(HPCRUN_UNWIND_PRECOMPUTE) != NULL);
 #if UW_RECIPE_MAP_DEBUG
   fprintf(stderr, "uw_recipe_map_init: call a2r_map_init(my_alloc) ... \n");
 #endif
@@ -845,3 +943,169 @@ uw_recipe_map_lookup(void *addr, unwinder_t uw, unwindr_info_t *unwr_info)
 
   return (unwr_info->btuwi != NULL);
 }
+
+
+//***************************************************************************
+// unit test
+//***************************************************************************
+
+//
+// ******** unit test: building recipes when a load module is mapped
+//
+// Maps a synthetic load module with HPCRUN_UNWIND_PRECOMPUTE set and
+// checks that every one of its functions then has a READY recipe that
+// uw_recipe_map_lookup_noinsert finds without building anything.  Maps
+// a second module while the thread is handling a sample and checks that
+// nothing is built at map time, and that the first lookup in each of
+// its functions builds the recipe on demand.  Finally unmaps both
+// modules and checks that their recipes are gone.  build_intervals is
+// replaced by a stub that covers each function with one interval.
+//
+// build with UNIT_TEST 1, linking binarytree_uwi.c interval_t.c uw_hash.c
+// env.c and lib/prof-lean cskiplist.c binarytree.c mcs-lock.c
+// pfq-rwlock.c randomizer.c
+//
+
+#define UNIT_TEST 0
+
+#if UNIT_TEST
+
+#define UT_NFCNS     200
+#define UT_FCN_SIZE  64
+#define UT_TEXT_SIZE (UT_NFCNS * UT_FCN_SIZE)
+
+// one spare function's worth of padding keeps the two modules from
+// abutting, as mapped load modules do not
+static char ut_text[2][UT_TEXT_SIZE + UT_FCN_SIZE];
+static void* ut_table[2][UT_NFCNS + 1];
+static dso_info_t ut_dso[2];
+static load_module_t ut_lm[2];
+
+static thread_data_t ut_td;
+static int ut_in_sample = 0;
+static int ut_nbuilt = 0;
+static loadmap_notify_t* ut_notifier = NULL;
+
+static thread_data_t* ut_get_thread_data(void) { return &ut_td; }
+thread_data_t* (*hpcrun_get_thread_data)(void) = ut_get_thread_data;
+
+void* hpcrun_malloc(size_t size) { return malloc(size); }
+int hpcrun_is_handling_sample(void) { return ut_in_sample; }
+void hpcrun_loadmap_notify_register(loadmap_notify_t* n) { ut_notifier = n; }
+void hpcrun_set_real_siglongjmp(void) { }
+int debug_flag_get(dbg_category flag) { return 0; }
+void hpcrun_pmsg(const char* tag, const char* fmt, ...) { }
+void hpcrun_emsg(const char* fmt, ...) { }
+void uw_recipe_tostr(void* uwr, char str[], unwinder_t uw) { str[0] = '\0'; }
+
+btuwi_status_t
+build_intervals(char* ins, unsigned int len, unwinder_t uw)
+{
+  bitree_uwi_t* u = bitree_uwi_malloc(uw, 0);
+  bitree_uwi_interval(u)->start = (uintptr_t) ins;
+  bitree_uwi_interval(u)->end = (uintptr_t) ins + len;
+  ut_nbuilt++;
+  return (btuwi_status_t) { .first_undecoded_ins = NULL, .first = u,
+                            .count = 1, .error = 0 };
+}
+
+bool
+fnbounds_enclosing_addr(void* ip, void** start, void** end, load_module_t** lm)
+{
+  for (int m = 0; m < 2; m++) {
+    char* text = ut_text[m];
+    if (text <= (char*) ip && (char*) ip < text + UT_TEXT_SIZE) {
+      int i = ((char*) ip - text) / UT_FCN_SIZE;
+      *start = ut_table[m][i];
+      *end = ut_table[m][i + 1];
+      *lm = &ut_lm[m];
+      return true;
+    }
+  }
+  return false;
+}
+
+static void
+ut_make_module(int m)
+{
+  for (int i = 0; i <= UT_NFCNS; i++) {
+    ut_table[m][i] = ut_text[m] + i * UT_FCN_SIZE;
+  }
+  ut_dso[m] = (dso_info_t) {
+    .name = (m == 0) ? "eager.so" : "risky.so",
+    .start_addr = ut_text[m],
+    .end_addr = ut_text[m] + UT_TEXT_SIZE,
+    .table = ut_table[m],
+    .nsymbols = UT_NFCNS + 1,
+    .is_relocatable = 0,
+  };
+  ut_lm[m].id = m + 1;
+  ut_lm[m].name = ut_dso[m].name;
+  ut_lm[m].dso_info = &ut_dso[m];
+}
+
+//
+// count the functions of module m whose recipe is READY in the map,
+// looking each up in the middle of the function
+//
+static int
+ut_count_ready(int m)
+{
+  int n = 0;
+  for (int i = 0; i < UT_NFCNS; i++) {
+    unwindr_info_t info;
+    void* addr = ut_text[m] + i * UT_FCN_SIZE + UT_FCN_SIZE / 2;
+    if (uw_recipe_map_lookup_noinsert(addr, NATIVE_UNWINDER, &info)
+        && info.lm == &ut_lm[m]
+        && info.interval.start == (uintptr_t) ut_table[m][i]
+        && info.interval.end == (uintptr_t) ut_table[m][i + 1]) {
+      n++;
+    }
+  }
+  return n;
+}
+
+int
+main(int argc, char** argv)
+{
+  int ok = 1;
+
+  ut_td.uw_hash_table = uw_hash_new(1024, hpcrun_malloc);
+  setenv(HPCRUN_UNWIND_PRECOMPUTE, "1", 1);
+  uw_recipe_map_init();
+  ut_make_module(0);
+  ut_make_module(1);
+
+  ut_notifier->map(&ut_lm[0]);
+  int ready = ut_count_ready(0);
+  printf("map: built %d recipes, %d of %d functions ready\n",
+         ut_nbuilt, ready, UT_NFCNS);
+  ok = ok && (ut_nbuilt == UT_NFCNS) && (ready == UT_NFCNS);
+
+  ut_in_sample = 1;
+  ut_notifier->map(&ut_lm[1]);
+  ready = ut_count_ready(1);
+  printf("map in sample: built %d recipes, %d functions ready\n",
+         ut_nbuilt - UT_NFCNS, ready);
+  ok = ok && (ut_nbuilt == UT_NFCNS) && (ready == 0);
+
+  for (int i = 0; i < UT_NFCNS; i++) {
+    unwindr_info_t info;
+    ok = ok && uw_recipe_map_lookup(ut_text[1] + i * UT_FCN_SIZE,
+                                    NATIVE_UNWINDER, &info);
+  }
+  ready = ut_count_ready(1);
+  printf("lookup: built %d recipes, %d functions ready\n",
+         ut_nbuilt - UT_NFCNS, ready);
+  ok = ok && (ut_nbuilt == 2 * UT_NFCNS) && (ready == UT_NFCNS);
+  ut_in_sample = 0;
+
+  ut_notifier->unmap(&ut_lm[0]);
+  ut_notifier->unmap(&ut_lm[1]);
+  ok = ok && (ut_count_ready(0) == 0) && (ut_count_ready(1) == 0);
+
+  printf("%s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
+
+#endif
@@ -48,16 +48,34 @@
 // system includes
 //*****************************************************************************
 
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <sys/time.h>
 #include <assert.h>
 
+#define UNIT_TEST 0
+
+#if UNIT_TEST
+#include <stdio.h>
+#endif
+
 
 //*****************************************************************************
 // local includes
 //*****************************************************************************
 
+#include <include/hpctoolkit-config.h>
+
 #include "hpcrun-nanotime.h"
 
+#if UNIT_TEST
+#define EMSG(...) (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#else
+#include <messages/messages.h>
+#endif
+
 
 
 //*****************************************************************************
@@ -66,23 +84,343 @@
 
 #define NS_PER_SEC 1000000000
 
+#ifndef CLOCK_MONOTONIC_RAW
+#define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
+#endif
+
+#define DEFAULT_CLOCK hpcrun_clock_realtime
+
+// how long to calibrate the TSC for; 10ms gives a rate good to a few ppm
+#define TSC_CALIBRATION_NS (10 * 1000 * 1000)
+
+// the TSC rate is kept as ns per tick in 32.32 fixed point
+#define TSC_SHIFT 32
+
+#if defined(HOST_CPU_x86_64)
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+
+
+//*****************************************************************************
+// local data
+//*****************************************************************************
+
+static hpcrun_clock_t clock_source = DEFAULT_CLOCK;
+
+static const char *clock_names[] = {
+  [hpcrun_clock_gettimeofday]  = "gettimeofday",
+  [hpcrun_clock_realtime]      = "realtime",
+  [hpcrun_clock_monotonic_raw] = "monotonic-raw",
+  [hpcrun_clock_tsc]           = "tsc",
+};
+
+#define NUM_CLOCKS (sizeof(clock_names) / sizeof(clock_names[0]))
+
+// CLOCK_REALTIME - CLOCK_MONOTONIC_RAW when hpcrun started
+static int64_t monotonic_offset_ns;
+
+#if HAVE_TSC
+static uint64_t tsc_ns_per_tick;  // 32.32 fixed point
+static uint64_t tsc_reanchor_ticks;
+
+// Each thread maps TSC ticks to time relative to its own anchor, which it
+// refreshes from CLOCK_MONOTONIC_RAW every second or so. This keeps the
+// multiplication from overflowing and the drift of the calibrated rate
+// bounded, without any shared state on the fast path.
+static __thread uint64_t tsc_anchor_ticks;
+static __thread uint64_t tsc_anchor_ns;
+static __thread uint64_t tsc_last_ns;
+#endif
+
+
 
 //*****************************************************************************
+// private operations
+//*****************************************************************************
+
+static inline uint64_t
+timespec_ns
+(
+  const struct timespec *ts
+)
+{
+  return (uint64_t) ts->tv_sec * NS_PER_SEC + ts->tv_nsec;
+}
+
+
+static inline uint64_t
+clock_ns
+(
+  clockid_t id
+)
+{
+  struct timespec now;
+
+  int res = clock_gettime(id, &now);
+
+  assert(res == 0);
+
+  return timespec_ns(&now);
+}
+
+
+static inline uint64_t
+monotonic_raw_nanotime
+(
+  void
+)
+{
+  return clock_ns(CLOCK_MONOTONIC_RAW) + monotonic_offset_ns;
+}
+
+
+static void
+monotonic_raw_init
+(
+  void
+)
+{
+  // bracket the realtime read to halve the error of the offset
+  uint64_t raw0 = clock_ns(CLOCK_MONOTONIC_RAW);
+  uint64_t real = clock_ns(CLOCK_REALTIME);
+  uint64_t raw1 = clock_ns(CLOCK_MONOTONIC_RAW);
+
+  monotonic_offset_ns = (int64_t) real - (int64_t) (raw0 + (raw1 - raw0) / 2);
+}
+
+
+#if HAVE_TSC
+
+static inline uint64_t
+rdtsc
+(
+  void
+)
+{
+  uint32_t lo, hi;
+  __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+
+static bool
+tsc_invariant
+(
+  void
+)
+{
+  uint32_t eax, ebx, ecx, edx;
+
+  // CPUID.80000007H:EDX[8] is the invariant TSC flag
+  __asm__ __volatile__ ("cpuid"
+    : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (0x80000000));
+  if (eax < 0x80000007) return false;
+
+  __asm__ __volatile__ ("cpuid"
+    : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (0x80000007));
+  return (edx & (1u << 8)) != 0;
+}
+
+
+static bool
+tsc_init
+(
+  void
+)
+{
+  if (!tsc_invariant()) return false;
+
+  uint64_t ns0 = clock_ns(CLOCK_MONOTONIC_RAW);
+  uint64_t ticks0 = rdtsc();
+  uint64_t ns1, ticks1;
+  do {
+    ns1 = clock_ns(CLOCK_MONOTONIC_RAW);
+    ticks1 = rdtsc();
+  } while (ns1 - ns0 < TSC_CALIBRATION_NS);
+
+  if (ticks1 <= ticks0) return false;
+
+  tsc_ns_per_tick = ((ns1 - ns0) << TSC_SHIFT) / (ticks1 - ticks0);
+  if (tsc_ns_per_tick == 0) return false;
+
+  tsc_reanchor_ticks = ((uint64_t) NS_PER_SEC << TSC_SHIFT) / tsc_ns_per_tick;
+
+  return true;
+}
+
+
+static inline uint64_t
+tsc_nanotime
+(
+  void
+)
+{
+  uint64_t ticks = rdtsc();
+  uint64_t delta = ticks - tsc_anchor_ticks;
+
+  if (tsc_anchor_ticks == 0 || delta >= tsc_reanchor_ticks) {
+    tsc_anchor_ns = monotonic_raw_nanotime();
+    tsc_anchor_ticks = rdtsc();
+    delta = 0;
+  }
+
+  uint64_t now = tsc_anchor_ns + ((delta * tsc_ns_per_tick) >> TSC_SHIFT);
+
+  // re-anchoring may step time back by the calibration error; hide that
+  if (now < tsc_last_ns) now = tsc_last_ns;
+  tsc_last_ns = now;
+
+  return now;
+}
+
+#endif
+
+
+
 //*****************************************************************************
 // interface operations
 //*****************************************************************************
 
+void
+hpcrun_nanotime_init
+(
+  const char *name
+)
+{
+  hpcrun_clock_t source = DEFAULT_CLOCK;
+
+  if (name != NULL && *name != '\0') {
+    size_t i;
+    for (i = 0; i < NUM_CLOCKS; i++) {
+      if (strcasecmp(name, clock_names[i]) == 0) break;
+    }
+    if (i < NUM_CLOCKS) {
+      source = (hpcrun_clock_t) i;
+    } else {
+      EMSG("unknown trace clock '%s', using '%s'", name,
+	   clock_names[DEFAULT_CLOCK]);
+    }
+  }
+
+  monotonic_raw_init();
+
+  if (source == hpcrun_clock_tsc) {
+#if HAVE_TSC
+    bool ok = tsc_init();
+#else
+    bool ok = false;
+#endif
+    if (!ok) {
+      EMSG("no invariant TSC, using trace clock '%s'",
+	   clock_names[hpcrun_clock_monotonic_raw]);
+      source = hpcrun_clock_monotonic_raw;
+    }
+  }
+
+  clock_source = source;
+}
+
+
+hpcrun_clock_t
+hpcrun_nanotime_clock
+(
+  void
+)
+{
+  return clock_source;
+}
+
+
+const char *
+hpcrun_nanotime_clock_name
+(
+  hpcrun_clock_t clock
+)
+{
+  return ((size_t) clock < NUM_CLOCKS) ? clock_names[clock] : "unknown";
+}
+
+
 uint64_t
 hpcrun_nanotime()
 {
-  struct timespec now;
+  switch (clock_source) {
+  case hpcrun_clock_gettimeofday: {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (uint64_t) now.tv_sec * NS_PER_SEC + now.tv_usec * 1000;
+  }
+  case hpcrun_clock_monotonic_raw:
+    return monotonic_raw_nanotime();
+#if HAVE_TSC
+  case hpcrun_clock_tsc:
+    return tsc_nanotime();
+#endif
+  case hpcrun_clock_realtime:
+  default:
+    return clock_ns(CLOCK_REALTIME);
+  }
+}
 
-  int res = clock_gettime(CLOCK_REALTIME, &now);
 
-  assert(res == 0);
 
-  uint64_t now_sec = now.tv_sec;
-  uint64_t now_ns = now_sec * NS_PER_SEC + now.tv_nsec;
+//*****************************************************************************
+// unit test
+//*****************************************************************************
 
-  return now_ns;
+#if UNIT_TEST
+
+// Reports the cost of stamping and encoding one trace record with each
+// clock, i.e. the per-sample work of hpcrun_trace_append().
+//
+// cc -std=gnu99 -O2 -I... hpcrun-nanotime.c hpcrun-fmt.c ... (UNIT_TEST 1)
+
+#include <lib/prof-lean/hpcrun-fmt.h>
+
+#define APPENDS (10 * 1000 * 1000)
+
+int
+main
+(
+  int argc,
+  char **argv
+)
+{
+  static hpctrace_fmt_block_t block;
+  hpctrace_fmt_datum_t datum = { 0, 1, 0 };
+  size_t i;
+
+  for (i = 0; i < NUM_CLOCKS; i++) {
+    hpcrun_nanotime_init(clock_names[i]);
+    if (hpcrun_nanotime_clock() != (hpcrun_clock_t) i) continue;
+
+    hpctrace_fmt_block_init(&block, hpctrace_hdr_flags_NULL);
+
+    uint64_t prev = 0, backwards = 0;
+    uint64_t start = clock_ns(CLOCK_MONOTONIC_RAW);
+    for (int n = 0; n < APPENDS; n++) {
+      uint64_t now = hpcrun_nanotime();
+      if (now < prev) backwards++;
+      prev = now;
+      HPCTRACE_FMT_SET_TIME(datum.comp, now);
+      if (hpctrace_fmt_block_add(&block, &datum)) {
+        hpctrace_fmt_block_init(&block, hpctrace_hdr_flags_NULL);
+      }
+    }
+    uint64_t elapsed = clock_ns(CLOCK_MONOTONIC_RAW) - start;
+
+    int64_t skew = (int64_t) hpcrun_nanotime() - (int64_t) clock_ns(CLOCK_REALTIME);
+
+    printf("%-14s %6.2f ns/append  skew vs realtime %+lld ns  "
+           "backward steps %llu\n", clock_names[i],
+           (double) elapsed / APPENDS, (long long) skew,
+           (unsigned long long) backwards);
+  }
+
+  return 0;
 }
+
+#endif
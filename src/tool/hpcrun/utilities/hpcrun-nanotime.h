@@ -55,10 +55,54 @@
 
 
 
+//*****************************************************************************
+// type declarations
+//*****************************************************************************
+
+// Where hpcrun_nanotime() gets its time from. Whatever the source, the
+// result is in nanoseconds since the epoch, so that the timestamps of
+// different processes, threads and GPU streams line up.
+typedef enum {
+  hpcrun_clock_gettimeofday,   // gettimeofday(): microsecond resolution
+  hpcrun_clock_realtime,       // clock_gettime(CLOCK_REALTIME)
+  hpcrun_clock_monotonic_raw,  // clock_gettime(CLOCK_MONOTONIC_RAW), offset
+                               // to the epoch when hpcrun starts
+  hpcrun_clock_tsc             // invariant TSC, calibrated against
+                               // CLOCK_MONOTONIC_RAW at startup and
+                               // anchored per thread
+} hpcrun_clock_t;
+
+
+
 //*****************************************************************************
 // interface operations
 //*****************************************************************************
 
+// Selects the clock named by 'name' (cf. hpcrun_nanotime_clock_name()),
+// or the default one for NULL, and calibrates it. Falls back to the
+// default clock if the named one is unknown or not usable on this machine.
+// Until this is called, hpcrun_nanotime() reads CLOCK_REALTIME.
+void
+hpcrun_nanotime_init
+(
+  const char *name
+);
+
+
+hpcrun_clock_t
+hpcrun_nanotime_clock
+(
+  void
+);
+
+
+const char *
+hpcrun_nanotime_clock_name
+(
+  hpcrun_clock_t clock
+);
+
+
 uint64_t
 hpcrun_nanotime
 (
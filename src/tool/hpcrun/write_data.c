@@ -145,8 +145,14 @@ lazy_open_data_file(core_profile_trace_data_t * cptd)
   if (rank < 0) {
     rank = 0;
   }
-  int fd = hpcrun_open_profile_file(rank, cptd->id);
-  fs = fdopen(fd, "w");
+  if (hpcrun_files_packed()) {
+    hpcio_pack_member_t *member = hpcrun_open_profile_member(rank, cptd->id);
+    fs = hpcio_pack_member_fopen_w(member, HPCRUN_TraceBufferSz);
+  }
+  else {
+    int fd = hpcrun_open_profile_file(rank, cptd->id);
+    fs = fdopen(fd, "w");
+  }
   if (fs == NULL) {
     EEMSG("HPCToolkit: %s: unable to open profile file", __func__);
     return NULL;
@@ -71,6 +71,7 @@ using std::string;
 #include <include/hpctoolkit-config.h>
 
 #include "Args.hpp"
+#include "Constants.hpp"
 
 #include <lib/analysis/Util.hpp>
 
@@ -110,8 +111,11 @@ hpctraceviewer client to specify and access any database that hpcserver can read
 Options: General\n\
   -V, --version        Print version information.\n\
   -h, --help           Print this help.\n\
-  -c, --compression    Enables or disables compression (on by default)\n\
-                       Allowed values: on off \n\
+  -c, --compression    Sets how trace lines are compressed (on by default)\n\
+                       Allowed values: on off deflate varint varint-deflate\n\
+                           'on' picks varint-deflate, or deflate for clients\n\
+                           that do not support the varint encodings. On fast\n\
+                           networks, varint is the cheapest to produce.\n\
   -p, --port           Sets the main communication port (default is 21590)\n\
                            Specifying 0 indicates that an open port should be \n\
                            chosen automatically.\n\
@@ -120,6 +124,17 @@ Options: General\n\
                            indicates that the port will be auto-negotiated with\n\
                            the client. Specifying 1 indicates that the xml will\n\
                            be transferred on the main data port.\n\
+  -t, --threads <n>    Use <n> threads to read trace lines when hpcserver runs\n\
+                           without MPI. The default, 0, uses one thread per\n\
+                           available core.\n\
+  -l, --levels         Build downsampled levels of the timestamps next to the\n\
+                           merged trace file when a database is opened. They\n\
+                           speed up zoomed-out views of long traces and take\n\
+                           about a fifth of the size of the merged file.\n\
+  -m, --cache <n>      Keep up to <n> MB of the trace lines of recent requests\n\
+                           so that returning to a view, or panning across\n\
+                           it, needs less reading. The default is 64; 0 turns\n\
+                           the cache off. With MPI, each rank has its own.\n\
 \n\
 ";
 
@@ -149,6 +164,12 @@ CmdLineParser::OptArgDesc Args::optArgs[] = {
      CLP::isOptArg_long },
   {  'x' , "xmlport",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
      CLP::isOptArg_long },
+  {  't' , "threads",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     CLP::isOptArg_long },
+  {  'l' , "levels",        CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
+     NULL },
+  {  'm' , "cache",         CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     CLP::isOptArg_long },
   CmdLineParser_OptArgDesc_NULL_MACRO // SGI's compiler requires this version
 };
 
@@ -175,9 +196,12 @@ Args::Args(int argc, const char* const argv[])
 void
 Args::Ctor()
 {
-  compression = true;
+  compression = TraceviewerServer::COMPRESSION_AUTO;
   mainPort = DEFAULT_PORT;//21590
   xmlPort = 0;
+  threads = 0;
+  levels = false;
+  cacheSize = TraceviewerServer::DEFAULT_CACHE_BUDGET >> 20;
 }
 
 
@@ -256,7 +280,16 @@ Args::parse(int argc, const char* const argv[])
     // Check for other options: Communication options
     if (parser.isOpt("compression")) {
       const string& arg = parser.getOptArg("compression");
-      compression = CmdLineParser::parseArg_bool(arg, "--compression option");
+      if (arg == "deflate")
+        compression = TraceviewerServer::COMPRESSION_DEFLATE;
+      else if (arg == "varint")
+        compression = TraceviewerServer::COMPRESSION_VARINT;
+      else if (arg == "varint-deflate")
+        compression = TraceviewerServer::COMPRESSION_VARINT_DEFLATE;
+      else if (CmdLineParser::parseArg_bool(arg, "--compression option"))
+        compression = TraceviewerServer::COMPRESSION_AUTO;
+      else
+        compression = TraceviewerServer::COMPRESSION_NONE;
     }
     if (parser.isOpt("port")) {
       const string& arg = parser.getOptArg("port");
@@ -270,6 +303,21 @@ Args::parse(int argc, const char* const argv[])
       if (xmlPort < 1024 && xmlPort > 1)
     	   ARG_ERROR("Ports must be greater than 1024.")
     }
+    if (parser.isOpt("threads")) {
+      const string& arg = parser.getOptArg("threads");
+      threads = (int) CmdLineParser::toLong(arg);
+      if (threads < 0)
+         ARG_ERROR("The number of threads must not be negative.")
+    }
+    if (parser.isOpt("levels")) {
+      levels = true;
+    }
+    if (parser.isOpt("cache")) {
+      const string& arg = parser.getOptArg("cache");
+      cacheSize = (int) CmdLineParser::toLong(arg);
+      if (cacheSize < 0)
+         ARG_ERROR("The cache size must not be negative.")
+    }
   }
   catch (const CmdLineParser::ParseError& x) {
     ARG_ERROR(x.what());
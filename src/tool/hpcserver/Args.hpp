@@ -112,7 +112,10 @@ public:
   // Parsed Data: optional arguments
   int mainPort;       // default: 21590
   int xmlPort;        // default: 0
-  bool compression;   // default: true
+  int compression;    // default: COMPRESSION_AUTO
+  int threads;        // default: 0 (one per core)
+  bool levels;        // default: false
+  int cacheSize;      // default: DEFAULT_CACHE_BUDGET, in MB
 
 private:
   void
@@ -88,10 +88,11 @@ void Communication::sendParseInfo(Time minBegTime, Time maxEndTime, int headerSi
 
 }
 
-void Communication::sendParseOpenDB(string pathToDB)
+void Communication::sendParseOpenDB(string pathToDB, int compressionType)
 {
 	MPICommunication::CommandMessage cmdPathToDB;
 	cmdPathToDB.command = OPEN;
+	cmdPathToDB.ofile.compressionType = compressionType;
 	if (pathToDB.length() > MAX_DB_PATH_LENGTH)
 	{
 		cerr << "Path too long" << endl;
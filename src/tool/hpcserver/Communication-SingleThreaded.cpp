@@ -59,11 +59,11 @@
 
 #include <stdint.h>                     // for uint64_t
 #include <iostream>                     // for operator<<, basic_ostream, etc
+#include <mutex>                        // for mutex, lock_guard
 #include <string>                       // for string
 #include <vector>                       // for vector, vector<>::iterator
 
 #include "Communication.hpp"            // for Communication
-#include "DataCompressionLayer.hpp"     // for DataCompressionLayer
 #include "DataSocketStream.hpp"         // for DataSocketStream
 #include "DebugUtils.hpp"               // for DEBUGCOUT
 #include "Filter.hpp"
@@ -73,6 +73,7 @@
 #include "Server.hpp"                   // for Server
 #include "SpaceTimeDataController.hpp"  // for SpaceTimeDataController
 #include "TimeCPID.hpp"                 // for TimeCPID, Time
+#include "TimelineEncoder.hpp"          // for TimelineEncoder
 #include "TraceDataByRank.hpp"          // for TraceDataByRank
 
 
@@ -83,7 +84,7 @@ void Communication::sendParseInfo(uint64_t minBegTime, uint64_t maxEndTime, int
 {//Do nothing
 }
 
-void Communication::sendParseOpenDB(string pathToDB) {}
+void Communication::sendParseOpenDB(string pathToDB, int compressionType) {}
 
 void Communication::sendStartGetData(SpaceTimeDataController* contr, int processStart, int processEnd,
 			Time timeStart, Time timeEnd, int verticalResolution, int horizontalResolution)
@@ -101,46 +102,53 @@ void Communication::sendStartGetData(SpaceTimeDataController* contr, int process
 
 
 }
-void Communication::sendEndGetData(DataSocketStream* stream, ProgressBar* prog, SpaceTimeDataController* controller)
+//Compresses each timeline on the thread that filled it and writes it to the
+//client right away. Only the writes to the socket are serialized; the client
+//places lines by the line number sent ahead of each one.
+class TraceLineSender : public TraceLineSink
 {
-	// TODO: Make this so that the Lines get sent as soon as they are
-	// filled.
+public:
+	TraceLineSender(DataSocketStream* _stream, ProgressBar* _prog)
+	{
+		stream = _stream;
+		prog = _prog;
+	}
 
-	controller->fillTraces();
-	for (int i = 0; i < controller->tracesLength; i++)
+	void lineFilled(ProcessTimeline* timeline)
 	{
+		vector<TimeCPID>& data = *timeline->data->listCPID;
+		DEBUGCOUT(2) << "Sending process timeline with " << data.size() << " entries" << endl;
+
+		TimelineEncoder encoder(compressionType);
+		encoder.encode(data);
+		int outputBufferLen = encoder.getOutputLength();
+		char* outputBuffer = (char*)encoder.getOutputBuffer();
+
+		std::lock_guard<std::mutex> guard(streamLock);
 
-		ProcessTimeline* timeline = controller->traces[i];
 		stream->writeInt( timeline->line());
-		vector<TimeCPID> data = *timeline->data->listCPID;
 		stream->writeInt( data.size());
 		// Begin time
 		stream->writeLong( data[0].timestamp);
 		//End time
 		stream->writeLong( data[data.size() - 1].timestamp);
 
-		DataCompressionLayer comprStr;
-
-		vector<TimeCPID>::iterator it;
-		DEBUGCOUT(2) << "Sending process timeline with " << data.size() << " entries" << endl;
-
-
-		Time currentTime = data[0].timestamp;
-		for (it = data.begin(); it != data.end(); ++it)
-		{
-			comprStr.writeInt( (int)(it->timestamp - currentTime));
-			comprStr.writeInt( it->cpid);
-			currentTime = it->timestamp;
-		}
-		comprStr.flush();
-		int outputBufferLen = comprStr.getOutputLength();
-		char* outputBuffer = (char*)comprStr.getOutputBuffer();
-
 		stream->writeInt(outputBufferLen);
 
 		stream->writeRawData(outputBuffer, outputBufferLen);
 		prog->incrementProgress();
 	}
+
+private:
+	DataSocketStream* stream;
+	ProgressBar* prog;
+	std::mutex streamLock;
+};
+
+void Communication::sendEndGetData(DataSocketStream* stream, ProgressBar* prog, SpaceTimeDataController* controller)
+{
+	TraceLineSender sender(stream, prog);
+	controller->fillTraces(numThreads, &sender);
 	stream->flush();
 }
 
@@ -81,7 +81,7 @@ class Communication {
 public:
 
 	static void sendParseInfo(Time minBegTime, Time maxEndTime, int headerSize);
-	static void sendParseOpenDB(string pathToDB);
+	static void sendParseOpenDB(string pathToDB, int compressionType);
 	static void sendStartGetData(SpaceTimeDataController* contr, int processStart, int processEnd,
 			Time timeStart, Time timeEnd, int verticalResolution, int horizontalResolution);
 	static void sendEndGetData(DataSocketStream* stream, ProgressBar* prog, SpaceTimeDataController* controller);
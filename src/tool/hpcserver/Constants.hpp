@@ -76,6 +76,8 @@ namespace TraceviewerServer
 
 	static const int DEFAULT_PORT = 21590;
 	static const unsigned int MAX_DB_PATH_LENGTH = 1023;
+	//Memory for the lines of recent requests, in bytes
+	static const unsigned int DEFAULT_CACHE_BUDGET = 64 << 20;
 
 enum DatabaseType {
 	MULTI_PROCESSES = 1,
@@ -96,6 +98,16 @@ enum Header {
 	SLAVE_DONE = 0x534C444E
 };
 
+//How trace lines are encoded on the wire. The server announces the type it
+//picked with DBOK; types above COMPRESSION_DEFLATE need protocol 0x00010002.
+enum CompressionType {
+	COMPRESSION_AUTO = -1, //Never sent: the best type the client supports
+	COMPRESSION_NONE = 0, //Per record: int time delta, int cpid
+	COMPRESSION_DEFLATE = 1, //COMPRESSION_NONE, deflated
+	COMPRESSION_VARINT = 2, //Per record: zigzag varint time delta, zigzag varint cpid delta
+	COMPRESSION_VARINT_DEFLATE = 3 //COMPRESSION_VARINT, deflated at the fastest level
+};
+
 enum ServerNextAction {
 	CLOSE_SERVER = 0,
 	START_NEW_CONNECTION_IMMEDIATELY=1
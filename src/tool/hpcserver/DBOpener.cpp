@@ -63,6 +63,7 @@
 #include "MergeDataFiles.hpp"
 #include "FileUtils.hpp"
 #include "FileData.hpp"
+#include "Server.hpp"
 #include "SpaceTimeDataController.hpp"
 
 namespace TraceviewerServer
@@ -93,7 +94,7 @@ namespace TraceviewerServer
 		if (!hasDatabase)
 			return NULL;
 
-		stdcl = new SpaceTimeDataController(ptrLocation);
+		stdcl = new SpaceTimeDataController(ptrLocation, cacheBudget);
 		return stdcl;
 	}
 	/****
@@ -137,7 +138,7 @@ namespace TraceviewerServer
 					DEBUGCOUT(2) <<"\tTrying to open "<<outputFile<<endl;
 
 					MergeDataAttribute att = MergeDataFiles::merge(directory, "*.hpctrace",
-							outputFile);
+							outputFile, buildTraceLevels);
 
 					DEBUGCOUT(2) <<"\tMerge resulted in "<<att<<endl;
 
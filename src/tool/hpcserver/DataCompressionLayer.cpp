@@ -70,7 +70,7 @@ using namespace std;
 namespace TraceviewerServer
 {
 
-	DataCompressionLayer::DataCompressionLayer()
+	DataCompressionLayer::DataCompressionLayer(int level)
 	{
 
 		//See: http://www.zlib.net/zpipe.c
@@ -87,7 +87,7 @@ namespace TraceviewerServer
 		compressor.zalloc = Z_NULL;
 		compressor.zfree = Z_NULL;
 		compressor.opaque = Z_NULL;
-		int ret = deflateInit(&compressor, -1);
+		int ret = deflateInit(&compressor, level);
 		if (ret != Z_OK)
 			throw ret;
 
@@ -139,24 +139,46 @@ namespace TraceviewerServer
 		}
 		flush();
 	}
+	void DataCompressionLayer::writeRawData(const unsigned char* data, unsigned int count)
+	{
+		//Whatever was written before goes into the stream first
+		if (bufferIndex > 0)
+			softFlush(Z_NO_FLUSH);
+		deflateData(data, count, Z_NO_FLUSH);
+		pInc(count);
+	}
 	void DataCompressionLayer::flush()
 	{
 		softFlush(Z_FINISH);
 	}
+	void DataCompressionLayer::reset()
+	{
+		deflateReset(&compressor);
+		bufferIndex = 0;
+		posInCompBuffer = 0;
+	}
 	void DataCompressionLayer::makeRoom(int count)
 	{
 		if (count + bufferIndex > BUFFER_SIZE)
 			softFlush(Z_NO_FLUSH);
 	}
 	void DataCompressionLayer::softFlush(int flushType)
+	{
+		deflateData((unsigned char*)inBuf, bufferIndex, flushType);
+		bufferIndex = 0;
+	}
+
+	void DataCompressionLayer::deflateData(const unsigned char* data, unsigned int count,
+			int flushType)
 	{
 
 		/* run deflate() on input until output buffer not full, finish
 		 compression if all of source has been read in */
 
 		//Adapted from http://www.zlib.net/zpipe.c
-		compressor.avail_in = bufferIndex;
-		compressor.next_in = (unsigned char*)inBuf;
+		compressor.avail_in = count;
+		//zlib does not write through next_in, it is only missing the const
+		compressor.next_in = (unsigned char*)data;
 		do
 		{
 			compressor.avail_out = outBufferCurrentSize - posInCompBuffer;
@@ -174,8 +196,6 @@ namespace TraceviewerServer
 
 		} while (compressor.avail_out == 0);
 		assert(compressor.avail_in == 0);
-
-		bufferIndex = 0;
 	}
 
 	void DataCompressionLayer::growOutputBuffer()
@@ -78,7 +78,8 @@ namespace TraceviewerServer
 	class DataCompressionLayer
 	{
 	public:
-		DataCompressionLayer();
+		//level is a zlib compression level, from Z_BEST_SPEED to Z_BEST_COMPRESSION
+		DataCompressionLayer(int level = Z_DEFAULT_COMPRESSION);
 		//Advanced constructor:
 		DataCompressionLayer(z_stream customCompressor, ProgressBar* progMonitor);
 
@@ -87,7 +88,12 @@ namespace TraceviewerServer
 		void writeLong(uint64_t);
 		void writeDouble(double);
 		void writeFile(FILE*);
+		//Compresses count bytes straight from data, without copying them
+		void writeRawData(const unsigned char* data, unsigned int count);
 		void flush();
+		//Discards the output and starts a new stream with the same settings,
+		//which is much cheaper than setting up a new compressor
+		void reset();
 		unsigned char* getOutputBuffer();
 		int getOutputLength();
 
@@ -96,6 +102,7 @@ namespace TraceviewerServer
 		//bytes. If there is not, it makes room by flushing the buffer.
 		void makeRoom(int count);
 		void softFlush(int flushType);
+		void deflateData(const unsigned char* data, unsigned int count, int flushType);
 
 		//Increment the progress bar if it isn't NULL
 		void pInc(unsigned int count);
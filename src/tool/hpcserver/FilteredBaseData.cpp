@@ -73,6 +73,11 @@ FilteredBaseData::FilteredBaseData(string filename, int _headerSize) {
 	baseDataFile = new BaseDataFile(filename, _headerSize);
 	headerSize = _headerSize;
 	baseOffsets = baseDataFile->getOffsets();
+	levels = new TraceLevels(filename, _headerSize, baseDataFile->getNumberOfFiles());
+	if (!levels->isValid()) {
+		delete levels;
+		levels = NULL;
+	}
 	//Filters are default, which is allow everything, so this will initialize the vector
 	filter();
 
@@ -80,6 +85,7 @@ FilteredBaseData::FilteredBaseData(string filename, int _headerSize) {
 
 FilteredBaseData::~FilteredBaseData() {
 	delete baseDataFile;
+	delete levels;
 }
 
 void FilteredBaseData::setFilters(FilterSet _filter)
@@ -121,6 +127,21 @@ int FilteredBaseData::getInt(FileOffset position)
 	return baseDataFile->getMasterBuffer()->getInt(position);
 }
 
+int FilteredBaseData::getNumLevels(int pseudoRank)
+{
+	if (levels == NULL)
+		return 0;
+	return levels->getNumLevels(rankMapping[pseudoRank]);
+}
+FileOffset FilteredBaseData::getLevelStart(int pseudoRank, int level)
+{
+	return levels->getLevelStart(rankMapping[pseudoRank], level);
+}
+int64_t FilteredBaseData::getLevelTime(FileOffset levelStart, int64_t index)
+{
+	return levels->getTime(levelStart, index);
+}
+
 int FilteredBaseData::getNumberOfRanks()
 {
 	return rankMapping.size();
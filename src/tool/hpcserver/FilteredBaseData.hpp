@@ -64,6 +64,7 @@
 #include "BaseDataFile.hpp"
 #include "FilterSet.hpp"
 #include "FileUtils.hpp"//For FileOffset
+#include "TraceLevels.hpp"
 
 #include <vector>
 #include <stdint.h>
@@ -82,6 +83,10 @@ namespace TraceviewerServer
 		FileOffset getMaxLoc(int pseudoRank);
 		int64_t getLong(FileOffset position);
 		int getInt(FileOffset position);
+		//Downsampled timestamps of the rank; 0 levels if none were built
+		int getNumLevels(int pseudoRank);
+		FileOffset getLevelStart(int pseudoRank, int level);
+		int64_t getLevelTime(FileOffset levelStart, int64_t index);
 		int getNumberOfRanks();
 		int* getProcessIDs();
 		short* getThreadIDs();
@@ -90,6 +95,7 @@ namespace TraceviewerServer
 		void filter();
 
 		BaseDataFile* baseDataFile;
+		TraceLevels* levels;
 		OffsetPair* baseOffsets;
 		FilterSet currentlyAppliedFilter;
 		//Maps the pseudoranks the program asks for from the unfiltered
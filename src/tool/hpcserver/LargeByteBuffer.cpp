@@ -113,15 +113,32 @@ namespace TraceviewerServer
 		numPages = FullPages + (PartialPageSize == 0 ? 0 : 1);
 		pageManagementList = new LRUList<VersatileMemoryPage>(numPages);
 
+		pagesEvictable = numPages > MaxPages;
+		residentPages = new std::atomic<char*>[numPages];
+		pagePins = new std::atomic<int>[numPages];
+		for (int i = 0; i < numPages; i++)
+		{
+			residentPages[i].store(NULL, std::memory_order_relaxed);
+			pagePins[i].store(0, std::memory_order_relaxed);
+		}
+		lastTouchedPage.store(-1, std::memory_order_relaxed);
+
 		FileDescriptor fd = open(sPath.c_str(), O_RDONLY);
 
 		FileOffset sizeRemaining = fileSize;
 
+		//The page list refers to the pages by address, so they are built in
+		//place and never moved
+		masterBuffer.reserve(numPages);
 		for (int i = 0; i < numPages; i++)
 		{
 			FileOffset mapping_len = min( mmPageSize, sizeRemaining);
 
-			masterBuffer.push_back(VersatileMemoryPage(mmPageSize*i, mapping_len, fd, pageManagementList));
+			if (pagesEvictable)
+				masterBuffer.emplace_back(mmPageSize*i, mapping_len, fd, pageManagementList,
+						&residentPages[i], &pagePins[i]);
+			else
+				masterBuffer.emplace_back(mmPageSize*i, mapping_len, fd, pageManagementList);
 
 			sizeRemaining -= mapping_len;
 
@@ -129,20 +146,74 @@ namespace TraceviewerServer
 
 	}
 
+	char* LargeByteBuffer::getResidentPage(int page)
+	{
+		char* p = residentPages[page].load(std::memory_order_acquire);
+		if (p == NULL)
+		{
+			std::lock_guard<std::mutex> guard(pageLock);
+			p = masterBuffer[page].get();
+			residentPages[page].store(p, std::memory_order_release);
+		}
+		return p;
+	}
+
+	//Returns the address of a page that stays mapped until unpinPage.
+	//Reads of a resident page only touch that page's pin count; the lock
+	//is taken to map a page, and now and then to keep the LRU order.
+	char* LargeByteBuffer::pinPage(int page)
+	{
+		if (!pagesEvictable)
+			return getResidentPage(page);
+
+		//Pin first, then load: an evicting thread withdraws the address
+		//first, then checks the pins, so one of the two sees the other
+		pagePins[page].fetch_add(1);
+		char* p = residentPages[page].load();
+		if (p != NULL)
+		{
+			//Successive reads mostly hit the same page. Only a change of page
+			//updates the LRU order, and only if that does not mean waiting.
+			if (lastTouchedPage.exchange(page, std::memory_order_relaxed) != page
+					&& pageLock.try_lock())
+			{
+				masterBuffer[page].get();
+				pageLock.unlock();
+			}
+			return p;
+		}
+		pagePins[page].fetch_sub(1);
+
+		std::lock_guard<std::mutex> guard(pageLock);
+		p = masterBuffer[page].get();
+		residentPages[page].store(p);
+		//Pages are only unmapped with the lock held, so this pin is safe
+		pagePins[page].fetch_add(1);
+		return p;
+	}
+
+	void LargeByteBuffer::unpinPage(int page)
+	{
+		if (pagesEvictable)
+			pagePins[page].fetch_sub(1, std::memory_order_release);
+	}
+
 	int LargeByteBuffer::getInt(FileOffset pos)
 	{
 		int Page = pos / mmPageSize;
 		int loc = pos % mmPageSize;
-		char* p2D = masterBuffer[Page].get() + loc;
+		char* p2D = pinPage(Page) + loc;
 		int val = ByteUtilities::readInt(p2D);
+		unpinPage(Page);
 		return val;
 	}
 	Long LargeByteBuffer::getLong(FileOffset pos)
 	{
 		int Page = pos / mmPageSize;
 		int loc = pos % mmPageSize;
-		char* p2D = masterBuffer[Page].get() + loc;
+		char* p2D = pinPage(Page) + loc;
 		Long val = ByteUtilities::readLong(p2D);
+		unpinPage(Page);
 		return val;
 
 	}
@@ -196,6 +267,8 @@ namespace TraceviewerServer
 	{
 		masterBuffer.clear();
 		delete pageManagementList;
+		delete[] residentPages;
+		delete[] pagePins;
 
 	}
 }
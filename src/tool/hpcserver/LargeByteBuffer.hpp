@@ -65,6 +65,8 @@
 #include "FileUtils.hpp" //For FileOffset
 #include "LRUList.hpp"
 
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <stdint.h>
@@ -83,10 +85,26 @@ namespace TraceviewerServer
 	private:
 		static uint64_t lcm(uint64_t, uint64_t);
 		static uint64_t getRamSize();
+		char* getResidentPage(int);
+		char* pinPage(int);
+		void unpinPage(int);
 		vector<VersatileMemoryPage> masterBuffer;
 		int numPages;
 		LRUList<VersatileMemoryPage>* pageManagementList;
 
+		//Timelines may be read by several threads at once. The page list is
+		//guarded by pageLock. A mapped page's address is published in
+		//residentPages and read from there without locking. When every page
+		//fits in the mapping budget no page is ever unmapped. Otherwise a
+		//reader pins the page in pagePins for the duration of the read, and
+		//a page is unmapped only after its address has been withdrawn and
+		//its pins released (cf. VersatileMemoryPage::unmapPage).
+		bool pagesEvictable;
+		std::atomic<char*>* residentPages;
+		std::atomic<int>* pagePins;
+		std::atomic<int> lastTouchedPage;
+		std::mutex pageLock;
+
 	};
 
 } /* namespace TraceviewerServer */
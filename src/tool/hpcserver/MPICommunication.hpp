@@ -68,7 +68,7 @@
 namespace TraceviewerServer
 {
 //Forward declarations so we don't need to include the class just to have a pointer to it
-	class DataCompressionLayer;
+	class TimelineEncoder;
 
 
 	class MPICommunication
@@ -79,6 +79,7 @@ namespace TraceviewerServer
 		typedef struct
 		{
 			char path[1024];
+			int compressionType;
 		} open_file_command;
 		typedef struct
 		{
@@ -145,11 +146,7 @@ namespace TraceviewerServer
 		typedef struct
 		{
 			ResultMessage* header;
-			bool compressed;
-			union{
-				DataCompressionLayer* compMsg;
-				unsigned char* message;
-			};
+			TimelineEncoder* encoder;
 			MPI::Request headerRequest;
 			MPI::Request bodyRequest;
 		} ResultBufferLocations;
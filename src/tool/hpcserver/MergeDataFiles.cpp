@@ -64,8 +64,14 @@
 #include "FileUtils.hpp"
 #include "DebugUtils.hpp"
 #include "ProgressBar.hpp"
+#include "TraceLevels.hpp"
+
+#include <lib/prof-lean/hpcio.h>
+#include <lib/prof-lean/hpcio-pack.h>
+#include <lib/prof-lean/hpcrun-fmt.h>
 
 #include <string>
+#include <set>
 #include <algorithm>
 #include <cstdlib>
 #include <cstdio>
@@ -75,8 +81,10 @@ using namespace std;
 typedef int64_t Long;
 namespace TraceviewerServer
 {
+	const char MergeDataFiles::V1_VERSION[] = "01.01";
+
 	MergeDataAttribute MergeDataFiles::merge(string directory, string globInputFile,
-			string outputFile)
+			string outputFile, bool buildLevels)
 	{
 		 int lastDot = globInputFile.find_last_of('.');
 		 string suffix = globInputFile.substr(lastDot);
@@ -90,7 +98,11 @@ namespace TraceviewerServer
 			DEBUGCOUT(2) << "Exists" << endl;
 
 			if (isMergedFileCorrect(&outputFile))
+			{
+				if (buildLevels && !FileUtils::exists(TraceLevels::getLevelsFile(outputFile)))
+					insertLevels(outputFile);
 				return SUCCESS_ALREADY_CREATED;
+			}
 			// the file exists but corrupted.
 			cout << "Database file may be corrupted. Continuing" << endl;
 			return STATUS_UNKNOWN;
@@ -116,18 +128,7 @@ namespace TraceviewerServer
 		int type = 0;
 		dos.writeInt(type);
 
-		vector<string> allPaths = FileUtils::getAllFilesInDir(directory);
-		vector<string> filteredFileNames;
-		vector<string>::iterator it;
-		for (it = allPaths.begin(); it != allPaths.end(); it++)
-		{
-			string val = *it;
-			if (val.find(".hpctrace") < string::npos)//This is hardcoded, which isn't great but will have to do because GlobInputFile is regex-style ("*.hpctrace")
-				filteredFileNames.push_back(val);
-		}
-		// on linux, we have to sort the files
-		//To sort them, we need a random access iterator, which means we need to load all of them into a vector
-		sort(filteredFileNames.begin(), filteredFileNames.end());
+		vector<string> filteredFileNames = getTraceFiles(directory);
 
 		dos.writeInt(filteredFileNames.size());
 		const Long num_metric_header = 2 * SIZEOF_INT; // type of app (4 bytes) + num procs (4 bytes)
@@ -177,7 +178,7 @@ namespace TraceviewerServer
 			if (Thread != 0)
 				type |= MULTI_THREADING;
 			dos.writeLong(currentOffset);
-			currentOffset += FileUtils::getFileSize(Filename);
+			currentOffset += getMergedSize(Filename);
 		}
 		//-----------------------------------------------------
 		// 3. Copy all data from the multiple files into one file
@@ -187,17 +188,17 @@ namespace TraceviewerServer
 		{
 			string i = *it2;
 
-			ifstream dis(i.c_str(), ios_base::binary | ios_base::in);
-			char data[PAGE_SIZE_GUESS];
-			dis.read(data, PAGE_SIZE_GUESS);
-			int bytesRead = dis.gcount();
-			while (bytesRead > 0)
+			if (isBlockFramed(i))
+				copyBlockFramed(i, &dos);
+			else
 			{
-				dos.write(data, bytesRead);
-				dis.read(data, PAGE_SIZE_GUESS);
-				bytesRead = dis.gcount();
+				FILE* fs = hpcio_fopen_r(i.c_str());
+				char data[PAGE_SIZE_GUESS];
+				size_t bytesRead;
+				while (fs != NULL && (bytesRead = fread(data, 1, PAGE_SIZE_GUESS, fs)) > 0)
+					dos.write(data, bytesRead);
+				hpcio_fclose(fs);
 			}
-			dis.close();
 			prog.incrementProgress();
 		}
 		insertMarker(&dos);
@@ -216,11 +217,169 @@ namespace TraceviewerServer
 		// 5. remove old files
 		//-----------------------------------------------------
 		removeFiles(filteredFileNames);
+
+		//-----------------------------------------------------
+		// 6. optionally write the downsampled levels
+		//-----------------------------------------------------
+		if (buildLevels)
+			insertLevels(outputFile);
 		return SUCCESS_MERGED;
 	}
 
 
 
+	//All trace files of the database, sorted. A trace in a pack file
+	//(HPCRUN_PACK) is named "<pack-file>/<member>" and stands in for the
+	//member, unless hpcprof rewrote the trace into an individual file.
+	vector<string> MergeDataFiles::getTraceFiles(string directory)
+	{
+		vector<string> allPaths = FileUtils::getAllFilesInDir(directory);
+		vector<string> filteredFileNames;
+		set<string> individualFiles;
+		vector<string> packFiles;
+		vector<string>::iterator it;
+		for (it = allPaths.begin(); it != allPaths.end(); it++)
+		{
+			string val = *it;
+			if (val.find(".hpctrace") < string::npos)//This is hardcoded, which isn't great but will have to do because GlobInputFile is regex-style ("*.hpctrace")
+			{
+				filteredFileNames.push_back(val);
+				individualFiles.insert(val);
+			}
+			else if (endsWith(val, string(".") + HPCIO_PACK_FnmSfx))
+				packFiles.push_back(val);
+		}
+		for (it = packFiles.begin(); it != packFiles.end(); it++)
+		{
+			vector<string> members;
+			hpcio_pack_foreach(it->c_str(), addPackTrace, &members);
+			vector<string>::iterator m;
+			for (m = members.begin(); m != members.end(); m++)
+			{
+				if (individualFiles.count(FileUtils::combinePaths(directory, *m)) == 0)
+					filteredFileNames.push_back(*it + "/" + *m);
+			}
+		}
+		// on linux, we have to sort the files
+		//To sort them, we need a random access iterator, which means we need to load all of them into a vector
+		sort(filteredFileNames.begin(), filteredFileNames.end());
+		return filteredFileNames;
+	}
+
+	void MergeDataFiles::addPackTrace(const char* name, uint64_t size, void* arg)
+	{
+		if (endsWith(name, ".hpctrace"))
+			static_cast<vector<string>*>(arg)->push_back(name);
+	}
+
+	bool MergeDataFiles::endsWith(string s, string ending)
+	{
+		return s.length() >= ending.length()
+				&& s.compare(s.length() - ending.length(), ending.length(), ending) == 0;
+	}
+
+	//Also the size of a trace in a pack file, which stat() can't tell
+	FileOffset MergeDataFiles::getTraceFileSize(string filename)
+	{
+		if (hpcio_pack_member_name(filename.c_str()) == NULL)
+			return FileUtils::getFileSize(filename);
+		FILE* fs = hpcio_fopen_r(filename.c_str());
+		if (fs == NULL)
+			return 0;
+		fseek(fs, 0, SEEK_END);
+		FileOffset size = ftell(fs);
+		hpcio_fclose(fs);
+		return size;
+	}
+
+	//Version 2.00 and later trace files group their records into blocks of
+	//varints. The merged file needs fixed-size records to be searched, so
+	//those files are written out as version 01.01 files instead of copied.
+	bool MergeDataFiles::isBlockFramed(string filename)
+	{
+		FILE* fs = hpcio_fopen_r(filename.c_str());
+		if (fs == NULL)
+			return false;
+		hpctrace_fmt_hdr_t hdr;
+		bool blockFramed = (hpctrace_fmt_hdr_fread(&hdr, fs) == HPCFMT_OK)
+				&& (hdr.version >= HPCTRACE_FMT_Version_20);
+		hpcio_fclose(fs);
+		return blockFramed;
+	}
+
+	FileOffset MergeDataFiles::getMergedSize(string filename)
+	{
+		if (!isBlockFramed(filename))
+			return getTraceFileSize(filename);
+		return V1_HEADER_SIZE + countRecords(filename) * SIZE_OF_TRACE_RECORD;
+	}
+
+	//Only the block headers are read. A last block cut short, e.g. because
+	//the process was killed, is left out.
+	FileOffset MergeDataFiles::countRecords(string filename)
+	{
+		FileOffset fileSize = getTraceFileSize(filename);
+		FILE* fs = hpcio_fopen_r(filename.c_str());
+		hpctrace_fmt_hdr_t hdr;
+		hpctrace_fmt_hdr_fread(&hdr, fs);
+
+		FileOffset numRecords = 0;
+		hpctrace_fmt_block_hdr_t bhdr;
+		while (hpctrace_fmt_block_hdr_fread(&bhdr, fs) == HPCFMT_OK)
+		{
+			FileOffset blockEnd = ftell(fs) + (FileOffset) bhdr.len;
+			if (blockEnd > fileSize)
+				break;
+			numRecords += bhdr.numRecords;
+			fseek(fs, bhdr.len, SEEK_CUR);
+		}
+		hpcio_fclose(fs);
+		return numRecords;
+	}
+
+	void MergeDataFiles::copyBlockFramed(string filename, DataOutputFileStream* dos)
+	{
+		FileOffset numRecords = countRecords(filename);
+
+		FILE* fs = hpcio_fopen_r(filename.c_str());
+		char* fsBuf = new char[HPCIO_RWBufferSz];
+		setvbuf(fs, fsBuf, _IOFBF, HPCIO_RWBufferSz);
+
+		hpctrace_fmt_hdr_t hdr;
+		hpctrace_fmt_hdr_fread(&hdr, fs);
+
+		//The merged file has no room for metric ids
+		hpctrace_hdr_flags_t flags = hdr.flags;
+		HPCTRACE_HDR_FLAGS_SET_BIT(flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS, false);
+		dos->write(HPCTRACE_FMT_Magic, HPCTRACE_FMT_MagicLen);
+		dos->write(V1_VERSION, HPCTRACE_FMT_VersionLen);
+		dos->write(HPCTRACE_FMT_Endian, HPCTRACE_FMT_EndianLen);
+		dos->writeLong(flags);
+
+		hpctrace_fmt_datum_t datum;
+		datum.comp = 0;
+		datum.cpId = 0;
+		for (FileOffset i = 0; i < numRecords; i++)
+		{
+			//A failed read can only happen if the file changed under us.
+			//Repeating the last record keeps the offsets of the following
+			//ranks right all the same.
+			hpctrace_fmt_datum_fread(&datum, &hdr, fs);
+			dos->writeLong(HPCTRACE_FMT_GET_TIME(datum.comp));
+			dos->writeInt(datum.cpId);
+		}
+
+		hpcio_fclose(fs);
+		delete[] fsBuf;
+	}
+
+	void MergeDataFiles::insertLevels(string outputFile)
+	{
+		//The levels only speed up searches, so the database is usable without them
+		if (!TraceLevels::build(outputFile))
+			cerr << "Could not build trace levels for " << outputFile << ". Continuing" << endl;
+	}
+
 	void MergeDataFiles::insertMarker(DataOutputFileStream* dos)
 	{
 		dos->writeLong(MARKER_END_MERGED_FILE);
@@ -246,10 +405,20 @@ namespace TraceviewerServer
 	bool MergeDataFiles::removeFiles(vector<string> vect)
 	{
 		bool success = true;
+		set<string> packsDone;
 		vector<string>::iterator it;
 		for (it = vect.begin(); it != vect.end(); ++it)
 		{
-			bool thisSuccess = (remove(it->c_str()) == 0);
+			//The whole pack goes with its first trace
+			string name = *it;
+			const char* member = hpcio_pack_member_name(name.c_str());
+			if (member != NULL)
+			{
+				name = name.substr(0, member - it->c_str() - 1);
+				if (!packsDone.insert(name).second)
+					continue;
+			}
+			bool thisSuccess = (remove(name.c_str()) == 0);
 			success &= thisSuccess;
 		}
 		return success;
@@ -274,7 +443,8 @@ namespace TraceviewerServer
 				return true;
 			}
 		}
-		return false;
+		//or if a pack file holds a trace
+		return !getTraceFiles(dir).empty();
 	}
 	//From http://stackoverflow.com/questions/236129/splitting-a-string-in-c
 	vector<string> MergeDataFiles::splitString(string toSplit, char delimiter)
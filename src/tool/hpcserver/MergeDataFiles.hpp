@@ -60,6 +60,7 @@
 #define MERGEDATAFILES_H_
 
 #include "DataOutputFileStream.hpp"
+#include "FileUtils.hpp" // For FileOffset
 #include <vector>
 #include <string>
 #include <stdint.h>
@@ -76,7 +77,9 @@ namespace TraceviewerServer
 	class MergeDataFiles
 	{
 	public:
-		static MergeDataAttribute merge(string, string, string);
+		//With buildLevels, also writes the downsampled levels of the merged
+		//file (see TraceLevels) if they do not exist yet
+		static MergeDataAttribute merge(string, string, string, bool buildLevels = false);
 
 		static vector<string> splitString(string, char);
 	private:
@@ -84,7 +87,19 @@ namespace TraceviewerServer
 		static const int PAGE_SIZE_GUESS = 4096;
 		static const int PROC_POS = 5;
 		static const int THREAD_POS = 4;
+		//What version 2.00 trace files are written out as
+		static const int V1_HEADER_SIZE = 32;
+		static const char V1_VERSION[];
+		static vector<string> getTraceFiles(string);
+		static void addPackTrace(const char*, uint64_t, void*);
+		static bool endsWith(string, string);
+		static FileOffset getTraceFileSize(string);
 		static void insertMarker(DataOutputFileStream*);
+		static void insertLevels(string);
+		static bool isBlockFramed(string);
+		static FileOffset getMergedSize(string);
+		static FileOffset countRecords(string);
+		static void copyBlockFramed(string, DataOutputFileStream*);
 		static bool isMergedFileCorrect(string*);
 		static bool removeFiles(vector<string>);
 		//This was in Util.java in a modified form but is more useful here
@@ -63,7 +63,7 @@ namespace TraceviewerServer
 {
 
 	ProcessTimeline::ProcessTimeline(ImageTraceAttributes attrib, int _lineNum, FilteredBaseData* _dataTrace,
-			Time _startingTime, int _headerSize)
+			Time _startingTime, int _headerSize, TimelineCache* _cache)
 	{
 		lineNum = _lineNum;
 
@@ -73,7 +73,7 @@ namespace TraceviewerServer
 		pixelLength = timeRange / (double) attrib.numPixelsH;
 
 		attributes = attrib;
-		data = new TraceDataByRank(_dataTrace, lineNumToProcessNum(_lineNum), attrib.numPixelsH, _headerSize);
+		data = new TraceDataByRank(_dataTrace, lineNumToProcessNum(_lineNum), attrib.numPixelsH, _headerSize, _cache);
 	}
 	int ProcessTimeline::lineNumToProcessNum(int line) {
 		int numTimelinesToPaint = attributes.endProcess - attributes.begProcess;
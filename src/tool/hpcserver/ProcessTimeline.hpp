@@ -71,7 +71,7 @@ namespace TraceviewerServer
 	public:
 		ProcessTimeline();
 		ProcessTimeline(ImageTraceAttributes attrib, int _lineNum, FilteredBaseData* _dataTrace,
-				Time _startingTime, int _headerSize);
+				Time _startingTime, int _headerSize, TimelineCache* _cache = NULL);
 		virtual ~ProcessTimeline();
 		int line();
 		void readInData();
@@ -86,9 +86,13 @@ using namespace std;
 
 namespace TraceviewerServer
 {
-	bool useCompression = true;
+	int requestedCompression = COMPRESSION_AUTO;
+	int compressionType = COMPRESSION_DEFLATE;
 	int mainPortNumber = DEFAULT_PORT;
 	int xmlPortNumber = 0;
+	int numThreads = 0;
+	bool buildTraceLevels = false;
+	uint64_t cacheBudget = DEFAULT_CACHE_BUDGET;
 
 	Server::Server()
 	{
@@ -241,11 +245,7 @@ namespace TraceviewerServer
 		int numFiles = controller->getNumRanks();
 		socket->writeInt(numFiles);
 
-		// This is an int so that it is possible to have different compression
-		// algorithms in the future. For now, it is just
-		// 0=no compression, 1= normal compression
-		int compressionType;
-		compressionType = useCompression ? 1 : 0;
+		// One of CompressionType, picked by negotiateCompression
 		socket->writeInt(compressionType);
 
 		//Send ValuesX
@@ -308,6 +308,7 @@ namespace TraceviewerServer
 	void Server::checkProtocolVersions(DataSocketStream* receiver)
 	{
 		int clientProtocolVersion = receiver->readInt();
+		agreedUponProtocolVersion = clientProtocolVersion;
 
 		if (clientProtocolVersion != SERVER_PROTOCOL_MAX_VERSION)
 			cout << "The client is using protocol version 0x" << hex << clientProtocolVersion<<
@@ -325,9 +326,30 @@ namespace TraceviewerServer
 		cout << dec;//Switch it back to decimal mode
 	}
 
+	int Server::negotiateCompression()
+	{
+		bool varintSupported = agreedUponProtocolVersion >= PROTOCOL_VERSION_VARINT;
+		switch (requestedCompression)
+		{
+			case COMPRESSION_AUTO:
+				return varintSupported ? COMPRESSION_VARINT_DEFLATE : COMPRESSION_DEFLATE;
+			case COMPRESSION_VARINT:
+			case COMPRESSION_VARINT_DEFLATE:
+				if (!varintSupported)
+				{
+					cout << "The client does not support varint compression. Using deflate." << endl;
+					return COMPRESSION_DEFLATE;
+				}
+				return requestedCompression;
+			default:
+				return requestedCompression;
+		}
+	}
+
 	SpaceTimeDataController* Server::parseOpenDB(DataSocketStream* receiver)
 	{
 		checkProtocolVersions(receiver);
+		compressionType = negotiateCompression();
 
 		string pathToDB = receiver->readString();
 		DBOpener DBO;
@@ -336,7 +358,7 @@ namespace TraceviewerServer
 
 		if (controller != NULL)
 		{
-			Communication::sendParseOpenDB(pathToDB);
+			Communication::sendParseOpenDB(pathToDB, compressionType);
 		}
 
 		return controller;
@@ -67,9 +67,15 @@
 
 namespace TraceviewerServer
 {
-	extern bool useCompression;
+	extern int requestedCompression;
+	//The CompressionType agreed on with the current client
+	extern int compressionType;
 	extern int mainPortNumber;
 	extern int xmlPortNumber;
+	extern int numThreads;
+	extern bool buildTraceLevels;
+	//Memory for the lines of recent requests, in bytes; 0 turns the cache off
+	extern uint64_t cacheBudget;
 	class Server
 	{
 
@@ -89,12 +95,15 @@ namespace TraceviewerServer
 		void sendXML(DataSocketStream*);
 		void sendDBOpenFailed(DataSocketStream*);
 		void checkProtocolVersions(DataSocketStream* receiver);
+		int negotiateCompression();
 
 		SpaceTimeDataController* controller;
 
 		//Currently not really used, but pretty necessary for future extensions
 		int agreedUponProtocolVersion;
-		static const int SERVER_PROTOCOL_MAX_VERSION = 0x00010001;
+		static const int SERVER_PROTOCOL_MAX_VERSION = 0x00010002;
+		//The first version whose clients decode COMPRESSION_VARINT*
+		static const int PROTOCOL_VERSION_VARINT = 0x00010002;
 
 	};
 }/* namespace TraceviewerServer */
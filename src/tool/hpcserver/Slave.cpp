@@ -70,7 +70,7 @@
 #include "Constants.hpp"
 #include "DBOpener.hpp"
 #include "ImageTraceAttributes.hpp"
-#include "DataCompressionLayer.hpp"
+#include "TimelineEncoder.hpp"
 #include "Server.hpp"
 #include "FilterSet.hpp"
 #include "DebugUtils.hpp"
@@ -109,6 +109,7 @@ namespace TraceviewerServer
 					{//Set an artificial context to avoid initialization crossing cases
 						DBOpener DBO;
 						controller = DBO.openDbAndCreateStdc(string(Message.ofile.path));
+						compressionType = Message.ofile.compressionType;
 					}
 					break;
 				case INFO:
@@ -248,7 +249,7 @@ namespace TraceviewerServer
 			}
 			nextTrace->readInData();
 
-			vector<TimeCPID> ActualData = *nextTrace->data->listCPID;
+			vector<TimeCPID>& ActualData = *nextTrace->data->listCPID;
 
 			MPICommunication::ResultBufferLocations* locs = new MPICommunication::ResultBufferLocations;
 
@@ -265,52 +266,12 @@ namespace TraceviewerServer
 			msg->data.rankID = trueRank;
 
 
-			int i = 0;
-
-			unsigned char* outputBuffer = NULL;
-			DataCompressionLayer* compr = NULL;
-			int outputBufferLen;
-			if (useCompression)
-			{
-				compr = new DataCompressionLayer();
-
-				locs->compressed = true;
-				locs->compMsg = compr;
-
-				Time currentTimestamp = msg->data.begtime;
-				for (i = 0; i < entries; i++)
-				{
-					compr->writeInt((int) (ActualData[i].timestamp - currentTimestamp));
-					compr->writeInt(ActualData[i].cpid);
-					currentTimestamp = ActualData[i].timestamp;
-				}
-				compr->flush();
-				outputBufferLen = compr->getOutputLength();
-				outputBuffer = compr->getOutputBuffer();
-			}
-			else
-			{
-
-				outputBuffer = new unsigned char[entries*SIZEOF_DELTASAMPLE];
-
-				locs->compressed = false;
-				locs->message = outputBuffer;
-
-				char* ptrToFirstElem = (char*)&(outputBuffer[0]);
-				char* currentPtr = ptrToFirstElem;
-				Time currentTimestamp = msg->data.begtime;
-				for (i = 0; i < entries; i++)
-				{
-					int deltaTimestamp = ActualData[i].timestamp - currentTimestamp;
-					ByteUtilities::writeInt(currentPtr, deltaTimestamp);
-					currentPtr += SIZEOF_INT;
-					ByteUtilities::writeInt(currentPtr, ActualData[i].cpid);
-					currentPtr += SIZEOF_INT;
-				}
-				outputBufferLen = entries*SIZEOF_DELTASAMPLE;
-			}
-
+			TimelineEncoder* encoder = new TimelineEncoder(compressionType);
+			encoder->encode(ActualData);
+			locs->encoder = encoder;
 
+			unsigned char* outputBuffer = encoder->getOutputBuffer();
+			int outputBufferLen = encoder->getOutputLength();
 
 			msg->data.compressedSize = outputBufferLen;
 			locs->headerRequest = COMM_WORLD.Isend(msg, sizeof(*msg), MPI_PACKED,
@@ -333,6 +294,7 @@ namespace TraceviewerServer
 		}
 		//Clean up all our MPI buffers.
 		cleanSent(buffers, true);
+		controller->printCacheStats();
 
 
 		return LinesSentCount;
@@ -354,10 +316,7 @@ namespace TraceviewerServer
 			}
 			//Now it is safe to delete everything
 			delete (current->header);
-			if (current->compressed)
-				delete (current->compMsg);
-			else
-				delete (current->message);
+			delete (current->encoder);
 			delete (current);
 			buffers.pop_front();
 		}
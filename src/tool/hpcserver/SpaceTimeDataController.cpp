@@ -58,7 +58,12 @@
 //***************************************************************************
 #include "SpaceTimeDataController.hpp"
 #include "FileData.hpp"
+#include "DebugUtils.hpp"
 #include <iostream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 using namespace std;
 namespace TraceviewerServer
 {
@@ -67,7 +72,8 @@ namespace TraceviewerServer
 //ProcessTimeline** Traces;
 //int TracesLength;
 
-	SpaceTimeDataController::SpaceTimeDataController(FileData* locations)
+	SpaceTimeDataController::SpaceTimeDataController(FileData* locations,
+			uint64_t cacheBudget)
 	{
 		attributes = new ImageTraceAttributes();
 
@@ -80,6 +86,7 @@ namespace TraceviewerServer
 		experimentXML = locations->fileXML;
 		fileTrace = locations->fileTrace;
 		tracesInitialized = false;
+		cache = (cacheBudget > 0) ? new TimelineCache(cacheBudget) : NULL;
 
 	}
 
@@ -92,6 +99,8 @@ namespace TraceviewerServer
 		headerSize = _headerSize;
 		delete dataTrace;
 		dataTrace = new FilteredBaseData(fileTrace, headerSize);
+		if (cache != NULL)
+			cache->clear();
 	}
 
 	int SpaceTimeDataController::getNumRanks()
@@ -104,13 +113,27 @@ namespace TraceviewerServer
 		return experimentXML;
 	}
 
+	TimelineCache* SpaceTimeDataController::getCache()
+	{
+		return cache;
+	}
+
+	void SpaceTimeDataController::printCacheStats()
+	{
+		if (cache == NULL)
+			return;
+		DEBUGCOUT(1) << "Line cache: " << cache->getHits() << " hits, "
+				<< cache->getPartialHits() << " partial hits, " << cache->getMisses()
+				<< " misses, " << cache->getSize() << " bytes" << endl;
+	}
+
 	ProcessTimeline* SpaceTimeDataController::getNextTrace()
 	{
 		if (attributes->lineNum
 				< min(attributes->numPixelsV, attributes->endProcess - attributes->begProcess))
 		{
 			ProcessTimeline* toReturn  = new ProcessTimeline(*attributes, attributes->lineNum, dataTrace,
-					minBegTime + attributes->begTime, headerSize);
+					minBegTime + attributes->begTime, headerSize, cache);
 			attributes->lineNum++;
 			return toReturn;
 		}
@@ -125,21 +148,38 @@ namespace TraceviewerServer
 	}
 
 	//Don't call if in MPI mode
-	void SpaceTimeDataController::fillTraces()
+	void SpaceTimeDataController::fillTraces(int numThreads, TraceLineSink* sink)
 	{
 		//Traces might be null. resetTraces will fix that.
 		resetTraces();
 
-
-		//Taken straight from TimelineThread
-		ProcessTimeline* nextTrace = getNextTrace();
-		while (nextTrace != NULL)
+#ifdef _OPENMP
+		if (numThreads <= 0)
+			numThreads = omp_get_max_threads();
+#else
+		numThreads = 1;
+#endif
+
+		//Lines are independent: each reads its own rank through dataTrace
+		//and lands in its own slot of traces, so they are handed out to the
+		//threads one at a time to balance ranks of very different lengths.
+		Time startingTime = minBegTime + attributes->begTime;
+		int numLines = tracesLength;
+
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) if (numThreads > 1)
+		for (int line = 0; line < numLines; line++)
 		{
+			ProcessTimeline* nextTrace = new ProcessTimeline(*attributes, line, dataTrace,
+					startingTime, headerSize, cache);
 			nextTrace->readInData();
-			addNextTrace(nextTrace);
+			traces[line] = nextTrace;
 
-			nextTrace = getNextTrace();
+			if (sink != NULL)
+				sink->lineFilled(nextTrace);
 		}
+
+		attributes->lineNum = numLines;
+		printCacheStats();
 	}
 
 	 int* SpaceTimeDataController::getValuesXProcessID()
@@ -167,6 +207,9 @@ namespace TraceviewerServer
 	void SpaceTimeDataController::applyFilters(FilterSet filters)
 	{
 		dataTrace->setFilters(filters);
+		//Ranks are numbered after filtering, so the cached lines no longer match
+		if (cache != NULL)
+			cache->clear();
 	}
 	void SpaceTimeDataController::deleteTraces()
 	{
@@ -185,6 +228,7 @@ namespace TraceviewerServer
 	{
 		delete attributes;
 		delete dataTrace;
+		delete cache;
 
 		//The MPI implementation actually doesn't use the Traces array at all!
 		//It does call getNextTrace, but changedBounds is always true so
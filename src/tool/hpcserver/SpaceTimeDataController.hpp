@@ -64,22 +64,36 @@
 #include "FilteredBaseData.hpp"
 #include "FilterSet.hpp"
 #include "TimeCPID.hpp"
+#include "TimelineCache.hpp"
 
 #include <string>
 
 namespace TraceviewerServer
 {
 
+	//Receives each timeline as soon as fillTraces has read it in. With more
+	//than one thread, lineFilled is called concurrently and in no particular
+	//line order.
+	class TraceLineSink
+	{
+	public:
+		virtual ~TraceLineSink() {}
+		virtual void lineFilled(ProcessTimeline*) = 0;
+	};
+
 	class SpaceTimeDataController
 	{
 	public:
 
-		SpaceTimeDataController(FileData*);
+		//cacheBudget is the memory, in bytes, for the lines of recent
+		//requests. 0 turns the cache off.
+		SpaceTimeDataController(FileData*, uint64_t cacheBudget = 0);
 		virtual ~SpaceTimeDataController();
 		void setInfo(Time, Time, int);
 		ProcessTimeline* getNextTrace();
 		void addNextTrace(ProcessTimeline*);
-		void fillTraces();
+		//numThreads <= 0 uses one thread per available core
+		void fillTraces(int numThreads = 1, TraceLineSink* sink = NULL);
 		ProcessTimeline* fillTrace(bool);
 		void applyFilters(FilterSet filters);
 		//The number of processes in the database, independent of the current display size
@@ -89,6 +103,9 @@ namespace TraceviewerServer
 		 short* getValuesXThreadID();
 
 		std::string getExperimentXML();
+		//NULL if the cache is off
+		TimelineCache* getCache();
+		void printCacheStats();
 		ImageTraceAttributes* attributes;
 		ProcessTimeline** traces;
 		int tracesLength;
@@ -98,6 +115,7 @@ namespace TraceviewerServer
 
 		FilteredBaseData* dataTrace;
 		int headerSize;
+		TimelineCache* cache;
 
 		// The minimum beginning and maximum ending time stamp across all traces (in microseconds).
 		Time maxEndTime, minBegTime;
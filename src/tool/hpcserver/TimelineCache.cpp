@@ -0,0 +1,220 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Keeps the trace lines of recent requests so that repeated and
+//   overlapping views do not have to search the trace file again.
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#include "TimelineCache.hpp"
+
+namespace TraceviewerServer
+{
+	TimelineCache::TimelineCache(uint64_t _budget)
+	{
+		budget = _budget;
+		size = 0;
+		hits = 0;
+		partialHits = 0;
+		misses = 0;
+	}
+
+	TimelineCache::~TimelineCache()
+	{
+		clear();
+	}
+
+	bool TimelineCache::find(int rank, Time timeStart, Time timeRange,
+			int numPixelsH, vector<TimeCPID>* line)
+	{
+		lock_guard<mutex> guard(lock);
+		Entry* entry = lookUp(rank, timeStart, timeRange, numPixelsH);
+		if (entry == NULL)
+			return false;
+
+		touch(entry);
+		*line = entry->line;
+		hits++;
+		return true;
+	}
+
+	void TimelineCache::findKnownRecords(int rank, Time timeStart, Time timeRange,
+			vector<KnownRecord>* known)
+	{
+		lock_guard<mutex> guard(lock);
+		map<int, list<Entry*> >::iterator ranksEntries = byRank.find(rank);
+		if (ranksEntries != byRank.end())
+		{
+			list<Entry*>::iterator it = ranksEntries->second.begin();
+			for (; it != ranksEntries->second.end(); ++it)
+			{
+				Entry* entry = *it;
+				if (entry->timeStart <= timeStart + timeRange
+						&& timeStart <= entry->timeStart + entry->timeRange)
+				{
+					touch(entry);
+					*known = entry->known;
+					partialHits++;
+					return;
+				}
+			}
+		}
+		misses++;
+	}
+
+	void TimelineCache::insert(int rank, Time timeStart, Time timeRange,
+			int numPixelsH, const vector<TimeCPID>& line, vector<KnownRecord>& known)
+	{
+		uint64_t entrySize = sizeof(Entry) + line.size() * sizeof(TimeCPID)
+				+ known.size() * sizeof(KnownRecord);
+		if (entrySize > budget)
+			return;
+
+		Entry* entry = new Entry;
+		entry->rank = rank;
+		entry->timeStart = timeStart;
+		entry->timeRange = timeRange;
+		entry->numPixelsH = numPixelsH;
+		entry->line = line;
+		//Swapping with a copy drops the spare capacity of known
+		vector<KnownRecord>(known).swap(entry->known);
+		known.clear();
+		entry->size = entrySize;
+
+		lock_guard<mutex> guard(lock);
+		//Two threads can fill the same line if it is requested twice at once
+		Entry* old = lookUp(rank, timeStart, timeRange, numPixelsH);
+		if (old != NULL)
+			evict(old);
+
+		useOrder.push_front(entry);
+		entry->usePos = useOrder.begin();
+		list<Entry*>& ranksEntries = byRank[rank];
+		ranksEntries.push_front(entry);
+		entry->rankPos = ranksEntries.begin();
+		size += entrySize;
+
+		while (size > budget)
+			evict(useOrder.back());
+	}
+
+	void TimelineCache::clear()
+	{
+		lock_guard<mutex> guard(lock);
+		while (!useOrder.empty())
+			evict(useOrder.back());
+	}
+
+	Long TimelineCache::getHits()
+	{
+		lock_guard<mutex> guard(lock);
+		return hits;
+	}
+
+	Long TimelineCache::getPartialHits()
+	{
+		lock_guard<mutex> guard(lock);
+		return partialHits;
+	}
+
+	Long TimelineCache::getMisses()
+	{
+		lock_guard<mutex> guard(lock);
+		return misses;
+	}
+
+	uint64_t TimelineCache::getSize()
+	{
+		lock_guard<mutex> guard(lock);
+		return size;
+	}
+
+	TimelineCache::Entry* TimelineCache::lookUp(int rank, Time timeStart,
+			Time timeRange, int numPixelsH)
+	{
+		map<int, list<Entry*> >::iterator ranksEntries = byRank.find(rank);
+		if (ranksEntries == byRank.end())
+			return NULL;
+
+		list<Entry*>::iterator it = ranksEntries->second.begin();
+		for (; it != ranksEntries->second.end(); ++it)
+		{
+			Entry* entry = *it;
+			if (entry->timeStart == timeStart && entry->timeRange == timeRange
+					&& entry->numPixelsH == numPixelsH)
+				return entry;
+		}
+		return NULL;
+	}
+
+	void TimelineCache::touch(Entry* entry)
+	{
+		useOrder.splice(useOrder.begin(), useOrder, entry->usePos);
+		list<Entry*>& ranksEntries = byRank[entry->rank];
+		ranksEntries.splice(ranksEntries.begin(), ranksEntries, entry->rankPos);
+	}
+
+	void TimelineCache::evict(Entry* entry)
+	{
+		useOrder.erase(entry->usePos);
+		map<int, list<Entry*> >::iterator ranksEntries = byRank.find(entry->rank);
+		ranksEntries->second.erase(entry->rankPos);
+		if (ranksEntries->second.empty())
+			byRank.erase(ranksEntries);
+		size -= entry->size;
+		delete entry;
+	}
+
+} /* namespace TraceviewerServer */
@@ -0,0 +1,154 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Keeps the trace lines of recent requests so that repeated and
+//   overlapping views do not have to search the trace file again.
+//
+// Description:
+//   Each entry belongs to one rank and one view (start time, time range and
+//   pixel width). It holds the finished line, which answers an identical
+//   request directly, and the records that the searches for the line ended
+//   on. Those are known (time, offset) pairs of the trace file, so a later
+//   view of the same rank that overlaps, such as a pan, starts each search
+//   between the two known records around its time instead of between the
+//   ends of the rank. Entries are evicted least recently used first once
+//   their total size goes over the budget.
+//
+//***************************************************************************
+
+#ifndef TIMELINECACHE_H_
+#define TIMELINECACHE_H_
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+#include "ByteUtilities.hpp" // For Long
+#include "FileUtils.hpp"     // For FileOffset
+#include "TimeCPID.hpp"
+
+using namespace std;
+namespace TraceviewerServer
+{
+	//A record of the trace file whose time is known
+	struct KnownRecord
+	{
+		Time time;
+		FileOffset loc;
+		KnownRecord(Time _time, FileOffset _loc)
+		{
+			time = _time;
+			loc = _loc;
+		}
+	};
+
+	//All methods may be called concurrently from the threads of fillTraces.
+	class TimelineCache
+	{
+	public:
+		//budget is the most memory, in bytes, that the entries may take
+		TimelineCache(uint64_t budget);
+		virtual ~TimelineCache();
+
+		//Copies the line of an identical earlier request into line and
+		//returns true, or returns false if there is none.
+		bool find(int rank, Time timeStart, Time timeRange, int numPixelsH,
+				vector<TimeCPID>* line);
+		//Copies the known records, sorted by offset, of the most recent
+		//request for rank whose time range overlaps this one into known.
+		void findKnownRecords(int rank, Time timeStart, Time timeRange,
+				vector<KnownRecord>* known);
+		//Adds a finished line. known must be sorted by offset and is taken
+		//over by the cache (it is left empty).
+		void insert(int rank, Time timeStart, Time timeRange, int numPixelsH,
+				const vector<TimeCPID>& line, vector<KnownRecord>& known);
+		//Drops every entry. Must be called whenever the lines could change,
+		//i.e. when the filters or the header size change.
+		void clear();
+
+		Long getHits();
+		Long getPartialHits();
+		Long getMisses();
+		uint64_t getSize();
+	private:
+		struct Entry
+		{
+			int rank;
+			Time timeStart, timeRange;
+			int numPixelsH;
+			vector<TimeCPID> line;
+			vector<KnownRecord> known;
+			uint64_t size;
+			list<Entry*>::iterator usePos;
+			list<Entry*>::iterator rankPos;
+		};
+
+		Entry* lookUp(int rank, Time timeStart, Time timeRange, int numPixelsH);
+		void touch(Entry*);
+		void evict(Entry*);
+
+		uint64_t budget;
+		uint64_t size;
+
+		//Most recently used first, over all ranks
+		list<Entry*> useOrder;
+		//Most recently used first, for each rank
+		map<int, list<Entry*> > byRank;
+
+		Long hits, partialHits, misses;
+		mutex lock;
+	};
+
+} /* namespace TraceviewerServer */
+#endif /* TIMELINECACHE_H_ */
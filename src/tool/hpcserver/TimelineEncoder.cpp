@@ -0,0 +1,151 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Encodes a whole trace line for the wire in the negotiated CompressionType.
+//
+// Description:
+//   The records are turned into deltas in one pass over the line rather than
+//   one writeInt at a time, and the deflate stream is reset between lines
+//   rather than set up anew for each one.
+//
+//***************************************************************************
+
+#include "TimelineEncoder.hpp"
+#include "ByteUtilities.hpp"
+#include "Constants.hpp"
+
+namespace TraceviewerServer
+{
+	TimelineEncoder::TimelineEncoder(int _compressionType)
+	{
+		compressionType = _compressionType;
+		encodedLength = 0;
+		deflater = NULL;
+		if (compressionType == COMPRESSION_DEFLATE)
+			deflater = new DataCompressionLayer();
+		else if (compressionType == COMPRESSION_VARINT_DEFLATE)
+			deflater = new DataCompressionLayer(Z_BEST_SPEED);
+	}
+
+	TimelineEncoder::~TimelineEncoder()
+	{
+		delete deflater;
+	}
+
+	void TimelineEncoder::encode(const vector<TimeCPID>& line)
+	{
+		if (compressionType == COMPRESSION_VARINT || compressionType == COMPRESSION_VARINT_DEFLATE)
+			encodeVarint(line);
+		else
+			encodeFixed(line);
+
+		if (deflater != NULL)
+		{
+			deflater->reset();
+			deflater->writeRawData(&encoded[0], encodedLength);
+			deflater->flush();
+		}
+	}
+
+	//The original format: the time delta is truncated to an int
+	void TimelineEncoder::encodeFixed(const vector<TimeCPID>& line)
+	{
+		encoded.resize(line.size() * SIZEOF_DELTASAMPLE);
+		char* out = (char*) &encoded[0];
+
+		Time currentTimestamp = line[0].timestamp;
+		for (vector<TimeCPID>::const_iterator it = line.begin(); it != line.end(); ++it)
+		{
+			ByteUtilities::writeInt(out, (int) (it->timestamp - currentTimestamp));
+			ByteUtilities::writeInt(out + SIZEOF_INT, it->cpid);
+			out += SIZEOF_DELTASAMPLE;
+			currentTimestamp = it->timestamp;
+		}
+		encodedLength = line.size() * SIZEOF_DELTASAMPLE;
+	}
+
+	//Sampled traces advance by roughly the sampling period and stay in the
+	//same few call paths, so both deltas are small and mostly take one or
+	//two bytes. Zigzag keeps negative deltas small too.
+	void TimelineEncoder::encodeVarint(const vector<TimeCPID>& line)
+	{
+		encoded.resize(line.size() * 2 * MAX_VARINT_SIZE);
+		unsigned char* start = &encoded[0];
+		unsigned char* out = start;
+
+		Time currentTimestamp = line[0].timestamp;
+		int currentCpid = 0;
+		for (vector<TimeCPID>::const_iterator it = line.begin(); it != line.end(); ++it)
+		{
+			out = writeVarint(out, zigzag((int64_t) (it->timestamp - currentTimestamp)));
+			out = writeVarint(out, zigzag((int64_t) it->cpid - currentCpid));
+			currentTimestamp = it->timestamp;
+			currentCpid = it->cpid;
+		}
+		encodedLength = out - start;
+	}
+
+	unsigned char* TimelineEncoder::getOutputBuffer()
+	{
+		if (deflater != NULL)
+			return deflater->getOutputBuffer();
+		return &encoded[0];
+	}
+
+	int TimelineEncoder::getOutputLength()
+	{
+		if (deflater != NULL)
+			return deflater->getOutputLength();
+		return encodedLength;
+	}
+
+} /* namespace TraceviewerServer */
@@ -0,0 +1,112 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Encodes a whole trace line for the wire in the negotiated CompressionType.
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#ifndef TIMELINEENCODER_H_
+#define TIMELINEENCODER_H_
+
+#include <vector>
+#include <stdint.h>
+
+#include "DataCompressionLayer.hpp"
+#include "TimeCPID.hpp"
+
+using namespace std;
+namespace TraceviewerServer
+{
+	class TimelineEncoder
+	{
+	public:
+		TimelineEncoder(int compressionType);
+		virtual ~TimelineEncoder();
+
+		//Encodes line, which must not be empty. The output stays valid until
+		//the next call, so one encoder can be reused for many lines.
+		void encode(const vector<TimeCPID>& line);
+		unsigned char* getOutputBuffer();
+		int getOutputLength();
+
+		static uint64_t zigzag(int64_t value)
+		{
+			return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+		}
+		static unsigned char* writeVarint(unsigned char* out, uint64_t value)
+		{
+			while (value >= 0x80)
+			{
+				*out++ = (unsigned char) (value | 0x80);
+				value >>= 7;
+			}
+			*out++ = (unsigned char) value;
+			return out;
+		}
+
+		//The longest a varint of a 64 bit value can be
+		static const int MAX_VARINT_SIZE = 10;
+	private:
+		void encodeFixed(const vector<TimeCPID>& line);
+		void encodeVarint(const vector<TimeCPID>& line);
+
+		int compressionType;
+		vector<unsigned char> encoded;
+		int encodedLength;
+		DataCompressionLayer* deflater;
+	};
+
+} /* namespace TraceviewerServer */
+#endif /* TIMELINEENCODER_H_ */
@@ -61,13 +61,28 @@
 #include <algorithm>
 #include <cstdlib> // previously: cmath but it causes ambuguity in abs function for gcc 4.4.6
 #include "Constants.hpp"
+#include "TraceLevels.hpp"
 #include <iostream>
 
 namespace TraceviewerServer
 {
+	static bool compareLoc(const KnownRecord& a, const KnownRecord& b)
+	{
+		return a.loc < b.loc;
+	}
+
+	static bool equalLoc(const KnownRecord& a, const KnownRecord& b)
+	{
+		return a.loc == b.loc;
+	}
+
+	static bool compareTime(Time time, const KnownRecord& record)
+	{
+		return time < record.time;
+	}
 
 	TraceDataByRank::TraceDataByRank(FilteredBaseData* _data, int _rank,
-			int _numPixelH, int _headerSize)
+			int _numPixelH, int _headerSize, TimelineCache* _cache)
 	{
 		data = _data;
 		rank = _rank;
@@ -75,21 +90,31 @@ namespace TraceviewerServer
 		minloc = data->getMinLoc(rank);
 		maxloc = data->getMaxLoc(rank);
 		numPixelsH = _numPixelH;
+		level = 0;
+		levelStart = 0;
+		cache = _cache;
 
-		
 		listCPID = new vector<TimeCPID>();
 
 	}
 	void TraceDataByRank::getData(Time timeStart, Time timeRange,
 			double pixelLength)
 	{
+		if (cache != NULL)
+		{
+			// an identical request needs no searching at all
+			if (cache->find(rank, timeStart, timeRange, numPixelsH, listCPID))
+				return;
+			cache->findKnownRecords(rank, timeStart, timeRange, &known);
+		}
+
 		// get the start location
-		FileOffset startLoc = findTimeInInterval(timeStart, minloc, maxloc);
+		FileOffset startLoc = findTimeInKnown(timeStart, minloc, maxloc);
 
 		// get the end location
 		 Time endTime = timeStart + timeRange;
 		 FileOffset endLoc = min(
-				findTimeInInterval(endTime, minloc, maxloc) + SIZE_OF_TRACE_RECORD, maxloc);
+				findTimeInKnown(endTime, minloc, maxloc) + SIZE_OF_TRACE_RECORD, maxloc);
 
 		// get the number of records data to display
 		 Long numRec = 1 + getNumberOfRecords(startLoc, endLoc);
@@ -112,6 +137,14 @@ namespace TraceviewerServer
 		{
 			// the data is too big: try to fit the "big" data into the display
 
+			// search the coarsest level that still has a record for every pixel
+			int numLevels = data->getNumLevels(rank);
+			while (level < numLevels
+					&& (numRec >> (TraceLevels::LOG_DECIMATION * (level + 1))) >= numPixelsH)
+				level++;
+			if (level > 0)
+				levelStart = data->getLevelStart(rank, level);
+
 			//fills in the rest of the data for this process timeline
 			sampleTimeLine(startLoc, endLoc, 0, numPixelsH, 0, pixelLength, timeStart);
 		}
@@ -135,6 +168,14 @@ namespace TraceviewerServer
 			addSample(0, dataFirst);
 		}
 		postProcess();
+
+		if (cache != NULL)
+		{
+			sort(found.begin(), found.end(), compareLoc);
+			found.erase(unique(found.begin(), found.end(), equalLoc), found.end());
+			cache->insert(rank, timeStart, timeRange, numPixelsH, *listCPID, found);
+			vector<KnownRecord>().swap(known);
+		}
 	}
 	/*******************************************************************************************
 	 * Recursive method that fills in times and timeLine with the correct data from the file.
@@ -159,7 +200,7 @@ namespace TraceviewerServer
 		if (midPixel == startPixel)
 			return 0;
 
-		Long loc = findTimeInInterval((long)(midPixel * pixelLength + startingTime), minLoc,
+		Long loc = findTimeInKnown((long)(midPixel * pixelLength + startingTime), minLoc,
 				maxLoc);
 		 TimeCPID nextData = getData(loc);
 		addSample(minIndex, nextData);
@@ -202,7 +243,9 @@ namespace TraceviewerServer
 			//rate instead. This line of code and the one in the else block account for
 			//about 40% of the computation once the data is in memory
 			//double rate = (r_time - l_time) / (r_index - l_index);
-			double invrate = (r_index - l_index) / (r_time - l_time);
+			//Equal times at both ends would divide by zero; fall back to stepping
+			//in from one end in that case.
+			double invrate = (r_time > l_time) ? (r_index - l_index) / (r_time - l_time) : 0;
 			Time mtime = (r_time - l_time) / 2;
 			if (time <= mtime)
 			{
@@ -238,6 +281,12 @@ namespace TraceviewerServer
 		l_time = data->getLong(l_offset);
 		r_time = data->getLong(r_offset);
 
+		if (cache != NULL)
+		{
+			found.push_back(KnownRecord(l_time, l_offset));
+			found.push_back(KnownRecord(r_time, r_offset));
+		}
+
 		int leftDiff = time - l_time;
 		int rightDiff = r_time - time;
 		 bool is_left_closer = abs(leftDiff) < abs(rightDiff);
@@ -248,6 +297,76 @@ namespace TraceviewerServer
 		else
 			return maxloc;
 	}
+	/*********************************************************************************
+	 *	Same result as findTimeInInterval, but first narrows the interval down with
+	 *	the current level. findTimeInInterval ends on the last record in
+	 *	(l_boundOffset, r_boundOffset) whose time is <= time (or on l_boundOffset if
+	 *	there is none) and its successor. The last level entry in that range with a
+	 *	time <= time and the entry after it bracket the same pair, so searching
+	 *	between them picks the same record while touching only a few pages of the
+	 *	trace file.
+	 ********************************************************************************/
+	FileOffset TraceDataByRank::findTimeInLevel(Time time, FileOffset l_boundOffset,
+			FileOffset r_boundOffset)
+	{
+		if (level == 0 || l_boundOffset == r_boundOffset)
+			return findTimeInInterval(time, l_boundOffset, r_boundOffset);
+
+		int shift = TraceLevels::LOG_DECIMATION * level;
+		FileOffset l_index = getRelativeLocation(l_boundOffset);
+		FileOffset r_index = getRelativeLocation(r_boundOffset);
+
+		// level entries whose records lie in (l_index, r_index - 1]
+		Long lo = (l_index >> shift) + 1;
+		Long hi = (r_index - 1) >> shift;
+
+		// binary search for the last entry <= time; below and above end up
+		// on the entries on either side of it
+		Long below = lo - 1;
+		Long above = hi + 1;
+		while (above - below > 1)
+		{
+			Long mid = below + (above - below) / 2;
+			if ((Time) data->getLevelTime(levelStart, mid) <= time)
+				below = mid;
+			else
+				above = mid;
+		}
+
+		if (below >= lo)
+			l_boundOffset = getAbsoluteLocation(below << shift);
+		if (above <= hi)
+			r_boundOffset = getAbsoluteLocation(above << shift);
+		return findTimeInInterval(time, l_boundOffset, r_boundOffset);
+	}
+
+	/*********************************************************************************
+	 *	Same result as findTimeInLevel, but first narrows the interval down to the
+	 *	last known record whose time is <= time and the first one whose time is
+	 *	greater. Like the level entries, they bracket the pair that
+	 *	findTimeInInterval ends on, so a time that an earlier request already
+	 *	searched for is found without reading anything in between.
+	 ********************************************************************************/
+	FileOffset TraceDataByRank::findTimeInKnown(Time time, FileOffset l_boundOffset,
+			FileOffset r_boundOffset)
+	{
+		if (!known.empty())
+		{
+			vector<KnownRecord>::iterator above = upper_bound(known.begin(),
+					known.end(), time, compareTime);
+			if (above != known.end() && above->loc > l_boundOffset
+					&& above->loc < r_boundOffset)
+				r_boundOffset = above->loc;
+			if (above != known.begin())
+			{
+				vector<KnownRecord>::iterator below = above - 1;
+				if (below->loc > l_boundOffset && below->loc < r_boundOffset)
+					l_boundOffset = below->loc;
+			}
+		}
+		return findTimeInLevel(time, l_boundOffset, r_boundOffset);
+	}
+
 	FileOffset TraceDataByRank::getAbsoluteLocation(FileOffset relativePosition)
 	{
 		return minloc + (relativePosition * SIZE_OF_TRACE_RECORD);
@@ -65,6 +65,7 @@
 #include "TimeCPID.hpp"
 #include "FilteredBaseData.hpp"
 #include "FileUtils.hpp"//FileOffset
+#include "TimelineCache.hpp"
 
 namespace TraceviewerServer
 {
@@ -73,12 +74,14 @@ namespace TraceviewerServer
 	{
 	public:
 
-		TraceDataByRank(FilteredBaseData*, int, int, int);
+		TraceDataByRank(FilteredBaseData*, int, int, int, TimelineCache* = NULL);
 		virtual ~TraceDataByRank();
 
 		void getData(Time timeStart, Time timeRange, double pixelLength);
 		int sampleTimeLine(FileOffset minLoc, FileOffset maxLoc, int startPixel, int endPixel, int minIndex, double pixelLength, Time startingTime);
 		FileOffset findTimeInInterval(Time time, FileOffset l_boundOffset, FileOffset r_boundOffset);
+		FileOffset findTimeInLevel(Time time, FileOffset l_boundOffset, FileOffset r_boundOffset);
+		FileOffset findTimeInKnown(Time time, FileOffset l_boundOffset, FileOffset r_boundOffset);
 
 
 
@@ -91,6 +94,18 @@ namespace TraceviewerServer
 		FileOffset maxloc;
 		int numPixelsH;
 
+		//The downsampled level that findTimeInLevel searches first; 0 for none
+		int level;
+		FileOffset levelStart;
+
+		//NULL if lines are not cached
+		TimelineCache* cache;
+		//Records of an earlier overlapping request, sorted by offset, that
+		//findTimeInKnown narrows searches down with
+		vector<KnownRecord> known;
+		//Records that the searches for this line ended on
+		vector<KnownRecord> found;
+
 		FileOffset getAbsoluteLocation(FileOffset);
 
 		FileOffset getRelativeLocation(FileOffset);
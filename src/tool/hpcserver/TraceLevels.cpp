@@ -0,0 +1,285 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Builds and maps the downsampled timestamp levels of a merged trace file.
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#include "TraceLevels.hpp"
+#include "DataOutputFileStream.hpp"
+#include "DebugUtils.hpp"
+#include "ProgressBar.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <vector>
+
+using namespace std;
+namespace TraceviewerServer
+{
+	//From lib/prof-lean/hpcrun-fmt.h: a 24 byte header for version 01.00,
+	//followed by 8 bytes of flags since 01.01
+	#define TRACE_MAGIC "HPCRUN-trace______"
+	#define TRACE_MAGIC_LEN 18
+	#define TRACE_VERSION_LEN 5
+	#define TRACE_HEADER_SIZE_V100 24
+	#define TRACE_HEADER_SIZE_V101 32
+
+	TraceLevels::TraceLevels(string mergedFile, int headerSize, int _numRanks)
+	{
+		mapping = NULL;
+		mappingSize = 0;
+		numRanks = _numRanks;
+
+		string levelsFile = getLevelsFile(mergedFile);
+		struct stat levelsInfo, mergedInfo;
+		if (stat(levelsFile.c_str(), &levelsInfo) != 0 || stat(mergedFile.c_str(), &mergedInfo) != 0)
+			return;
+		//Levels older than the merged file were built for a different one
+		if (levelsInfo.st_mtime < mergedInfo.st_mtime)
+			return;
+
+		FileOffset size = levelsInfo.st_size;
+		if (size < (FileOffset) (LEVELS_HEADER_SIZE + numRanks * LEVELS_RANK_ENTRY_SIZE + SIZEOF_LONG))
+			return;
+
+		FileDescriptor fd = open(levelsFile.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+		void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED)
+			return;
+
+		char* header = (char*) map;
+		uint64_t marker = ByteUtilities::readLong(header + size - SIZEOF_LONG);
+		if (ByteUtilities::readInt(header) != LEVELS_MAGIC
+				|| ByteUtilities::readInt(header + SIZEOF_INT) != LEVELS_VERSION
+				|| ByteUtilities::readInt(header + 2 * SIZEOF_INT) != headerSize
+				|| ByteUtilities::readInt(header + 3 * SIZEOF_INT) != numRanks
+				|| marker != MARKER_END_LEVELS_FILE)
+		{
+			DEBUGCOUT(1) << "Ignoring trace levels in " << levelsFile << endl;
+			munmap(map, size);
+			return;
+		}
+
+		mapping = header;
+		mappingSize = size;
+		DEBUGCOUT(1) << "Using trace levels in " << levelsFile << endl;
+	}
+
+	TraceLevels::~TraceLevels()
+	{
+		if (mapping != NULL)
+			munmap(mapping, mappingSize);
+	}
+
+	bool TraceLevels::isValid()
+	{
+		return mapping != NULL;
+	}
+
+	int TraceLevels::getNumLevels(int rank)
+	{
+		char* entry = mapping + LEVELS_HEADER_SIZE + rank * LEVELS_RANK_ENTRY_SIZE;
+		return levelsFor(ByteUtilities::readLong(entry + SIZEOF_LONG));
+	}
+
+	FileOffset TraceLevels::getLevelStart(int rank, int level)
+	{
+		char* entry = mapping + LEVELS_HEADER_SIZE + rank * LEVELS_RANK_ENTRY_SIZE;
+		FileOffset start = ByteUtilities::readLong(entry);
+		Long numRecords = ByteUtilities::readLong(entry + SIZEOF_LONG);
+		for (int i = 1; i < level; i++)
+			start += recordsAt(numRecords, i) * SIZEOF_LONG;
+		return start;
+	}
+
+	string TraceLevels::getLevelsFile(string mergedFile)
+	{
+		return mergedFile + ".levels";
+	}
+
+	//Only levels with at least two entries are kept: a single entry does not
+	//narrow a search down any further than the rank's own bounds do.
+	int TraceLevels::levelsFor(Long numRecords)
+	{
+		int levels = 0;
+		while (numRecords > 1 && ((numRecords - 1) >> (LOG_DECIMATION * (levels + 1))) > 0)
+			levels++;
+		return levels;
+	}
+
+	Long TraceLevels::recordsAt(Long numRecords, int level)
+	{
+		if (numRecords <= 0)
+			return 0;
+		return ((numRecords - 1) >> (LOG_DECIMATION * level)) + 1;
+	}
+
+	int TraceLevels::readHeaderSize(ifstream& merged, FileOffset rankStart)
+	{
+		char magic[TRACE_MAGIC_LEN + TRACE_VERSION_LEN];
+		merged.seekg(rankStart, ios_base::beg);
+		merged.read(magic, sizeof(magic));
+		if (merged.gcount() != sizeof(magic) || memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_LEN) != 0)
+			return -1;
+		if (memcmp(magic + TRACE_MAGIC_LEN, "01.00", TRACE_VERSION_LEN) == 0)
+			return TRACE_HEADER_SIZE_V100;
+		return TRACE_HEADER_SIZE_V101;
+	}
+
+	bool TraceLevels::build(string mergedFile)
+	{
+		ifstream merged(mergedFile.c_str(), ios_base::binary | ios_base::in);
+		if (!merged)
+			return false;
+
+		//Same layout as BaseDataFile::setData reads
+		char buffer[SIZEOF_LONG];
+		merged.read(buffer, SIZEOF_INT); //type
+		merged.read(buffer, SIZEOF_INT);
+		int numFiles = ByteUtilities::readInt(buffer);
+		if (!merged || numFiles <= 0)
+			return false;
+
+		vector<FileOffset> starts(numFiles + 1);
+		for (int i = 0; i < numFiles; i++)
+		{
+			merged.read(buffer, 2 * SIZEOF_INT); //proc and thread ID
+			merged.read(buffer, SIZEOF_LONG);
+			starts[i] = ByteUtilities::readLong(buffer);
+		}
+		//The merged file ends with a long marker after the last rank
+		starts[numFiles] = FileUtils::getFileSize(mergedFile) - SIZEOF_LONG;
+		if (!merged)
+			return false;
+
+		int headerSize = readHeaderSize(merged, starts[0]);
+		if (headerSize < 0)
+			return false;
+
+		string levelsFile = getLevelsFile(mergedFile);
+		DataOutputFileStream dos(levelsFile.c_str());
+		dos.writeInt(LEVELS_MAGIC);
+		dos.writeInt(LEVELS_VERSION);
+		dos.writeInt(headerSize);
+		dos.writeInt(numFiles);
+
+		vector<Long> numRecords(numFiles);
+		FileOffset levelStart = LEVELS_HEADER_SIZE + numFiles * LEVELS_RANK_ENTRY_SIZE;
+		for (int i = 0; i < numFiles; i++)
+		{
+			Long dataSize = starts[i + 1] - starts[i] - headerSize;
+			numRecords[i] = dataSize > 0 ? dataSize / SIZE_OF_TRACE_RECORD : 0;
+			dos.writeLong(levelStart);
+			dos.writeLong(numRecords[i]);
+			for (int level = 1; level <= levelsFor(numRecords[i]); level++)
+				levelStart += recordsAt(numRecords[i], level) * SIZEOF_LONG;
+		}
+
+		ProgressBar prog("Building trace levels", numFiles);
+		const int RECORDS_PER_READ = 4096;
+		vector<char> records(RECORDS_PER_READ * SIZE_OF_TRACE_RECORD);
+		for (int i = 0; i < numFiles; i++)
+		{
+			int numLevels = levelsFor(numRecords[i]);
+			vector<Time> times;
+			times.reserve(recordsAt(numRecords[i], 1));
+
+			merged.seekg(starts[i] + headerSize, ios_base::beg);
+			for (Long index = 0; numLevels > 0 && index < numRecords[i];)
+			{
+				Long count = min((Long) RECORDS_PER_READ, numRecords[i] - index);
+				merged.read(&records[0], count * SIZE_OF_TRACE_RECORD);
+				if (merged.gcount() != (streamsize) (count * SIZE_OF_TRACE_RECORD))
+				{
+					dos.close();
+					remove(levelsFile.c_str());
+					return false;
+				}
+				for (Long j = 0; j < count; j++, index++)
+				{
+					if ((index & (DECIMATION - 1)) == 0)
+						times.push_back(ByteUtilities::readLong(&records[j * SIZE_OF_TRACE_RECORD]));
+				}
+			}
+
+			//Each level is every DECIMATION-th entry of the one below it, so
+			//it can be compacted in place once the level below is written
+			for (int level = 1; level <= numLevels; level++)
+			{
+				Long count = recordsAt(numRecords[i], level);
+				for (Long j = 0; j < count; j++)
+				{
+					if (level > 1)
+						times[j] = times[j * DECIMATION];
+					dos.writeLong(times[j]);
+				}
+			}
+			prog.incrementProgress();
+		}
+
+		dos.writeLong(MARKER_END_LEVELS_FILE);
+		dos.close();
+		return !dos.fail();
+	}
+
+} /* namespace TraceviewerServer */
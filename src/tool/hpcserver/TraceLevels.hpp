@@ -0,0 +1,126 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Downsampled copies of the timestamps in the merged trace file. Level k
+//   of a rank holds the time of every 4^k-th record of that rank. The levels
+//   are an index over the merged file: a search first narrows down to
+//   two neighbouring level entries, and then finishes between them in the
+//   merged file.
+//
+// Description:
+//   The levels live in their own file next to the merged file. All values
+//   are big-endian, like in the merged file:
+//     int magic, int version, int header size, int number of ranks
+//     for each rank: long offset of its level 1, long number of records
+//     for each rank: the times of level 1, then level 2, and so on
+//     long end marker
+//
+//***************************************************************************
+
+#ifndef TRACELEVELS_H_
+#define TRACELEVELS_H_
+
+#include <fstream>
+#include <string>
+#include <stdint.h>
+
+#include "ByteUtilities.hpp" // For Long
+#include "Constants.hpp"
+#include "FileUtils.hpp"     // For FileOffset
+#include "TimeCPID.hpp"      // For Time
+
+using namespace std;
+namespace TraceviewerServer
+{
+	class TraceLevels
+	{
+	public:
+		//Maps the levels that were built for mergedFile. isValid() is false
+		//if there are none, or if they were built for a different header size.
+		TraceLevels(string mergedFile, int headerSize, int numRanks);
+		virtual ~TraceLevels();
+
+		bool isValid();
+		int getNumLevels(int rank);
+		FileOffset getLevelStart(int rank, int level);
+		//The time of the record at index << (LOG_DECIMATION * level) within
+		//the rank, where levelStart comes from getLevelStart
+		Time getTime(FileOffset levelStart, Long index)
+		{
+			return ByteUtilities::readLong(mapping + levelStart + index * SIZEOF_LONG);
+		}
+
+		//Scans mergedFile and writes its levels. Returns false on failure.
+		static bool build(string mergedFile);
+		static string getLevelsFile(string mergedFile);
+
+		//Each level keeps one record out of DECIMATION of the level below it
+		static const int DECIMATION = 4;
+		static const int LOG_DECIMATION = 2;
+	private:
+		static int levelsFor(Long numRecords);
+		static Long recordsAt(Long numRecords, int level);
+		static int readHeaderSize(ifstream& merged, FileOffset rankStart);
+
+		char* mapping;
+		FileOffset mappingSize;
+		int numRanks;
+
+		static const int LEVELS_MAGIC = 0x4C564C53; //LVLS
+		static const int LEVELS_VERSION = 1;
+		static const int LEVELS_HEADER_SIZE = 4 * SIZEOF_INT;
+		static const int LEVELS_RANK_ENTRY_SIZE = 2 * SIZEOF_LONG;
+		static const uint64_t MARKER_END_LEVELS_FILE = 0xFFFFFFFFDEADF00D;
+	};
+
+} /* namespace TraceviewerServer */
+#endif /* TRACELEVELS_H_ */
@@ -0,0 +1,224 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Checks that a sequence of zooms, pans and returns to earlier views gives
+//   the same timelines with the line cache as without it, and reports how
+//   long each takes.
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#undef NDEBUG
+
+#include "../ByteUtilities.hpp"
+#include "../Constants.hpp"
+#include "../FileData.hpp"
+#include "../ProcessTimeline.hpp"
+#include "../SpaceTimeDataController.hpp"
+#include "../TimeCPID.hpp"
+#include "../TimelineCache.hpp"
+#include "../TraceDataByRank.hpp"
+
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+using namespace TraceviewerServer;
+
+#define CT_RANKS 16
+#define CT_RECORDS_PER_RANK 300000
+#define CT_HEADER_SIZE 32
+#define CT_PIXELS 1500
+
+//Writes a merged trace database with version 01.01 hpctrace headers
+static Time writeCacheDB(const char* path)
+{
+	FILE* f = fopen(path, "wb");
+	assert(f != NULL);
+	char b[CT_HEADER_SIZE];
+
+	int headerLen = 2 * SIZEOF_INT + CT_RANKS * (2 * SIZEOF_INT + SIZEOF_LONG);
+	Long rankLen = CT_HEADER_SIZE + (Long) CT_RECORDS_PER_RANK * SIZE_OF_TRACE_RECORD;
+	ByteUtilities::writeInt(b, MULTI_PROCESSES);
+	fwrite(b, 1, SIZEOF_INT, f);
+	ByteUtilities::writeInt(b, CT_RANKS);
+	fwrite(b, 1, SIZEOF_INT, f);
+	for (int rank = 0; rank < CT_RANKS; rank++) {
+		ByteUtilities::writeInt(b, rank);
+		fwrite(b, 1, SIZEOF_INT, f);
+		ByteUtilities::writeInt(b, 0);
+		fwrite(b, 1, SIZEOF_INT, f);
+		ByteUtilities::writeLong(b, headerLen + rank * rankLen);
+		fwrite(b, 1, SIZEOF_LONG, f);
+	}
+
+	srand(4099);
+	Time maxTime = 0;
+	for (int rank = 0; rank < CT_RANKS; rank++) {
+		memset(b, 0, CT_HEADER_SIZE);
+		memcpy(b, "HPCRUN-trace______01.01b", 24);
+		fwrite(b, 1, CT_HEADER_SIZE, f);
+
+		Time t = 1000;
+		for (int rec = 0; rec < CT_RECORDS_PER_RANK; rec++) {
+			t += rand() % (3 + rank % 5);
+			ByteUtilities::writeLong(b, t);
+			fwrite(b, 1, SIZEOF_LONG, f);
+			ByteUtilities::writeInt(b, rand() % 500);
+			fwrite(b, 1, SIZEOF_INT, f);
+		}
+		maxTime = max(maxTime, t);
+	}
+
+	ByteUtilities::writeLong(b, 0xFFFFFFFFDEADF00D);
+	fwrite(b, 1, SIZEOF_LONG, f);
+	fclose(f);
+	return maxTime;
+}
+
+//Walks through the views a user might: zoom in to the middle, pan by whole
+//and by partial pixels, zoom back out to views seen before. Returns the time
+//taken.
+static double browse(const char* path, Time maxTime, uint64_t budget,
+		vector<vector<TimeCPID> >& lines)
+{
+	FileData location;
+	location.fileTrace = path;
+	SpaceTimeDataController* controller = new SpaceTimeDataController(&location, budget);
+	controller->setInfo(0, maxTime, CT_HEADER_SIZE);
+
+	ImageTraceAttributes* attributes = controller->attributes;
+	attributes->begProcess = 0;
+	attributes->endProcess = CT_RANKS;
+	attributes->numPixelsH = CT_PIXELS;
+	attributes->numPixelsV = CT_RANKS;
+
+	//The zoom level halves the time range, and the pan moves the view right
+	//by that many hundredths of a pixel
+	int zoom[] = {0, 1, 2, 2, 2, 2, 1, 0, 3, 0};
+	long pan[] = {0, 0, 0, 100, 250, 175, 0, 0, 40, 0};
+	int numViews = sizeof(zoom) / sizeof(zoom[0]);
+
+	lines.clear();
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int view = 0; view < numViews; view++) {
+		long width = maxTime >> zoom[view];
+		attributes->begTime = (maxTime - width) / 2 + width * pan[view] / (100 * CT_PIXELS);
+		attributes->endTime = attributes->begTime + width;
+
+		controller->fillTraces();
+		for (int i = 0; i < controller->tracesLength; i++)
+			lines.push_back(*controller->traces[i]->data->listCPID);
+	}
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	TimelineCache* cache = controller->getCache();
+	if (cache != NULL) {
+		cout << "Line cache: " << cache->getHits() << " hits, "
+				<< cache->getPartialHits() << " partial hits, "
+				<< cache->getMisses() << " misses, " << cache->getSize()
+				<< " bytes." << endl;
+		assert(cache->getSize() <= budget);
+	}
+	delete controller;
+	return elapsed.count();
+}
+
+static void assertSameLines(vector<vector<TimeCPID> >& expected,
+		vector<vector<TimeCPID> >& actual)
+{
+	assert(expected.size() == actual.size());
+	for (size_t i = 0; i < expected.size(); i++) {
+		assert(expected[i].size() == actual[i].size());
+		for (size_t j = 0; j < expected[i].size(); j++) {
+			assert(expected[i][j].timestamp == actual[i][j].timestamp);
+			assert(expected[i][j].cpid == actual[i][j].cpid);
+		}
+	}
+}
+
+void cacheTest()
+{
+	char path[] = "/tmp/cacheTestXXXXXX";
+	int fd = mkstemp(path);
+	assert(fd >= 0);
+	close(fd);
+	Time maxTime = writeCacheDB(path);
+
+	vector<vector<TimeCPID> > uncached, cached;
+	//Once to fault the file in, then once to time it
+	browse(path, maxTime, 0, uncached);
+	double uncachedTime = browse(path, maxTime, 0, uncached);
+	double cachedTime = browse(path, maxTime, DEFAULT_CACHE_BUDGET, cached);
+
+	assertSameLines(uncached, cached);
+
+	//A budget too small for any line must still give the same timelines
+	browse(path, maxTime, 1024, cached);
+	assertSameLines(uncached, cached);
+
+	cout << "Browsed " << CT_RANKS << " ranks in " << uncachedTime * 1000
+			<< " ms without the line cache and " << cachedTime * 1000
+			<< " ms with it." << endl;
+	cout << "Line cache correctness verified." << endl;
+
+	unlink(path);
+}
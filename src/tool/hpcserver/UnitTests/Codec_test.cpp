@@ -0,0 +1,229 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Measures encode throughput and size of each trace line CompressionType
+//   and checks that the varint encodings decode back to the original lines.
+//
+// Description:
+//   Lines are synthesized in two shapes: periodic samples that mostly stay
+//   in the same call path, and dense GPU activity that switches between a
+//   few kernels. Setting CODEC_TEST_TRACE to an .hpctrace file also runs
+//   the lines of that trace.
+//
+//***************************************************************************
+
+#undef NDEBUG
+
+#include "../ByteUtilities.hpp"
+#include "../Constants.hpp"
+#include "../TimeCPID.hpp"
+#include "../TimelineEncoder.hpp"
+
+#include <zlib.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+using namespace TraceviewerServer;
+
+#define CT_LINES 1000
+#define CT_LINE_LENGTH 2000
+
+typedef vector<vector<TimeCPID> > Lines;
+
+static Lines sampledLines()
+{
+	Lines lines(CT_LINES);
+	srand(4417);
+	for (int i = 0; i < CT_LINES; i++) {
+		Time t = 1400000000000000000ULL + rand() % 1000000;
+		int cpid = 1 + rand() % 500;
+		for (int j = 0; j < CT_LINE_LENGTH; j++) {
+			//5 ms period with some jitter; 70% of samples stay in the same path
+			t += 5000000 - 250000 + rand() % 500000;
+			if (rand() % 10 >= 7)
+				cpid = 1 + (rand() % 500) * (rand() % 500) / 500;
+			lines[i].push_back(TimeCPID(t, cpid));
+		}
+	}
+	return lines;
+}
+
+static Lines gpuLines()
+{
+	Lines lines(CT_LINES);
+	srand(4418);
+	for (int i = 0; i < CT_LINES; i++) {
+		Time t = 1400000000000000000ULL;
+		for (int j = 0; j < CT_LINE_LENGTH; j++) {
+			//Kernels of a few microseconds, separated by idle gaps
+			t += (j % 2 == 0) ? 1000 + rand() % 20000 : 100 + rand() % 3000;
+			int cpid = (j % 2 == 0) ? 7000 + rand() % 6 : 0;
+			lines[i].push_back(TimeCPID(t, cpid));
+		}
+	}
+	return lines;
+}
+
+//Cuts the records of an hpctrace file into lines of CT_LINE_LENGTH
+static Lines fileLines(const char* path)
+{
+	Lines lines;
+	FILE* f = fopen(path, "rb");
+	if (f == NULL)
+		return lines;
+
+	char header[32];
+	size_t headerSize = fread(header, 1, 24, f) == 24 && memcmp(header + 18, "01.00", 5) == 0 ? 24 : 32;
+	fseek(f, headerSize, SEEK_SET);
+
+	char record[SIZE_OF_TRACE_RECORD];
+	vector<TimeCPID> line;
+	while (fread(record, 1, SIZE_OF_TRACE_RECORD, f) == SIZE_OF_TRACE_RECORD) {
+		line.push_back(TimeCPID(ByteUtilities::readLong(record),
+				ByteUtilities::readInt(record + SIZEOF_LONG)));
+		if (line.size() == CT_LINE_LENGTH) {
+			lines.push_back(line);
+			line.clear();
+		}
+	}
+	if (!line.empty())
+		lines.push_back(line);
+	fclose(f);
+	return lines;
+}
+
+static uint64_t readVarint(const unsigned char*& in)
+{
+	uint64_t value = 0;
+	int shift = 0;
+	while (*in & 0x80) {
+		value |= (uint64_t) (*in++ & 0x7F) << shift;
+		shift += 7;
+	}
+	value |= (uint64_t) *in++ << shift;
+	return value;
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+	return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+static void checkDecode(int type, const vector<TimeCPID>& line, unsigned char* buf, int len)
+{
+	vector<unsigned char> inflated;
+	if (type == COMPRESSION_VARINT_DEFLATE) {
+		inflated.resize(line.size() * 2 * TimelineEncoder::MAX_VARINT_SIZE);
+		uLongf inflatedLen = inflated.size();
+		assert(uncompress(&inflated[0], &inflatedLen, buf, len) == Z_OK);
+		buf = &inflated[0];
+	}
+
+	const unsigned char* in = buf;
+	Time t = line[0].timestamp;
+	int cpid = 0;
+	for (size_t i = 0; i < line.size(); i++) {
+		t += unzigzag(readVarint(in));
+		cpid += unzigzag(readVarint(in));
+		assert(t == line[i].timestamp);
+		assert(cpid == line[i].cpid);
+	}
+}
+
+static void runCodecs(const char* shape, const Lines& lines)
+{
+	static const char* names[] = { "none", "deflate", "varint", "varint-deflate" };
+
+	uint64_t records = 0;
+	for (size_t i = 0; i < lines.size(); i++)
+		records += lines[i].size();
+
+	for (int type = COMPRESSION_NONE; type <= COMPRESSION_VARINT_DEFLATE; type++) {
+		TimelineEncoder encoder(type);
+		uint64_t bytes = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (size_t i = 0; i < lines.size(); i++) {
+			encoder.encode(lines[i]);
+			bytes += encoder.getOutputLength();
+		}
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+		if (type >= COMPRESSION_VARINT)
+			for (size_t i = 0; i < lines.size(); i++) {
+				encoder.encode(lines[i]);
+				checkDecode(type, lines[i], encoder.getOutputBuffer(), encoder.getOutputLength());
+			}
+
+		printf("%-8s %-15s %8.1f Mrecords/s %6.2f bytes/record\n", shape, names[type],
+				records / elapsed.count() / 1e6, (double) bytes / records);
+	}
+}
+
+void codecTest()
+{
+	runCodecs("sampled", sampledLines());
+	runCodecs("gpu", gpuLines());
+	const char* trace = getenv("CODEC_TEST_TRACE");
+	if (trace != NULL) {
+		Lines lines = fileLines(trace);
+		if (!lines.empty())
+			runCodecs("file", lines);
+	}
+	cout << "Codec correctness verified." << endl;
+}
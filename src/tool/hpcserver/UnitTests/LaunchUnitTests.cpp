@@ -61,6 +61,10 @@ extern void filterTest();
 extern void progBarTest();
 extern void compressionTest();
 extern void lruTest();
+extern void timelineTest();
+extern void levelsTest();
+extern void codecTest();
+extern void cacheTest();
 
 int main(int argc, char** argv)
 {
@@ -68,5 +72,9 @@ int main(int argc, char** argv)
 	compressionTest();
 	progBarTest();
 	filterTest();
+	timelineTest();
+	levelsTest();
+	codecTest();
+	cacheTest();
 }
 
@@ -0,0 +1,200 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Checks that timelines sampled with the help of the trace levels are the
+//   same as timelines sampled from the merged file alone, and reports how
+//   long each takes.
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#undef NDEBUG
+
+#include "../ByteUtilities.hpp"
+#include "../Constants.hpp"
+#include "../FileData.hpp"
+#include "../ProcessTimeline.hpp"
+#include "../SpaceTimeDataController.hpp"
+#include "../TimeCPID.hpp"
+#include "../TraceDataByRank.hpp"
+#include "../TraceLevels.hpp"
+
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+using namespace TraceviewerServer;
+
+#define LV_RANKS 16
+#define LV_RECORDS_PER_RANK 300000
+#define LV_HEADER_SIZE 32
+#define LV_VIEWS 20
+
+//Writes a merged trace database the way MergeDataFiles::merge does, with
+//version 01.01 hpctrace headers. Time steps of 0 give runs of equal times.
+static Time writeLevelsDB(const char* path)
+{
+	FILE* f = fopen(path, "wb");
+	assert(f != NULL);
+	char b[LV_HEADER_SIZE];
+
+	int headerLen = 2 * SIZEOF_INT + LV_RANKS * (2 * SIZEOF_INT + SIZEOF_LONG);
+	Long rankLen = LV_HEADER_SIZE + (Long) LV_RECORDS_PER_RANK * SIZE_OF_TRACE_RECORD;
+	ByteUtilities::writeInt(b, MULTI_PROCESSES);
+	fwrite(b, 1, SIZEOF_INT, f);
+	ByteUtilities::writeInt(b, LV_RANKS);
+	fwrite(b, 1, SIZEOF_INT, f);
+	for (int rank = 0; rank < LV_RANKS; rank++) {
+		ByteUtilities::writeInt(b, rank);
+		fwrite(b, 1, SIZEOF_INT, f);
+		ByteUtilities::writeInt(b, 0);
+		fwrite(b, 1, SIZEOF_INT, f);
+		ByteUtilities::writeLong(b, headerLen + rank * rankLen);
+		fwrite(b, 1, SIZEOF_LONG, f);
+	}
+
+	srand(2203);
+	Time maxTime = 0;
+	for (int rank = 0; rank < LV_RANKS; rank++) {
+		memset(b, 0, LV_HEADER_SIZE);
+		memcpy(b, "HPCRUN-trace______01.01b", 24);
+		fwrite(b, 1, LV_HEADER_SIZE, f);
+
+		Time t = 1000;
+		for (int rec = 0; rec < LV_RECORDS_PER_RANK; rec++) {
+			t += rand() % (3 + rank % 5);
+			ByteUtilities::writeLong(b, t);
+			fwrite(b, 1, SIZEOF_LONG, f);
+			ByteUtilities::writeInt(b, rand() % 500);
+			fwrite(b, 1, SIZEOF_INT, f);
+		}
+		maxTime = max(maxTime, t);
+	}
+
+	ByteUtilities::writeLong(b, 0xFFFFFFFFDEADF00D);
+	fwrite(b, 1, SIZEOF_LONG, f);
+	fclose(f);
+	return maxTime;
+}
+
+//Samples every rank over LV_VIEWS views, from the whole trace down to a
+//small part of it, and returns the time taken
+static double sampleViews(const char* path, Time maxTime, vector<vector<TimeCPID> >& lines)
+{
+	FileData location;
+	location.fileTrace = path;
+	SpaceTimeDataController controller(&location);
+	controller.setInfo(0, maxTime, LV_HEADER_SIZE);
+
+	ImageTraceAttributes* attributes = controller.attributes;
+	attributes->begProcess = 0;
+	attributes->endProcess = LV_RANKS;
+	attributes->numPixelsH = 1500;
+	attributes->numPixelsV = LV_RANKS;
+
+	lines.clear();
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int view = 0; view < LV_VIEWS; view++) {
+		Time width = maxTime >> (view / 2);
+		attributes->begTime = (view % 2) * (maxTime - width) / 3;
+		attributes->endTime = attributes->begTime + width;
+
+		controller.fillTraces();
+		for (int i = 0; i < controller.tracesLength; i++)
+			lines.push_back(*controller.traces[i]->data->listCPID);
+	}
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+void levelsTest()
+{
+	char path[] = "/tmp/levelsTestXXXXXX";
+	int fd = mkstemp(path);
+	assert(fd >= 0);
+	close(fd);
+	Time maxTime = writeLevelsDB(path);
+
+	vector<vector<TimeCPID> > raw, leveled;
+	//Once to fault the file in, then once to time it
+	sampleViews(path, maxTime, raw);
+	double rawTime = sampleViews(path, maxTime, raw);
+
+	assert(TraceLevels::build(path));
+	double leveledTime = sampleViews(path, maxTime, leveled);
+
+	assert(raw.size() == leveled.size());
+	for (size_t i = 0; i < raw.size(); i++) {
+		assert(raw[i].size() == leveled[i].size());
+		for (size_t j = 0; j < raw[i].size(); j++) {
+			assert(raw[i][j].timestamp == leveled[i][j].timestamp);
+			assert(raw[i][j].cpid == leveled[i][j].cpid);
+		}
+	}
+
+	cout << "Sampled " << LV_VIEWS << " views of " << LV_RANKS << " ranks in "
+			<< rawTime * 1000 << " ms from the trace and " << leveledTime * 1000
+			<< " ms with its levels." << endl;
+	cout << "Trace level correctness verified." << endl;
+
+	unlink(TraceLevels::getLevelsFile(path).c_str());
+	unlink(path);
+}
@@ -0,0 +1,184 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Checks that filling the timelines on several threads gives the same
+//   lines as filling them on one, and reports how long each takes.
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#undef NDEBUG
+
+#include "../ByteUtilities.hpp"
+#include "../Constants.hpp"
+#include "../FileData.hpp"
+#include "../ProcessTimeline.hpp"
+#include "../SpaceTimeDataController.hpp"
+#include "../TimeCPID.hpp"
+#include "../TraceDataByRank.hpp"
+
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+using namespace TraceviewerServer;
+
+#define TL_RANKS 256
+#define TL_RECORDS_PER_RANK 10000
+#define TL_PIXELS_H 2000
+
+//Writes a merged trace database with TL_RANKS ranks of TL_RECORDS_PER_RANK
+//records each. Ranks get different sampling intervals so that some lines are
+//much denser than others, as in a real run.
+static void writeTimelineDB(const char* path)
+{
+	FILE* f = fopen(path, "wb");
+	assert(f != NULL);
+	char b[SIZEOF_LONG];
+
+	int headerLen = 2 * SIZEOF_INT + TL_RANKS * (2 * SIZEOF_INT + SIZEOF_LONG);
+	ByteUtilities::writeInt(b, MULTI_PROCESSES);
+	fwrite(b, 1, SIZEOF_INT, f);
+	ByteUtilities::writeInt(b, TL_RANKS);
+	fwrite(b, 1, SIZEOF_INT, f);
+	for (int rank = 0; rank < TL_RANKS; rank++) {
+		ByteUtilities::writeInt(b, rank);
+		fwrite(b, 1, SIZEOF_INT, f);
+		ByteUtilities::writeInt(b, 0);
+		fwrite(b, 1, SIZEOF_INT, f);
+		ByteUtilities::writeLong(b, headerLen
+				+ (int64_t) rank * TL_RECORDS_PER_RANK * SIZE_OF_TRACE_RECORD);
+		fwrite(b, 1, SIZEOF_LONG, f);
+	}
+
+	srand(1701);
+	for (int rank = 0; rank < TL_RANKS; rank++) {
+		Time t = 0;
+		for (int rec = 0; rec < TL_RECORDS_PER_RANK; rec++) {
+			t += 1 + rand() % (1 + rank % 7);
+			ByteUtilities::writeLong(b, t);
+			fwrite(b, 1, SIZEOF_LONG, f);
+			ByteUtilities::writeInt(b, rand() % 500);
+			fwrite(b, 1, SIZEOF_INT, f);
+		}
+	}
+
+	//End of file marker
+	ByteUtilities::writeInt(b, 0);
+	fwrite(b, 1, SIZEOF_INT, f);
+	fclose(f);
+}
+
+static double fillAndTime(SpaceTimeDataController& controller, int numThreads,
+		vector<vector<TimeCPID> >& lines)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	controller.fillTraces(numThreads);
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	lines.resize(controller.tracesLength);
+	for (int i = 0; i < controller.tracesLength; i++)
+		lines[controller.traces[i]->line()] = *controller.traces[i]->data->listCPID;
+	return elapsed.count();
+}
+
+void timelineTest()
+{
+	char path[] = "/tmp/timelineTestXXXXXX";
+	int fd = mkstemp(path);
+	assert(fd >= 0);
+	close(fd);
+	writeTimelineDB(path);
+
+	FileData location;
+	location.fileTrace = path;
+	SpaceTimeDataController controller(&location);
+
+	Time maxTime = (Time) TL_RECORDS_PER_RANK * 7;
+	controller.setInfo(0, maxTime, 24);
+	controller.attributes->begTime = 0;
+	controller.attributes->endTime = maxTime;
+	controller.attributes->begProcess = 0;
+	controller.attributes->endProcess = TL_RANKS;
+	controller.attributes->numPixelsH = TL_PIXELS_H;
+	controller.attributes->numPixelsV = TL_RANKS;
+
+	vector<vector<TimeCPID> > serial, parallel;
+	//Touch every page once so that neither run pays for faulting the file in
+	fillAndTime(controller, 1, serial);
+	double serialTime = fillAndTime(controller, 1, serial);
+	double parallelTime = fillAndTime(controller, 0, parallel);
+
+	assert(serial.size() == parallel.size());
+	for (size_t i = 0; i < serial.size(); i++) {
+		assert(serial[i].size() == parallel[i].size());
+		for (size_t j = 0; j < serial[i].size(); j++) {
+			assert(serial[i][j].timestamp == parallel[i][j].timestamp);
+			assert(serial[i][j].cpid == parallel[i][j].cpid);
+		}
+	}
+
+	cout << "Filled " << TL_RANKS << " timelines in " << serialTime * 1000
+			<< " ms on one thread and " << parallelTime * 1000
+			<< " ms on all cores." << endl;
+	cout << "Multithreaded timeline correctness verified." << endl;
+
+	unlink(path);
+}
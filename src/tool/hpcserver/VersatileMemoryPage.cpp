@@ -63,6 +63,7 @@
 #include <cstring>
 #include <list>
 #include <errno.h>
+#include <sched.h>
 
 #include "DebugUtils.hpp"
 #include "VersatileMemoryPage.hpp"
@@ -72,8 +73,11 @@ namespace TraceviewerServer
 {
 	static int MAX_PAGES_TO_ALLOCATE_AT_ONCE = 0;
 
-	VersatileMemoryPage::VersatileMemoryPage(FileOffset _startPoint, int _size, FileDescriptor _file, LRUList<VersatileMemoryPage>* pageManagementList)
+	VersatileMemoryPage::VersatileMemoryPage(FileOffset _startPoint, int _size, FileDescriptor _file, LRUList<VersatileMemoryPage>* pageManagementList,
+			std::atomic<char*>* _published, std::atomic<int>* _pins)
 	{
+		published = _published;
+		pins = _pins;
 		startPoint = _startPoint;
 		size = _size;
 		mostRecentlyUsed = pageManagementList;
@@ -150,6 +154,14 @@ namespace TraceviewerServer
 			cerr << "Trying to double unmap!"<<endl;
 			return;
 		}
+		if (published != NULL)
+		{
+			//Readers pin the page before loading its address, so once the
+			//address is withdrawn no new reader can start using it
+			published->store(NULL);
+			while (pins->load() != 0)
+				sched_yield();
+		}
 		munmap(page, size);
 
 		isMapped = false;
@@ -62,6 +62,7 @@
 
 
 #include <sys/mman.h>
+#include <atomic>
 #include "FileUtils.hpp" //FileOffset
 #include "LRUList.hpp"
 
@@ -73,7 +74,8 @@ namespace TraceviewerServer
 	{
 	public:
 		VersatileMemoryPage();
-		VersatileMemoryPage(FileOffset, int, FileDescriptor, LRUList<VersatileMemoryPage>* pageManagementList);
+		VersatileMemoryPage(FileOffset, int, FileDescriptor, LRUList<VersatileMemoryPage>* pageManagementList,
+				std::atomic<char*>* published = NULL, std::atomic<int>* pins = NULL);
 		virtual ~VersatileMemoryPage();
 		static void setMaxPages(int);
 		char* get();
@@ -90,6 +92,12 @@ namespace TraceviewerServer
 		bool isMapped;
 		LRUList<VersatileMemoryPage>* mostRecentlyUsed;
 
+		//If set, the page's address as published to lock-free readers and
+		//the number of readers currently using it. Unmapping withdraws the
+		//address and then waits for the readers to finish.
+		std::atomic<char*>* published;
+		std::atomic<int>* pins;
+
 		// Use MAP_POPULATE if available
 #ifdef MAP_POPULATE
 		static const int MAP_FLAGS = MAP_SHARED | MAP_POPULATE;
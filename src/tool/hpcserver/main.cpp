@@ -71,9 +71,12 @@ int main(int argc, char *argv[])
 		return 0;
 
 	Args args(argc, argv);
-	TraceviewerServer::useCompression = args.compression;
+	TraceviewerServer::requestedCompression = args.compression;
 	TraceviewerServer::xmlPortNumber = args.xmlPort;
 	TraceviewerServer::mainPortNumber = args.mainPort;
+	TraceviewerServer::numThreads = args.threads;
+	TraceviewerServer::buildTraceLevels = args.levels;
+	TraceviewerServer::cacheBudget = (uint64_t) args.cacheSize << 20;
 
 	try
 	{
@@ -107,7 +107,7 @@ main(int argc, char **argv)
   while ( !feof(infs) ) {
     hpctrace_fmt_datum_t datum;
 
-    ret = hpctrace_fmt_datum_fread(&datum, hdr.flags, infs);
+    ret = hpctrace_fmt_datum_fread(&datum, &hdr, infs);
 
     if (ret == HPCFMT_EOF) {
       break;